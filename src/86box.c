@@ -170,6 +170,7 @@ int      force_43                               = 0;              /* (C) video *
 int      video_filter_method                    = 1;              /* (C) video */
 int      video_vsync                            = 0;              /* (C) video */
 int      video_framerate                        = -1;             /* (C) video */
+int      video_frameskip                        = 0;              /* (C) video */
 char     video_shader[512]                      = { '\0' };       /* (C) video */
 bool     serial_passthrough_enabled[SERIAL_MAX] = { 0, 0, 0, 0, 0, 0, 0 }; /* (C) activation and kind of
                                                                                   pass-through for serial ports */
@@ -200,6 +201,16 @@ int      confirm_save                           = 1;              /* (C) enable
 int      enable_discord                         = 0;              /* (C) enable Discord integration */
 int      pit_mode                               = -1;             /* (C) force setting PIT mode */
 int      fm_driver                              = 0;              /* (C) select FM sound driver */
+int      fm_thread                              = 0;              /* (C) generate FM sound on a worker thread */
+int      sound_latency                          = 0;              /* (C) buffered sound output latency in ms,
+                                                                         0 = off */
+int      sound_sink                             = 0;              /* (C) buffered sound output sink */
+char     sound_wav_path[1024]                   = { '\0' };       /* (C) WAV file for the buffered sound
+                                                                         output */
+int      cdrom_audio_cache                      = 0;              /* (C) keep decoded compressed CD audio
+                                                                         tracks on disk */
+int      cdrom_audio_cache_size                 = 2048;           /* (C) size limit of the CD audio cache
+                                                                         in MB */
 int      open_dir_usr_path                      = 0;              /* (C) default file open dialog directory
                                                                          of usr_path */
 int      video_fullscreen_scale_maximized       = 0;              /* (C) Whether fullscreen scaling settings
@@ -247,6 +258,10 @@ int efscrnsz_y = SCREEN_RES_Y;
 
 static wchar_t mouse_msg[3][200];
 
+static int frames_skipped_total = 0;
+static int frames_skipped_last  = 0;
+static int onesec_paused        = 0; /* paused at some point this second */
+
 static volatile atomic_int do_pause_ack = 0;
 static volatile atomic_int pause_ack = 0;
 
@@ -1463,6 +1478,22 @@ pc_onesec(void)
     fps        = framecount;
     framecount = 0;
 
+    /* pc_run() runs 100 blocks per second at full speed. A second spent
+       partly paused runs fewer, without the host being too slow. */
+    atomic_store(&video_overloaded, !onesec_paused && !dopause && (fps < 95));
+    onesec_paused = dopause;
+
+    /* Report the frame skip rate whenever it changes. */
+    if (video_frameskip) {
+        int skipped = video_frames_skipped() - frames_skipped_total;
+
+        frames_skipped_total += skipped;
+        if (skipped != frames_skipped_last) {
+            pc_log("Video: %d frames skipped in the last second\n", skipped);
+            frames_skipped_last = skipped;
+        }
+    }
+
     title_update = 1;
 }
 
@@ -1627,6 +1658,8 @@ do_pause(int p)
     if ((p == 1) && !old_p)
         do_pause_ack = p;
     dopause = !!p;
+    if (dopause)
+        onesec_paused = 1;
     if ((p == 1) && !old_p) {
         while (!atomic_load(&pause_ack))
             ;
@@ -40,6 +40,8 @@
 #include <86box/86box.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/plat_dir.h>
+#include <86box/thread.h>
 #include <86box/cdrom_image_backend.h>
 
 #include <sndfile.h>
@@ -70,30 +72,642 @@ cdrom_image_backend_log(const char *fmt, ...)
 #    define cdrom_image_backend_log(fmt, ...)
 #endif
 
+/* Compressed audio tracks are decoded in blocks of 15 sectors (0.2 s) by a
+   per-file thread that keeps a ring of PCM ahead of the last read position,
+   so sequential sector reads never touch the decoder. A read outside the
+   ring fetches just the sector asked for and restarts the ring there; the
+   thread carries on from that point. Blocks of compressed tracks can also
+   be kept in a PCM cache file, with a map of the blocks it holds. A miss in
+   a cached block is read from the cache through a handle of its own, and
+   one in any other block is decoded with a second decoder, so neither ever
+   waits for the block the thread is working on. The data of the last
+   AUDIO_SEEK_POINTS misses that had to be decoded is also kept in a small
+   LRU list keyed by exact track offset, so that a game looping a track
+   back to the same place does not decode it again; this is not an index
+   of the file, other positions are decoded as usual.
+
+   Cache files are named cdaudio_<hash>.pcm and live in the global data
+   directory. They can be deleted at any time while no image is mounted;
+   the least recently used ones that are not in use are deleted to keep
+   the total under cdrom_audio_cache_size MB. */
+#define AUDIO_BLOCK_SIZE    (15 * RAW_SECTOR_SIZE)
+#define AUDIO_RING_SIZE     (8 * AUDIO_BLOCK_SIZE)
+#define AUDIO_CACHE_MAGIC   "86BoxCDA"
+#define AUDIO_CACHE_VERSION 1
+#define AUDIO_CACHE_ALIGN   4096
+#define AUDIO_SEEK_POINTS   32
+
+typedef struct audio_cache_hdr_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t src_size;
+    int64_t  src_mtime;
+    uint64_t length;
+} audio_cache_hdr_t;
+
+typedef struct audio_seek_point_t {
+    uint64_t pos;  /* Track offset, (uint64_t) -1 if unused. */
+    uint32_t len;
+    uint32_t used; /* Value of seek_clock when last used. */
+    uint8_t  data[RAW_SECTOR_SIZE];
+} audio_seek_point_t;
+
 typedef struct audio_file_t {
     SNDFILE *file;
     SF_INFO  info;
+    uint64_t length;
+
+    /* Guards the decoder, the cache file and the block buffer. */
+    mutex_t *dec_mutex;
+    uint64_t dec_pos;
+    uint8_t *block;
+
+    /* Guards the seek decoder, the seek handle of the cache file and the
+       list of recent seek points. */
+    mutex_t            *seek_mutex;
+    SNDFILE            *seek_file;
+    int                 seek_failed;
+    uint64_t            seek_pos;
+    FILE               *seek_cache_fp;
+    audio_seek_point_t *seek_points;
+    uint32_t            seek_clock;
+    uint8_t             seek_buf[RAW_SECTOR_SIZE];
+
+    /* Guards the read-ahead ring. */
+    mutex_t *ring_mutex;
+    uint8_t *ring;
+    uint32_t ring_head;  /* Ring index of ring_start. */
+    uint64_t ring_start; /* Track offset of the oldest buffered byte. */
+    uint64_t ring_len;
+    uint32_t ring_gen;   /* Bumped whenever a read restarts the ring. */
+    uint64_t read_pos;   /* Track offset following the last read. */
+
+    thread_t *thread;
+    event_t  *wake;
+    int       stop;
+
+    /* Bits of cache_map are set under ring_mutex, once the block is in the
+       file, so that the seek path can read them without dec_mutex. */
+    FILE    *cache_fp;
+    uint8_t *cache_map;  /* One bit per block present in the cache. */
+    uint32_t blocks;
+    uint64_t cache_data;
+    char    *cache_path;
+
+    struct audio_file_t *cache_next; /* Open cache files, see audio_cache_files. */
 } audio_file_t;
 
+/* Tracks with an open cache file, so that the cache of one image is never
+   deleted or shared by another. Guarded by audio_cache_mutex. */
+static audio_file_t *audio_cache_files;
+static mutex_t      *audio_cache_mutex;
+
+/* Returns whether the cache file name is in use. Must be called with
+   audio_cache_mutex held. */
+static int
+audio_cache_in_use(const char *name)
+{
+    for (const audio_file_t *audio = audio_cache_files; audio != NULL; audio = audio->cache_next) {
+        if (!strcmp(path_get_filename(audio->cache_path), name))
+            return 1;
+    }
+
+    return 0;
+}
+
+static int
+audio_is_compressed(const SF_INFO *info)
+{
+    /* FLAC reports the PCM format it decodes to. */
+    if ((info->format & SF_FORMAT_TYPEMASK) == SF_FORMAT_FLAC)
+        return 1;
+
+    switch (info->format & SF_FORMAT_SUBMASK) {
+        case SF_FORMAT_PCM_S8:
+        case SF_FORMAT_PCM_16:
+        case SF_FORMAT_PCM_24:
+        case SF_FORMAT_PCM_32:
+        case SF_FORMAT_PCM_U8:
+            return 0;
+
+        default:
+            return 1;
+    }
+}
+
+typedef struct audio_cache_entry_t {
+    char     name[64];
+    uint64_t size;
+    time_t   mtime;
+} audio_cache_entry_t;
+
+/* Delete the least recently used cache files in dir, other than keep and
+   those in use, until they and need more bytes fit in cdrom_audio_cache_size.
+   A reused cache has its header rewritten, so its mtime is the time it was
+   last used. Must be called with audio_cache_mutex held. */
+static void
+audio_cache_trim(const char *dir, const char *keep, uint64_t need)
+{
+    audio_cache_entry_t *entries = NULL;
+    struct dirent       *entry;
+    struct stat          stats;
+    char                 path[1024];
+    const uint64_t       limit = (uint64_t) cdrom_audio_cache_size << 20;
+    uint64_t             total = need;
+    int                  num   = 0;
+    int                  max   = 0;
+    DIR                 *dirp  = opendir(dir);
+
+    if (dirp == NULL)
+        return;
+
+    while ((entry = readdir(dirp))) {
+        const size_t len = strlen(entry->d_name);
+
+        if ((len >= sizeof(entries->name)) || strncmp(entry->d_name, "cdaudio_", 8) ||
+            (len < 12) || strcmp(&entry->d_name[len - 4], ".pcm") || !strcmp(entry->d_name, keep))
+            continue;
+
+        path_append_filename(path, dir, entry->d_name);
+        if (stat(path, &stats) != 0)
+            continue;
+
+        if (num == max) {
+            audio_cache_entry_t *grown = (audio_cache_entry_t *) realloc(entries, (max + 16) * sizeof(audio_cache_entry_t));
+
+            if (grown == NULL)
+                break;
+            entries = grown;
+            max += 16;
+        }
+
+        total += (uint64_t) stats.st_size;
+        if (audio_cache_in_use(entry->d_name))
+            continue;
+
+        strcpy(entries[num].name, entry->d_name);
+        entries[num].size  = (uint64_t) stats.st_size;
+        entries[num].mtime = stats.st_mtime;
+        num++;
+    }
+    closedir(dirp);
+
+    while ((total > limit) && (num > 0)) {
+        int oldest = 0;
+
+        for (int i = 1; i < num; i++) {
+            if (entries[i].mtime < entries[oldest].mtime)
+                oldest = i;
+        }
+
+        path_append_filename(path, dir, entries[oldest].name);
+        cdrom_image_backend_log("CD Audio cache: Deleting %s\n", path);
+        plat_remove(path);
+
+        total -= entries[oldest].size;
+        entries[oldest] = entries[--num];
+    }
+
+    free(entries);
+}
+
+static void
+audio_cache_open(track_file_t *tf, audio_file_t *audio)
+{
+    audio_cache_hdr_t hdr;
+    audio_cache_hdr_t file_hdr;
+    struct stat       stats;
+    char              dir[256] = { 0 };
+    char              name[64];
+    char              path[1024];
+    uint64_t          hash     = 0xcbf29ce484222325ull;
+    const uint32_t    map_size = (audio->blocks + 7) >> 3;
+
+    if (stat(tf->fn, &stats) != 0)
+        return;
+
+    for (const char *c = tf->fn; *c; c++)
+        hash = (hash ^ (uint8_t) *c) * 0x100000001b3ull;
+
+    memset(&hdr, 0x00, sizeof(audio_cache_hdr_t));
+    memcpy(hdr.magic, AUDIO_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version    = AUDIO_CACHE_VERSION;
+    hdr.block_size = AUDIO_BLOCK_SIZE;
+    hdr.src_size   = (uint64_t) stats.st_size;
+    hdr.src_mtime  = (int64_t) stats.st_mtime;
+    hdr.length     = audio->length;
+
+    plat_get_global_data_dir(dir, sizeof(dir) - 2);
+    path_slash(dir);
+    snprintf(name, sizeof(name), "cdaudio_%016" PRIx64 ".pcm", hash);
+    path_append_filename(path, dir, name);
+
+    audio->cache_map  = (uint8_t *) calloc(1, map_size);
+    audio->cache_path = strdup(path);
+    audio->cache_data = (sizeof(audio_cache_hdr_t) + map_size + AUDIO_CACHE_ALIGN - 1) & ~(uint64_t) (AUDIO_CACHE_ALIGN - 1);
+    if ((audio->cache_map == NULL) || (audio->cache_path == NULL))
+        return;
+
+    thread_wait_mutex(audio_cache_mutex);
+
+    /* The same file mounted twice only gets a cache the first time. */
+    if (audio_cache_in_use(name)) {
+        cdrom_image_backend_log("CD Audio cache: %s is in use\n", path);
+        thread_release_mutex(audio_cache_mutex);
+        return;
+    }
+
+    audio_cache_trim(dir, name, audio->cache_data + audio->length);
+
+    /* A cache for a different or modified file is simply started over. */
+    audio->cache_fp = plat_fopen64(path, "rb+");
+    if (audio->cache_fp != NULL) {
+        if ((fread(&file_hdr, sizeof(audio_cache_hdr_t), 1, audio->cache_fp) == 1) &&
+            !memcmp(&file_hdr, &hdr, sizeof(audio_cache_hdr_t)) &&
+            (fread(audio->cache_map, 1, map_size, audio->cache_fp) == map_size)) {
+            /* Rewrite the header to mark the file as recently used. */
+            if (fseeko64(audio->cache_fp, 0, SEEK_SET) != -1)
+                fwrite(&hdr, sizeof(audio_cache_hdr_t), 1, audio->cache_fp);
+            cdrom_image_backend_log("CD Audio cache: Reusing %s\n", path);
+        } else {
+            fclose(audio->cache_fp);
+            audio->cache_fp = NULL;
+        }
+    }
+
+    if (audio->cache_fp == NULL) {
+        memset(audio->cache_map, 0x00, map_size);
+        audio->cache_fp = plat_fopen64(path, "wb+");
+        if ((audio->cache_fp != NULL) &&
+            ((fwrite(&hdr, sizeof(audio_cache_hdr_t), 1, audio->cache_fp) != 1) ||
+             (fwrite(audio->cache_map, 1, map_size, audio->cache_fp) != map_size) ||
+             fflush(audio->cache_fp))) {
+            fclose(audio->cache_fp);
+            audio->cache_fp = NULL;
+        }
+
+        cdrom_image_backend_log("CD Audio cache: Creating %s (%s)\n", path, audio->cache_fp ? "ok" : "failed");
+    }
+
+    if (audio->cache_fp != NULL) {
+        audio->cache_next = audio_cache_files;
+        audio_cache_files = audio;
+    }
+
+    thread_release_mutex(audio_cache_mutex);
+}
+
+static void
+audio_cache_close(audio_file_t *audio)
+{
+    thread_wait_mutex(audio_cache_mutex);
+    for (audio_file_t **prev = &audio_cache_files; *prev != NULL; prev = &(*prev)->cache_next) {
+        if (*prev == audio) {
+            *prev = audio->cache_next;
+            break;
+        }
+    }
+    thread_release_mutex(audio_cache_mutex);
+}
+
+static SNDFILE *
+audio_open(const char *filename, SF_INFO *info)
+{
+#ifdef _WIN32
+    wchar_t filename_w[4096];
+
+    mbstowcs(filename_w, filename, 4096);
+    return sf_wchar_open(filename_w, SFM_READ, info);
+#else
+    return sf_open(filename, SFM_READ, info);
+#endif
+}
+
+/* Decode len bytes at track offset pos, seeking the decoder only if it is
+   not already there. *file_pos tracks where the decoder is. */
+static uint32_t
+audio_decode(SNDFILE *file, uint64_t *file_pos, uint64_t pos, uint8_t *buf, uint32_t len)
+{
+    if (*file_pos != pos) {
+        if (sf_seek(file, pos >> 2, SEEK_SET) == -1) {
+            *file_pos = (uint64_t) -1;
+            return 0;
+        }
+        *file_pos = pos;
+    }
+
+    const uint32_t got = (uint32_t) sf_readf_short(file, (short *) buf, len >> 2) << 2;
+    *file_pos += got;
+
+    return got;
+}
+
+/* Fill the block buffer with the len bytes at track offset pos, which must
+   not cross a block boundary, from the cache if it has the block, otherwise
+   from the decoder. Only whole blocks go into the cache. Must be called with
+   dec_mutex held. */
+static uint32_t
+audio_load_range(audio_file_t *audio, uint64_t pos, uint32_t len)
+{
+    const uint32_t b     = (uint32_t) (pos / AUDIO_BLOCK_SIZE);
+    const int      whole = !(pos % AUDIO_BLOCK_SIZE) && (len == MIN(AUDIO_BLOCK_SIZE, audio->length - pos));
+
+    if ((audio->cache_fp != NULL) && (audio->cache_map[b >> 3] & (1 << (b & 7)))) {
+        if ((fseeko64(audio->cache_fp, audio->cache_data + pos, SEEK_SET) != -1) &&
+            (fread(audio->block, 1, len, audio->cache_fp) == len))
+            return len;
+    }
+
+    const uint32_t got = audio_decode(audio->file, &audio->dec_pos, pos, audio->block, len);
+
+    if (whole && (got == len) && (audio->cache_fp != NULL)) {
+        /* The data is flushed before its bit is set, as the seek path
+           reads it through a handle of its own. */
+        int ok = (fseeko64(audio->cache_fp, audio->cache_data + pos, SEEK_SET) != -1) &&
+                 (fwrite(audio->block, 1, len, audio->cache_fp) == len) && !fflush(audio->cache_fp);
+
+        if (ok) {
+            thread_wait_mutex(audio->ring_mutex);
+            audio->cache_map[b >> 3] |= (1 << (b & 7));
+            thread_release_mutex(audio->ring_mutex);
+
+            ok = (fseeko64(audio->cache_fp, sizeof(audio_cache_hdr_t) + (b >> 3), SEEK_SET) != -1) &&
+                 (fwrite(&audio->cache_map[b >> 3], 1, 1, audio->cache_fp) == 1);
+        }
+
+        if (!ok) {
+            /* Stop caching rather than leave a map that lies. */
+            cdrom_image_backend_log("CD Audio cache: Write failed, disabling\n");
+            fclose(audio->cache_fp);
+            audio->cache_fp = NULL;
+        }
+    }
+
+    return got;
+}
+
+/* Append block data at the end of the ring. Must be called with ring_mutex held. */
+static void
+audio_ring_append(audio_file_t *audio, const uint8_t *data, uint32_t len)
+{
+    uint32_t tail = (uint32_t) ((audio->ring_head + audio->ring_len) % AUDIO_RING_SIZE);
+
+    /* Drop the oldest data, the fill policy keeps this behind read_pos. */
+    if ((audio->ring_len + len) > AUDIO_RING_SIZE) {
+        const uint32_t drop = (uint32_t) (audio->ring_len + len - AUDIO_RING_SIZE);
+
+        audio->ring_head = (audio->ring_head + drop) % AUDIO_RING_SIZE;
+        audio->ring_start += drop;
+        audio->ring_len -= drop;
+    }
+
+    while (len > 0) {
+        const uint32_t n = MIN(len, AUDIO_RING_SIZE - tail);
+
+        memcpy(&audio->ring[tail], data, n);
+        tail = (tail + n) % AUDIO_RING_SIZE;
+        audio->ring_len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void
+audio_thread(void *priv)
+{
+    audio_file_t *audio = (audio_file_t *) priv;
+
+    while (1) {
+        uint64_t end;
+        uint32_t gen;
+        uint32_t len = 0;
+
+        thread_wait_mutex(audio->dec_mutex);
+        thread_wait_mutex(audio->ring_mutex);
+        if (audio->stop) {
+            thread_release_mutex(audio->ring_mutex);
+            thread_release_mutex(audio->dec_mutex);
+            break;
+        }
+        end = audio->ring_start + audio->ring_len;
+        gen = audio->ring_gen;
+        const int want = (end < audio->length) && ((end - audio->read_pos + AUDIO_BLOCK_SIZE) <= AUDIO_RING_SIZE);
+        thread_release_mutex(audio->ring_mutex);
+
+        /* After a seek the ring ends mid-block; the rest of that block is
+           loaded first, then whole blocks. */
+        if (want)
+            len = audio_load_range(audio, end, (uint32_t) MIN(AUDIO_BLOCK_SIZE - (end % AUDIO_BLOCK_SIZE), audio->length - end));
+
+        if (len > 0) {
+            /* A read may have moved the ring on while this was decoding, in
+               which case the data is no longer wanted. */
+            thread_wait_mutex(audio->ring_mutex);
+            if ((gen == audio->ring_gen) && (end == (audio->ring_start + audio->ring_len)))
+                audio_ring_append(audio, audio->block, len);
+            thread_release_mutex(audio->ring_mutex);
+        }
+        thread_release_mutex(audio->dec_mutex);
+
+        if (len == 0) {
+            thread_wait_event(audio->wake, -1);
+            thread_reset_event(audio->wake);
+        }
+    }
+}
+
+/* Set up the read-ahead on first use, so that mounting an image with many
+   tracks does not start a decoder for every one of them. */
+static int
+audio_start(track_file_t *tf, audio_file_t *audio)
+{
+    thread_wait_mutex(audio->dec_mutex);
+    if (audio->ring == NULL) {
+        uint8_t *ring = (uint8_t *) malloc(AUDIO_RING_SIZE);
+
+        audio->block       = (uint8_t *) malloc(AUDIO_BLOCK_SIZE);
+        audio->seek_points = (audio_seek_point_t *) calloc(AUDIO_SEEK_POINTS, sizeof(audio_seek_point_t));
+        if ((audio->block != NULL) && (audio->seek_points != NULL) && (ring != NULL)) {
+            for (int i = 0; i < AUDIO_SEEK_POINTS; i++)
+                audio->seek_points[i].pos = (uint64_t) -1;
+
+            if (cdrom_audio_cache && audio_is_compressed(&audio->info))
+                audio_cache_open(tf, audio);
+
+            audio->wake   = thread_create_event();
+            audio->thread = thread_create(audio_thread, audio);
+
+            /* Published last, the thread cannot get to it before dec_mutex
+               is released. */
+            thread_wait_mutex(audio->ring_mutex);
+            audio->ring = ring;
+            thread_release_mutex(audio->ring_mutex);
+        } else {
+            free(audio->block);
+            free(audio->seek_points);
+            free(ring);
+            audio->block       = NULL;
+            audio->seek_points = NULL;
+        }
+    }
+    thread_release_mutex(audio->dec_mutex);
+
+    return (audio->ring != NULL);
+}
+
+/* Find the data at track offset pos for a read outside the ring. A block
+   that is in the cache is read from it, up to the end of the block, with
+   the seek handle of the cache file. Otherwise the data comes from the list
+   of recent seek points if it is there, or one sector is decoded with the
+   seek decoder; both handles are opened on first use, and if the decoder
+   cannot be the main one is used, waiting for the thread. A seek that had
+   to be decoded is added to the list, a read that just runs past the end of
+   the ring is not. Must be called with seek_mutex held. */
+static uint32_t
+audio_seek_sector(track_file_t *tf, audio_file_t *audio, uint64_t pos, int cached, int is_seek, const uint8_t **data)
+{
+    audio_seek_point_t *point = &audio->seek_points[0];
+    uint32_t            len   = (uint32_t) MIN(RAW_SECTOR_SIZE, audio->length - pos);
+    uint32_t            got;
+
+    if (cached) {
+        len = (uint32_t) MIN(len, AUDIO_BLOCK_SIZE - (pos % AUDIO_BLOCK_SIZE));
+
+        if (audio->seek_cache_fp == NULL)
+            audio->seek_cache_fp = plat_fopen64(audio->cache_path, "rb");
+
+        if ((audio->seek_cache_fp != NULL) &&
+            (fseeko64(audio->seek_cache_fp, audio->cache_data + pos, SEEK_SET) != -1) &&
+            (fread(audio->seek_buf, 1, len, audio->seek_cache_fp) == len)) {
+            *data = audio->seek_buf;
+            return len;
+        }
+    }
+
+    audio->seek_clock++;
+    for (int i = 0; i < AUDIO_SEEK_POINTS; i++) {
+        if (audio->seek_points[i].pos == pos) {
+            audio->seek_points[i].used = audio->seek_clock;
+            *data                      = audio->seek_points[i].data;
+            return audio->seek_points[i].len;
+        }
+
+        if (audio->seek_points[i].used < point->used)
+            point = &audio->seek_points[i];
+    }
+
+    if ((audio->seek_file == NULL) && !audio->seek_failed) {
+        SF_INFO info;
+
+        memset(&info, 0x00, sizeof(SF_INFO));
+        audio->seek_file   = audio_open(tf->fn, &info);
+        audio->seek_failed = (audio->seek_file == NULL);
+        audio->seek_pos    = 0;
+    }
+
+    if (audio->seek_file != NULL)
+        got = audio_decode(audio->seek_file, &audio->seek_pos, pos, audio->seek_buf, len);
+    else {
+        thread_wait_mutex(audio->dec_mutex);
+        got = audio_decode(audio->file, &audio->dec_pos, pos, audio->seek_buf, len);
+        thread_release_mutex(audio->dec_mutex);
+    }
+
+    if (is_seek && (got > 0)) {
+        memcpy(point->data, audio->seek_buf, got);
+        point->pos  = pos;
+        point->len  = got;
+        point->used = audio->seek_clock;
+    }
+
+    *data = audio->seek_buf;
+    return got;
+}
+
 /* Audio file functions */
 static int
 audio_read(void *priv, uint8_t *buffer, uint64_t seek, size_t count)
 {
-    track_file_t *tf            = (track_file_t *) priv;
-    audio_file_t *audio         = (audio_file_t *) tf->priv;
-    uint64_t      samples_seek  = seek / 4;
-    uint64_t      samples_count = count / 4;
+    track_file_t *tf    = (track_file_t *) priv;
+    audio_file_t *audio = (audio_file_t *) tf->priv;
+    int           hit;
 
     if ((seek & 3) || (count & 3)) {
         cdrom_image_backend_log("CD Audio file: Reading on non-4-aligned boundaries.\n");
     }
 
-    sf_count_t res = sf_seek(audio->file, samples_seek, SEEK_SET);
+    thread_wait_mutex(audio->ring_mutex);
+    hit = (audio->ring != NULL);
+    thread_release_mutex(audio->ring_mutex);
 
-    if (res == -1)
+    if (!hit && !audio_start(tf, audio))
         return 0;
 
-    return !!sf_readf_short(audio->file, (short *) buffer, samples_count);
+    while (count > 0) {
+        if (seek >= audio->length) {
+            /* Past the end of the file, the rest of the track is silence. */
+            memset(buffer, 0x00, count);
+            break;
+        }
+
+        thread_wait_mutex(audio->ring_mutex);
+        hit = (seek >= audio->ring_start) && (seek < (audio->ring_start + audio->ring_len));
+        if (!hit) {
+            const uint64_t pos    = seek & ~3ULL;
+            const uint32_t b      = (uint32_t) (pos / AUDIO_BLOCK_SIZE);
+            const int      at_end = (audio->ring_len > 0) && (pos == (audio->ring_start + audio->ring_len));
+            const int      cached = (audio->cache_map != NULL) && (audio->cache_map[b >> 3] & (1 << (b & 7)));
+            const uint8_t *data;
+
+            thread_release_mutex(audio->ring_mutex);
+
+            /* Miss: fetch just the sector asked for, without waiting for
+               the thread, then let the thread carry on from there. */
+            thread_wait_mutex(audio->seek_mutex);
+            const uint32_t len = audio_seek_sector(tf, audio, pos, cached, !at_end, &data);
+
+            /* The thread may have appended the data meanwhile, so check
+               again. A read just past the ring extends it, anything else
+               restarts it, dropping whatever the thread is decoding. */
+            thread_wait_mutex(audio->ring_mutex);
+            if ((seek < audio->ring_start) || (seek >= (audio->ring_start + audio->ring_len))) {
+                if (seek >= (pos + len)) {
+                    cdrom_image_backend_log("CD Audio file: Decode failed at %" PRIu64 "\n", seek);
+                    thread_release_mutex(audio->ring_mutex);
+                    thread_release_mutex(audio->seek_mutex);
+                    return 0;
+                }
+
+                if ((audio->ring_len == 0) || (pos != (audio->ring_start + audio->ring_len))) {
+                    audio->ring_gen++;
+                    audio->ring_head  = 0;
+                    audio->ring_start = pos;
+                    audio->ring_len   = 0;
+                }
+                audio_ring_append(audio, data, len);
+            }
+            thread_release_mutex(audio->seek_mutex);
+        }
+
+        const uint64_t offset = seek - audio->ring_start;
+        const uint32_t n      = (uint32_t) MIN(count, audio->ring_len - offset);
+        const uint32_t index  = (uint32_t) ((audio->ring_head + offset) % AUDIO_RING_SIZE);
+        const uint32_t first  = MIN(n, AUDIO_RING_SIZE - index);
+
+        memcpy(buffer, &audio->ring[index], first);
+        memcpy(buffer + first, audio->ring, n - first);
+        audio->read_pos = seek + n;
+        thread_release_mutex(audio->ring_mutex);
+
+        buffer += n;
+        seek += n;
+        count -= n;
+    }
+
+    thread_set_event(audio->wake);
+
+    return 1;
 }
 
 static uint64_t
@@ -103,7 +717,7 @@ audio_get_length(void *priv)
     audio_file_t *audio = (audio_file_t *) tf->priv;
 
     /* Assume 16-bit audio, 2 channel. */
-    return audio->info.frames * 4ull;
+    return audio->length;
 }
 
 static void
@@ -113,8 +727,38 @@ audio_close(void *priv)
     audio_file_t *audio = (audio_file_t *) tf->priv;
 
     memset(tf->fn, 0x00, sizeof(tf->fn));
-    if (audio && audio->file)
-        sf_close(audio->file);
+    if (audio) {
+        if (audio->thread) {
+            thread_wait_mutex(audio->ring_mutex);
+            audio->stop = 1;
+            thread_release_mutex(audio->ring_mutex);
+            thread_set_event(audio->wake);
+            thread_wait(audio->thread);
+        }
+        if (audio->wake)
+            thread_destroy_event(audio->wake);
+        if (audio->cache_path)
+            audio_cache_close(audio);
+        if (audio->cache_fp)
+            fclose(audio->cache_fp);
+        if (audio->seek_cache_fp)
+            fclose(audio->seek_cache_fp);
+        if (audio->seek_file)
+            sf_close(audio->seek_file);
+        free(audio->cache_map);
+        free(audio->cache_path);
+        free(audio->seek_points);
+        free(audio->ring);
+        free(audio->block);
+        if (audio->ring_mutex)
+            thread_close_mutex(audio->ring_mutex);
+        if (audio->seek_mutex)
+            thread_close_mutex(audio->seek_mutex);
+        if (audio->dec_mutex)
+            thread_close_mutex(audio->dec_mutex);
+        if (audio->file)
+            sf_close(audio->file);
+    }
     free(audio);
     free(tf);
 }
@@ -124,9 +768,6 @@ audio_init(const char *filename, int *error)
 {
     track_file_t *tf    = (track_file_t *) calloc(sizeof(track_file_t), 1);
     audio_file_t *audio = (audio_file_t *) calloc(sizeof(audio_file_t), 1);
-#ifdef _WIN32
-    wchar_t filename_w[4096];
-#endif
 
     if (tf == NULL || audio == NULL) {
         goto cleanup_error;
@@ -134,12 +775,7 @@ audio_init(const char *filename, int *error)
 
     memset(tf->fn, 0x00, sizeof(tf->fn));
     strncpy(tf->fn, filename, sizeof(tf->fn) - 1);
-#ifdef _WIN32
-    mbstowcs(filename_w, filename, 4096);
-    audio->file = sf_wchar_open(filename_w, SFM_READ, &audio->info);
-#else
-    audio->file = sf_open(filename, SFM_READ, &audio->info);
-#endif
+    audio->file = audio_open(filename, &audio->info);
 
     if (!audio->file) {
         cdrom_image_backend_log("Audio file open error!");
@@ -152,6 +788,16 @@ audio_init(const char *filename, int *error)
         goto cleanup_error;
     }
 
+    audio->length     = audio->info.frames * 4ull;
+    audio->blocks     = (uint32_t) ((audio->length + AUDIO_BLOCK_SIZE - 1) / AUDIO_BLOCK_SIZE);
+    audio->dec_mutex  = thread_create_mutex();
+    audio->seek_mutex = thread_create_mutex();
+    audio->ring_mutex = thread_create_mutex();
+
+    /* Images are mounted one at a time, so this cannot race. */
+    if (audio_cache_mutex == NULL)
+        audio_cache_mutex = thread_create_mutex();
+
     *error         = 0;
     tf->priv       = audio;
     tf->fp         = NULL;
@@ -197,6 +197,7 @@ load_general(void)
 
     video_framerate = ini_section_get_int(cat, "video_gl_framerate", -1);
     video_vsync     = ini_section_get_int(cat, "video_gl_vsync", 0);
+    video_frameskip = !!ini_section_get_int(cat, "video_frameskip", 0);
     strncpy(video_shader, ini_section_get_string(cat, "video_gl_shader", ""), sizeof(video_shader) - 1);
 
     window_remember = ini_section_get_int(cat, "window_remember", 0);
@@ -634,6 +635,21 @@ load_sound(void)
     } else {
         fm_driver = FM_DRV_NUKED;
     }
+
+    fm_thread = !!ini_section_get_int(cat, "fm_thread", 0);
+
+    sound_latency = ini_section_get_int(cat, "sound_latency", 0);
+
+    p = ini_section_get_string(cat, "sound_sink", "device");
+    if (!strcmp(p, "wav"))
+        sound_sink = SOUND_SINK_WAV;
+    else if (!strcmp(p, "null"))
+        sound_sink = SOUND_SINK_NULL;
+    else
+        sound_sink = SOUND_SINK_DEVICE;
+
+    p = ini_section_get_string(cat, "sound_wav_path", "");
+    strncpy(sound_wav_path, p, sizeof(sound_wav_path) - 1);
 }
 
 /* Load "Network" section. */
@@ -1268,6 +1284,11 @@ load_floppy_and_cdrom_drives(void)
         }
     }
 
+    cdrom_audio_cache      = !!ini_section_get_int(cat, "cdrom_audio_cache", 0);
+    cdrom_audio_cache_size = ini_section_get_int(cat, "cdrom_audio_cache_size", 2048);
+    if (cdrom_audio_cache_size < 1)
+        cdrom_audio_cache_size = 1;
+
     memset(temp, 0x00, sizeof(temp));
     for (c = 0; c < CDROM_NUM; c++) {
         sprintf(temp, "cdrom_%02i_host_drive", c + 1);
@@ -1805,7 +1826,7 @@ config_load(void)
         config_log("Config loaded.\n\n");
     }
 
-    video_copy = (video_grayscale || invert_display) ? video_transform_copy : memcpy;
+    video_color_transform_update();
 }
 
 /* Save "General" section. */
@@ -1969,6 +1990,10 @@ save_general(void)
         ini_section_set_int(cat, "video_gl_vsync", video_vsync);
     else
         ini_section_delete_var(cat, "video_gl_vsync");
+    if (video_frameskip != 0)
+        ini_section_set_int(cat, "video_frameskip", video_frameskip);
+    else
+        ini_section_delete_var(cat, "video_frameskip");
     if (strlen(video_shader) > 0)
         ini_section_set_string(cat, "video_gl_shader", video_shader);
     else
@@ -2271,6 +2296,28 @@ save_sound(void)
     else
         ini_section_set_string(cat, "fm_driver", "ymfm");
 
+    if (fm_thread)
+        ini_section_set_int(cat, "fm_thread", fm_thread);
+    else
+        ini_section_delete_var(cat, "fm_thread");
+
+    if (sound_latency)
+        ini_section_set_int(cat, "sound_latency", sound_latency);
+    else
+        ini_section_delete_var(cat, "sound_latency");
+
+    if (sound_sink == SOUND_SINK_WAV)
+        ini_section_set_string(cat, "sound_sink", "wav");
+    else if (sound_sink == SOUND_SINK_NULL)
+        ini_section_set_string(cat, "sound_sink", "null");
+    else
+        ini_section_delete_var(cat, "sound_sink");
+
+    if (sound_wav_path[0] != '\0')
+        ini_section_set_string(cat, "sound_wav_path", sound_wav_path);
+    else
+        ini_section_delete_var(cat, "sound_wav_path");
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -2803,6 +2850,16 @@ save_floppy_and_cdrom_drives(void)
         }
     }
 
+    if (cdrom_audio_cache)
+        ini_section_set_int(cat, "cdrom_audio_cache", cdrom_audio_cache);
+    else
+        ini_section_delete_var(cat, "cdrom_audio_cache");
+
+    if (cdrom_audio_cache_size != 2048)
+        ini_section_set_int(cat, "cdrom_audio_cache_size", cdrom_audio_cache_size);
+    else
+        ini_section_delete_var(cat, "cdrom_audio_cache_size");
+
     ini_delete_section_if_empty(config, cat);
 }
 
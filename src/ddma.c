@@ -61,22 +61,27 @@ ddma_reg_read(uint16_t addr, void *priv)
     uint8_t               ret  = 0xff;
     int                   ch   = dev->channel;
     uint8_t               dmab = (ch >= 4) ? 0xc0 : 0x00;
+    uint32_t              ac;
+    int                   cc;
+
+    /* Hide transfers a device has read ahead, as the 8237 ports do. */
+    dma_ahead_pos(&dma[ch], &ac, &cc);
 
     switch (addr & 0x0f) {
         case 0x00:
-            ret = dma[ch].ac & 0xff;
+            ret = ac & 0xff;
             break;
         case 0x01:
-            ret = (dma[ch].ac >> 8) & 0xff;
+            ret = (ac >> 8) & 0xff;
             break;
         case 0x02:
             ret = dma[ch].page;
             break;
         case 0x04:
-            ret = dma[ch].cc & 0xff;
+            ret = cc & 0xff;
             break;
         case 0x05:
-            ret = (dma[ch].cc >> 8) & 0xff;
+            ret = (cc >> 8) & 0xff;
             break;
         case 0x09:
             ret = inb(dmab + 0x08);
@@ -97,6 +102,10 @@ ddma_reg_write(uint16_t addr, uint8_t val, void *priv)
     uint8_t               page_regs[4] = { 7, 3, 1, 2 };
     uint8_t               dmab = (ch >= 4) ? 0xc0 : 0x00;
 
+    /* Give back any transfers read ahead, so that the write acts on the
+       state the guest sees. */
+    dma_ahead_return(&dma[ch]);
+
     switch (addr & 0x0f) {
         case 0x00:
             dma[ch].ab = (dma[ch].ab & 0xffff00) | val;
@@ -110,6 +110,42 @@ dma_transfer_size(dma_t *dev)
     return dev->transfer_mode & 0xff;
 }
 
+/* Transfers read ahead by dma_channel_read_ahead() but not yet retired by
+   the device are hidden from the guest: the address and count registers
+   read back as if they had not happened yet. */
+void
+dma_ahead_pos(const dma_t *dma_c, uint32_t *ac, int *cc)
+{
+    int      as   = dma_advanced ? (dma_c->transfer_mode >> 8) : (dma_c->size ? 2 : 1);
+    uint32_t wrap = (as == 2) ? 0x1ffff : 0xffff;
+
+    if (dma_c->ahead) {
+        *ac = ((dma_c->ac & ~wrap) & dma_mask) | ((dma_c->ac - (dma_c->ahead * as)) & wrap);
+        *cc = dma_c->cc + dma_c->ahead;
+    } else {
+        *ac = dma_c->ac;
+        *cc = dma_c->cc;
+    }
+}
+
+/* Hands the transfers a device has read ahead back to the controller, so
+   that a register write acts on the state the guest expects. */
+void
+dma_ahead_return(dma_t *dma_c)
+{
+    if (dma_c->ahead) {
+        dma_ahead_pos(dma_c, &dma_c->ac, &dma_c->cc);
+        dma_c->ahead = 0;
+    }
+}
+
+void
+dma_ahead_return_all(void)
+{
+    for (int c = 0; c < 8; c++)
+        dma_ahead_return(&dma[c]);
+}
+
 static void
 dma_sg_next_addr(dma_t *dev)
 {
@@ -186,6 +222,8 @@ dma_sg_write(uint16_t port, uint8_t val, void *priv)
 
     dma_log("DMA S/G BYTE  write: %04X       %02X\n", port, val);
 
+    dma_ahead_return(dev);
+
     port &= 0xff;
 
     if (port < 0x20)
@@ -243,6 +281,8 @@ dma_sg_writew(uint16_t port, uint16_t val, void *priv)
 
     dma_log("DMA S/G WORD  write: %04X     %04X\n", port, val);
 
+    dma_ahead_return(dev);
+
     port &= 0xff;
 
     if (port < 0x20)
@@ -276,6 +316,8 @@ dma_sg_writel(uint16_t port, uint32_t val, void *priv)
 
     dma_log("DMA S/G DWORD write: %04X %08X\n", port, val);
 
+    dma_ahead_return(dev);
+
     port &= 0xff;
 
     if (port < 0x20)
@@ -419,6 +461,8 @@ dma_ext_mode_write(uint16_t addr, uint8_t val, UNUSED(void *priv))
     if (addr == 0x4d6)
         channel |= 4;
 
+    dma_ahead_return_all();
+
     dma[channel].ext_mode = val & 0x7c;
 
     switch ((val > 2) & 0x03) {
@@ -458,9 +502,10 @@ dma_sg_int_status_read(UNUSED(uint16_t addr), UNUSED(void *priv))
 static uint8_t
 dma_read(uint16_t addr, UNUSED(void *priv))
 {
-    int     channel = (addr >> 1) & 3;
-    int     count;
-    uint8_t ret = (dmaregs[0][addr & 0xf]);
+    int      channel = (addr >> 1) & 3;
+    int      count;
+    uint32_t ac;
+    uint8_t  ret = (dmaregs[0][addr & 0xf]);
 
     switch (addr & 0xf) {
         case 0:
@@ -468,10 +513,11 @@ dma_read(uint16_t addr, UNUSED(void *priv))
         case 4:
         case 6: /*Address registers*/
             dma_wp[0] ^= 1;
+            dma_ahead_pos(&dma[channel], &ac, &count);
             if (dma_wp[0])
-                ret = (dma[channel].ac & 0xff);
+                ret = (ac & 0xff);
             else
-                ret = ((dma[channel].ac >> 8) & 0xff);
+                ret = ((ac >> 8) & 0xff);
             break;
 
         case 1:
@@ -479,7 +525,7 @@ dma_read(uint16_t addr, UNUSED(void *priv))
         case 5:
         case 7: /*Count registers*/
             dma_wp[0] ^= 1;
-            count = dma[channel].cc/* + 1*/;
+            dma_ahead_pos(&dma[channel], &ac, &count);
             if (dma_wp[0])
                 ret = count & 0xff;
             else
@@ -514,6 +560,8 @@ dma_write(uint16_t addr, uint8_t val, UNUSED(void *priv))
     dma_log("DMA: [W] %04X = %02X\n", addr, val);
 
     dmaregs[0][addr & 0xf] = val;
+
+    dma_ahead_return_all();
     switch (addr & 0xf) {
         case 0:
         case 2:
@@ -682,6 +730,8 @@ dma_ps2_write(uint16_t addr, uint8_t val, UNUSED(void *priv))
     dma_t  *dma_c = &dma[dma_ps2.xfr_channel];
     uint8_t mode;
 
+    dma_ahead_return_all();
+
     switch (addr) {
         case 0x18:
             dma_ps2.xfr_channel = val & 0x7;
@@ -784,8 +834,9 @@ dma16_read(uint16_t addr, UNUSED(void *priv))
 #ifdef ENABLE_DMA_LOG
     uint16_t port = addr;
 #endif
-    uint8_t ret;
-    int count;
+    uint8_t  ret;
+    int      count;
+    uint32_t ac;
 
     addr >>= 1;
 
@@ -797,15 +848,16 @@ dma16_read(uint16_t addr, UNUSED(void *priv))
         case 4:
         case 6: /*Address registers*/
             dma_wp[1] ^= 1;
+            dma_ahead_pos(&dma[channel], &ac, &count);
             if (dma_ps2.is_ps2) {
                 if (dma_wp[1])
-                    ret = (dma[channel].ac);
+                    ret = ac;
                 else
-                    ret = ((dma[channel].ac >> 8) & 0xff);
+                    ret = ((ac >> 8) & 0xff);
             } else if (dma_wp[1])
-                ret = ((dma[channel].ac >> 1) & 0xff);
+                ret = ((ac >> 1) & 0xff);
             else
-                ret = ((dma[channel].ac >> 9) & 0xff);
+                ret = ((ac >> 9) & 0xff);
             break;
 
         case 1:
@@ -813,7 +865,7 @@ dma16_read(uint16_t addr, UNUSED(void *priv))
         case 5:
         case 7: /*Count registers*/
             dma_wp[1] ^= 1;
-            count = dma[channel].cc/* + 1*/;
+            dma_ahead_pos(&dma[channel], &ac, &count);
             if (dma_wp[1])
                 ret = count & 0xff;
             else
@@ -842,6 +894,8 @@ dma16_write(uint16_t addr, uint8_t val, UNUSED(void *priv))
 
     dma_log("dma16_write(%08X, %02X)\n", addr, val);
 
+    dma_ahead_return_all();
+
     addr >>= 1;
 
     dmaregs[1][addr & 0xf] = val;
@@ -954,6 +1008,8 @@ dma_page_write(uint16_t addr, uint8_t val, UNUSED(void *priv))
     addr &= 0x0f;
     dmaregs[2][addr] = val;
 
+    dma_ahead_return_all();
+
     if (addr >= 8)
         addr = convert[addr & 0x07] | 4;
     else
@@ -1656,6 +1712,65 @@ dma_channel_read(int channel)
     return temp;
 }
 
+/* Reads up to max transfers of a memory read channel into buf for a device
+   that paces its own playback, without letting the guest see them until the
+   device retires them. The transfer that reaches the terminal count is
+   always left to dma_channel_read(), so TC and auto-init happen on time. */
+int
+dma_channel_read_ahead(int channel, uint8_t *buf, int max)
+{
+    dma_t   *dma_c = &dma[channel];
+    int      as    = dma_c->size ? 2 : 1;
+    uint32_t wrap  = dma_c->size ? 0x1ffff : 0xffff;
+    int      n;
+
+    if (!dma_channel_readable(channel) || dma_ps2.is_ps2 || (!dma_at && !channel) ||
+        (dma_c->mode & 0x20) || (dma_stat_adv_pend & (1 << channel)))
+        return 0;
+
+    if (dma_advanced && ((dma_c->sg_status & 1) || ((dma_c->transfer_mode >> 8) != as)))
+        return 0;
+
+    n = MIN(max, dma_c->cc);
+
+    for (int i = 0; i < n;) {
+        int run = ((wrap + 1) - (dma_c->ac & wrap)) / as;
+
+        if (run > (n - i))
+            run = n - i;
+
+        dma_bm_read(dma_c->ac, &(buf[i * as]), run * as, dma_advanced ? dma_transfer_size(dma_c) : as);
+        dma_c->ac = ((dma_c->ac & ~wrap) & dma_mask) | ((dma_c->ac + (run * as)) & wrap);
+        i += run;
+    }
+
+    if (n > 0) {
+        dma_c->cc -= n;
+        dma_c->ahead += n;
+        dma_stat_rq |= (1 << channel);
+    } else
+        n = 0;
+
+    return n;
+}
+
+/* Makes transfers read ahead by dma_channel_read_ahead() visible. */
+void
+dma_channel_retire(int channel, int count)
+{
+    dma_t *dma_c = &dma[channel];
+
+    dma_c->ahead = MAX(dma_c->ahead - count, 0);
+}
+
+/* Gives back the transfers read ahead but not retired, for when the device
+   stops before playing them. */
+void
+dma_channel_unread(int channel)
+{
+    dma_ahead_return(&dma[channel]);
+}
+
 int
 dma_channel_write(int channel, uint16_t val)
 {
@@ -1840,6 +1955,20 @@ dma_mode(int channel)
 }
 
 /* DMA Bus Master Page Read/Write */
+
+/* Returns how many bytes of a bus master transfer, in whole transfers, can
+   be copied before the granule containing addr ends. */
+static uint32_t
+dma_bm_chunk(uint32_t addr, uint32_t len, int TransferSize)
+{
+    uint32_t chunk = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+
+    if (chunk > len)
+        chunk = len;
+
+    return chunk & ~(TransferSize - 1);
+}
+
 void
 dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int TransferSize)
 {
@@ -1850,10 +1979,19 @@ dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int Tra
     n  = TotalSize & ~(TransferSize - 1);
     n2 = TotalSize - n;
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
+    /* Do the divisible block, if there is one. Runs of RAM are copied a
+       granule at a time, anything else goes one transfer at a time. */
+    for (uint32_t i = 0; i < n;) {
+        const uint8_t *p     = mem_get_phys_ptr(PhysAddress + i, 0);
+        uint32_t       chunk = dma_bm_chunk(PhysAddress + i, n - i, TransferSize);
+
+        if (p && chunk) {
+            memcpy(&(DataRead[i]), p, chunk);
+            i += chunk;
+        } else {
             mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
+            i += TransferSize;
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
@@ -1874,9 +2012,17 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
     n2 = TotalSize - n;
 
     /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
+    for (uint32_t i = 0; i < n;) {
+        uint8_t *p     = mem_get_phys_ptr(PhysAddress + i, 1);
+        uint32_t chunk = dma_bm_chunk(PhysAddress + i, n - i, TransferSize);
+
+        if (p && chunk) {
+            memcpy(p, &(DataWrite[i]), chunk);
+            i += chunk;
+        } else {
             mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
+            i += TransferSize;
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
@@ -125,6 +125,7 @@ extern int      force_43;                   /* (C) video */
 extern int      video_filter_method;        /* (C) video */
 extern int      video_vsync;                /* (C) video */
 extern int      video_framerate;            /* (C) video */
+extern int      video_frameskip;            /* (C) video */
 extern int      gfxcard[GFXCARD_MAX];       /* (C) graphics/video card */
 extern char     video_shader[512];          /* (C) video */
 extern int      bugger_enabled;             /* (C) enable ISAbugger */
@@ -165,6 +166,12 @@ extern _Atomic double mouse_y_error;        /* Mouse error accumulator - Y */
 #endif
 extern int    pit_mode;                     /* (C) force setting PIT mode */
 extern int    fm_driver;                    /* (C) select FM sound driver */
+extern int    fm_thread;                    /* (C) generate FM sound on a worker thread */
+extern int    sound_latency;                /* (C) buffered sound output latency in ms, 0 = off */
+extern int    sound_sink;                   /* (C) buffered sound output sink */
+extern char   sound_wav_path[1024];         /* (C) WAV file for the buffered sound output */
+extern int    cdrom_audio_cache;            /* (C) keep decoded compressed CD audio tracks on disk */
+extern int    cdrom_audio_cache_size;       /* (C) size limit of the CD audio cache in MB */
 
 /* Keyboard variables for future key combination redefinition. */
 extern uint16_t key_prefix_1_1;
@@ -74,6 +74,7 @@ typedef struct dma_t {
     int      size;
     int      count;
     int      eot;
+    int      ahead;
 } dma_t;
 
 extern dma_t   dma[8];
@@ -101,6 +102,14 @@ extern int dma_channel_advance(int channel);
 extern int dma_channel_read(int channel);
 extern int dma_channel_write(int channel, uint16_t val);
 
+extern int  dma_channel_read_ahead(int channel, uint8_t *buf, int max);
+extern void dma_channel_retire(int channel, int count);
+extern void dma_channel_unread(int channel);
+
+extern void dma_ahead_pos(const dma_t *dma_c, uint32_t *ac, int *cc);
+extern void dma_ahead_return(dma_t *dma_c);
+extern void dma_ahead_return_all(void);
+
 extern void dma_alias_set(void);
 extern void dma_alias_set_piix(void);
 extern void dma_alias_remove(void);
@@ -1,6 +1,14 @@
 #ifndef EMU_FILTERS_H
 #define EMU_FILTERS_H
 
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    define FILTERS_SSE2
+#    include <emmintrin.h>
+#elif defined __aarch64__ || defined _M_ARM64
+#    define FILTERS_NEON
+#    include <arm_neon.h>
+#endif
+
 #define NCoef 2
 
 /* fc=150Hz */
@@ -181,21 +189,24 @@ dac_iir(int i, float NewSample)
 #undef NCoef
 #define NCoef 2
 
+static const double low_iir_acoef[NCoef + 1] = {
+    0.00049713569693400649,
+    0.00099427139386801299,
+    0.00049713569693400649
+};
+
+static const double low_iir_bcoef[NCoef + 1] = {
+    1.00000000000000000000,
+    -1.93522955470669530000,
+    0.93726236021404663000
+};
+
 /* fc=350Hz */
 static inline double
 low_iir(int c, int i, double NewSample)
 {
-    double ACoef[NCoef + 1] = {
-        0.00049713569693400649,
-        0.00099427139386801299,
-        0.00049713569693400649
-    };
-
-    double BCoef[NCoef + 1] = {
-        1.00000000000000000000,
-        -1.93522955470669530000,
-        0.93726236021404663000
-    };
+    const double *ACoef = low_iir_acoef;
+    const double *BCoef = low_iir_bcoef;
 
     static double y[5][2][NCoef + 1]; /* output samples */
     static double x[5][2][NCoef + 1]; /* input samples */
@@ -216,21 +227,24 @@ low_iir(int c, int i, double NewSample)
     return y[c][i][0];
 }
 
+static const double low_cut_iir_acoef[NCoef + 1] = {
+    0.96839970114733542000,
+    -1.93679940229467080000,
+    0.96839970114733542000
+};
+
+static const double low_cut_iir_bcoef[NCoef + 1] = {
+    1.00000000000000000000,
+    -1.93522955471202770000,
+    0.93726236021916731000
+};
+
 /* fc=350Hz */
 static inline double
 low_cut_iir(int c, int i, double NewSample)
 {
-    double ACoef[NCoef + 1] = {
-        0.96839970114733542000,
-        -1.93679940229467080000,
-        0.96839970114733542000
-    };
-
-    double BCoef[NCoef + 1] = {
-        1.00000000000000000000,
-        -1.93522955471202770000,
-        0.93726236021916731000
-    };
+    const double *ACoef = low_cut_iir_acoef;
+    const double *BCoef = low_cut_iir_bcoef;
 
     static double y[5][2][NCoef + 1]; /* output samples */
     static double x[5][2][NCoef + 1]; /* input samples */
@@ -251,21 +265,25 @@ low_cut_iir(int c, int i, double NewSample)
     return y[c][i][0];
 }
 
+static const double high_iir_acoef[NCoef + 1] = {
+    0.72248704753064896000,
+    -1.44497409506129790000,
+    0.72248704753064896000
+};
+
+static const double high_iir_bcoef[NCoef + 1] = {
+    1.00000000000000000000,
+    -1.36640781670578510000,
+    0.52352474706139873000
+};
+
 /* fc=3.5kHz */
 static inline double
 high_iir(int c, int i, double NewSample)
 {
-    double ACoef[NCoef + 1] = {
-        0.72248704753064896000,
-        -1.44497409506129790000,
-        0.72248704753064896000
-    };
+    const double *ACoef = high_iir_acoef;
+    const double *BCoef = high_iir_bcoef;
 
-    double BCoef[NCoef + 1] = {
-        1.00000000000000000000,
-        -1.36640781670578510000,
-        0.52352474706139873000
-    };
     static double y[5][2][NCoef + 1]; /* output samples */
     static double x[5][2][NCoef + 1]; /* input samples */
     int           n;
@@ -285,21 +303,25 @@ high_iir(int c, int i, double NewSample)
     return y[c][i][0];
 }
 
+static const double high_cut_iir_acoef[NCoef + 1] = {
+    0.03927726802250377400,
+    0.07855453604500754700,
+    0.03927726802250377400
+};
+
+static const double high_cut_iir_bcoef[NCoef + 1] = {
+    1.00000000000000000000,
+    -1.36640781666419950000,
+    0.52352474703279628000
+};
+
 /* fc=3.5kHz */
 static inline double
 high_cut_iir(int c, int i, double NewSample)
 {
-    double ACoef[NCoef + 1] = {
-        0.03927726802250377400,
-        0.07855453604500754700,
-        0.03927726802250377400
-    };
+    const double *ACoef = high_cut_iir_acoef;
+    const double *BCoef = high_cut_iir_bcoef;
 
-    double BCoef[NCoef + 1] = {
-        1.00000000000000000000,
-        -1.36640781666419950000,
-        0.52352474703279628000
-    };
     static double y[5][2][NCoef + 1]; /* output samples */
     static double x[5][2][NCoef + 1]; /* input samples */
     int           n;
@@ -356,21 +378,24 @@ deemph_iir(int i, double NewSample)
 #undef NCoef
 #define NCoef 2
 
+static const double sb_iir_acoef[NCoef + 1] = {
+    0.03356837051492005100,
+    0.06713674102984010200,
+    0.03356837051492005100
+};
+
+static const double sb_iir_bcoef[NCoef + 1] = {
+    1.00000000000000000000,
+    -1.41898265221812010000,
+    0.55326988968868285000
+};
+
 /* fc=3.2kHz */
 static inline double
 sb_iir(int c, int i, double NewSample)
 {
-    double ACoef[NCoef + 1] = {
-        0.03356837051492005100,
-        0.06713674102984010200,
-        0.03356837051492005100
-    };
-
-    double BCoef[NCoef + 1] = {
-        1.00000000000000000000,
-        -1.41898265221812010000,
-        0.55326988968868285000
-    };
+    const double *ACoef = sb_iir_acoef;
+    const double *BCoef = sb_iir_bcoef;
 
     static double y[5][2][NCoef + 1]; /* output samples */
     static double x[5][2][NCoef + 1]; /* input samples */
@@ -391,10 +416,179 @@ sb_iir(int c, int i, double NewSample)
     return y[c][i][0];
 }
 
+/* Stereo versions of the filters above, for callers that filter both channels
+   with the same filter. Both channels are run through one double precision
+   biquad side by side; each channel goes through exactly the operations of
+   the single channel version, so the output is identical. The state is
+   separate from that of the single channel versions, so a caller must use
+   one or the other for a given c. */
+static inline void
+biquad_stereo_c(const double *ACoef, const double *BCoef, double x[NCoef][2], double y[NCoef][2],
+                double in_l, double in_r, double *out)
+{
+    double in_c[2] = { in_l, in_r };
+
+    for (int i = 0; i < 2; i++) {
+        out[i] = ACoef[0] * in_c[i];
+        out[i] += ACoef[1] * x[0][i] - BCoef[1] * y[0][i];
+        out[i] += ACoef[2] * x[1][i] - BCoef[2] * y[1][i];
+
+        x[1][i] = x[0][i];
+        x[0][i] = in_c[i];
+        y[1][i] = y[0][i];
+        y[0][i] = out[i];
+    }
+}
+
+static inline void
+biquad_stereo(const double *ACoef, const double *BCoef, double x[NCoef][2], double y[NCoef][2],
+              double in_l, double in_r, double *out)
+{
+#if defined FILTERS_SSE2
+    __m128d in   = _mm_set_pd(in_r, in_l);
+    __m128d x1   = _mm_loadu_pd(x[0]);
+    __m128d x2   = _mm_loadu_pd(x[1]);
+    __m128d y1   = _mm_loadu_pd(y[0]);
+    __m128d y2   = _mm_loadu_pd(y[1]);
+    __m128d outv = _mm_mul_pd(_mm_set1_pd(ACoef[0]), in);
+
+    outv = _mm_add_pd(outv, _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(ACoef[1]), x1), _mm_mul_pd(_mm_set1_pd(BCoef[1]), y1)));
+    outv = _mm_add_pd(outv, _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(ACoef[2]), x2), _mm_mul_pd(_mm_set1_pd(BCoef[2]), y2)));
+
+    _mm_storeu_pd(x[1], x1);
+    _mm_storeu_pd(x[0], in);
+    _mm_storeu_pd(y[1], y1);
+    _mm_storeu_pd(y[0], outv);
+    _mm_storeu_pd(out, outv);
+#elif defined FILTERS_NEON
+    float64x2_t in   = vcombine_f64(vdup_n_f64(in_l), vdup_n_f64(in_r));
+    float64x2_t x1   = vld1q_f64(x[0]);
+    float64x2_t x2   = vld1q_f64(x[1]);
+    float64x2_t y1   = vld1q_f64(y[0]);
+    float64x2_t y2   = vld1q_f64(y[1]);
+    float64x2_t outv = vmulq_n_f64(in, ACoef[0]);
+
+    outv = vaddq_f64(outv, vsubq_f64(vmulq_n_f64(x1, ACoef[1]), vmulq_n_f64(y1, BCoef[1])));
+    outv = vaddq_f64(outv, vsubq_f64(vmulq_n_f64(x2, ACoef[2]), vmulq_n_f64(y2, BCoef[2])));
+
+    vst1q_f64(x[1], x1);
+    vst1q_f64(x[0], in);
+    vst1q_f64(y[1], y1);
+    vst1q_f64(y[0], outv);
+    vst1q_f64(out, outv);
+#else
+    biquad_stereo_c(ACoef, BCoef, x, y, in_l, in_r, out);
+#endif
+}
+
+static inline void
+low_iir_stereo(int c, double in_l, double in_r, double *out)
+{
+    static double x[5][NCoef][2];
+    static double y[5][NCoef][2];
+
+    biquad_stereo(low_iir_acoef, low_iir_bcoef, x[c], y[c], in_l, in_r, out);
+}
+
+static inline void
+low_cut_iir_stereo(int c, double in_l, double in_r, double *out)
+{
+    static double x[5][NCoef][2];
+    static double y[5][NCoef][2];
+
+    biquad_stereo(low_cut_iir_acoef, low_cut_iir_bcoef, x[c], y[c], in_l, in_r, out);
+}
+
+static inline void
+high_iir_stereo(int c, double in_l, double in_r, double *out)
+{
+    static double x[5][NCoef][2];
+    static double y[5][NCoef][2];
+
+    biquad_stereo(high_iir_acoef, high_iir_bcoef, x[c], y[c], in_l, in_r, out);
+}
+
+static inline void
+high_cut_iir_stereo(int c, double in_l, double in_r, double *out)
+{
+    static double x[5][NCoef][2];
+    static double y[5][NCoef][2];
+
+    biquad_stereo(high_cut_iir_acoef, high_cut_iir_bcoef, x[c], y[c], in_l, in_r, out);
+}
+
+static inline void
+sb_iir_stereo(int c, double in_l, double in_r, double *out)
+{
+    static double x[5][NCoef][2];
+    static double y[5][NCoef][2];
+
+    biquad_stereo(sb_iir_acoef, sb_iir_bcoef, x[c], y[c], in_l, in_r, out);
+}
+
 #undef NCoef
 #define NCoef      1
 #define SB16_NCoef 51
 
+/* Runs a FIR over both channels of a stereo sample at once, in the same way as
+   biquad_stereo(). x holds the last SB16_NCoef + 1 samples, left and right
+   interleaved, and pos is the slot for the new sample. */
+static inline void
+fir_stereo_c(const double *coef, double x[SB16_NCoef + 1][2], int p, double *out)
+{
+    int n;
+
+    out[0] = out[1] = 0.0;
+
+    for (n = 0; n < ((SB16_NCoef + 1) - p) && n < SB16_NCoef; n++) {
+        out[0] += coef[n] * x[n + p][0];
+        out[1] += coef[n] * x[n + p][1];
+    }
+    for (; n < SB16_NCoef; n++) {
+        out[0] += coef[n] * x[(n + p) - (SB16_NCoef + 1)][0];
+        out[1] += coef[n] * x[(n + p) - (SB16_NCoef + 1)][1];
+    }
+}
+
+static inline void
+fir_stereo(const double *coef, double x[SB16_NCoef + 1][2], int *pos, double in_l, double in_r, double *out)
+{
+    int p = *pos;
+#if defined FILTERS_SSE2 || defined FILTERS_NEON
+    int n;
+#endif
+
+    x[p][0] = in_l;
+    x[p][1] = in_r;
+
+#if defined FILTERS_SSE2
+    __m128d acc = _mm_setzero_pd();
+
+    for (n = 0; n < ((SB16_NCoef + 1) - p) && n < SB16_NCoef; n++)
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(coef[n]), _mm_loadu_pd(x[n + p])));
+    for (; n < SB16_NCoef; n++)
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(coef[n]), _mm_loadu_pd(x[(n + p) - (SB16_NCoef + 1)])));
+
+    _mm_storeu_pd(out, acc);
+#elif defined FILTERS_NEON
+    float64x2_t acc = vdupq_n_f64(0.0);
+
+    for (n = 0; n < ((SB16_NCoef + 1) - p) && n < SB16_NCoef; n++)
+        acc = vaddq_f64(acc, vmulq_n_f64(vld1q_f64(x[n + p]), coef[n]));
+    for (; n < SB16_NCoef; n++)
+        acc = vaddq_f64(acc, vmulq_n_f64(vld1q_f64(x[(n + p) - (SB16_NCoef + 1)]), coef[n]));
+
+    vst1q_f64(out, acc);
+#else
+    fir_stereo_c(coef, x, p, out);
+#endif
+
+    p++;
+    if (p > SB16_NCoef)
+        p = 0;
+    *pos = p;
+}
+
 extern double low_fir_sb16_coef[5][SB16_NCoef];
 
 static inline double
@@ -449,4 +643,22 @@ low_fir_pas16(const int i, const double NewSample)
     return out;
 }
 
+static inline void
+low_fir_sb16_stereo(int c, double in_l, double in_r, double *out)
+{
+    static double x[4][SB16_NCoef + 1][2];
+    static int    pos[4] = { 0, 0, 0, 0 };
+
+    fir_stereo(low_fir_sb16_coef[c], x[c], &pos[c], in_l, in_r, out);
+}
+
+static inline void
+low_fir_pas16_stereo(double in_l, double in_r, double *out)
+{
+    static double x[SB16_NCoef + 1][2];
+    static int    pos = 0;
+
+    fir_stereo(low_fir_pas16_coef, x, &pos, in_l, in_r, out);
+}
+
 #endif /*EMU_FILTERS_H*/
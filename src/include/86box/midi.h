@@ -28,12 +28,18 @@ extern int         midi_in_device_get_from_internal_name(char *s);
 extern void        midi_out_device_init(void);
 extern void        midi_in_device_init(void);
 
+typedef struct midi_queue_t midi_queue_t;
+
 typedef struct midi_device_t {
     void (*play_sysex)(uint8_t *sysex, unsigned int len);
     void (*play_msg)(uint8_t *msg);
     void (*poll)(void);
     void (*reset)(void);
     int (*write)(uint8_t val);
+
+    /* If set, messages are timestamped and queued instead of played at once,
+       and play_msg/play_sysex are called from midi_queue_render(). */
+    midi_queue_t *queue;
 } midi_device_t;
 
 typedef struct midi_in_handler_t {
@@ -80,6 +86,11 @@ extern void midi_clear_buffer(void);
 extern void midi_poll(void);
 extern void midi_reset(void);
 
+extern midi_queue_t *midi_queue_init(void);
+extern void          midi_queue_close(midi_queue_t *q);
+extern uint64_t      midi_queue_get_time(midi_queue_t *q);
+extern void          midi_queue_render(midi_device_t *dev, uint64_t start, uint32_t ticks, int samples, void (*render)(int pos, int len));
+
 extern void midi_in_handler(int set, void (*msg)(void *priv, uint8_t *msg, uint32_t len), int (*sysex)(void *priv, uint8_t *buffer, uint32_t len, int abort), void *priv);
 extern void midi_in_handlers_clear(void);
 extern void midi_in_msg(uint8_t *msg, uint32_t len);
@@ -347,6 +347,18 @@ typedef struct emu8k_voice_t {
 
 } emu8k_voice_t;
 
+/* Number of samples that are rendered together. */
+#define EMU8K_VOICE_BLOCK 64
+
+/* State of one voice for each sample of a block, as the envelopes left it. */
+typedef struct emu8k_voice_block_t {
+    uint32_t addr[EMU8K_VOICE_BLOCK];
+    uint16_t fract[EMU8K_VOICE_BLOCK];
+    uint16_t cut[EMU8K_VOICE_BLOCK];
+    int32_t  vol[EMU8K_VOICE_BLOCK];
+    int32_t  dat[EMU8K_VOICE_BLOCK];
+} emu8k_voice_block_t;
+
 typedef struct emu8k_t {
     emu8k_voice_t voice[32];
 
@@ -397,6 +409,8 @@ typedef struct emu8k_t {
     int     pos;
     int32_t buffer[WTBUFLEN * 2];
 
+    emu8k_voice_block_t voice_block[32];
+
     uint16_t addr;
 } emu8k_t;
 
@@ -159,6 +159,8 @@ typedef struct {
 
     int     pos;
     int32_t buffer[MUSICBUFLEN * 2];
+
+    struct nuked_worker_t *worker; /* Only set when generating on a worker thread. */
 } nuked_drv_t;
 
 enum {
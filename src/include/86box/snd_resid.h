@@ -1,10 +1,14 @@
 #ifndef SOUND_RESID_H
 #define SOUND_RESID_H
 
+#define SID_SAMPLING_INTERPOLATE 0
+#define SID_SAMPLING_RESAMPLE    1
+#define SID_SAMPLING_FAST        2
+
 #ifdef __cplusplus
 extern "C" {
 #endif
-void   *sid_init(void);
+void   *sid_init(int sampling);
 void    sid_close(void *priv);
 void    sid_reset(void *priv);
 uint8_t sid_read(uint16_t addr, void *priv);
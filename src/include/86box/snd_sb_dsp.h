@@ -11,6 +11,9 @@
 #define SB_SUBTYPE_ESS_ES688           3 /* ESS Technology ES688 */
 #define SB_SUBTYPE_ESS_ES1688          4 /* ESS Technology ES1688 */
 
+/* Transfers the DSP reads ahead of playback, about the depth of the SB16 FIFO. */
+#define SB_DSP_DMA_AHEAD 32
+
 /* ESS-related */
 #define IS_ESS(dsp) ((dsp)->sb_subtype >= SB_SUBTYPE_ESS_ES688)    /* Check for future ESS cards here */
 #define IS_NOT_ESS(dsp) ((dsp)->sb_subtype < SB_SUBTYPE_ESS_ES688) /* Check for future ESS cards here */
@@ -58,6 +61,11 @@ typedef struct sb_dsp_t {
     uint8_t dma_ff;
     int     dma_data;
 
+    uint8_t dma_ahead[SB_DSP_DMA_AHEAD * 2];
+    int     dma_ahead_ch;
+    int     dma_ahead_pos;
+    int     dma_ahead_len;
+
     int     sb_read_wp;
     int     sb_read_rp;
     int     sb_speaker;
@@ -52,7 +52,8 @@ extern int gated;
 extern int speakval;
 extern int speakon;
 
-extern int sound_pos_global;
+extern int      sound_pos_global;
+extern uint64_t sound_get_pos_ts(int pos);
 
 extern int music_pos_global;
 extern int wavetable_pos_global;
@@ -108,6 +109,25 @@ extern void givealbuffer_music(const void *buf);
 extern void givealbuffer_wt(const void *buf);
 extern void givealbuffer_cd(const void *buf);
 
+/* Frames the buffered output stage mixes and hands to its sink at a time. */
+#define SOUND_OUT_PERIOD (SOUND_FREQ / 200)
+
+#define SOUND_SINK_DEVICE 0
+#define SOUND_SINK_WAV    1
+#define SOUND_SINK_NULL   2
+
+extern int  sound_out_give(int stream, const void *buf, int samples, int freq);
+extern void sound_out_get_stats(int stream, uint32_t *underruns, uint32_t *overruns, int *drift_ppm);
+extern void sound_out_init(void);
+extern void sound_out_close(void);
+
+/* Device sink of the buffered output stage, provided by the audio library
+   interface. Takes interleaved stereo float frames. */
+extern int  al_out_open(int freq);
+extern void al_out_close(void);
+extern int  al_out_queued(void);
+extern void al_out_write(const float *buf, int frames);
+
 #define sb_vibra16c_onboard_relocate_base sb_vibra16s_onboard_relocate_base
 extern void sb_vibra16s_onboard_relocate_base(uint16_t new_addr, void *priv);
 
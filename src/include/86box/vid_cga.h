@@ -59,6 +59,7 @@ typedef struct cga_t {
     int drawcursor;
 
     int fullchange;
+    int frame_skip;
 
     uint8_t *vram;
 
@@ -64,6 +64,7 @@ typedef struct ega_t {
     int vres;
     int readmode;
     int writemode;
+    int planar_write; /* Non-zero when a plain write mode 0 (1) or a write mode 1 latch copy (2) applies. */
     int readplane;
     int vrammask;
     int chain4;
@@ -79,6 +80,7 @@ typedef struct ega_t {
     int cursoron;
     int blink;
     int fullchange;
+    int frame_skip;
     int linepos;
     int vslines;
     int linecountff;
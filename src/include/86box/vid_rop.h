@@ -0,0 +1,76 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Common ternary raster operation (ROP3) definitions.
+ */
+#ifndef VIDEO_ROP_H
+#define VIDEO_ROP_H
+
+/*Common GDI raster operations.*/
+#define ROP3_BLACKNESS   0x00
+#define ROP3_NOTSRCERASE 0x11
+#define ROP3_NOTSRCCOPY  0x33
+#define ROP3_SRCERASE    0x44
+#define ROP3_DSTINVERT   0x55
+#define ROP3_PATINVERT   0x5a
+#define ROP3_SRCINVERT   0x66
+#define ROP3_SRCAND      0x88
+#define ROP3_NOP         0xaa
+#define ROP3_MERGEPAINT  0xbb
+#define ROP3_MERGECOPY   0xc0
+#define ROP3_SRCCOPY     0xcc
+#define ROP3_SRCPAINT    0xee
+#define ROP3_PATCOPY     0xf0
+#define ROP3_PATPAINT    0xfb
+#define ROP3_WHITENESS   0xff
+
+/*Returns non-zero if the result of the ROP depends on the source/pattern.*/
+#define ROP3_USES_SRC(rop) ((((rop) >> 2) ^ (rop)) & 0x33)
+#define ROP3_USES_PAT(rop) ((((rop) >> 4) ^ (rop)) & 0x0f)
+
+typedef struct rop3_span_t {
+    uint8_t       *dst;      /*Destination, also the D operand*/
+    const uint8_t *src;      /*Source pixels, NULL to use src_col for every pixel*/
+    const uint8_t *pat;      /*Pattern pixels, NULL to use pat_col for every pixel*/
+    uint32_t       src_col;
+    uint32_t       pat_col;
+    uint32_t       wrt_mask; /*Per pixel write mask, set bits are written*/
+    int            bpp;      /*Bytes per pixel, 1 to 4*/
+    int            count;    /*Number of pixels*/
+} rop3_span_t;
+
+/*Bit n of the result is bit ((P << 2) | (S << 1) | D) of the ROP, for
+  every bit n of the operands. Written as a chain of multiplexers so that a
+  constant ROP folds down to the plain expression.*/
+#define ROP3_MUX(sel, a, b) ((b) ^ ((sel) & ((a) ^ (b))))
+
+static __inline uint32_t
+rop3(uint8_t rop, uint32_t dst, uint32_t src, uint32_t pat)
+{
+    uint32_t m0 = -(uint32_t) ((rop >> 0) & 1);
+    uint32_t m1 = -(uint32_t) ((rop >> 1) & 1);
+    uint32_t m2 = -(uint32_t) ((rop >> 2) & 1);
+    uint32_t m3 = -(uint32_t) ((rop >> 3) & 1);
+    uint32_t m4 = -(uint32_t) ((rop >> 4) & 1);
+    uint32_t m5 = -(uint32_t) ((rop >> 5) & 1);
+    uint32_t m6 = -(uint32_t) ((rop >> 6) & 1);
+    uint32_t m7 = -(uint32_t) ((rop >> 7) & 1);
+    uint32_t s0 = ROP3_MUX(src, ROP3_MUX(dst, m3, m2), ROP3_MUX(dst, m1, m0));
+    uint32_t s1 = ROP3_MUX(src, ROP3_MUX(dst, m7, m6), ROP3_MUX(dst, m5, m4));
+
+    return ROP3_MUX(pat, s1, s0);
+}
+
+/*IBM 8514/A style two operand mix codes 0-15, as also used by the ATI
+  Mach64 DP_MIX and S3 FRGD_MIX/BKGD_MIX registers, as ROP3s with the
+  pattern operand unused.*/
+extern const uint8_t rop3_mix[16];
+
+extern void rop3_span(uint8_t rop, const rop3_span_t *span);
+
+#endif /*VIDEO_ROP_H*/
@@ -30,6 +30,11 @@
 #    define FLAG_S3_911_16BIT 256
 #    define FLAG_512K_MASK    512
 #    define FLAG_NO_SHIFT3    1024 /* Needed for Bochs VBE. */
+
+/* Planar write paths, see svga_recalc_planar_write(). */
+#    define SVGA_PLANAR_GENERIC 0 /* Evaluate the write mode in full. */
+#    define SVGA_PLANAR_DIRECT  1 /* Write mode 0, no set/reset, logical op or bit mask. */
+#    define SVGA_PLANAR_LATCH   2 /* Write mode 1, store the latches. */
 struct monitor_t;
 
 typedef struct hwcursor_t {
@@ -72,6 +77,7 @@ typedef struct svga_t {
     uint8_t fb_only;
     uint8_t readmode;
     uint8_t writemode;
+    uint8_t planar_write;
     uint8_t readplane;
     uint8_t hwcursor_oddeven;
     uint8_t dac_hwcursor_oddeven;
@@ -218,6 +224,9 @@ typedef struct svga_t {
     /*If set then another device is driving the monitor output and the SVGA
       card should not attempt to display anything */
     int   override;
+    /*If set then the current frame is neither rendered nor blitted, see
+      video_frame_skip_monitor()*/
+    int   frame_skip;
     void *priv;
 
     uint8_t  crtc[256];
@@ -334,6 +343,7 @@ extern int  svga_init(const device_t *info, svga_t *svga, void *priv, int memsiz
                       void (*hwcursor_draw)(struct svga_t *svga, int displine),
                       void (*overlay_draw)(struct svga_t *svga, int displine));
 extern void svga_recalctimings(svga_t *svga);
+extern void svga_recalc_planar_write(svga_t *svga);
 extern void svga_close(svga_t *svga);
 
 uint8_t  svga_read(uint32_t addr, void *priv);
@@ -0,0 +1,403 @@
+/*AArch64 pixel pipeline recompiler.
+
+  Covers the untextured part of the pipeline : iterated or constant RGB,
+  depth test/write, dithering and the RGB/depth write masks. Anything else
+  (texturing, fog, alpha test/blend, W buffering, depth bias/source, tiled
+  framebuffers) returns NULL from voodoo_get_block() and is left to the
+  interpreter.
+
+  Register usage :
+    X0  - state                 X1  - params (prologue only)
+    W2  - x                     W3  - real_y (prologue), output pixel
+    W4  - ir / constant R       W5  - ig / constant G
+    W6  - ib / constant B       W7  - z
+    W8  - dRdX   W9  - dGdX     W10 - dBdX   W11 - dZdX
+    X12 - fb_mem                X13 - aux_mem
+    W14 - x2                    W15 - pixel_count
+    W16, W17 - scratch
+    W19 - 0xff                  W20 - 0xffff
+    X21 - dither_rb row         X22 - dither_g row
+    W23 - new_depth             X24 - scratch
+*/
+
+#ifndef VIDEO_VOODOO_CODEGEN_ARM64_H
+#define VIDEO_VOODOO_CODEGEN_ARM64_H
+
+#if defined(__APPLE__)
+#    include <pthread.h>
+#endif
+#ifdef _MSC_VER
+#    include <windows.h>
+#endif
+
+#define BLOCK_NUM  8
+#define BLOCK_MASK (BLOCK_NUM - 1)
+#define BLOCK_SIZE 1024
+
+typedef struct voodoo_arm64_data_t {
+    uint8_t  code_block[BLOCK_SIZE];
+    int      xdir;
+    uint32_t alphaMode;
+    uint32_t fbzMode;
+    uint32_t fogMode;
+    uint32_t fbzColorPath;
+    int      valid;
+} voodoo_arm64_data_t;
+
+static int last_block[VOODOO_MAX_RENDER_THREADS];
+static int next_block_to_write[VOODOO_MAX_RENDER_THREADS];
+
+#define addlong(val)                                \
+    do {                                            \
+        *(uint32_t *) &code_block[block_pos] = val; \
+        block_pos += 4;                             \
+    } while (0)
+
+#define ARM64_REG_WZR 31
+#define ARM64_REG_SP  31
+
+#define ARM64_COND_EQ 0x0
+#define ARM64_COND_NE 0x1
+#define ARM64_COND_LT 0xb
+#define ARM64_COND_GT 0xc
+#define ARM64_COND_LE 0xd
+#define ARM64_COND_GE 0xa
+
+#define ARM64_ADD_W(d, n, m)           (0x0b000000 | ((m) << 16) | ((n) << 5) | (d))
+#define ARM64_SUB_W(d, n, m)           (0x4b000000 | ((m) << 16) | ((n) << 5) | (d))
+#define ARM64_ADD_W_IMM(d, n, imm)     (0x11000000 | ((imm) << 10) | ((n) << 5) | (d))
+#define ARM64_SUB_W_IMM(d, n, imm)     (0x51000000 | ((imm) << 10) | ((n) << 5) | (d))
+#define ARM64_ADD_X_LSL(d, n, m, sh)   (0x8b000000 | ((m) << 16) | ((sh) << 10) | ((n) << 5) | (d))
+#define ARM64_ORR_W_LSL(d, n, m, sh)   (0x2a000000 | ((m) << 16) | ((sh) << 10) | ((n) << 5) | (d))
+#define ARM64_AND_W_MASK(d, n, bits)   (0x12000000 | (((bits) - 1) << 10) | ((n) << 5) | (d))
+#define ARM64_CMP_W(n, m)              (0x6b00001f | ((m) << 16) | ((n) << 5))
+#define ARM64_CMP_W_IMM(n, imm)        (0x7100001f | ((imm) << 10) | ((n) << 5))
+#define ARM64_CSEL_W(d, n, m, cond)    (0x1a800000 | ((m) << 16) | ((cond) << 12) | ((n) << 5) | (d))
+#define ARM64_ASR_W(d, n, sh)          (0x13007c00 | ((sh) << 16) | ((n) << 5) | (d))
+#define ARM64_LSR_W(d, n, sh)          (0x53007c00 | ((sh) << 16) | ((n) << 5) | (d))
+#define ARM64_LSL_W(d, n, sh)          (0x53000000 | (((32 - (sh)) & 31) << 16) | ((31 - (sh)) << 10) | ((n) << 5) | (d))
+#define ARM64_UBFX_W(d, n, lsb, w)     (0x53000000 | ((lsb) << 16) | (((lsb) + (w) -1) << 10) | ((n) << 5) | (d))
+#define ARM64_MOVZ_W(d, imm)           (0x52800000 | ((imm) << 5) | (d))
+#define ARM64_MOVZ_X(d, imm, hw)       (0xd2800000 | ((hw) << 21) | ((imm) << 5) | (d))
+#define ARM64_MOVK_X(d, imm, hw)       (0xf2800000 | ((hw) << 21) | ((imm) << 5) | (d))
+#define ARM64_LDR_W_IMM(t, n, off)     (0xb9400000 | (((off) >> 2) << 10) | ((n) << 5) | (t))
+#define ARM64_STR_W_IMM(t, n, off)     (0xb9000000 | (((off) >> 2) << 10) | ((n) << 5) | (t))
+#define ARM64_LDR_X_IMM(t, n, off)     (0xf9400000 | (((off) >> 3) << 10) | ((n) << 5) | (t))
+#define ARM64_LDR_W_REG(t, n, m)       (0xb8606800 | ((m) << 16) | ((n) << 5) | (t))
+#define ARM64_STR_W_REG(t, n, m)       (0xb8206800 | ((m) << 16) | ((n) << 5) | (t))
+#define ARM64_LDR_X_REG(t, n, m)       (0xf8606800 | ((m) << 16) | ((n) << 5) | (t))
+#define ARM64_LDRB_REG(t, n, m)        (0x38606800 | ((m) << 16) | ((n) << 5) | (t))
+#define ARM64_LDRH_SXTW1(t, n, m)      (0x7860d800 | ((m) << 16) | ((n) << 5) | (t))
+#define ARM64_STRH_SXTW1(t, n, m)      (0x7820d800 | ((m) << 16) | ((n) << 5) | (t))
+#define ARM64_STP_X_PRE(t1, t2, n, o)  (0xa9800000 | ((((o) >> 3) & 0x7f) << 15) | ((t2) << 10) | ((n) << 5) | (t1))
+#define ARM64_STP_X(t1, t2, n, o)      (0xa9000000 | ((((o) >> 3) & 0x7f) << 15) | ((t2) << 10) | ((n) << 5) | (t1))
+#define ARM64_LDP_X(t1, t2, n, o)      (0xa9400000 | ((((o) >> 3) & 0x7f) << 15) | ((t2) << 10) | ((n) << 5) | (t1))
+#define ARM64_LDP_X_POST(t1, t2, n, o) (0xa8c00000 | ((((o) >> 3) & 0x7f) << 15) | ((t2) << 10) | ((n) << 5) | (t1))
+#define ARM64_B(offset)                (0x14000000 | (((offset) >> 2) & 0x3ffffff))
+#define ARM64_B_COND(offset, cond)     (0x54000000 | ((((offset) >> 2) & 0x7ffff) << 5) | (cond))
+#define ARM64_RET                      0xd65f03c0
+
+static int
+codegen_arm64_load_imm64(uint8_t *code_block, int block_pos, int reg, uint64_t val)
+{
+    addlong(ARM64_MOVZ_X(reg, val & 0xffff, 0));
+    for (int hw = 1; hw < 4; hw++) {
+        if ((val >> (hw * 16)) & 0xffff)
+            addlong(ARM64_MOVK_X(reg, (uint32_t) ((val >> (hw * 16)) & 0xffff), hw));
+    }
+
+    return block_pos;
+}
+
+/*Structure offsets are normally well within the scaled 12-bit immediate
+  range, but fall back to a register offset through X17 if not.*/
+static int
+codegen_arm64_ldst(uint8_t *code_block, int block_pos, int is_load, int is_64, int rt, int rn, uint32_t offset)
+{
+    int scale = is_64 ? 3 : 2;
+
+    if (!(offset & ((1 << scale) - 1)) && (offset >> scale) < 4096) {
+        if (is_64)
+            addlong(ARM64_LDR_X_IMM(rt, rn, offset));
+        else if (is_load)
+            addlong(ARM64_LDR_W_IMM(rt, rn, offset));
+        else
+            addlong(ARM64_STR_W_IMM(rt, rn, offset));
+    } else {
+        block_pos = codegen_arm64_load_imm64(code_block, block_pos, 17, offset);
+        if (is_64)
+            addlong(ARM64_LDR_X_REG(rt, rn, 17));
+        else if (is_load)
+            addlong(ARM64_LDR_W_REG(rt, rn, 17));
+        else
+            addlong(ARM64_STR_W_REG(rt, rn, 17));
+    }
+
+    return block_pos;
+}
+
+#define LOAD_W(rt, rn, offset)  block_pos = codegen_arm64_ldst(code_block, block_pos, 1, 0, rt, rn, offset)
+#define STORE_W(rt, rn, offset) block_pos = codegen_arm64_ldst(code_block, block_pos, 0, 0, rt, rn, offset)
+#define LOAD_X(rt, rn, offset)  block_pos = codegen_arm64_ldst(code_block, block_pos, 1, 1, rt, rn, offset)
+
+static int
+voodoo_arm64_supported(voodoo_params_t *params)
+{
+    if (voodoo_plain_colour_mode(params) < 0)
+        return 0;
+    if (params->fbzMode & (FBZ_DEPTH_BIAS | FBZ_DEPTH_SOURCE))
+        return 0;
+
+    return 1;
+}
+
+static inline void
+voodoo_generate(uint8_t *code_block, voodoo_params_t *params, voodoo_state_t *state)
+{
+    int      block_pos  = 0;
+    int      iterated   = cc_zero_other ? !cc_localselect : (_rgb_sel == CC_LOCALSELECT_ITER_RGB);
+    int      depth_test = params->fbzMode & FBZ_DEPTH_ENABLE;
+    int      depth_wr   = (params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE);
+    int      rgb_wr     = params->fbzMode & FBZ_RGB_WMASK;
+    int      loop_pos;
+    int      skip_patch = -1;
+    uint32_t skip_cond  = 0;
+
+    addlong(ARM64_STP_X_PRE(19, 20, ARM64_REG_SP, -48)); /*STP X19, X20, [SP, #-48]!*/
+    addlong(ARM64_STP_X(21, 22, ARM64_REG_SP, 16));      /*STP X21, X22, [SP, #16]*/
+    addlong(ARM64_STP_X(23, 24, ARM64_REG_SP, 32));      /*STP X23, X24, [SP, #32]*/
+
+    LOAD_W(7, 0, offsetof(voodoo_state_t, z));
+    LOAD_W(11, 1, offsetof(voodoo_params_t, dZdX));
+    LOAD_X(12, 0, offsetof(voodoo_state_t, fb_mem));
+    LOAD_X(13, 0, offsetof(voodoo_state_t, aux_mem));
+    LOAD_W(14, 0, offsetof(voodoo_state_t, x2));
+    LOAD_W(15, 0, offsetof(voodoo_state_t, pixel_count));
+    addlong(ARM64_MOVZ_W(19, 0xff));   /*MOV W19, #0xff*/
+    addlong(ARM64_MOVZ_W(20, 0xffff)); /*MOV W20, #0xffff*/
+
+    if (iterated) {
+        LOAD_W(4, 0, offsetof(voodoo_state_t, ir));
+        LOAD_W(5, 0, offsetof(voodoo_state_t, ig));
+        LOAD_W(6, 0, offsetof(voodoo_state_t, ib));
+        LOAD_W(8, 1, offsetof(voodoo_params_t, dRdX));
+        LOAD_W(9, 1, offsetof(voodoo_params_t, dGdX));
+        LOAD_W(10, 1, offsetof(voodoo_params_t, dBdX));
+    } else {
+        /*color0 for the local path, color1 for the other path. Loaded at
+          run time as the colours are not part of the block key.*/
+        LOAD_W(16, 1, cc_zero_other ? offsetof(voodoo_params_t, color0) : offsetof(voodoo_params_t, color1));
+        addlong(ARM64_UBFX_W(4, 16, 16, 8)); /*UBFX W4, W16, #16, #8*/
+        addlong(ARM64_UBFX_W(5, 16, 8, 8));  /*UBFX W5, W16, #8, #8*/
+        addlong(ARM64_UBFX_W(6, 16, 0, 8));  /*UBFX W6, W16, #0, #8*/
+    }
+
+    if (dither) {
+        /*Fold the row (real_y) part of the dither table index into the
+          base pointers, leaving [colour][x] per pixel*/
+        if (dither2x2) {
+            block_pos = codegen_arm64_load_imm64(code_block, block_pos, 21, (uintptr_t) dither_rb2x2);
+            block_pos = codegen_arm64_load_imm64(code_block, block_pos, 22, (uintptr_t) dither_g2x2);
+            addlong(ARM64_AND_W_MASK(16, 3, 1));    /*AND W16, W3, #1*/
+            addlong(ARM64_ADD_X_LSL(21, 21, 16, 1)); /*ADD X21, X21, X16, LSL #1*/
+            addlong(ARM64_ADD_X_LSL(22, 22, 16, 1)); /*ADD X22, X22, X16, LSL #1*/
+        } else {
+            block_pos = codegen_arm64_load_imm64(code_block, block_pos, 21, (uintptr_t) dither_rb);
+            block_pos = codegen_arm64_load_imm64(code_block, block_pos, 22, (uintptr_t) dither_g);
+            addlong(ARM64_AND_W_MASK(16, 3, 2));    /*AND W16, W3, #3*/
+            addlong(ARM64_ADD_X_LSL(21, 21, 16, 2)); /*ADD X21, X21, X16, LSL #2*/
+            addlong(ARM64_ADD_X_LSL(22, 22, 16, 2)); /*ADD X22, X22, X16, LSL #2*/
+        }
+    }
+
+    loop_pos = block_pos;
+
+    if (depth_test) {
+        addlong(ARM64_ASR_W(23, 7, 12));                           /*ASR W23, W7, #12*/
+        addlong(ARM64_CMP_W_IMM(23, 0));                           /*CMP W23, #0*/
+        addlong(ARM64_CSEL_W(23, ARM64_REG_WZR, 23, ARM64_COND_LT)); /*CSEL W23, WZR, W23, LT*/
+        addlong(ARM64_CMP_W(23, 20));                              /*CMP W23, W20*/
+        addlong(ARM64_CSEL_W(23, 20, 23, ARM64_COND_GT));          /*CSEL W23, W20, W23, GT*/
+
+        switch (depth_op) {
+            case DEPTHOP_NEVER:
+                skip_patch = block_pos;
+                addlong(ARM64_B(0)); /*B skip*/
+                break;
+            case DEPTHOP_ALWAYS:
+                break;
+            default:
+                addlong(ARM64_LDRH_SXTW1(16, 13, 2)); /*LDRH W16, [X13, W2, SXTW #1]*/
+                addlong(ARM64_CMP_W(23, 16));         /*CMP W23, W16*/
+                switch (depth_op) {
+                    case DEPTHOP_LESSTHAN:
+                        skip_cond = ARM64_COND_GE;
+                        break;
+                    case DEPTHOP_EQUAL:
+                        skip_cond = ARM64_COND_NE;
+                        break;
+                    case DEPTHOP_LESSTHANEQUAL:
+                        skip_cond = ARM64_COND_GT;
+                        break;
+                    case DEPTHOP_GREATERTHAN:
+                        skip_cond = ARM64_COND_LE;
+                        break;
+                    case DEPTHOP_NOTEQUAL:
+                        skip_cond = ARM64_COND_EQ;
+                        break;
+                    case DEPTHOP_GREATERTHANEQUAL:
+                        skip_cond = ARM64_COND_LT;
+                        break;
+                }
+                skip_patch = block_pos;
+                addlong(ARM64_B_COND(0, skip_cond)); /*B.cond skip*/
+                break;
+        }
+    }
+
+    if (rgb_wr) {
+        if (dither)
+            addlong(ARM64_AND_W_MASK(17, 2, dither2x2 ? 1 : 2)); /*AND W17, W2, #1 / #3*/
+
+        for (int c = 0; c < 3; c++) {
+            int src = 4 + c; /*W4 = R, W5 = G, W6 = B*/
+
+            if (iterated) {
+                addlong(ARM64_ASR_W(16, src, 12));                           /*ASR W16, Wsrc, #12*/
+                addlong(ARM64_CMP_W_IMM(16, 0));                             /*CMP W16, #0*/
+                addlong(ARM64_CSEL_W(16, ARM64_REG_WZR, 16, ARM64_COND_LT)); /*CSEL W16, WZR, W16, LT*/
+                addlong(ARM64_CMP_W(16, 19));                                /*CMP W16, W19*/
+                addlong(ARM64_CSEL_W(16, 19, 16, ARM64_COND_GT));            /*CSEL W16, W19, W16, GT*/
+                src = 16;
+            }
+
+            if (dither) {
+                addlong(ARM64_ADD_X_LSL(24, (c == 1) ? 22 : 21, src, dither2x2 ? 2 : 4)); /*ADD X24, Xtable, Xsrc, LSL #2 / #4*/
+                addlong(ARM64_LDRB_REG(16, 24, 17));                                     /*LDRB W16, [X24, X17]*/
+            } else
+                addlong(ARM64_LSR_W(16, src, (c == 1) ? 2 : 3)); /*LSR W16, Wsrc, #2 / #3*/
+
+            if (c == 0)
+                addlong(ARM64_LSL_W(3, 16, 11)); /*LSL W3, W16, #11*/
+            else
+                addlong(ARM64_ORR_W_LSL(3, 3, 16, (c == 1) ? 5 : 0)); /*ORR W3, W3, W16, LSL #5 / #0*/
+        }
+
+        addlong(ARM64_STRH_SXTW1(3, 12, 2)); /*STRH W3, [X12, W2, SXTW #1]*/
+    }
+
+    if (depth_wr)
+        addlong(ARM64_STRH_SXTW1(23, 13, 2)); /*STRH W23, [X13, W2, SXTW #1]*/
+
+    if (skip_patch != -1) {
+        int offset = block_pos - skip_patch;
+
+        if (depth_op == DEPTHOP_NEVER)
+            *(uint32_t *) &code_block[skip_patch] = ARM64_B(offset);
+        else
+            *(uint32_t *) &code_block[skip_patch] = ARM64_B_COND(offset, skip_cond);
+    }
+
+    addlong(ARM64_ADD_W_IMM(15, 15, 1)); /*ADD W15, W15, #1*/
+    if (state->xdir > 0) {
+        if (iterated) {
+            addlong(ARM64_ADD_W(4, 4, 8));  /*ADD W4, W4, W8*/
+            addlong(ARM64_ADD_W(5, 5, 9));  /*ADD W5, W5, W9*/
+            addlong(ARM64_ADD_W(6, 6, 10)); /*ADD W6, W6, W10*/
+        }
+        addlong(ARM64_ADD_W(7, 7, 11)); /*ADD W7, W7, W11*/
+    } else {
+        if (iterated) {
+            addlong(ARM64_SUB_W(4, 4, 8));  /*SUB W4, W4, W8*/
+            addlong(ARM64_SUB_W(5, 5, 9));  /*SUB W5, W5, W9*/
+            addlong(ARM64_SUB_W(6, 6, 10)); /*SUB W6, W6, W10*/
+        }
+        addlong(ARM64_SUB_W(7, 7, 11)); /*SUB W7, W7, W11*/
+    }
+
+    /*Loop until the pixel just drawn was x2, as the interpreter does*/
+    addlong(ARM64_CMP_W(2, 14)); /*CMP W2, W14*/
+    if (state->xdir > 0)
+        addlong(ARM64_ADD_W_IMM(2, 2, 1)); /*ADD W2, W2, #1*/
+    else
+        addlong(ARM64_SUB_W_IMM(2, 2, 1)); /*SUB W2, W2, #1*/
+    addlong(ARM64_B_COND(loop_pos - block_pos, ARM64_COND_NE)); /*B.NE loop*/
+
+    STORE_W(15, 0, offsetof(voodoo_state_t, pixel_count));
+
+    addlong(ARM64_LDP_X(23, 24, ARM64_REG_SP, 32));      /*LDP X23, X24, [SP, #32]*/
+    addlong(ARM64_LDP_X(21, 22, ARM64_REG_SP, 16));      /*LDP X21, X22, [SP, #16]*/
+    addlong(ARM64_LDP_X_POST(19, 20, ARM64_REG_SP, 48)); /*LDP X19, X20, [SP], #48*/
+    addlong(ARM64_RET);                                  /*RET*/
+
+#ifndef _MSC_VER
+    __clear_cache((char *) code_block, (char *) &code_block[block_pos]);
+#else
+    FlushInstructionCache(GetCurrentProcess(), code_block, block_pos);
+#endif
+}
+
+int voodoo_recomp = 0;
+
+static inline void *
+voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
+{
+    int                  b                 = last_block[odd_even];
+    voodoo_arm64_data_t *voodoo_arm64_data = voodoo->codegen_data;
+    voodoo_arm64_data_t *data;
+
+    if (!voodoo_arm64_supported(params))
+        return NULL;
+
+    for (uint8_t c = 0; c < BLOCK_NUM; c++) {
+        data = &voodoo_arm64_data[odd_even + b * VOODOO_MAX_RENDER_THREADS];
+
+        if (data->valid && state->xdir == data->xdir && params->alphaMode == data->alphaMode && params->fbzMode == data->fbzMode && params->fogMode == data->fogMode && params->fbzColorPath == data->fbzColorPath) {
+            last_block[odd_even] = b;
+            return data->code_block;
+        }
+
+        b = (b + 1) & BLOCK_MASK;
+    }
+    voodoo_recomp++;
+    data = &voodoo_arm64_data[odd_even + next_block_to_write[odd_even] * VOODOO_MAX_RENDER_THREADS];
+
+#if defined(__APPLE__) && defined(__aarch64__)
+    if (__builtin_available(macOS 11.0, *)) {
+        pthread_jit_write_protect_np(0);
+    }
+#endif
+    voodoo_generate(data->code_block, params, state);
+#if defined(__APPLE__) && defined(__aarch64__)
+    if (__builtin_available(macOS 11.0, *)) {
+        pthread_jit_write_protect_np(1);
+    }
+#endif
+
+    data->valid        = 1;
+    data->xdir         = state->xdir;
+    data->alphaMode    = params->alphaMode;
+    data->fbzMode      = params->fbzMode;
+    data->fogMode      = params->fogMode;
+    data->fbzColorPath = params->fbzColorPath;
+
+    last_block[odd_even]          = next_block_to_write[odd_even];
+    next_block_to_write[odd_even] = (next_block_to_write[odd_even] + 1) & BLOCK_MASK;
+
+    return data->code_block;
+}
+
+void
+voodoo_codegen_init(voodoo_t *voodoo)
+{
+    /*Freshly mapped memory is zeroed, so every block starts out invalid*/
+    voodoo->codegen_data = plat_mmap(sizeof(voodoo_arm64_data_t) * BLOCK_NUM * VOODOO_MAX_RENDER_THREADS, 1);
+}
+
+void
+voodoo_codegen_close(voodoo_t *voodoo)
+{
+    plat_munmap(voodoo->codegen_data, sizeof(voodoo_arm64_data_t) * BLOCK_NUM * VOODOO_MAX_RENDER_THREADS);
+}
+
+#endif /*VIDEO_VOODOO_CODEGEN_ARM64_H*/
@@ -30,7 +30,16 @@
 
 #define TEX_DIRTY_SHIFT 10
 
-#define TEX_CACHE_MAX   64
+#define TEX_CACHE_MAX   1024 /*Most texture cache entries per TMU*/
+#define TEX_HASH_SIZE   1024
+#define TEX_HASH_MASK   (TEX_HASH_SIZE - 1)
+
+/*Texture memory is split into 64 kB regions for invalidation. Each region
+  holds a bitmap of the cache entries that overlap it.*/
+#define TEX_INDEX_SHIFT   16
+#define TEX_INDEX_REGIONS (1 << (24 - TEX_INDEX_SHIFT))
+
+#define VOODOO_MAX_RENDER_THREADS 16
 
 #ifdef __cplusplus
 #    include <atomic>
@@ -234,12 +243,13 @@ typedef struct texture_t {
     uint32_t   base;
     uint32_t   tLOD;
     atomic_int refcount;
-    atomic_int refcount_r[4];
+    atomic_int refcount_r[VOODOO_MAX_RENDER_THREADS];
     int        is16;
     uint32_t   palette_checksum;
     uint32_t   addr_start[4];
     uint32_t   addr_end[4];
     uint32_t  *data;
+    int        hash_next;
 } texture_t;
 
 typedef struct vert_t {
@@ -266,6 +276,11 @@ typedef struct clip_t {
     int y_max;
 } clip_t;
 
+typedef struct voodoo_render_param_t {
+    struct voodoo_t *voodoo;
+    int              thread;
+} voodoo_render_param_t;
+
 typedef struct voodoo_t {
     mem_mapping_t mapping;
 
@@ -362,25 +377,26 @@ typedef struct voodoo_t {
     int    ncc_dirty[2];
 
     thread_t *fifo_thread;
-    thread_t *render_thread[4];
+    thread_t *render_thread[VOODOO_MAX_RENDER_THREADS];
     event_t  *wake_fifo_thread;
     event_t  *wake_main_thread;
     event_t  *fifo_not_full_event;
-    event_t  *render_not_full_event[4];
-    event_t  *wake_render_thread[4];
+    event_t  *render_not_full_event[VOODOO_MAX_RENDER_THREADS];
+    event_t  *wake_render_thread[VOODOO_MAX_RENDER_THREADS];
+
+    voodoo_render_param_t render_param[VOODOO_MAX_RENDER_THREADS];
 
     int voodoo_busy;
-    int render_voodoo_busy[4];
+    int render_voodoo_busy[VOODOO_MAX_RENDER_THREADS];
 
     int render_threads;
-    int odd_even_mask;
 
-    int pixel_count[4];
-    int texel_count[4];
+    int pixel_count[VOODOO_MAX_RENDER_THREADS];
+    int texel_count[VOODOO_MAX_RENDER_THREADS];
     int tri_count;
     int frame_count;
-    int pixel_count_old[4];
-    int texel_count_old[4];
+    int pixel_count_old[VOODOO_MAX_RENDER_THREADS];
+    int texel_count_old[VOODOO_MAX_RENDER_THREADS];
     int wr_count;
     int rd_count;
     int tex_count;
@@ -411,7 +427,7 @@ typedef struct voodoo_t {
     atomic_int   cmd_written_fifo_2;
 
     voodoo_params_t params_buffer[PARAM_SIZE];
-    atomic_int      params_read_idx[4];
+    atomic_int      params_read_idx[VOODOO_MAX_RENDER_THREADS];
     atomic_int      params_write_idx;
 
     uint32_t   cmdfifo_base;
@@ -656,15 +672,25 @@ typedef struct voodoo_t {
     uint8_t  thefilterb[256][256];
     uint16_t purpleline[256][3];
 
-    texture_t texture_cache[2][TEX_CACHE_MAX];
-    uint8_t   texture_present[2][16384];
-    int       texture_last_removed;
+    texture_t *texture_cache[2];
+    int        texture_cache_size;
+    int        texture_hash[2][TEX_HASH_SIZE];
+    uint32_t  *texture_index[2];
+    int        texture_index_words;
+    uint16_t   texture_present[2][16384];
+    int        texture_last_removed;
+
+    uint64_t texture_cache_bytes; /*Texture data allocated, for both TMUs*/
+    uint64_t texture_cache_hits;
+    uint64_t texture_cache_misses;
+    uint64_t texture_cache_evictions;
+    uint64_t texture_cache_flushes;
 
     uint32_t palette_checksum[2];
     int      palette_dirty[2];
 
     uint64_t time;
-    int      render_time[4];
+    int      render_time[VOODOO_MAX_RENDER_THREADS];
 
     int      force_blit_count;
     int      can_blit;
@@ -676,7 +702,7 @@ typedef struct voodoo_t {
     struct voodoo_set_t *set;
 
     uint8_t fifo_thread_run;
-    uint8_t render_thread_run[4];
+    uint8_t render_thread_run[VOODOO_MAX_RENDER_THREADS];
 
     uint8_t *vram;
     uint8_t *changedvram;
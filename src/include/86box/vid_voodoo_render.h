@@ -1,7 +1,7 @@
 #ifndef VIDEO_VOODOO_RENDER_H
 #define VIDEO_VOODOO_RENDER_H
 
-#if !(defined i386 || defined __i386 || defined __i386__ || defined _X86_ || defined _M_IX86 || defined __amd64__ || defined _M_X64)
+#if !(defined i386 || defined __i386 || defined __i386__ || defined _X86_ || defined _M_IX86 || defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
 #    define NO_CODEGEN
 #endif
 
@@ -268,10 +268,8 @@ void voodoo_codegen_close(voodoo_t *voodoo);
         src_b = CLAMP(src_b);                                \
     } while (0)
 
-void voodoo_render_thread_1(void *param);
-void voodoo_render_thread_2(void *param);
-void voodoo_render_thread_3(void *param);
-void voodoo_render_thread_4(void *param);
+void voodoo_render_threads_init(voodoo_t *voodoo);
+void voodoo_render_threads_close(voodoo_t *voodoo);
 void voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params);
 
 extern int voodoo_recomp;
@@ -280,29 +278,88 @@ extern int tris;
 static __inline void
 voodoo_wake_render_thread(voodoo_t *voodoo)
 {
-    thread_set_event(voodoo->wake_render_thread[0]); /*Wake up render thread if moving from idle*/
-    if (voodoo->render_threads >= 2)
-        thread_set_event(voodoo->wake_render_thread[1]); /*Wake up render thread if moving from idle*/
-    if (voodoo->render_threads == 4) {
-        thread_set_event(voodoo->wake_render_thread[2]); /*Wake up render thread if moving from idle*/
-        thread_set_event(voodoo->wake_render_thread[3]); /*Wake up render thread if moving from idle*/
+    for (int c = 0; c < voodoo->render_threads; c++)
+        thread_set_event(voodoo->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
+}
+
+static __inline int
+voodoo_render_thread_busy(voodoo_t *voodoo, int thread)
+{
+    return !PARAM_EMPTY(thread) || voodoo->render_voodoo_busy[thread];
+}
+
+static __inline int
+voodoo_render_busy(voodoo_t *voodoo)
+{
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (voodoo_render_thread_busy(voodoo, c))
+            return 1;
     }
+
+    return 0;
 }
 
 static __inline void
 voodoo_wait_for_render_thread_idle(voodoo_t *voodoo)
 {
-    while (!PARAM_EMPTY(0) || (voodoo->render_threads >= 2 && !PARAM_EMPTY(1)) || (voodoo->render_threads == 4 && (!PARAM_EMPTY(2) || !PARAM_EMPTY(3))) || voodoo->render_voodoo_busy[0] || (voodoo->render_threads >= 2 && voodoo->render_voodoo_busy[1]) || (voodoo->render_threads == 4 && (voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3]))) {
+    while (voodoo_render_busy(voodoo)) {
         voodoo_wake_render_thread(voodoo);
-        if (!PARAM_EMPTY(0) || voodoo->render_voodoo_busy[0])
-            thread_wait_event(voodoo->render_not_full_event[0], 1);
-        if (voodoo->render_threads >= 2 && (!PARAM_EMPTY(1) || voodoo->render_voodoo_busy[1]))
-            thread_wait_event(voodoo->render_not_full_event[1], 1);
-        if (voodoo->render_threads == 4 && (!PARAM_EMPTY(2) || voodoo->render_voodoo_busy[2]))
-            thread_wait_event(voodoo->render_not_full_event[2], 1);
-        if (voodoo->render_threads == 4 && (!PARAM_EMPTY(3) || voodoo->render_voodoo_busy[3]))
-            thread_wait_event(voodoo->render_not_full_event[3], 1);
+        for (int c = 0; c < voodoo->render_threads; c++) {
+            if (voodoo_render_thread_busy(voodoo, c))
+                thread_wait_event(voodoo->render_not_full_event[c], 1);
+        }
+    }
+}
+
+/*Untextured, unfogged, unblended spans whose colour is either the iterated
+  RGB or a constant register, as handled by the span renderers and the
+  AArch64 recompiler. Selections the interpreter treats as fatal are left to
+  the interpreter. Returns -1 if the mode is not one of these, otherwise
+  whether the colour is iterated.*/
+static __inline int
+voodoo_plain_colour_mode(voodoo_params_t *params)
+{
+    if (params->col_tiled || params->aux_tiled)
+        return -1;
+    if (params->fbzColorPath & FBZCP_TEXTURE_ENABLED)
+        return -1;
+    if (params->fogMode & FOG_ENABLE)
+        return -1;
+    if (params->alphaMode & ((1 << 0) | (1 << 4))) /*Alpha test / alpha blend*/
+        return -1;
+    if (params->fbzMode & FBZ_W_BUFFER)
+        return -1;
+    if (cca_localselect == 3 || a_sel == 3)
+        return -1;
+    if (cc_invert_output || cc_sub_clocal || cc_mselect != CC_MSELECT_ZERO)
+        return -1;
+
+    if (cc_zero_other) {
+        /*Local colour only : (0 * msel) + clocal*/
+        if (cc_add != CC_ADD_CLOCAL || cc_localselect_override)
+            return -1;
+        return !cc_localselect;
     }
+
+    /*Other colour only : (cother * 256) >> 8*/
+    if (cc_add || cc_reverse_blend)
+        return -1;
+    if (_rgb_sel != CC_LOCALSELECT_ITER_RGB && _rgb_sel != CC_LOCALSELECT_COLOR1)
+        return -1;
+    return (_rgb_sel == CC_LOCALSELECT_ITER_RGB);
+}
+
+/*A texture cache entry can only be replaced once every render thread has
+  finished with all the triangles that referenced it.*/
+static __inline int
+voodoo_texture_idle(voodoo_t *voodoo, texture_t *texture)
+{
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (texture->refcount != texture->refcount_r[c])
+            return 0;
+    }
+
+    return 1;
 }
 
 #endif /*VIDEO_VOODOO_RENDER_H*/
@@ -96,6 +96,9 @@ typedef struct dbcs_font_t {
     uint8_t chr[32];
 } dbcs_font_t;
 
+/* Most frames in a row skipped while the emulator is not keeping up. */
+#define VIDEO_FRAMESKIP_MAX 3
+
 struct blit_data_struct;
 
 typedef struct monitor_t {
@@ -123,6 +126,8 @@ typedef struct monitor_t {
     int                      mon_fullchange;
     int                      mon_changeframecount;
     atomic_int               mon_screenshots;
+    int                      mon_frameskip_run;  /* Consecutive frames skipped */
+    atomic_int               mon_frames_skipped; /* Frames not rendered due to frame skipping */
     uint32_t                *mon_pal_lookup;
     int                     *mon_cga_palette;
     int                      mon_pal_lookup_static;  /* Whether it should not be freed by the API. */
@@ -202,6 +207,8 @@ extern uint32_t    *video_8togs;
 extern uint32_t    *video_8to32;
 extern uint32_t    *video_15to32;
 extern uint32_t    *video_16to32;
+extern uint32_t     video_font_mask[256][8];
+extern const uint32_t video_plane_mask[16]; /* Byte lanes selected by a 4-bit plane mask. */
 extern int          enable_overscan;
 extern int          force_43;
 extern int          vid_resize;
@@ -209,6 +216,8 @@ extern int          herc_blend;
 extern int          vid_cga_contrast;
 extern int          video_grayscale;
 extern int          video_graytype;
+extern atomic_int   video_overloaded;
+extern atomic_int   video_minimized;
 
 extern double cpuclock;
 extern int    emu_fps;
@@ -230,6 +239,30 @@ extern void *(*video_copy)(void *__restrict _Dst, const void *__restrict _Src, s
 extern void *video_transform_copy(void *__restrict _Dst, const void *__restrict _Src, size_t _Size);
 #endif
 
+/* Expand one row of a text mode glyph to 8 pixels. The expansion table only
+   depends on the font byte, so it never needs to be invalidated on font or
+   palette changes, and the colour select is branch free. */
+static __inline void
+video_font_row(uint32_t *p, uint8_t dat, uint32_t fg, uint32_t bg)
+{
+    const uint32_t *mask = video_font_mask[dat];
+    uint32_t        diff = fg ^ bg;
+
+    for (int x = 0; x < 8; x++)
+        p[x] = bg ^ (diff & mask[x]);
+}
+
+/* Same as above, with every pixel doubled (40 column modes). */
+static __inline void
+video_font_row_wide(uint32_t *p, uint8_t dat, uint32_t fg, uint32_t bg)
+{
+    const uint32_t *mask = video_font_mask[dat];
+    uint32_t        diff = fg ^ bg;
+
+    for (int x = 0; x < 16; x++)
+        p[x] = bg ^ (diff & mask[x >> 1]);
+}
+
 /* Table functions. */
 extern int video_card_available(int card);
 #ifdef EMU_DEVICE_H
@@ -256,6 +289,8 @@ extern void video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monit
 extern void video_blit_complete_monitor(int monitor_index);
 extern void video_wait_for_blit_monitor(int monitor_index);
 extern void video_wait_for_buffer_monitor(int monitor_index);
+extern int  video_frame_skip_monitor(int monitor_index);
+extern int  video_frames_skipped(void);
 
 extern bitmap_t *create_bitmap(int w, int h);
 extern void      destroy_bitmap(bitmap_t *b);
@@ -283,6 +318,7 @@ extern int get_actual_size_x(void);
 extern int get_actual_size_y(void);
 
 extern uint32_t video_color_transform(uint32_t color);
+extern void     video_color_transform_update(void);
 
 #define video_inform(type, video_timings_ptr) video_inform_monitor(type, video_timings_ptr, monitor_index_global)
 #define video_get_type()                      video_get_type_monitor(0)
@@ -292,6 +328,7 @@ extern uint32_t video_color_transform(uint32_t color);
 #define video_blit_complete()                 video_blit_complete_monitor(monitor_index_global)
 #define video_wait_for_blit()                 video_wait_for_blit_monitor(monitor_index_global)
 #define video_wait_for_buffer()               video_wait_for_buffer_monitor(monitor_index_global)
+#define video_frame_skip()                    video_frame_skip_monitor(monitor_index_global)
 #define cgapal_rebuild()                      cgapal_rebuild_monitor(monitor_index_global)
 #define video_force_resize_get()              video_force_resize_get_monitor(monitor_index_global)
 #define video_force_resize_set(val)           video_force_resize_set_monitor(val, monitor_index_global)
@@ -1732,6 +1732,22 @@ mem_readl_phys(uint32_t addr)
     return ret;
 }
 
+/* Returns a pointer to the RAM behind a physical address as seen by bus
+   masters, valid up to the end of its granule, or NULL if the address is
+   not backed by directly accessible RAM. */
+uint8_t *
+mem_get_phys_ptr(uint32_t addr, int write)
+{
+    mem_mapping_t *map = write ? write_mapping_bus[addr >> MEM_GRANULARITY_BITS] : read_mapping_bus[addr >> MEM_GRANULARITY_BITS];
+
+    mem_logical_addr = 0xffffffff;
+
+    if (cpu_use_exec && map && map->exec && ((map->mask & MEM_GRANULARITY_MASK) == MEM_GRANULARITY_MASK))
+        return &(map->exec[(addr - map->base) & map->mask]);
+
+    return NULL;
+}
+
 void
 mem_read_phys(void *dest, uint32_t addr, int transfer_size)
 {
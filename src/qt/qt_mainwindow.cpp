@@ -1436,7 +1436,7 @@ video_toggle_option(QAction *action, int *val)
 {
     startblit();
     *val ^= 1;
-    video_copy = (video_grayscale || invert_display) ? video_transform_copy : memcpy;
+    video_color_transform_update();
     action->setChecked(*val > 0 ? true : false);
     endblit();
     config_save();
@@ -1631,7 +1631,7 @@ update_greyscale_checkboxes(Ui::MainWindow *ui, QAction *selected, int value)
 
     startblit();
     video_grayscale = value;
-    video_copy      = (video_grayscale || invert_display) ? video_transform_copy : memcpy;
+    video_color_transform_update();
     endblit();
     device_force_redraw();
     config_save();
@@ -1674,7 +1674,10 @@ update_greyscale_type_checkboxes(Ui::MainWindow *ui, QAction *selected, int valu
     ui->actionBT709_HDTV->setChecked(ui->actionBT709_HDTV == selected);
     ui->actionAverage->setChecked(ui->actionAverage == selected);
 
+    startblit();
     video_graytype = value;
+    video_color_transform_update();
+    endblit();
     device_force_redraw();
     config_save();
 }
@@ -1960,6 +1963,8 @@ MainWindow::changeEvent(QEvent *event)
     }
 #endif
     QWidget::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange)
+        video_minimized = isMinimized();
     if (isVisible()) {
         monitor_settings[0].mon_window_maximized = isMaximized();
         config_save();
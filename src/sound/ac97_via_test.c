@@ -0,0 +1,814 @@
+/*
+ * 86Box     A hypervisor and IBM PC system emulator that specializes in
+ *           running old operating systems and software designed for IBM
+ *           PC systems and compatibles from 1981 through fairly recent
+ *           system designs based on the PCI bus.
+ *
+ *           This file is part of the 86Box distribution.
+ *
+ *           VIA AC'97 block DMA comparison test.
+ *
+ *           Runs two VIA AC'97 controllers side by side on the real timer
+ *           code. One runs its SGDs in blocks through ac97_via_sync(), the
+ *           other with copies of the per slot ac97_via_sgd_process() and
+ *           per sample ac97_via_poll_stereo() and ac97_via_poll_fm() the
+ *           blocks replaced, each on its own timer. A random driver points
+ *           all six SGDs at scatter gather tables, sets formats, interrupt
+ *           enables, auto-start, the variable sample rate and volumes,
+ *           starts, stops and pauses SGDs, acknowledges interrupts and
+ *           reads the registers at random times, doing the same to both
+ *           controllers. The register values, the interrupt line after
+ *           every step, every output buffer and the dwords written to
+ *           memory must be identical. The tables and buffers are filled
+ *           once up front, since the block runner reads them when a block
+ *           is run rather than on the slot, and written dwords are summed
+ *           up rather than stored for the same reason.
+ *
+ *           Build from this directory with:
+ *             gcc -O2 -I../include -I../cpu -o ac97_via_test ac97_via_test.c -lm
+ *
+ *           Usage: ac97_via_test [seeds]
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../timer.c"
+#include "snd_ac97_via.c"
+
+#define RAM_SIZE    (1 << 20)
+#define TABLES      64
+#define TABLE_BASE  0x80000
+#define TABLE_SIZE  0x100
+#define AUDIO_BASE  0x1000
+#define MODEM_BASE  0x1100
+
+uint64_t tsc              = 0;
+int      sound_pos_global = 0;
+
+ac97_codec_t **ac97_codec             = NULL;
+ac97_codec_t **ac97_modem_codec       = NULL;
+int            ac97_codec_count       = 0;
+int            ac97_modem_codec_count = 0;
+int            ac97_codec_id          = 0;
+int            ac97_modem_codec_id    = 0;
+
+static uint8_t      guest_ram[RAM_SIZE];
+static ac97_codec_t codecs[2];
+static ac97_via_t  *dev;
+static ac97_via_t  *ref;
+static ac97_via_t  *cur;
+static pc_timer_t   ref_dma_timer[6];
+static pc_timer_t   ref_poll_timer[6];
+static pc_timer_t   sound_timer;
+static uint64_t     sound_latch;
+static int          irq_changes[2];
+static uint64_t     writes[2];
+static int32_t      out_dev[SOUNDBUFLEN * 2];
+static int32_t      out_ref[SOUNDBUFLEN * 2];
+static int          buffers;
+static uint32_t     rng;
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void
+pclog_ex(UNUSED(const char *fmt), UNUSED(va_list ap))
+{
+}
+
+void
+io_sethandler(UNUSED(uint16_t base), UNUSED(int size),
+              UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+              UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+              UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+              UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+              UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+              UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+              UNUSED(void *priv))
+{
+}
+
+void
+io_removehandler(UNUSED(uint16_t base), UNUSED(int size),
+                 UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+                 UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+                 UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+                 UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+                 UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+                 UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+                 UNUSED(void *priv))
+{
+}
+
+void
+sound_add_handler(UNUSED(void (*get_buffer)(int32_t *buffer, int len, void *priv)), UNUSED(void *priv))
+{
+}
+
+void
+sound_set_cd_audio_filter(UNUSED(void (*filter)(int channel, double *buffer, void *priv)), UNUSED(void *priv))
+{
+}
+
+uint64_t
+sound_get_pos_ts(int pos)
+{
+    return sound_timer.ts.ts64 - ((uint64_t) (sound_pos_global - pos) * sound_latch);
+}
+
+void
+ac97_codec_reset(UNUSED(void *priv))
+{
+}
+
+uint16_t
+ac97_codec_readw(ac97_codec_t *codec, uint8_t reg)
+{
+    return codec->regs[(reg >> 1) & 0x3f];
+}
+
+void
+ac97_codec_writew(ac97_codec_t *codec, uint8_t reg, uint16_t val)
+{
+    codec->regs[(reg >> 1) & 0x3f] = val;
+}
+
+/* Volumes come from the guest's codec writes, so any fixed mapping does. */
+void
+ac97_codec_getattn(void *priv, uint8_t reg, int *l, int *r)
+{
+    const ac97_codec_t *codec = (ac97_codec_t *) priv;
+    uint16_t            val   = codec->regs[(reg >> 1) & 0x3f];
+
+    *l = 0x4000 + ((val >> 8) << 7);
+    *r = 0x4000 + ((val & 0xff) << 7);
+}
+
+uint32_t
+ac97_codec_getrate(void *priv, uint8_t reg)
+{
+    const ac97_codec_t *codec = (ac97_codec_t *) priv;
+    uint16_t            val   = codec->regs[(reg >> 1) & 0x3f];
+
+    return 8000 + (val % 40001);
+}
+
+void
+pci_irq(UNUSED(uint8_t slot), UNUSED(uint8_t pci_int), UNUSED(int level), int set, uint8_t *irq_state)
+{
+    if (*irq_state != set)
+        irq_changes[irq_state == &ref->irq_state]++;
+    *irq_state = set;
+}
+
+uint32_t
+mem_readl_phys(uint32_t addr)
+{
+    addr &= RAM_SIZE - 4;
+
+    return guest_ram[addr] | (guest_ram[addr + 1] << 8) | (guest_ram[addr + 2] << 16) | ((uint32_t) guest_ram[addr + 3] << 24);
+}
+
+/* Written dwords are summed up per controller instead of stored, so that
+   both keep reading the same memory. The sum does not depend on the order,
+   as the block runner moves one SGD's block before the next one's. */
+void
+mem_writel_phys(uint32_t addr, uint32_t val)
+{
+    uint64_t x = ((uint64_t) addr << 32) | val;
+
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    writes[cur == ref] += x;
+}
+
+/* The output update as it was before it took a time stamp. */
+static void
+ref_update_stereo(ac97_via_t *dev, ac97_via_sgd_t *sgd)
+{
+    int32_t l = (((sgd->out_l * sgd->vol_l) >> 15) * dev->master_vol_l) >> 15;
+    int32_t r = (((sgd->out_r * sgd->vol_r) >> 15) * dev->master_vol_r) >> 15;
+
+    if (l < -32768)
+        l = -32768;
+    else if (l > 32767)
+        l = 32767;
+    if (r < -32768)
+        r = -32768;
+    else if (r > 32767)
+        r = 32767;
+
+    for (; sgd->pos < sound_pos_global; sgd->pos++) {
+        sgd->buffer[sgd->pos * 2]     = l;
+        sgd->buffer[sgd->pos * 2 + 1] = r;
+    }
+}
+
+/* The per slot DMA transfer, running off its own timer. */
+static void
+ref_sgd_process(void *priv)
+{
+    ac97_via_sgd_t *sgd = (ac97_via_sgd_t *) priv;
+    ac97_via_t     *dev = sgd->dev;
+
+    /* Stop if this SGD is not active. */
+    uint8_t sgd_status = dev->sgd_regs[sgd->id] & 0xc4;
+    if (!(sgd_status & 0x80))
+        return;
+
+    /* Schedule next run. */
+    timer_on_auto(&ref_dma_timer[sgd->id >> 4], 10.0);
+
+    /* Process SGD if it's active, and the FIFO has room or is disabled. */
+    if (((sgd_status & 0xc7) == 0x80) && (sgd->always_run || ((sgd->fifo_end - sgd->fifo_pos) <= (sizeof(sgd->fifo) - 4)))) {
+        /* Move on to the next block if no entry is present. */
+        if (sgd->restart) {
+            /* (Re)load entry pointer if required. */
+            if (sgd->restart & 2)
+                sgd->entry_ptr = *((uint32_t *) &dev->sgd_regs[sgd->id | 0x4]) & 0xfffffffe; /* TODO: probe real hardware - does "even addr" actually mean dword aligned? */
+            sgd->restart = 0;
+
+            /* Read entry. */
+            sgd->sample_ptr = mem_readl_phys(sgd->entry_ptr);
+            sgd->entry_ptr += 4;
+            sgd->sample_count = mem_readl_phys(sgd->entry_ptr);
+            sgd->entry_ptr += 4;
+#ifdef ENABLE_AC97_VIA_LOG
+            if (((sgd->sample_ptr == 0xffffffff) && (sgd->sample_count == 0xffffffff)) || ((sgd->sample_ptr == 0x00000000) && (sgd->sample_count == 0x00000000)))
+                fatal("AC97 VIA: Invalid SGD %d entry %08X%08X at %08X\n", sgd->id >> 4,
+                      sgd->sample_ptr, sgd->sample_count, sgd->entry_ptr - 8);
+#endif
+
+            /* Extract flags from the most significant byte. */
+            sgd->entry_flags = sgd->sample_count >> 24;
+            sgd->sample_count &= 0xffffff;
+
+            ac97_via_log("AC97 VIA: Starting SGD %d block at %08X start %08X len %06X flags %02X\n", sgd->id >> 4,
+                         sgd->entry_ptr - 8, sgd->sample_ptr, sgd->sample_count, sgd->entry_flags);
+        }
+
+        if (sgd->id & 0x10) {
+            /* Write channel: read data from FIFO. */
+            mem_writel_phys(sgd->sample_ptr, *((uint32_t *) &sgd->fifo[sgd->fifo_end & (sizeof(sgd->fifo) - 1)]));
+        } else {
+            /* Read channel: write data to FIFO. */
+            *((uint32_t *) &sgd->fifo[sgd->fifo_end & (sizeof(sgd->fifo) - 1)]) = mem_readl_phys(sgd->sample_ptr);
+        }
+        sgd->fifo_end += 4;
+        sgd->sample_ptr += 4;
+        sgd->sample_count -= 4;
+
+        /* Check if we've hit the end of this block. */
+        if (sgd->sample_count <= 0) {
+            ac97_via_log("AC97 VIA: Ending SGD %d block", sgd->id >> 4);
+
+            /* Move on to the next block on the next run, unless overridden below. */
+            sgd->restart = 1;
+
+            if (sgd->entry_flags & 0x20) {
+                ac97_via_log(" with STOP");
+
+                /* Raise STOP to pause SGD. */
+                dev->sgd_regs[sgd->id] |= 0x04;
+            }
+
+            if (sgd->entry_flags & 0x40) {
+                ac97_via_log(" with FLAG");
+
+                /* Raise FLAG to pause SGD. */
+                dev->sgd_regs[sgd->id] |= 0x01;
+
+#ifdef ENABLE_AC97_VIA_LOG
+                if (dev->sgd_regs[sgd->id | 0x2] & 0x01)
+                    ac97_via_log(" interrupt");
+#endif
+            }
+
+            if (sgd->entry_flags & 0x80) {
+                ac97_via_log(" with EOL");
+
+                /* Raise EOL. */
+                dev->sgd_regs[sgd->id] |= 0x02;
+
+#ifdef ENABLE_AC97_VIA_LOG
+                if (dev->sgd_regs[sgd->id | 0x2] & 0x02)
+                    ac97_via_log(" interrupt");
+#endif
+
+                /* Restart SGD if a trigger is queued or auto-start is enabled. */
+                if ((dev->sgd_regs[sgd->id] & 0x08) || (dev->sgd_regs[sgd->id | 0x2] & 0x80)) {
+                    ac97_via_log(" restart");
+
+                    /* Un-queue trigger. */
+                    dev->sgd_regs[sgd->id] &= ~0x08;
+
+                    /* Go back to the starting block on the next run. */
+                    sgd->restart = 2;
+                } else {
+                    ac97_via_log(" finish");
+
+                    /* Terminate SGD. */
+                    dev->sgd_regs[sgd->id] &= ~0x80;
+                }
+            }
+            ac97_via_log("\n");
+
+            /* Fire any requested status interrupts. */
+            ac97_via_update_irqs(dev);
+        }
+    }
+}
+
+/* The per sample PCM poll, running off its own timer. */
+static void
+ref_poll_stereo(void *priv)
+{
+    ac97_via_t     *dev = (ac97_via_t *) priv;
+    ac97_via_sgd_t *sgd = &dev->sgd[0]; /* Audio Read */
+
+    /* Schedule next run if PCM playback is enabled. */
+    if (dev->pcm_enabled)
+        timer_advance_u64(&ref_poll_timer[sgd->id >> 4], sgd->timer_latch);
+
+    /* Update stereo audio buffer. */
+    ref_update_stereo(dev, sgd);
+
+    /* Feed next sample from the FIFO. */
+    switch (dev->sgd_regs[sgd->id | 0x2] & 0x30) {
+        case 0x00: /* Mono, 8-bit PCM */
+            if ((sgd->fifo_end - sgd->fifo_pos) >= 1) {
+                sgd->out_l = sgd->out_r = (sgd->fifo[sgd->fifo_pos++ & (sizeof(sgd->fifo) - 1)] ^ 0x80) << 8;
+                return;
+            }
+            break;
+
+        case 0x10: /* Stereo, 8-bit PCM */
+            if ((sgd->fifo_end - sgd->fifo_pos) >= 2) {
+                sgd->out_l = (sgd->fifo[sgd->fifo_pos++ & (sizeof(sgd->fifo) - 1)] ^ 0x80) << 8;
+                sgd->out_r = (sgd->fifo[sgd->fifo_pos++ & (sizeof(sgd->fifo) - 1)] ^ 0x80) << 8;
+                return;
+            }
+            break;
+
+        case 0x20: /* Mono, 16-bit PCM */
+            if ((sgd->fifo_end - sgd->fifo_pos) >= 2) {
+                sgd->out_l = sgd->out_r = *((uint16_t *) &sgd->fifo[sgd->fifo_pos & (sizeof(sgd->fifo) - 1)]);
+                sgd->fifo_pos += 2;
+                return;
+            }
+            break;
+
+        case 0x30: /* Stereo, 16-bit PCM */
+            if ((sgd->fifo_end - sgd->fifo_pos) >= 4) {
+                sgd->out_l = *((uint16_t *) &sgd->fifo[sgd->fifo_pos & (sizeof(sgd->fifo) - 1)]);
+                sgd->fifo_pos += 2;
+                sgd->out_r = *((uint16_t *) &sgd->fifo[sgd->fifo_pos & (sizeof(sgd->fifo) - 1)]);
+                sgd->fifo_pos += 2;
+                return;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    /* Feed silence if the FIFO is empty. */
+    sgd->out_l = sgd->out_r = 0;
+}
+
+/* The per sample FM poll, running off its own timer. */
+static void
+ref_poll_fm(void *priv)
+{
+    ac97_via_t     *dev = (ac97_via_t *) priv;
+    ac97_via_sgd_t *sgd = &dev->sgd[2]; /* FM Read */
+
+    /* Schedule next run if FM playback is enabled. */
+    if (dev->fm_enabled)
+        timer_advance_u64(&ref_poll_timer[sgd->id >> 4], sgd->timer_latch);
+
+    /* Update FM audio buffer. */
+    ref_update_stereo(dev, sgd);
+
+    /* Feed next sample from the FIFO.
+       The data format is not documented, but it probes as 16-bit stereo at 24 KHz. */
+    if ((sgd->fifo_end - sgd->fifo_pos) >= 4) {
+        sgd->out_l = *((uint16_t *) &sgd->fifo[sgd->fifo_pos & (sizeof(sgd->fifo) - 1)]);
+        sgd->fifo_pos += 2;
+        sgd->out_r = *((uint16_t *) &sgd->fifo[sgd->fifo_pos & (sizeof(sgd->fifo) - 1)]);
+        sgd->fifo_pos += 2;
+        return;
+    }
+
+    /* Feed silence if the FIFO is empty. */
+    sgd->out_l = sgd->out_r = 0;
+}
+
+static void
+ref_get_buffer(int32_t *buffer, int len, void *priv)
+{
+    ac97_via_t *dev = (ac97_via_t *) priv;
+
+    ref_update_stereo(dev, &dev->sgd[0]);
+    ref_update_stereo(dev, &dev->sgd[2]);
+
+    for (int c = 0; c < len * 2; c++) {
+        buffer[c] += dev->sgd[0].buffer[c] / 2;
+        buffer[c] += dev->sgd[2].buffer[c] / 2;
+    }
+
+    dev->sgd[0].pos = dev->sgd[2].pos = 0;
+}
+
+
+static void
+dev_sgd_process(void *priv)
+{
+    cur = dev;
+    ac97_via_sgd_process(priv);
+}
+
+static void
+dev_poll(void *priv)
+{
+    cur = dev;
+    ac97_via_poll(priv);
+}
+
+static void
+ref_dma_timer_process(void *priv)
+{
+    cur = ref;
+    ref_sgd_process(priv);
+}
+
+static void
+ref_poll_timer_process(void *priv)
+{
+    cur = ref;
+    if (priv == &ref->sgd[0])
+        ref_poll_stereo(ref);
+    else
+        ref_poll_fm(ref);
+}
+
+static void
+sound_poll_test(UNUSED(void *priv))
+{
+    timer_advance_u64(&sound_timer, sound_latch);
+
+    sound_pos_global++;
+    if (sound_pos_global == SOUNDBUFLEN) {
+        memset(out_dev, 0, sizeof(out_dev));
+        memset(out_ref, 0, sizeof(out_ref));
+        cur = dev;
+        ac97_via_get_buffer(out_dev, SOUNDBUFLEN, dev);
+        cur = ref;
+        ref_get_buffer(out_ref, SOUNDBUFLEN, ref);
+
+        for (int c = 0; c < (SOUNDBUFLEN * 2); c++) {
+            if (out_dev[c] != out_ref[c])
+                fatal("Buffer %i sample %i: %i, should be %i\n", buffers, c, out_dev[c], out_ref[c]);
+        }
+        buffers++;
+
+        sound_pos_global = 0;
+    }
+}
+
+static uint32_t
+rnd(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+
+    return rng;
+}
+
+static void
+parked_timer(UNUSED(void *priv))
+{
+    fatal("Reference controller ran the block runner\n");
+}
+
+static void
+park_timer(pc_timer_t *timer)
+{
+    int enabled = timer_is_enabled(timer);
+
+    timer_disable(timer);
+    timer->ts.ts64         = 0ULL;
+    timer->ts.ts32.integer = (uint32_t) tsc + 0x40000000;
+    if (enabled)
+        timer_enable(timer);
+}
+
+/* The reference controller must never run the block runner, so its timers
+   are kept well out of reach around every register access. */
+static void
+park(void)
+{
+    for (int i = 0; i < 6; i++) {
+        park_timer(&ref->sgd[i].dma_timer);
+        park_timer(&ref->sgd[i].poll_timer);
+        ref->sgd[i].dma_ahead = ref->sgd[i].poll_ahead = 0;
+    }
+}
+
+static uint16_t
+sgd_port(int n, uint8_t reg)
+{
+    return ((n >= 4) ? MODEM_BASE : AUDIO_BASE) | (n << 4) | reg;
+}
+
+static void
+sgd_write_both(uint16_t port, uint8_t val)
+{
+    int n       = (port >> 4) & 0x0f;
+    int running = 0;
+
+    cur = dev;
+    ac97_via_sgd_write(port, val, dev);
+
+    park();
+    if (n < 6)
+        running = ref->sgd_regs[n << 4] & 0x80;
+    cur = ref;
+    ac97_via_sgd_write(port, val, ref);
+
+    /* Start the reference's DMA timer where the per slot code did. */
+    if ((n < 6) && ((port & 0x0f) == 0x1) && (val & 0x80) && !running)
+        timer_set_delay_u64(&ref_dma_timer[n], (uint64_t) (10.0 * ((double) TIMER_USEC)));
+    park();
+}
+
+static void
+write_control_both(uint8_t val)
+{
+    uint8_t  pcm   = ref->pcm_enabled;
+    uint8_t  fm    = ref->fm_enabled;
+    uint64_t latch = ref->sgd[0].timer_latch;
+
+    cur = dev;
+    ac97_via_write_control(dev, 0, val);
+
+    park();
+    cur = ref;
+    ac97_via_write_control(ref, 0, val);
+
+    /* Advance the reference's poll timers where the per sample code did. */
+    if (!pcm && ref->pcm_enabled)
+        timer_advance_u64(&ref_poll_timer[0], latch);
+    if (!fm && ref->fm_enabled)
+        timer_advance_u64(&ref_poll_timer[2], ref->sgd[2].timer_latch);
+    park();
+}
+
+static void
+check_regs(void)
+{
+    uint8_t a;
+    uint8_t b;
+
+    for (int n = 0; n < 6; n++) {
+        for (int reg = 0x0; reg <= 0xf; reg++) {
+            cur = dev;
+            a   = ac97_via_sgd_read(sgd_port(n, reg), dev);
+            park();
+            cur = ref;
+            b   = ac97_via_sgd_read(sgd_port(n, reg), ref);
+            park();
+
+            if (a != b)
+                fatal("SGD %i register %X: %02X, should be %02X\n", n, reg, a, b);
+        }
+    }
+
+    for (int port = 0x84; port <= 0x87; port++) {
+        cur = dev;
+        a   = ac97_via_sgd_read(AUDIO_BASE | port, dev);
+        park();
+        cur = ref;
+        b   = ac97_via_sgd_read(AUDIO_BASE | port, ref);
+        park();
+
+        if (a != b)
+            fatal("Register %02X: %02X, should be %02X\n", port, a, b);
+    }
+
+    if (writes[0] != writes[1])
+        fatal("Written data sum %016" PRIX64 ", should be %016" PRIX64 "\n", writes[0], writes[1]);
+}
+
+static void
+fill_tables(void)
+{
+    for (int t = 0; t < TABLES; t++) {
+        uint32_t base    = TABLE_BASE + (t * TABLE_SIZE);
+        int      entries = 1 + (rnd() % 8);
+
+        for (int e = 0; e < entries; e++) {
+            uint32_t ptr   = rnd() % (RAM_SIZE - 0x10000);
+            uint32_t count = 1 + (rnd() % ((rnd() & 3) ? 256 : 8192));
+            uint32_t flags = rnd() & ((rnd() & 3) ? 0x40 : 0x60);
+
+            if (e == (entries - 1))
+                flags |= 0x80;
+
+            for (int i = 0; i < 4; i++) {
+                guest_ram[base + (e * 8) + i]     = ptr >> (8 * i);
+                guest_ram[base + (e * 8) + 4 + i] = (count | (flags << 24)) >> (8 * i);
+            }
+        }
+    }
+}
+
+/* Mostly the PCM and FM read SGDs, as those have pollers. */
+static int
+random_sgd(void)
+{
+    static const int sgds[] = { 0, 0, 0, 2, 2, 1, 3, 4, 5 };
+
+    return sgds[rnd() % (sizeof(sgds) / sizeof(sgds[0]))];
+}
+
+static void
+program_sgd(int n)
+{
+    uint32_t table = TABLE_BASE + ((rnd() % TABLES) * TABLE_SIZE) + ((rnd() & 7) ? 0 : 1);
+
+    for (int i = 0; i < 4; i++)
+        sgd_write_both(sgd_port(n, 0x4 + i), table >> (8 * i));
+    sgd_write_both(sgd_port(n, 0x2), rnd() & 0xb3);
+}
+
+static void
+random_op(void)
+{
+    int n = random_sgd();
+
+    switch (rnd() % 12) {
+        case 0:
+            /* Start an SGD, sometimes with a new table. */
+            if (rnd() & 1)
+                program_sgd(n);
+            sgd_write_both(sgd_port(n, 0x1), 0x80);
+            break;
+        case 1:
+            sgd_write_both(sgd_port(n, 0x1), 0x40);
+            break;
+        case 2:
+            sgd_write_both(sgd_port(n, 0x1), (dev->sgd_regs[n << 4] & 0x40) ? 0x00 : 0x08);
+            break;
+        case 3:
+            /* Acknowledge status the way the drivers do. */
+            sgd_write_both(sgd_port(n, 0x0), (rnd() & 3) ? (dev->sgd_regs[n << 4] & 0x07) : (rnd() & 0x07));
+            break;
+        case 4:
+            sgd_write_both(sgd_port(n, 0x2), rnd() & 0xb3);
+            break;
+        case 5:
+            program_sgd(n);
+            break;
+        case 6:
+            /* Variable sample rate on or off, now and then stopping and
+               restarting playback in one go. */
+            if (rnd() & 1) {
+                write_control_both(0xc0);
+                write_control_both(0xc6);
+            } else
+                write_control_both((rnd() & 1) ? 0xce : 0xc6);
+            break;
+        case 7:
+            /* Codec write: master, PCM or CD volume or the PCM rate. */
+            {
+                static const uint8_t regs[] = { 0x02, 0x18, 0x12, 0x2c };
+                uint16_t             val    = rnd();
+
+                sgd_write_both(AUDIO_BASE | 0x83, 0x00);
+                sgd_write_both(AUDIO_BASE | 0x80, val);
+                sgd_write_both(AUDIO_BASE | 0x81, val >> 8);
+                sgd_write_both(AUDIO_BASE | 0x82, regs[rnd() & 3]);
+            }
+            break;
+        default:
+            check_regs();
+            break;
+    }
+}
+
+static void
+run(uint32_t seed)
+{
+    int steps;
+
+    rng = seed * 2654435761u + 1;
+
+    for (int i = 0; i < RAM_SIZE; i++)
+        guest_ram[i] = rnd() >> 24;
+    fill_tables();
+
+    memset(codecs, 0, sizeof(codecs));
+    dev = ac97_via_init(NULL);
+    ref = ac97_via_init(NULL);
+    dev->codec[0][0] = &codecs[0];
+    ref->codec[0][0] = &codecs[1];
+    ac97_via_remap_audio_sgd(dev, AUDIO_BASE, 1);
+    ac97_via_remap_modem_sgd(dev, MODEM_BASE, 1);
+    ac97_via_remap_audio_sgd(ref, AUDIO_BASE, 1);
+    ac97_via_remap_modem_sgd(ref, MODEM_BASE, 1);
+
+    for (int i = 0; i < 6; i++) {
+        timer_set_callback(&dev->sgd[i].dma_timer, dev_sgd_process);
+        timer_set_callback(&ref->sgd[i].dma_timer, parked_timer);
+        timer_add(&ref_dma_timer[i], ref_dma_timer_process, &ref->sgd[i], 0);
+    }
+    for (int i = 0; i <= 2; i += 2) {
+        timer_set_callback(&dev->sgd[i].poll_timer, dev_poll);
+        timer_set_callback(&ref->sgd[i].poll_timer, parked_timer);
+        timer_add(&ref_poll_timer[i], ref_poll_timer_process, &ref->sgd[i], 0);
+
+        /* The pollers pick up from their last sample, so start both from
+           now rather than from the previous seed. */
+        dev->sgd[i].poll_timer.ts.ts64 = ref_poll_timer[i].ts.ts64 = tsc << 32;
+    }
+
+    sound_latch = (uint64_t) (((double) TIMER_USEC) * (1000000.0 / 48000.0));
+    timer_add(&sound_timer, sound_poll_test, NULL, 0);
+    timer_set_delay_u64(&sound_timer, (sound_latch / 4) + (rnd() % (sound_latch / 2)));
+    sound_pos_global = 0;
+
+    write_control_both(0xc6);
+    for (int n = 0; n < 6; n++) {
+        program_sgd(n);
+        sgd_write_both(sgd_port(n, 0x1), 0x80);
+    }
+
+    irq_changes[0] = irq_changes[1] = 0;
+    writes[0] = writes[1] = 0;
+    buffers               = 0;
+
+    for (steps = 0; buffers < 200; steps++) {
+        /* Mostly short steps, so interrupts are checked close to when they
+           are raised, with the odd long one. */
+        uint32_t slot = (uint32_t) (((uint64_t) (10.0 * ((double) TIMER_USEC))) >> 32);
+
+        tsc += (rnd() & 15) ? (1 + (rnd() % (2 * slot))) : (rnd() % (200 * slot));
+        timer_process();
+
+        if (dev->irq_state != ref->irq_state)
+            fatal("Step %i: IRQ is %i, should be %i\n", steps, dev->irq_state, ref->irq_state);
+
+        if (!(rnd() % 40))
+            random_op();
+    }
+
+    check_regs();
+    if (irq_changes[0] != irq_changes[1])
+        fatal("IRQ changed %i times, should be %i\n", irq_changes[0], irq_changes[1]);
+
+    printf("Seed %u: %i steps, %i IRQ changes, identical\n", seed, steps, irq_changes[1]);
+
+    for (int i = 0; i < 6; i++) {
+        timer_disable(&dev->sgd[i].dma_timer);
+        timer_disable(&dev->sgd[i].poll_timer);
+        timer_disable(&ref->sgd[i].dma_timer);
+        timer_disable(&ref->sgd[i].poll_timer);
+        timer_disable(&ref_dma_timer[i]);
+        timer_disable(&ref_poll_timer[i]);
+    }
+    timer_disable(&sound_timer);
+    free(dev);
+    free(ref);
+}
+
+int
+main(int argc, char **argv)
+{
+    int seeds = (argc > 1) ? atoi(argv[1]) : 20;
+
+    TIMER_USEC = (uint64_t) 100 << 32;
+    timer_init();
+
+    for (int seed = 1; seed <= seeds; seed++)
+        run(seed);
+
+    return 0;
+}
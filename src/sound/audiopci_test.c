@@ -0,0 +1,785 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          AudioPCI block poll comparison test.
+ *
+ *          Runs two AudioPCIs side by side on the real timer code. One
+ *          polls in blocks through es1371_poll_sync(), the other with a
+ *          copy of the per sample es1371_poll() the blocks replaced,
+ *          including the byte at a time DAC fetch and the full 91-tap SRC
+ *          filter. A random driver programs buffers, formats, sample
+ *          rates, sample counts, SRC bypass and volumes, acknowledges
+ *          interrupts and reads the registers at random times, doing the
+ *          same to both cards. The register values, the interrupt line
+ *          after every step and every output buffer must be identical.
+ *          The guest buffers are filled once up front, since the block
+ *          poller reads them when a block is run rather than on the
+ *          sample, and MIDI input is left out, since it arrives from
+ *          another thread in the emulator.
+ *
+ *          Build from this directory with:
+ *            gcc -O2 -I../include -I../cpu -o audiopci_test audiopci_test.c -lm
+ *
+ *          Usage: audiopci_test [seeds]
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../timer.c"
+#include "snd_audiopci.c"
+
+#define RAM_SIZE (1 << 20)
+
+uint64_t tsc              = 0;
+int      sound_pos_global = 0;
+int      nmi              = 0;
+
+ac97_codec_t **ac97_codec       = NULL;
+int            ac97_codec_count = 0;
+int            ac97_codec_id    = 0;
+
+const device_t gameport_pnp_device = { 0 };
+
+static uint8_t    guest_ram[RAM_SIZE];
+static es1371_t  *dev;
+static es1371_t  *ref;
+static pc_timer_t ref_timer;
+static pc_timer_t sound_timer;
+static uint64_t   sound_latch;
+static int        irq_changes[2];
+static int32_t    out_dev[SOUNDBUFLEN * 2];
+static int32_t    out_ref[SOUNDBUFLEN * 2];
+static int        buffers;
+static uint32_t   rng;
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void
+pclog_ex(UNUSED(const char *fmt), UNUSED(va_list ap))
+{
+}
+
+void
+io_handler(UNUSED(int set), UNUSED(uint16_t base), UNUSED(int size),
+           UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+           UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+           UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+           UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+           UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+           UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+           UNUSED(void *priv))
+{
+}
+
+void
+io_sethandler(UNUSED(uint16_t base), UNUSED(int size),
+              UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+              UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+              UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+              UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+              UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+              UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+              UNUSED(void *priv))
+{
+}
+
+void
+io_removehandler(UNUSED(uint16_t base), UNUSED(int size),
+                 UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+                 UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+                 UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+                 UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+                 UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+                 UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+                 UNUSED(void *priv))
+{
+}
+
+void
+nmi_raise(void)
+{
+}
+
+void *
+gameport_add(UNUSED(const device_t *gameport_type))
+{
+    return NULL;
+}
+
+void
+gameport_remap(UNUSED(void *priv), UNUSED(uint16_t address))
+{
+}
+
+void
+midi_in_handler(UNUSED(int set), UNUSED(void (*msg)(void *priv, uint8_t *msg, uint32_t len)),
+                UNUSED(int (*sysex)(void *priv, uint8_t *buffer, uint32_t len, int abort)),
+                UNUSED(void *priv))
+{
+}
+
+void
+midi_raw_out_byte(UNUSED(uint8_t val))
+{
+}
+
+void
+sound_add_handler(UNUSED(void (*get_buffer)(int32_t *buffer, int len, void *priv)), UNUSED(void *priv))
+{
+}
+
+void
+sound_set_cd_audio_filter(UNUSED(void (*filter)(int channel, double *buffer, void *priv)), UNUSED(void *priv))
+{
+}
+
+uint64_t
+sound_get_pos_ts(int pos)
+{
+    return sound_timer.ts.ts64 - ((uint64_t) (sound_pos_global - pos) * sound_latch);
+}
+
+int
+device_get_config_int(UNUSED(const char *name))
+{
+    return 0;
+}
+
+void *
+device_add(UNUSED(const device_t *info))
+{
+    return NULL;
+}
+
+const device_t *
+ac97_codec_get(UNUSED(uint32_t id))
+{
+    return NULL;
+}
+
+uint16_t
+ac97_codec_readw(UNUSED(ac97_codec_t *codec), uint8_t reg)
+{
+    return reg * 0x0101;
+}
+
+void
+ac97_codec_writew(UNUSED(ac97_codec_t *codec), UNUSED(uint8_t reg), UNUSED(uint16_t val))
+{
+}
+
+/* Volumes come from the guest's codec writes, so any fixed values do. */
+void
+ac97_codec_getattn(UNUSED(void *priv), uint8_t reg, int *l, int *r)
+{
+    *l = 0x6000 + (reg << 8);
+    *r = 0x7000 - (reg << 8);
+}
+
+void
+pci_add_card(UNUSED(uint8_t add_type), UNUSED(uint8_t (*read)(int func, int addr, void *priv)),
+             UNUSED(void (*write)(int func, int addr, uint8_t val, void *priv)), UNUSED(void *priv),
+             uint8_t *slot)
+{
+    *slot = 0;
+}
+
+void
+pci_irq(UNUSED(uint8_t slot), UNUSED(uint8_t pci_int), UNUSED(int level), int set, uint8_t *irq_state)
+{
+    if (*irq_state != set)
+        irq_changes[irq_state == &ref->irq_state]++;
+    *irq_state = set;
+}
+
+void
+dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, UNUSED(int TransferSize))
+{
+    for (uint32_t i = 0; i < TotalSize; i++)
+        DataRead[i] = guest_ram[(PhysAddress + i) & (RAM_SIZE - 1)];
+}
+
+uint8_t
+mem_readb_phys(uint32_t addr)
+{
+    return guest_ram[addr & (RAM_SIZE - 1)];
+}
+
+uint16_t
+mem_readw_phys(uint32_t addr)
+{
+    return mem_readb_phys(addr) | (mem_readb_phys(addr + 1) << 8);
+}
+
+/* The DAC fetch as it was before bus master reads. */
+static void
+ref_fetch(es1371_t *dev, int dac_nr)
+{
+    if (dev->si_cr & (dac_nr ? SI_P2_PAUSE : SI_P1_PAUSE))
+        return;
+
+    int format = dac_nr ? ((dev->si_cr >> 2) & 3) : (dev->si_cr & 3);
+    int pos    = dev->dac[dac_nr].buffer_pos & 63;
+    int c;
+
+    switch (format) {
+        case FORMAT_MONO_8:
+            for (c = 0; c < 32; c += 4) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 1) ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_l[(pos + c + 2) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 2) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 2) ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_l[(pos + c + 3) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 3) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 3) ^ 0x80) << 8;
+                dev->dac[dac_nr].addr += 4;
+
+                dev->dac[dac_nr].buffer_pos_end += 4;
+                dev->dac[dac_nr].count++;
+
+                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
+                    dev->dac[dac_nr].count = 0;
+                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
+                    break;
+                }
+            }
+            break;
+
+        case FORMAT_STEREO_8:
+            for (c = 0; c < 16; c += 2) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63]     = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_r[(pos + c) & 63]     = (mem_readb_phys(dev->dac[dac_nr].addr + 1) ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 2) ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 3) ^ 0x80) << 8;
+                dev->dac[dac_nr].addr += 4;
+
+                dev->dac[dac_nr].buffer_pos_end += 2;
+                dev->dac[dac_nr].count++;
+
+                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
+                    dev->dac[dac_nr].count = 0;
+                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
+                    break;
+                }
+            }
+            break;
+
+        case FORMAT_MONO_16:
+            for (c = 0; c < 16; c += 2) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
+                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
+                dev->dac[dac_nr].addr += 4;
+
+                dev->dac[dac_nr].buffer_pos_end += 2;
+                dev->dac[dac_nr].count++;
+
+                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
+                    dev->dac[dac_nr].count = 0;
+                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
+                    break;
+                }
+            }
+            break;
+
+        case FORMAT_STEREO_16:
+            for (c = 0; c < 4; c++) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
+                dev->dac[dac_nr].buffer_r[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
+                dev->dac[dac_nr].addr += 4;
+
+                dev->dac[dac_nr].buffer_pos_end++;
+                dev->dac[dac_nr].count++;
+
+                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
+                    dev->dac[dac_nr].count = 0;
+                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
+                    break;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* The SRC filter as it was before it was split into phases. */
+static inline float
+ref_low_fir(int dac_nr, int i, float NewSample)
+{
+    static float x[2][2][128]; // input samples
+    static int   x_pos[2] = { 0, 0 };
+    float        out      = 0.0;
+    int          read_pos;
+    int          n_coef;
+    int          pos = x_pos[dac_nr];
+
+    x[dac_nr][i][pos] = NewSample;
+
+    /* Since only 1/16th of input samples are non-zero, only filter those that
+       are valid.*/
+    read_pos = (pos + 15) & (127 & ~15);
+    n_coef   = (16 - pos) & 15;
+
+    while (n_coef < ES1371_NCoef) {
+        out += low_fir_es1371_coef[n_coef] * x[dac_nr][i][read_pos];
+        read_pos = (read_pos + 16) & (127 & ~15);
+        n_coef += 16;
+    }
+
+    if (i == 1) {
+        x_pos[dac_nr] = (x_pos[dac_nr] + 1) & 127;
+        if (x_pos[dac_nr] > 127)
+            x_pos[dac_nr] = 0;
+    }
+
+    return out;
+}
+
+static void
+ref_next_sample_filtered(es1371_t *dev, int dac_nr, int out_idx)
+{
+    int out_l;
+    int out_r;
+
+    if ((dev->dac[dac_nr].buffer_pos - dev->dac[dac_nr].buffer_pos_end) >= 0)
+        ref_fetch(dev, dac_nr);
+
+    out_l = dev->dac[dac_nr].buffer_l[dev->dac[dac_nr].buffer_pos & 63];
+    out_r = dev->dac[dac_nr].buffer_r[dev->dac[dac_nr].buffer_pos & 63];
+
+    dev->dac[dac_nr].filtered_l[out_idx] = (int) ref_low_fir(dac_nr, 0, (float) out_l);
+    dev->dac[dac_nr].filtered_r[out_idx] = (int) ref_low_fir(dac_nr, 1, (float) out_r);
+
+    for (uint8_t c = 1; c < 16; c++) {
+        dev->dac[dac_nr].filtered_l[out_idx + c] = (int) ref_low_fir(dac_nr, 0, 0);
+        dev->dac[dac_nr].filtered_r[out_idx + c] = (int) ref_low_fir(dac_nr, 1, 0);
+    }
+
+    dev->dac[dac_nr].buffer_pos++;
+}
+
+static void
+ref_update(es1371_t *dev)
+{
+    int32_t l;
+    int32_t r;
+
+    l = (dev->dac[0].out_l * dev->dac[0].vol_l) >> 12;
+    l += ((dev->dac[1].out_l * dev->dac[1].vol_l) >> 12);
+    r = (dev->dac[0].out_r * dev->dac[0].vol_r) >> 12;
+    r += ((dev->dac[1].out_r * dev->dac[1].vol_r) >> 12);
+
+    l >>= 1;
+    r >>= 1;
+
+    l = (((l * dev->pcm_vol_l) >> 15) * dev->master_vol_l) >> 15;
+    r = (((r * dev->pcm_vol_r) >> 15) * dev->master_vol_r) >> 15;
+
+    if (l < -32768)
+        l = -32768;
+    else if (l > 32767)
+        l = 32767;
+    if (r < -32768)
+        r = -32768;
+    else if (r > 32767)
+        r = 32767;
+
+    for (; dev->pos < sound_pos_global; dev->pos++) {
+        dev->buffer[dev->pos * 2]     = l;
+        dev->buffer[dev->pos * 2 + 1] = r;
+    }
+}
+
+/* The per sample poll, running off its own timer. */
+static void
+ref_poll(void *priv)
+{
+    es1371_t *dev = (es1371_t *) priv;
+    int       frac;
+    int       idx;
+    int       samp1_l;
+    int       samp1_r;
+    int       samp2_l;
+    int       samp2_r;
+
+    timer_advance_u64(&ref_timer, dev->dac[1].latch);
+
+    es1371_scan_fifo(dev);
+
+    ref_update(dev);
+
+    if (dev->int_ctrl & INT_DAC1_EN) {
+        if ((dev->type >= AUDIOPCI_ES1373) && (dev->int_ctrl & INT_DAC1_BYPASS)) {
+            /* SRC bypass. */
+            if ((dev->dac[0].buffer_pos - dev->dac[0].buffer_pos_end) >= 0)
+                ref_fetch(dev, 0);
+
+            dev->dac[0].out_l = dev->dac[0].buffer_l[dev->dac[0].buffer_pos & 63];
+            dev->dac[0].out_r = dev->dac[0].buffer_r[dev->dac[0].buffer_pos & 63];
+            dev->dac[0].buffer_pos++;
+
+            goto dac0_count;
+        } else {
+            frac    = dev->dac[0].ac & 0x7fff;
+            idx     = dev->dac[0].ac >> 15;
+            samp1_l = dev->dac[0].filtered_l[idx];
+            samp1_r = dev->dac[0].filtered_r[idx];
+            samp2_l = dev->dac[0].filtered_l[(idx + 1) & 31];
+            samp2_r = dev->dac[0].filtered_r[(idx + 1) & 31];
+
+            dev->dac[0].out_l = ((samp1_l * (0x8000 - frac)) + (samp2_l * frac)) >> 15;
+            dev->dac[0].out_r = ((samp1_r * (0x8000 - frac)) + (samp2_r * frac)) >> 15;
+            dev->dac[0].ac += dev->dac[0].vf;
+            dev->dac[0].ac &= ((32 << 15) - 1);
+            if ((dev->dac[0].ac >> (15 + 4)) != dev->dac[0].f_pos) {
+                ref_next_sample_filtered(dev, 0, dev->dac[0].f_pos ? 16 : 0);
+                dev->dac[0].f_pos = (dev->dac[0].f_pos + 1) & 1;
+
+dac0_count:
+                dev->dac[0].curr_samp_ct--;
+                if (dev->dac[0].curr_samp_ct < 0) {
+                    dev->int_status |= INT_STATUS_DAC1;
+                    es1371_update_irqs(dev);
+                    dev->dac[0].curr_samp_ct = dev->dac[0].samp_ct;
+                }
+            }
+        }
+    }
+
+    if (dev->int_ctrl & INT_DAC2_EN) {
+        if ((dev->type >= AUDIOPCI_ES1373) && (dev->int_ctrl & INT_DAC2_BYPASS)) {
+            /* SRC bypass. */
+            if ((dev->dac[1].buffer_pos - dev->dac[1].buffer_pos_end) >= 0)
+                ref_fetch(dev, 1);
+
+            dev->dac[1].out_l = dev->dac[1].buffer_l[dev->dac[1].buffer_pos & 63];
+            dev->dac[1].out_r = dev->dac[1].buffer_r[dev->dac[1].buffer_pos & 63];
+            dev->dac[1].buffer_pos++;
+
+            goto dac1_count;
+        } else {
+            frac    = dev->dac[1].ac & 0x7fff;
+            idx     = dev->dac[1].ac >> 15;
+            samp1_l = dev->dac[1].filtered_l[idx];
+            samp1_r = dev->dac[1].filtered_r[idx];
+            samp2_l = dev->dac[1].filtered_l[(idx + 1) & 31];
+            samp2_r = dev->dac[1].filtered_r[(idx + 1) & 31];
+
+            dev->dac[1].out_l = ((samp1_l * (0x8000 - frac)) + (samp2_l * frac)) >> 15;
+            dev->dac[1].out_r = ((samp1_r * (0x8000 - frac)) + (samp2_r * frac)) >> 15;
+            dev->dac[1].ac += dev->dac[1].vf;
+            dev->dac[1].ac &= ((32 << 15) - 1);
+            if ((dev->dac[1].ac >> (15 + 4)) != dev->dac[1].f_pos) {
+                ref_next_sample_filtered(dev, 1, dev->dac[1].f_pos ? 16 : 0);
+                dev->dac[1].f_pos = (dev->dac[1].f_pos + 1) & 1;
+
+dac1_count:
+                dev->dac[1].curr_samp_ct--;
+                if (dev->dac[1].curr_samp_ct < 0) {
+                    dev->int_status |= INT_STATUS_DAC2;
+                    es1371_update_irqs(dev);
+                    dev->dac[1].curr_samp_ct = dev->dac[1].samp_ct;
+                }
+            }
+        }
+    }
+}
+
+static void
+ref_get_buffer(int32_t *buffer, int len, void *priv)
+{
+    es1371_t *dev = (es1371_t *) priv;
+
+    ref_update(dev);
+
+    for (int c = 0; c < len * 2; c++)
+        buffer[c] += (dev->buffer[c] / 2);
+
+    dev->pos = 0;
+}
+
+static void
+sound_poll_test(UNUSED(void *priv))
+{
+    timer_advance_u64(&sound_timer, sound_latch);
+
+    sound_pos_global++;
+    if (sound_pos_global == SOUNDBUFLEN) {
+        memset(out_dev, 0, sizeof(out_dev));
+        memset(out_ref, 0, sizeof(out_ref));
+        es1371_get_buffer(out_dev, SOUNDBUFLEN, dev);
+        ref_get_buffer(out_ref, SOUNDBUFLEN, ref);
+
+        for (int c = 0; c < (SOUNDBUFLEN * 2); c++) {
+            if (out_dev[c] != out_ref[c])
+                fatal("Buffer %i sample %i: %i, should be %i\n", buffers, c, out_dev[c], out_ref[c]);
+        }
+        buffers++;
+
+        sound_pos_global = 0;
+    }
+}
+
+static uint32_t
+rnd(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+
+    return rng;
+}
+
+static void
+parked_poll(UNUSED(void *priv))
+{
+    fatal("Reference card ran the block poller\n");
+}
+
+/* The reference card must never run the block poller, so its timer is kept
+   well out of reach before its registers are accessed. */
+static es1371_t *
+park(es1371_t *card)
+{
+    if (card == ref) {
+        ref->dac[1].timer.ts.ts64 = 0ULL;
+        ref->dac[1].timer.ts.ts32.integer = (uint32_t) tsc + 0x40000000;
+        ref->poll_ahead = 0;
+    }
+
+    return card;
+}
+
+static void
+outl_both(uint16_t port, uint32_t val)
+{
+    es1371_outl(port, val, park(dev));
+    es1371_outl(port, val, park(ref));
+}
+
+static void
+outw_both(uint16_t port, uint16_t val)
+{
+    es1371_outw(port, val, park(dev));
+    es1371_outw(port, val, park(ref));
+}
+
+static void
+outb_both(uint16_t port, uint8_t val)
+{
+    es1371_outb(port, val, park(dev));
+    es1371_outb(port, val, park(ref));
+}
+
+static void
+src_write(int reg, uint16_t val)
+{
+    outl_both(0x10, SRC_RAM_WE | (reg << 25) | val);
+}
+
+static void
+check_regs(void)
+{
+    static const uint8_t regs[] = { 0x00, 0x04, 0x0c, 0x10, 0x18, 0x1c, 0x20, 0x24, 0x28, 0x30, 0x34, 0x38, 0x3c };
+
+    for (int page = 0xc; page <= 0xd; page++) {
+        outl_both(0x0c, page);
+        for (unsigned i = 0; i < sizeof(regs); i++) {
+            uint32_t a = es1371_inl(regs[i], park(dev));
+            uint32_t b = es1371_inl(regs[i], park(ref));
+
+            if (a != b)
+                fatal("Register %02X page %X: %08X, should be %08X\n", regs[i], page, a, b);
+        }
+    }
+
+    for (int port = 0x08; port <= 0x0a; port++) {
+        uint8_t a = es1371_inb(port, park(dev));
+        uint8_t b = es1371_inb(port, park(ref));
+
+        if (a != b)
+            fatal("Register %02X: %02X, should be %02X\n", port, a, b);
+    }
+}
+
+static void
+program_dac(int d)
+{
+    uint32_t size = rnd() % ((rnd() & 1) ? 64 : 4096);
+    uint32_t addr = (rnd() % (RAM_SIZE - (4 * size) - 4)) & ~3;
+
+    outl_both(0x0c, 0xc);
+    outl_both(d ? 0x38 : 0x30, addr);
+    outl_both(d ? 0x3c : 0x34, size);
+}
+
+static void
+random_op(void)
+{
+    int d = rnd() & 1;
+
+    switch (rnd() % 12) {
+        case 0:
+            /* Start or stop a DAC, sometimes with a new buffer. */
+            if (rnd() & 1)
+                program_dac(d);
+            outl_both(0x00, dev->int_ctrl ^ (d ? INT_DAC2_EN : INT_DAC1_EN));
+            break;
+        case 1:
+            /* Acknowledge an interrupt the way the drivers do. */
+            outl_both(0x20, dev->si_cr & ~(d ? SI_P2_INTR_EN : SI_P1_INTR_EN));
+            outl_both(0x20, dev->si_cr | (d ? SI_P2_INTR_EN : SI_P1_INTR_EN));
+            break;
+        case 2:
+            outw_both(d ? 0x28 : 0x24, (rnd() & 1) ? (rnd() & 0x3f) : (rnd() & 0xfff));
+            break;
+        case 3:
+            outl_both(0x20, (dev->si_cr & ~(d ? 0x0c : 0x03)) | ((rnd() & 3) << (d ? 2 : 0)));
+            break;
+        case 4:
+            outl_both(0x20, dev->si_cr ^ (d ? SI_P2_PAUSE : SI_P1_PAUSE));
+            break;
+        case 5:
+            /* Integer and fractional rate, 4 kHz to 48 kHz, now and then
+               past the end of the range. The accumulator's integer part is
+               kept within the 32 filtered samples, as the driver indexes them
+               with it unchecked. */
+            {
+                uint32_t vf = (rnd() & 7) ? ((rnd() % 0x7a000) + 0xac00) : (rnd() & 0x1fffff);
+
+                src_write(d ? 0x75 : 0x71, ((vf >> 5) & 0xfc00) | (rnd() & 0x1f));
+                src_write(d ? 0x77 : 0x73, vf & 0x7fff);
+                if (rnd() & 1)
+                    src_write(d ? 0x76 : 0x72, rnd() & 0x7fff);
+            }
+            break;
+        case 6:
+            src_write(0x7c + (rnd() & 3), rnd() & 0x1fff);
+            break;
+        case 7:
+            outl_both(0x14, ((rnd() & 3) ? 0x18 : 0x02) << 16);
+            break;
+        case 8:
+            outl_both(0x00, dev->int_ctrl ^ (d ? INT_DAC2_BYPASS : INT_DAC1_BYPASS));
+            break;
+        case 9:
+            outb_both(0x09, rnd() & 0xe3);
+            break;
+        case 10:
+            program_dac(d);
+            break;
+        default:
+            check_regs();
+            break;
+    }
+}
+
+static void
+run(uint32_t seed)
+{
+    static const uint32_t types[] = { AUDIOPCI_ES1371, AUDIOPCI_ES1373, AUDIOPCI_CT5880 };
+    device_t              info    = { 0 };
+    int                   steps;
+
+    rng = seed * 2654435761u + 1;
+
+    for (int i = 0; i < RAM_SIZE; i++)
+        guest_ram[i] = rnd() >> 24;
+
+    info.local = types[seed % 3];
+    dev        = es1371_init(&info);
+    ref        = es1371_init(&info);
+
+    /* Start both pollers one sample from now, so that the setup below
+       happens before the first sample on both. */
+    dev->dac[1].timer.ts.ts64 = (tsc << 32) + dev->dac[1].latch;
+    timer_enable(&dev->dac[1].timer);
+    timer_add(&ref_timer, ref_poll, ref, 0);
+    ref_timer.ts.ts64 = dev->dac[1].timer.ts.ts64;
+    timer_enable(&ref_timer);
+    timer_set_callback(&ref->dac[1].timer, parked_poll);
+    park(ref);
+
+    /* Keep the sound timer clear of the poll timers' phase. */
+    sound_latch = dev->dac[1].latch;
+    timer_add(&sound_timer, sound_poll_test, NULL, 0);
+    timer_set_delay_u64(&sound_timer, (sound_latch / 4) + (rnd() % (sound_latch / 2)));
+    sound_pos_global = 0;
+
+    outl_both(0x14, 0x02 << 16);
+    outl_both(0x14, 0x18 << 16);
+    for (int r = 0x7c; r <= 0x7f; r++)
+        src_write(r, 0x1000);
+    for (int d = 0; d < 2; d++) {
+        program_dac(d);
+        outw_both(d ? 0x28 : 0x24, rnd() & 0x3ff);
+        src_write(d ? 0x75 : 0x71, 0x8000 | 0x10);
+        src_write(d ? 0x77 : 0x73, 0);
+    }
+    outl_both(0x20, SI_P1_INTR_EN | SI_P2_INTR_EN | 0x0f);
+    outl_both(0x00, INT_DAC1_EN | INT_DAC2_EN);
+
+    irq_changes[0] = irq_changes[1] = 0;
+    buffers                                     = 0;
+
+    for (steps = 0; buffers < 200; steps++) {
+        /* Mostly short steps, so interrupts are checked close to when they
+           are raised, with the odd long one. */
+        tsc += (rnd() & 15) ? (1 + (rnd() % (2 * (dev->dac[1].latch >> 32)))) : (rnd() % (200 * (dev->dac[1].latch >> 32)));
+        timer_process();
+
+        if (dev->irq_state != ref->irq_state)
+            fatal("Step %i: IRQ is %i, should be %i\n", steps, dev->irq_state, ref->irq_state);
+
+        if (!(rnd() % 40))
+            random_op();
+    }
+
+    if (irq_changes[0] != irq_changes[1])
+        fatal("IRQ changed %i times, should be %i\n", irq_changes[0], irq_changes[1]);
+
+    printf("Seed %u: %s, %i steps, %i IRQ changes, identical\n", seed,
+           (info.local == AUDIOPCI_ES1371) ? "ES1371" : ((info.local == AUDIOPCI_ES1373) ? "ES1373" : "CT5880"),
+           steps, irq_changes[1]);
+
+    /* The SRC filter history is shared by all cards, so bring it to where
+       the reference left it before the next seed. */
+    es1371_poll_sync(dev);
+
+    timer_disable(&dev->dac[1].timer);
+    timer_disable(&ref->dac[1].timer);
+    timer_disable(&ref_timer);
+    timer_disable(&sound_timer);
+    free(dev);
+    free(ref);
+}
+
+int
+main(int argc, char **argv)
+{
+    int seeds = (argc > 1) ? atoi(argv[1]) : 20;
+
+    TIMER_USEC = (uint64_t) 100 << 32;
+    timer_init();
+
+    for (int seed = 1; seed <= seeds; seed++)
+        run(seed);
+
+    return 0;
+}
@@ -0,0 +1,924 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          CMI8x38 block DMA comparison test.
+ *
+ *          Runs two CMI8x38s side by side on the real timer code. One
+ *          runs its DMA channels in blocks through cmi8x38_dma_sync(),
+ *          the other with copies of the per slot cmi8x38_dma_process()
+ *          and per sample cmi8x38_poll() the blocks replaced, each on its
+ *          own timer. A random driver programs buffers, directions,
+ *          formats, sample rates, channel counts, fragment sizes and
+ *          volumes, starts, pauses and resets channels, acknowledges
+ *          interrupts and reads the registers at random times, doing the
+ *          same to both cards. The register values, the interrupt line
+ *          after every step, every output buffer and the recorded dwords
+ *          written to memory must be identical. Recorded dwords are not
+ *          stored, since the block runner writes them when a block is run
+ *          rather than on the slot, and both cards read the same guest
+ *          memory.
+ *
+ *          Build from this directory with:
+ *            gcc -O2 -I../include -I../cpu -o cmi8x38_test cmi8x38_test.c -lm
+ *
+ *          Usage: cmi8x38_test [seeds]
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../timer.c"
+#include "snd_cmi8x38.c"
+
+#define RAM_SIZE (1 << 20)
+
+uint64_t tsc              = 0;
+int      sound_pos_global = 0;
+int      nmi              = 0;
+dma_t    dma[8];
+uint8_t  dma_m            = 0;
+
+const device_t sb_16_compat_device       = { 0 };
+const device_t sb_16_compat_nompu_device = { 0 };
+const device_t gameport_pnp_device       = { 0 };
+
+static uint8_t    guest_ram[RAM_SIZE];
+static cmi8x38_t *dev;
+static cmi8x38_t *ref;
+static cmi8x38_t *cur;
+static pc_timer_t ref_dma_timer[2];
+static pc_timer_t ref_poll_timer[2];
+static pc_timer_t sound_timer;
+static uint64_t   sound_latch;
+static int        irq_changes[2];
+static uint64_t   writes[2];
+static int32_t    out_dev[SOUNDBUFLEN * 2];
+static int32_t    out_ref[SOUNDBUFLEN * 2];
+static int        buffers;
+static uint32_t   rng;
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void
+pclog_ex(UNUSED(const char *fmt), UNUSED(va_list ap))
+{
+}
+
+void
+io_sethandler(UNUSED(uint16_t base), UNUSED(int size),
+              UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+              UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+              UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+              UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+              UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+              UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+              UNUSED(void *priv))
+{
+}
+
+void
+io_removehandler(UNUSED(uint16_t base), UNUSED(int size),
+                 UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+                 UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+                 UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+                 UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+                 UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+                 UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+                 UNUSED(void *priv))
+{
+}
+
+void *
+io_trap_add(UNUSED(void (*func)(int size, uint16_t addr, uint8_t write, uint8_t val, void *priv)),
+            UNUSED(void *priv))
+{
+    return NULL;
+}
+
+void
+io_trap_remap(UNUSED(void *handle), UNUSED(int enable), UNUSED(uint16_t addr), UNUSED(uint16_t size))
+{
+}
+
+void
+io_trap_remove(UNUSED(void *handle))
+{
+}
+
+void *
+gameport_add(UNUSED(const device_t *gameport_type))
+{
+    return NULL;
+}
+
+void
+gameport_remap(UNUSED(void *priv), UNUSED(uint16_t address))
+{
+}
+
+void
+mpu401_change_addr(UNUSED(mpu_t *mpu), UNUSED(uint16_t addr))
+{
+}
+
+void
+mpu401_irq_attach(UNUSED(mpu_t *mpu), UNUSED(void (*ext_irq_update)(void *priv, int set)),
+                  UNUSED(int (*ext_irq_pending)(void *priv)), UNUSED(void *priv))
+{
+}
+
+uint8_t
+mpu401_read(UNUSED(uint16_t addr), UNUSED(void *priv))
+{
+    return 0xff;
+}
+
+void
+mpu401_write(UNUSED(uint16_t addr), UNUSED(uint8_t val), UNUSED(void *priv))
+{
+}
+
+void
+sb_dsp_dma_attach(UNUSED(sb_dsp_t *dsp), UNUSED(int (*dma_readb)(void *priv)),
+                  UNUSED(int (*dma_readw)(void *priv)), UNUSED(int (*dma_writeb)(void *priv, uint8_t val)),
+                  UNUSED(int (*dma_writew)(void *priv, uint16_t val)), UNUSED(void *priv))
+{
+}
+
+void
+sb_dsp_irq_attach(UNUSED(sb_dsp_t *dsp), UNUSED(void (*irq_update)(void *priv, int set)), UNUSED(void *priv))
+{
+}
+
+void
+sb_dsp_set_stereo(UNUSED(sb_dsp_t *dsp), UNUSED(int stereo))
+{
+}
+
+void
+sb_dsp_setaddr(UNUSED(sb_dsp_t *dsp), UNUSED(uint16_t addr))
+{
+}
+
+void
+sb16_awe32_filter_cd_audio(UNUSED(int channel), UNUSED(double *buffer), UNUSED(void *priv))
+{
+}
+
+/* Only the volumes the wave channels are mixed at matter here. */
+void
+sb_ct1745_mixer_write(uint16_t addr, uint8_t val, void *priv)
+{
+    sb_ct1745_mixer_t *mixer = &((sb_t *) priv)->mixer_sb16;
+
+    if (!(addr & 1)) {
+        mixer->index = val;
+        return;
+    }
+
+    mixer->regs[mixer->index] = val;
+    switch (mixer->index) {
+        case 0x30:
+            mixer->master_l = val / 255.0;
+            break;
+        case 0x31:
+            mixer->master_r = val / 255.0;
+            break;
+        case 0x32:
+            mixer->voice_l = val / 255.0;
+            break;
+        case 0x33:
+            mixer->voice_r = val / 255.0;
+            break;
+        default:
+            break;
+    }
+}
+
+uint8_t
+sb_ct1745_mixer_read(UNUSED(uint16_t addr), void *priv)
+{
+    sb_ct1745_mixer_t *mixer = &((sb_t *) priv)->mixer_sb16;
+
+    return mixer->regs[mixer->index];
+}
+
+void
+sb_ct1745_mixer_reset(sb_t *sb)
+{
+    sb->mixer_sb16.master_l = sb->mixer_sb16.master_r = 0.75;
+    sb->mixer_sb16.voice_l = sb->mixer_sb16.voice_r = 0.75;
+}
+
+void
+sound_add_handler(UNUSED(void (*get_buffer)(int32_t *buffer, int len, void *priv)), UNUSED(void *priv))
+{
+}
+
+void
+sound_set_cd_audio_filter(UNUSED(void (*filter)(int channel, double *buffer, void *priv)), UNUSED(void *priv))
+{
+}
+
+uint64_t
+sound_get_pos_ts(int pos)
+{
+    return sound_timer.ts.ts64 - ((uint64_t) (sound_pos_global - pos) * sound_latch);
+}
+
+int
+device_get_config_int(UNUSED(const char *name))
+{
+    return 1;
+}
+
+void *
+device_add_inst(UNUSED(const device_t *dev), UNUSED(int inst))
+{
+    return calloc(1, sizeof(sb_t));
+}
+
+void
+pci_add_card(UNUSED(uint8_t add_type), UNUSED(uint8_t (*read)(int func, int addr, void *priv)),
+             UNUSED(void (*write)(int func, int addr, uint8_t val, void *priv)), UNUSED(void *priv),
+             uint8_t *slot)
+{
+    *slot = 0;
+}
+
+void
+pci_irq(UNUSED(uint8_t slot), UNUSED(uint8_t pci_int), UNUSED(int level), int set, uint8_t *irq_state)
+{
+    if (*irq_state != set)
+        irq_changes[irq_state == &ref->irq_state]++;
+    *irq_state = set;
+}
+
+uint8_t
+mem_readb_phys(uint32_t addr)
+{
+    return guest_ram[addr & (RAM_SIZE - 1)];
+}
+
+uint16_t
+mem_readw_phys(uint32_t addr)
+{
+    return mem_readb_phys(addr) | (mem_readb_phys(addr + 1) << 8);
+}
+
+uint32_t
+mem_readl_phys(uint32_t addr)
+{
+    return mem_readw_phys(addr) | (mem_readw_phys(addr + 2) << 16);
+}
+
+/* Recorded data is summed up per card instead of stored, so that both
+   cards keep reading the same memory. The sum does not depend on the order,
+   as the block runner moves one channel's block before the other's. */
+void
+mem_writel_phys(uint32_t addr, uint32_t val)
+{
+    uint64_t x = ((uint64_t) addr << 32) | val;
+
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    writes[cur == ref] += x;
+}
+
+void
+mem_writew_phys(uint32_t addr, uint16_t val)
+{
+    mem_writel_phys(addr, val);
+}
+
+void
+mem_writeb_phys(uint32_t addr, uint8_t val)
+{
+    mem_writel_phys(addr, val);
+}
+
+/* The output update as it was before it took a time stamp. */
+static void
+ref_update(cmi8x38_t *dev, cmi8x38_dma_t *dma)
+{
+    const sb_ct1745_mixer_t *mixer = &dev->sb->mixer_sb16;
+    int32_t                  l     = (dma->out_fl * mixer->voice_l) * mixer->master_l;
+    int32_t                  r     = (dma->out_fr * mixer->voice_r) * mixer->master_r;
+
+    for (; dma->pos < sound_pos_global; dma->pos++) {
+        dma->buffer[dma->pos * 2]     = l;
+        dma->buffer[dma->pos * 2 + 1] = r;
+    }
+}
+
+/* The per slot DMA transfer, running off its own timer. */
+static void
+ref_dma_process(void *priv)
+{
+    cmi8x38_dma_t *dma = (cmi8x38_dma_t *) priv;
+    cmi8x38_t     *dev = dma->dev;
+
+    /* Stop if this DMA channel is not active. */
+    uint8_t dma_bit = 0x01 << dma->id;
+    if (!(dev->io_regs[0x02] & dma_bit)) {
+        cmi8x38_log("CMI8x38: Stopping DMA %d due to inactive channel (%02X)\n", dma->id, dev->io_regs[0x02]);
+        return;
+    }
+
+    /* Schedule next run. */
+    timer_on_auto(&ref_dma_timer[dma->id], dma->dma_latch);
+
+    /* Process DMA if it's active, and the FIFO has room or is disabled. */
+    uint8_t dma_status = dev->io_regs[0x00] >> dma->id;
+    if (!(dma_status & 0x04) && (dma->always_run || ((dma->fifo_end - dma->fifo_pos) <= (sizeof(dma->fifo) - 4)))) {
+        /* Start DMA if requested. */
+        if (dma->restart) {
+            /* Set up base address and counters.
+               Nothing reads sample_count_out; it's implemented as an assumption. */
+            dma->restart         = 0;
+            dma->sample_ptr      = *((uint32_t *) &dev->io_regs[dma->reg]);
+            dma->frame_count_dma = dma->sample_count_out = *((uint16_t *) &dev->io_regs[dma->reg | 0x4]) + 1;
+            dma->frame_count_fragment                    = *((uint16_t *) &dev->io_regs[dma->reg | 0x6]) + 1;
+
+            cmi8x38_log("CMI8x38: Starting DMA %d at %08X (count %04X fragment %04X)\n", dma->id, dma->sample_ptr, dma->frame_count_dma, dma->frame_count_fragment);
+        }
+
+        if (dma_status & 0x01) {
+            /* Write channel: read data from FIFO. */
+            mem_writel_phys(dma->sample_ptr, *((uint32_t *) &dma->fifo[dma->fifo_end & (sizeof(dma->fifo) - 1)]));
+        } else {
+            /* Read channel: write data to FIFO. */
+            *((uint32_t *) &dma->fifo[dma->fifo_end & (sizeof(dma->fifo) - 1)]) = mem_readl_phys(dma->sample_ptr);
+        }
+        dma->fifo_end += 4;
+        dma->sample_ptr += 4;
+
+        /* Check if the fragment size was reached. */
+        if (--dma->frame_count_fragment <= 0) {
+            /* Reset fragment counter. */
+            dma->frame_count_fragment = *((uint16_t *) &dev->io_regs[dma->reg | 0x6]) + 1;
+#ifdef ENABLE_CMI8X38_LOG
+            if (dma->frame_count_fragment > 1) /* avoid log spam if fragment counting is unused, like on the newer WDM drivers (cmudax3) */
+                cmi8x38_log("CMI8x38: DMA %d fragment size reached at %04X frames left", dma->id, dma->frame_count_dma - 1);
+#endif
+            /* Fire interrupt if requested. */
+            if (dev->io_regs[0x0e] & dma_bit) {
+#ifdef ENABLE_CMI8X38_LOG
+                if (dma->frame_count_fragment > 1)
+                    cmi8x38_log(", firing interrupt\n");
+#endif
+                /* Set channel interrupt flag. */
+                dev->io_regs[0x10] |= dma_bit;
+
+                /* Fire interrupt. */
+                cmi8x38_update_irqs(dev);
+            } else {
+#ifdef ENABLE_CMI8X38_LOG
+                if (dma->frame_count_fragment > 1)
+                    cmi8x38_log("\n");
+#endif
+            }
+        }
+
+        /* Check if the buffer's end was reached. */
+        if (--dma->frame_count_dma <= 0) {
+            dma->frame_count_dma = 0;
+            cmi8x38_log("CMI8x38: DMA %d end reached, restarting\n", dma->id);
+
+            /* Restart DMA on the next run. */
+            dma->restart = 1;
+        }
+    }
+}
+
+/* The per sample poll, running off its own timer. */
+static void
+ref_poll(void *priv)
+{
+    cmi8x38_dma_t *dma = (cmi8x38_dma_t *) priv;
+    cmi8x38_t     *dev = dma->dev;
+    int16_t       *out_l;
+    int16_t       *out_r;
+    int16_t       *out_ol;
+    int16_t       *out_or; /* o = opposite */
+
+    /* Schedule next run if playback is enabled. */
+    if (dma->playback_enabled)
+        timer_advance_u64(&ref_poll_timer[dma->id], dma->timer_latch);
+
+    /* Update audio buffer. */
+    ref_update(dev, dma);
+
+    /* Swap stereo pair if this is the rear DMA channel according to ENDBDAC and XCHGDAC. */
+    if ((dev->io_regs[0x1a] & 0x80) && (!!(dev->io_regs[0x1a] & 0x40) ^ dma->id)) {
+        out_l  = &dma->out_rl;
+        out_r  = &dma->out_rr;
+        out_ol = &dma->out_fl;
+        out_or = &dma->out_fr;
+    } else {
+        out_l  = &dma->out_fl;
+        out_r  = &dma->out_fr;
+        out_ol = &dma->out_rl;
+        out_or = &dma->out_rr;
+    }
+    *out_ol = *out_or = dma->out_c = dma->out_lfe = 0;
+
+    /* Feed next sample from the FIFO. */
+    switch ((dev->io_regs[0x08] >> (dma->id << 1)) & 0x03) {
+        case 0x00: /* Mono, 8-bit PCM */
+            if ((dma->fifo_end - dma->fifo_pos) >= 1) {
+                *out_l = *out_r = (dma->fifo[dma->fifo_pos++ & (sizeof(dma->fifo) - 1)] ^ 0x80) << 8;
+                dma->sample_count_out--;
+                goto n4spk3d;
+            }
+            break;
+
+        case 0x01: /* Stereo, 8-bit PCM */
+            if ((dma->fifo_end - dma->fifo_pos) >= 2) {
+                *out_l = (dma->fifo[dma->fifo_pos++ & (sizeof(dma->fifo) - 1)] ^ 0x80) << 8;
+                *out_r = (dma->fifo[dma->fifo_pos++ & (sizeof(dma->fifo) - 1)] ^ 0x80) << 8;
+                dma->sample_count_out -= 2;
+                goto n4spk3d;
+            }
+            break;
+
+        case 0x02: /* Mono, 16-bit PCM */
+            if ((dma->fifo_end - dma->fifo_pos) >= 2) {
+                *out_l = *out_r = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                dma->fifo_pos += 2;
+                dma->sample_count_out -= 2;
+                goto n4spk3d;
+            }
+            break;
+
+        case 0x03: /* Stereo, 16-bit PCM, with multi-channel capability */
+            switch (dma->channels) {
+                case 2:
+                    if ((dma->fifo_end - dma->fifo_pos) >= 4) {
+                        *out_l = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        *out_r = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->sample_count_out -= 4;
+                        goto n4spk3d;
+                    }
+                    break;
+
+                case 4:
+                    if ((dma->fifo_end - dma->fifo_pos) >= 8) {
+                        dma->out_fl = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_fr = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_rl = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_rr = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->sample_count_out -= 8;
+                        return;
+                    }
+                    break;
+
+                case 5: /* not supported by WDM and Linux drivers; channel layout assumed */
+                    if ((dma->fifo_end - dma->fifo_pos) >= 10) {
+                        dma->out_fl = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_fr = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_rl = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_rr = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_c = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->sample_count_out -= 10;
+                        return;
+                    }
+                    break;
+
+                case 6:
+                    if ((dma->fifo_end - dma->fifo_pos) >= 12) {
+                        dma->out_fl = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_fr = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_rl = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_rr = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_c = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->out_lfe = *((uint16_t *) &dma->fifo[dma->fifo_pos & (sizeof(dma->fifo) - 1)]);
+                        dma->fifo_pos += 2;
+                        dma->sample_count_out -= 12;
+                        return;
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    /* Feed silence if the FIFO is empty. */
+    *out_l = *out_r = 0;
+
+    /* Stop playback if DMA is disabled. */
+    if ((*((uint32_t *) &dev->io_regs[0x00]) & (0x00010001 << dma->id)) != (0x00010000 << dma->id)) {
+        cmi8x38_log("CMI8x38: Stopping playback of DMA channel %d\n", dma->id);
+        dma->playback_enabled = 0;
+    }
+
+    return;
+n4spk3d:
+    /* Mirror front and rear channels if requested. */
+    if (dev->io_regs[0x1b] & 0x04) {
+        *out_ol = *out_l;
+        *out_or = *out_r;
+    }
+}
+
+static void
+ref_get_buffer(int32_t *buffer, int len, void *priv)
+{
+    cmi8x38_t *dev = (cmi8x38_t *) priv;
+
+    /* Update wave playback channels. */
+    ref_update(dev, &dev->dma[0]);
+    ref_update(dev, &dev->dma[1]);
+
+    /* Apply wave mute. */
+    if (!(dev->io_regs[0x24] & 0x40)) {
+        /* Fill buffer. */
+        for (int c = 0; c < len * 2; c++) {
+            buffer[c] += dev->dma[0].buffer[c];
+            buffer[c] += dev->dma[1].buffer[c];
+        }
+    }
+
+    dev->dma[0].pos = dev->dma[1].pos = 0;
+}
+
+
+static void
+dev_dma_process(void *priv)
+{
+    cur = dev;
+    cmi8x38_dma_process(priv);
+}
+
+static void
+dev_poll(void *priv)
+{
+    cur = dev;
+    cmi8x38_poll(priv);
+}
+
+static void
+ref_dma_timer_process(void *priv)
+{
+    cur = ref;
+    ref_dma_process(priv);
+}
+
+static void
+ref_poll_timer_process(void *priv)
+{
+    cur = ref;
+    ref_poll(priv);
+}
+
+static void
+sound_poll_test(UNUSED(void *priv))
+{
+    timer_advance_u64(&sound_timer, sound_latch);
+
+    sound_pos_global++;
+    if (sound_pos_global == SOUNDBUFLEN) {
+        memset(out_dev, 0, sizeof(out_dev));
+        memset(out_ref, 0, sizeof(out_ref));
+        cur = dev;
+        cmi8x38_get_buffer(out_dev, SOUNDBUFLEN, dev);
+        cur = ref;
+        ref_get_buffer(out_ref, SOUNDBUFLEN, ref);
+
+        for (int c = 0; c < (SOUNDBUFLEN * 2); c++) {
+            if (out_dev[c] != out_ref[c])
+                fatal("Buffer %i sample %i: %i, should be %i\n", buffers, c, out_dev[c], out_ref[c]);
+        }
+        buffers++;
+
+        sound_pos_global = 0;
+    }
+}
+
+static uint32_t
+rnd(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+
+    return rng;
+}
+
+static void
+parked_timer(UNUSED(void *priv))
+{
+    fatal("Reference card ran the block runner\n");
+}
+
+static void
+park_timer(pc_timer_t *timer)
+{
+    int enabled = timer_is_enabled(timer);
+
+    timer_disable(timer);
+    timer->ts.ts64            = 0ULL;
+    timer->ts.ts32.integer    = (uint32_t) tsc + 0x40000000;
+    if (enabled)
+        timer_enable(timer);
+}
+
+/* The reference card must never run the block runner, so its timers are
+   kept well out of reach around every register access. */
+static void
+park(void)
+{
+    for (int i = 0; i < 2; i++) {
+        park_timer(&ref->dma[i].dma_timer);
+        park_timer(&ref->dma[i].poll_timer);
+        ref->dma[i].dma_ahead = ref->dma[i].poll_ahead = 0;
+    }
+}
+
+static void
+outb_both(uint16_t port, uint8_t val)
+{
+    int playback[2];
+
+    cur = dev;
+    cmi8x38_write(port, val, dev);
+
+    park();
+    for (int i = 0; i < 2; i++)
+        playback[i] = ref->dma[i].playback_enabled;
+    cur = ref;
+    cmi8x38_write(port, val, ref);
+
+    /* Start the reference's timers where the per slot code did. */
+    for (int i = 0; i < 2; i++) {
+        if ((port == 0x02) && !(val & (0x04 << i)) && (val & (0x01 << i)))
+            timer_set_delay_u64(&ref_dma_timer[i], (uint64_t) (ref->dma[i].dma_latch * ((double) TIMER_USEC)));
+    }
+    for (int i = 0; i < 2; i++) {
+        if (!playback[i] && ref->dma[i].playback_enabled)
+            timer_set_delay_u64(&ref_poll_timer[i], ref->dma[i].timer_latch);
+    }
+    park();
+}
+
+/* Through the Sound Blaster mixer ports rather than the CMI8x38's own. */
+static void
+sb_mixer_both(uint8_t index, uint8_t val)
+{
+    cur = dev;
+    cmi8x38_sb_mixer_write(0x224, index, dev);
+    cmi8x38_sb_mixer_write(0x225, val, dev);
+
+    park();
+    cur = ref;
+    cmi8x38_sb_mixer_write(0x224, index, ref);
+    cmi8x38_sb_mixer_write(0x225, val, ref);
+    park();
+}
+
+static void
+check_regs(void)
+{
+    static const uint8_t regs[] = { 0x00, 0x02, 0x0e, 0x10, 0x11 };
+    uint8_t              a;
+    uint8_t              b;
+
+    for (unsigned i = 0; i < sizeof(regs); i++) {
+        cur = dev;
+        a   = cmi8x38_read(regs[i], dev);
+        park();
+        cur = ref;
+        b   = cmi8x38_read(regs[i], ref);
+        park();
+
+        if (a != b)
+            fatal("Register %02X: %02X, should be %02X\n", regs[i], a, b);
+    }
+
+    for (int port = 0x80; port <= 0x8f; port++) {
+        cur = dev;
+        a   = cmi8x38_read(port, dev);
+        park();
+        cur = ref;
+        b   = cmi8x38_read(port, ref);
+        park();
+
+        if (a != b)
+            fatal("Register %02X: %02X, should be %02X\n", port, a, b);
+    }
+
+    if (writes[0] != writes[1])
+        fatal("Recorded data sum %016" PRIX64 ", should be %016" PRIX64 "\n", writes[0], writes[1]);
+}
+
+static void
+program_channel(int d)
+{
+    uint32_t size     = 1 + (rnd() % ((rnd() & 1) ? 64 : 4096));
+    uint32_t addr     = (rnd() % (RAM_SIZE - (4 * size) - 4)) & ~3;
+    uint32_t fragment = (rnd() & 3) ? (rnd() % size) : (rnd() & 0xffff);
+    uint16_t reg      = 0x80 + (8 * d);
+
+    for (int i = 0; i < 4; i++)
+        outb_both(reg + i, addr >> (8 * i));
+    outb_both(reg + 4, size - 1);
+    outb_both(reg + 5, (size - 1) >> 8);
+    outb_both(reg + 6, fragment);
+    outb_both(reg + 7, fragment >> 8);
+}
+
+static void
+random_op(void)
+{
+    int d = rnd() & 1;
+
+    switch (rnd() % 14) {
+        case 0:
+            /* Start a channel, sometimes with a new buffer. */
+            if (rnd() & 1)
+                program_channel(d);
+            outb_both(0x02, dev->io_regs[0x02] | (0x01 << d));
+            break;
+        case 1:
+            /* Stop or reset a channel. */
+            outb_both(0x02, (rnd() & 1) ? (dev->io_regs[0x02] & ~(0x01 << d)) : (dev->io_regs[0x02] | (0x04 << d)));
+            break;
+        case 2:
+            /* Acknowledge an interrupt the way the drivers do. */
+            outb_both(0x0e, dev->io_regs[0x0e] & ~(0x01 << d));
+            outb_both(0x0e, dev->io_regs[0x0e] | (0x01 << d));
+            break;
+        case 3:
+            /* Disable or enable the interrupt. */
+            outb_both(0x0e, dev->io_regs[0x0e] ^ (0x01 << d));
+            break;
+        case 4:
+            /* Direction and pause. */
+            outb_both(0x00, dev->io_regs[0x00] ^ ((rnd() & 3) ? (0x04 << d) : (0x01 << d)));
+            break;
+        case 5:
+            outb_both(0x08, rnd());
+            break;
+        case 6:
+            outb_both(0x05, rnd() & 0xfc);
+            break;
+        case 7:
+            outb_both(0x09, (rnd() & 1) ? (rnd() & 0x0f) : 0x00);
+            break;
+        case 8:
+            outb_both((rnd() & 1) ? 0x0b : 0x15, rnd());
+            break;
+        case 9:
+            outb_both(0x1a, rnd() & 0xc0);
+            outb_both(0x1b, rnd() & 0x04);
+            break;
+        case 10:
+            if (rnd() & 1) {
+                outb_both(0x23, 0x30 + (rnd() & 3));
+                outb_both(0x22, rnd());
+            } else
+                sb_mixer_both(0x30 + (rnd() & 3), rnd());
+            break;
+        case 11:
+            outb_both(0x24, (rnd() & 7) ? 0x00 : 0x40);
+            break;
+        case 12:
+            program_channel(d);
+            break;
+        default:
+            check_regs();
+            break;
+    }
+}
+
+static void
+run(uint32_t seed)
+{
+    static const uint32_t types[] = { CMEDIA_CMI8338, CMEDIA_CMI8738_4CH, CMEDIA_CMI8738_6CH };
+    static const char    *names[] = { "CMI8338", "CMI8738 4-channel", "CMI8738 6-channel" };
+    device_t              info    = { 0 };
+    int                   steps;
+
+    rng = seed * 2654435761u + 1;
+
+    for (int i = 0; i < RAM_SIZE; i++)
+        guest_ram[i] = rnd() >> 24;
+
+    info.local = types[seed % 3];
+    dev        = cmi8x38_init(&info);
+    ref        = cmi8x38_init(&info);
+
+    for (int i = 0; i < 2; i++) {
+        timer_set_callback(&dev->dma[i].dma_timer, dev_dma_process);
+        timer_set_callback(&dev->dma[i].poll_timer, dev_poll);
+        timer_set_callback(&ref->dma[i].dma_timer, parked_timer);
+        timer_set_callback(&ref->dma[i].poll_timer, parked_timer);
+        timer_add(&ref_dma_timer[i], ref_dma_timer_process, &ref->dma[i], 0);
+        timer_add(&ref_poll_timer[i], ref_poll_timer_process, &ref->dma[i], 0);
+    }
+
+    sound_latch = (uint64_t) (((double) TIMER_USEC) * (1000000.0 / 48000.0));
+    timer_add(&sound_timer, sound_poll_test, NULL, 0);
+    timer_set_delay_u64(&sound_timer, (sound_latch / 4) + (rnd() % (sound_latch / 2)));
+    sound_pos_global = 0;
+
+    outb_both(0x0e, 0x03);
+    for (int d = 0; d < 2; d++)
+        program_channel(d);
+    outb_both(0x02, 0x03);
+
+    irq_changes[0] = irq_changes[1] = 0;
+    writes[0] = writes[1] = 0;
+    buffers               = 0;
+
+    for (steps = 0; buffers < 200; steps++) {
+        /* Mostly short steps, so interrupts are checked close to when they
+           are raised, with the odd long one. */
+        uint32_t sample = (uint32_t) (dev->dma[0].timer_latch >> 32);
+
+        tsc += (rnd() & 15) ? (1 + (rnd() % sample)) : (rnd() % (100 * sample));
+        timer_process();
+
+        if (dev->irq_state != ref->irq_state)
+            fatal("Step %i: IRQ is %i, should be %i\n", steps, dev->irq_state, ref->irq_state);
+
+        if (!(rnd() % 40))
+            random_op();
+    }
+
+    check_regs();
+    if (irq_changes[0] != irq_changes[1])
+        fatal("IRQ changed %i times, should be %i\n", irq_changes[0], irq_changes[1]);
+
+    printf("Seed %u: %s, %i steps, %i IRQ changes, identical\n", seed, names[seed % 3], steps, irq_changes[1]);
+
+    for (int i = 0; i < 2; i++) {
+        timer_disable(&dev->dma[i].dma_timer);
+        timer_disable(&dev->dma[i].poll_timer);
+        timer_disable(&ref->dma[i].dma_timer);
+        timer_disable(&ref->dma[i].poll_timer);
+        timer_disable(&ref_dma_timer[i]);
+        timer_disable(&ref_poll_timer[i]);
+    }
+    timer_disable(&sound_timer);
+    free(dev->sb);
+    free(ref->sb);
+    free(dev);
+    free(ref);
+}
+
+int
+main(int argc, char **argv)
+{
+    int seeds = (argc > 1) ? atoi(argv[1]) : 20;
+
+    TIMER_USEC = (uint64_t) 100 << 32;
+    timer_init();
+
+    for (int seed = 1; seed <= seeds; seed++)
+        run(seed);
+
+    return 0;
+}
@@ -0,0 +1,679 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          EMU8000 block renderer comparison test.
+ *
+ *          Plays the same SoundFont style note sequence on two EMU8000s,
+ *          one rendered with emu8k_update() and one with a copy of the
+ *          per sample emu8k_update() the block renderer replaced, with
+ *          its output position fix applied, and checks that the output,
+ *          effect sends and voice state stay identical. The sequence
+ *          uploads a few looped samples to onboard RAM, then starts and
+ *          releases notes on random voices with random envelopes, LFOs,
+ *          filters, pitch, pan and effect sends, updating in runs of
+ *          random length in between.
+ *
+ *          Build from this directory with:
+ *            gcc -O2 -I../include -I../cpu -o emu8k_test emu8k_test.c -lm
+ *
+ *          Usage: emu8k_test [seeds]
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snd_emu8k.c"
+
+int wavetable_pos_global = 0;
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void
+io_sethandler(UNUSED(uint16_t base), UNUSED(int size),
+              UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+              UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+              UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+              UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+              UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+              UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+              UNUSED(void *priv))
+{
+}
+
+void
+io_removehandler(UNUSED(uint16_t base), UNUSED(int size),
+                 UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+                 UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+                 UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+                 UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+                 UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+                 UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+                 UNUSED(void *priv))
+{
+}
+
+/* The ROM only has to be deterministic: noise at eight levels. */
+FILE *
+rom_fopen(UNUSED(const char *fn), UNUSED(char *mode))
+{
+    FILE    *fp  = tmpfile();
+    uint32_t lfsr = 0xace1;
+
+    if (fp == NULL)
+        return NULL;
+
+    for (uint32_t i = 0; i < (512 * 1024); i++) {
+        int16_t s;
+
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xb400);
+        s    = (int16_t) ((int32_t) (lfsr & 0xffff) - 0x8000) >> ((i >> 12) & 7);
+        fwrite(&s, 2, 1, fp);
+    }
+    rewind(fp);
+
+    return fp;
+}
+
+/* The per sample renderer as it was before block rendering, except that
+   each sample is mixed at its own position: the original only moved buf on
+   for samples it mixed, so a voice that became audible part way through an
+   update was written too early. */
+static void
+emu8k_update_ref(emu8k_t *emu8k)
+{
+    if (emu8k->pos >= wavetable_pos_global)
+        return;
+
+    int32_t       *buf;
+    emu8k_voice_t *emu_voice;
+    int            pos;
+
+    /* Clean the buffers since we will accumulate into them. */
+    buf = &emu8k->buffer[emu8k->pos * 2];
+    memset(buf, 0, 2 * (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->buffer[0]));
+    memset(&emu8k->chorus_in_buffer[emu8k->pos], 0, (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->chorus_in_buffer[0]));
+    memset(&emu8k->reverb_in_buffer[emu8k->pos], 0, (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->reverb_in_buffer[0]));
+
+    /* Voices section  */
+    for (uint8_t c = 0; c < 32; c++) {
+        emu_voice = &emu8k->voice[c];
+        buf       = &emu8k->buffer[emu8k->pos * 2];
+
+        for (pos = emu8k->pos; pos < wavetable_pos_global; pos++) {
+            int32_t dat;
+
+            if (emu_voice->cvcf_curr_volume) {
+                /* Waveform oscillator */
+#ifdef RESAMPLER_LINEAR
+                dat = EMU8K_READ_INTERP_LINEAR(emu8k, emu_voice->addr.int_address,
+                                               emu_voice->addr.fract_address);
+
+#elif defined RESAMPLER_CUBIC
+                dat = EMU8K_READ_INTERP_CUBIC(emu8k, emu_voice->addr.int_address,
+                                              emu_voice->addr.fract_address);
+#endif
+
+                /* Filter section */
+                if (emu_voice->filterq_idx || emu_voice->cvcf_curr_filt_ctoff != 0xFFFF) {
+                    int           cutoff = emu_voice->cvcf_curr_filt_ctoff >> 8;
+                    const int64_t coef0  = filt_coeffs[emu_voice->filterq_idx][cutoff][0];
+                    const int64_t coef1  = filt_coeffs[emu_voice->filterq_idx][cutoff][1];
+                    const int64_t coef2  = filt_coeffs[emu_voice->filterq_idx][cutoff][2];
+/* clip at twice the range */
+#define ClipBuffer(buf) (buf < -16777216) ? -16777216 : (buf > 16777216) ? 16777216 \
+                                                                         : buf
+
+#ifdef FILTER_INITIAL
+#    define NOOP(x) (void) x;
+                    NOOP(coef1)
+                    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one doesn't).
+                     * Work in 24bits. */
+                    dat = (dat * emu_voice->filt_att) >> 8;
+
+                    int64_t vhp = ((-emu_voice->filt_buffer[0] * coef2) >> 24) - emu_voice->filt_buffer[1] - dat;
+                    emu_voice->filt_buffer[1] += (emu_voice->filt_buffer[0] * coef0) >> 24;
+                    emu_voice->filt_buffer[0] += (vhp * coef0) >> 24;
+                    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
+                    if (dat > 32767) {
+                        dat = 32767;
+                    } else if (dat < -32768) {
+                        dat = -32768;
+                    }
+
+#elif defined FILTER_MOOG
+
+                    /*move to 24bits*/
+                    dat <<= 8;
+
+                    dat -= (coef2 * emu_voice->filt_buffer[4]) >> 24; /*feedback*/
+                    int64_t t1 = emu_voice->filt_buffer[1];
+                    emu_voice->filt_buffer[1] = ((dat + emu_voice->filt_buffer[0]) * coef0 - emu_voice->filt_buffer[1] * coef1) >> 24;
+                    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
+
+                    int64_t t2 = emu_voice->filt_buffer[2];
+                    emu_voice->filt_buffer[2] = ((emu_voice->filt_buffer[1] + t1) * coef0 - emu_voice->filt_buffer[2] * coef1) >> 24;
+                    emu_voice->filt_buffer[2] = ClipBuffer(emu_voice->filt_buffer[2]);
+
+                    int64_t t3 = emu_voice->filt_buffer[3];
+                    emu_voice->filt_buffer[3] = ((emu_voice->filt_buffer[2] + t2) * coef0 - emu_voice->filt_buffer[3] * coef1) >> 24;
+                    emu_voice->filt_buffer[3] = ClipBuffer(emu_voice->filt_buffer[3]);
+
+                    emu_voice->filt_buffer[4] = ((emu_voice->filt_buffer[3] + t3) * coef0 - emu_voice->filt_buffer[4] * coef1) >> 24;
+                    emu_voice->filt_buffer[4] = ClipBuffer(emu_voice->filt_buffer[4]);
+
+                    emu_voice->filt_buffer[0] = ClipBuffer(dat);
+
+                    dat = (int32_t) (emu_voice->filt_buffer[4] >> 8);
+                    if (dat > 32767) {
+                        dat = 32767;
+                    } else if (dat < -32768) {
+                        dat = -32768;
+                    }
+
+#elif defined FILTER_CONSTANT
+
+                    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one is constant gain).
+                     * Also stay at 24bits.*/
+                    dat = (dat * emu_voice->filt_att) >> 8;
+
+                    emu_voice->filt_buffer[0] = (coef1 * emu_voice->filt_buffer[0]
+                                                 + coef0 * (dat + ((coef2 * (emu_voice->filt_buffer[0] - emu_voice->filt_buffer[1])) >> 24)))
+                        >> 24;
+                    emu_voice->filt_buffer[1] = (coef1 * emu_voice->filt_buffer[1]
+                                                 + coef0 * emu_voice->filt_buffer[0])
+                        >> 24;
+
+                    emu_voice->filt_buffer[0] = ClipBuffer(emu_voice->filt_buffer[0]);
+                    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
+
+                    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
+                    if (dat > 32767) {
+                        dat = 32767;
+                    } else if (dat < -32768) {
+                        dat = -32768;
+                    }
+
+#endif
+                }
+                if ((emu8k->hwcf3 & 0x04) && !CCCA_DMA_ACTIVE(emu_voice->ccca)) {
+                    /*volume and pan*/
+                    dat = (dat * emu_voice->cvcf_curr_volume) >> 16;
+
+                    emu8k->buffer[pos * 2] += (dat * emu_voice->vol_l) >> 8;
+                    emu8k->buffer[(pos * 2) + 1] += (dat * emu_voice->vol_r) >> 8;
+
+                    /* Effects section */
+                    if (emu_voice->ptrx_revb_send > 0) {
+                        emu8k->reverb_in_buffer[pos] += (dat * emu_voice->ptrx_revb_send) >> 8;
+                    }
+                    if (emu_voice->csl_chor_send > 0) {
+                        emu8k->chorus_in_buffer[pos] += (dat * emu_voice->csl_chor_send) >> 8;
+                    }
+                }
+            }
+
+            if (emu_voice->env_engine_on) {
+                int32_t attenuation  = emu_voice->initial_att;
+                int32_t filtercut    = emu_voice->initial_filter;
+                int32_t currentpitch = emu_voice->ip;
+                /* run envelopes */
+                emu8k_envelope_t *volenv = &emu_voice->vol_envelope;
+                switch (volenv->state) {
+                    case ENV_DELAY:
+                        volenv->delay_samples--;
+                        if (volenv->delay_samples <= 0) {
+                            volenv->state         = ENV_ATTACK;
+                            volenv->delay_samples = 0;
+                        }
+                        attenuation = 0x1FFFFF;
+                        break;
+
+                    case ENV_ATTACK:
+                        /* Attack amount is in linear amplitude */
+                        volenv->value_amp_hz += volenv->attack_amount_amp_hz;
+                        if (volenv->value_amp_hz >= (1 << 21)) {
+                            volenv->value_amp_hz = 1 << 21;
+                            volenv->value_db_oct = 0;
+                            if (volenv->hold_samples) {
+                                volenv->state = ENV_HOLD;
+                            } else {
+                                /* RAMP_UP since db value is inverted and it is 0 at this point. */
+                                volenv->state = ENV_RAMP_UP;
+                            }
+                        }
+                        attenuation += env_vol_amplitude_to_db[volenv->value_amp_hz >> 5] << 5;
+                        break;
+
+                    case ENV_HOLD:
+                        volenv->hold_samples--;
+                        if (volenv->hold_samples <= 0) {
+                            volenv->state = ENV_RAMP_UP;
+                        }
+                        attenuation += volenv->value_db_oct;
+                        break;
+
+                    case ENV_RAMP_DOWN:
+                        /* Decay/release amount is in fraction of dBs and is always positive */
+                        volenv->value_db_oct -= volenv->ramp_amount_db_oct;
+                        if (volenv->value_db_oct <= volenv->sustain_value_db_oct) {
+                            volenv->value_db_oct = volenv->sustain_value_db_oct;
+                            volenv->state        = ENV_SUSTAIN;
+                        }
+                        attenuation += volenv->value_db_oct;
+                        break;
+
+                    case ENV_RAMP_UP:
+                        /* Decay/release amount is in fraction of dBs and is always positive */
+                        volenv->value_db_oct += volenv->ramp_amount_db_oct;
+                        if (volenv->value_db_oct >= volenv->sustain_value_db_oct) {
+                            volenv->value_db_oct = volenv->sustain_value_db_oct;
+                            volenv->state        = ENV_SUSTAIN;
+                        }
+                        attenuation += volenv->value_db_oct;
+                        break;
+
+                    case ENV_SUSTAIN:
+                        attenuation += volenv->value_db_oct;
+                        break;
+
+                    case ENV_STOPPED:
+                        attenuation = 0x1FFFFF;
+                        break;
+
+                    default:
+                        break;
+                }
+
+                emu8k_envelope_t *modenv = &emu_voice->mod_envelope;
+                switch (modenv->state) {
+                    case ENV_DELAY:
+                        modenv->delay_samples--;
+                        if (modenv->delay_samples <= 0) {
+                            modenv->state         = ENV_ATTACK;
+                            modenv->delay_samples = 0;
+                        }
+                        break;
+
+                    case ENV_ATTACK:
+                        /* Attack amount is in linear amplitude */
+                        modenv->value_amp_hz += modenv->attack_amount_amp_hz;
+                        modenv->value_db_oct = env_mod_hertz_to_octave[modenv->value_amp_hz >> 5] << 5;
+                        if (modenv->value_amp_hz >= (1 << 21)) {
+                            modenv->value_amp_hz = 1 << 21;
+                            modenv->value_db_oct = 1 << 21;
+                            if (modenv->hold_samples) {
+                                modenv->state = ENV_HOLD;
+                            } else {
+                                modenv->state = ENV_RAMP_DOWN;
+                            }
+                        }
+                        break;
+
+                    case ENV_HOLD:
+                        modenv->hold_samples--;
+                        if (modenv->hold_samples <= 0) {
+                            modenv->state = ENV_RAMP_UP;
+                        }
+                        break;
+
+                    case ENV_RAMP_DOWN:
+                        /* Decay/release amount is in fraction of octave and is always positive */
+                        modenv->value_db_oct -= modenv->ramp_amount_db_oct;
+                        if (modenv->value_db_oct <= modenv->sustain_value_db_oct) {
+                            modenv->value_db_oct = modenv->sustain_value_db_oct;
+                            modenv->state        = ENV_SUSTAIN;
+                        }
+                        break;
+
+                    case ENV_RAMP_UP:
+                        /* Decay/release amount is in fraction of octave and is always positive */
+                        modenv->value_db_oct += modenv->ramp_amount_db_oct;
+                        if (modenv->value_db_oct >= modenv->sustain_value_db_oct) {
+                            modenv->value_db_oct = modenv->sustain_value_db_oct;
+                            modenv->state        = ENV_SUSTAIN;
+                        }
+                        break;
+
+                    default:
+                        break;
+                }
+
+                /* run lfos */
+                if (emu_voice->lfo1_delay_samples) {
+                    emu_voice->lfo1_delay_samples--;
+                } else {
+                    emu_voice->lfo1_count.addr += emu_voice->lfo1_speed;
+                    emu_voice->lfo1_count.int_address &= 0xFFFF;
+                }
+                if (emu_voice->lfo2_delay_samples) {
+                    emu_voice->lfo2_delay_samples--;
+                } else {
+                    emu_voice->lfo2_count.addr += emu_voice->lfo2_speed;
+                    emu_voice->lfo2_count.int_address &= 0xFFFF;
+                }
+
+                if (emu_voice->fixed_modenv_pitch_height) {
+                    /* modenv range 1<<21, pitch height range 1<<14 desired range 0x1000 (+/-one octave) */
+                    currentpitch += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_pitch_height) >> 14;
+                }
+
+                if (emu_voice->fixed_lfo1_vibrato) {
+                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
+                    int32_t lfo1_vibrato = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_vibrato) >> 17;
+                    currentpitch += lfo1_vibrato;
+                }
+                if (emu_voice->fixed_lfo2_vibrato) {
+                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
+                    int32_t lfo2_vibrato = (lfotable[emu_voice->lfo2_count.int_address] * emu_voice->fixed_lfo2_vibrato) >> 17;
+                    currentpitch += lfo2_vibrato;
+                }
+
+                if (emu_voice->fixed_modenv_filter_height) {
+                    /* modenv range 1<<21, pitch height range 1<<14 desired range 0x200000 (+/-full filter range) */
+                    filtercut += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_filter_height) >> 5;
+                }
+
+                if (emu_voice->fixed_lfo1_filt_mod) {
+                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x100000 (+/-three octaves) */
+                    int32_t lfo1_filtmod = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_filt_mod) >> 9;
+                    filtercut += lfo1_filtmod;
+                }
+
+                if (emu_voice->fixed_lfo1_tremolo) {
+                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x40000 (+/-12dBs). */
+                    int32_t lfo1_tremolo = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_tremolo) >> 11;
+                    attenuation += lfo1_tremolo;
+                }
+
+                if (currentpitch > 0xFFFF)
+                    currentpitch = 0xFFFF;
+                if (currentpitch < 0)
+                    currentpitch = 0;
+                if (attenuation > 0x1FFFFF)
+                    attenuation = 0x1FFFFF;
+                if (attenuation < 0)
+                    attenuation = 0;
+                if (filtercut > 0x1FFFFF)
+                    filtercut = 0x1FFFFF;
+                if (filtercut < 0)
+                    filtercut = 0;
+
+                emu_voice->vtft_vol_target    = env_vol_db_to_vol_target[attenuation >> 5];
+                emu_voice->vtft_filter_target = filtercut >> 5;
+                emu_voice->ptrx_pit_target    = freqtable[currentpitch] >> 18;
+            }
+            /*
+            I've recopilated these sentences to get an idea of how to loop
+
+            - Set its PSST register and its CLS register to zero to cause no loops to occur.
+            -Setting the Loop Start Offset and the Loop End Offset to the same value, will cause the oscillator to loop the entire memory.
+
+            -Setting the PlayPosition greater than the Loop End Offset, will cause the oscillator to play in reverse, back to the Loop End Offset.
+               It's pretty neat, but appears to be uncontrollable (the rate at which the samples are played in reverse).
+
+            -Note that due to interpolator offset, the actual loop point is one greater than the start address
+            -Note that due to interpolator offset, the actual loop point will end at an address one greater than the loop address
+            -Note that the actual audio location is the point 1 word higher than this value due to interpolation offset
+            -In programs that use the awe, they generally set the loop address as "loopaddress -1" to compensate for the above.
+            (Note: I am already using address+1 in the interpolators so these things are already as they should.)
+            */
+            emu_voice->addr.addr += ((uint64_t) emu_voice->cpf_curr_pitch) << 18;
+            if (emu_voice->addr.addr >= emu_voice->loop_end.addr) {
+                emu_voice->addr.int_address -= (emu_voice->loop_end.int_address - emu_voice->loop_start.int_address);
+                emu_voice->addr.int_address &= EMU8K_MEM_ADDRESS_MASK;
+            }
+
+            /* TODO: How and when are the target and current values updated */
+            emu_voice->cpf_curr_pitch       = emu_voice->ptrx_pit_target;
+            emu_voice->cvcf_curr_volume     = emu8k_vol_slide(&emu_voice->volumeslide, emu_voice->vtft_vol_target);
+            emu_voice->cvcf_curr_filt_ctoff = emu_voice->vtft_filter_target;
+        }
+
+        /* Update EMU voice registers. */
+        emu_voice->ccca               = (((uint32_t) emu_voice->ccca_qcontrol) << 24) | emu_voice->addr.int_address;
+        emu_voice->cpf_curr_frac_addr = emu_voice->addr.fract_address;
+
+#if 0
+        if (emu_voice->cvcf_curr_volume != old_vol[c]) {
+            pclog("EMUVOL (%d):%d\n", c, emu_voice->cvcf_curr_volume);
+            old_vol[c]=emu_voice->cvcf_curr_volume;
+        }
+        pclog("EMUFILT :%d\n", emu_voice->cvcf_curr_filt_ctoff);
+#endif
+    }
+
+    buf = &emu8k->buffer[emu8k->pos * 2];
+    emu8k_work_reverb(&emu8k->reverb_in_buffer[emu8k->pos], buf, &emu8k->reverb_engine, wavetable_pos_global - emu8k->pos);
+    emu8k_work_chorus(&emu8k->chorus_in_buffer[emu8k->pos], buf, &emu8k->chorus_engine, wavetable_pos_global - emu8k->pos);
+    emu8k_work_eq(buf, wavetable_pos_global - emu8k->pos);
+
+    /* Update EMU clock. */
+    emu8k->wc += (wavetable_pos_global - emu8k->pos);
+
+    emu8k->pos = wavetable_pos_global;
+}
+
+
+#define EMU_ADDR 0x620
+#define RAM_KB   512
+
+static uint32_t rng;
+
+static uint32_t
+rnd(uint32_t range)
+{
+    rng = (rng * 1103515245) + 12345;
+    return ((rng >> 8) & 0xffffff) % range;
+}
+
+static emu8k_t *emu[2];
+static uint64_t audible;
+
+static void
+update_both(int samples)
+{
+    wavetable_pos_global += samples;
+    if (wavetable_pos_global > WTBUFLEN)
+        wavetable_pos_global = WTBUFLEN;
+
+    emu8k_update(emu[0]);
+    emu8k_update_ref(emu[1]);
+
+    if (memcmp(emu[0]->buffer, emu[1]->buffer, wavetable_pos_global * 2 * sizeof(int32_t)) ||
+        memcmp(emu[0]->chorus_in_buffer, emu[1]->chorus_in_buffer, wavetable_pos_global * sizeof(int32_t)) ||
+        memcmp(emu[0]->reverb_in_buffer, emu[1]->reverb_in_buffer, wavetable_pos_global * sizeof(int32_t)))
+        fatal("Output differs at sample %i\n", wavetable_pos_global);
+    if (memcmp(emu[0]->voice, emu[1]->voice, sizeof(emu[0]->voice)) || (emu[0]->wc != emu[1]->wc))
+        fatal("Voice state differs at sample %i\n", wavetable_pos_global);
+
+    for (int i = 0; i < (wavetable_pos_global * 2); i++)
+        audible += (emu[0]->buffer[i] != 0);
+
+    /* What sound.c and the Sound Blaster do at the end of each buffer. */
+    if (wavetable_pos_global == WTBUFLEN) {
+        wavetable_pos_global = 0;
+        emu[0]->pos          = 0;
+        emu[1]->pos          = 0;
+    }
+}
+
+/* Both cards are brought up to date first, so the update emu8k_outw() does
+   itself has nothing left to render. */
+static void
+out(uint16_t port, uint16_t val)
+{
+    update_both(0);
+    emu8k_outw(port, val, emu[0]);
+    emu8k_outw(port, val, emu[1]);
+}
+
+static void
+reg_write(int reg, int voice, uint16_t port, uint16_t val)
+{
+    out(EMU_ADDR + 0x802, (reg << 5) | voice);
+    out(port, val);
+}
+
+static void
+reg_write32(int reg, int voice, uint16_t port, uint32_t val)
+{
+    reg_write(reg, voice, port, val & 0xffff);
+    reg_write(reg, voice, port + 2, val >> 16);
+}
+
+#define DATA0 (EMU_ADDR)
+#define DATA1 (EMU_ADDR + 0x400)
+#define DATA2 (EMU_ADDR + 0x402)
+#define DATA3 (EMU_ADDR + 0x800)
+
+typedef struct sample_t {
+    uint32_t start;
+    uint32_t loop_start;
+    uint32_t loop_end;
+} sample_t;
+
+/* Upload a looped single cycle wave and a longer noise burst per sample,
+   through the SMALW/SMLD ports as a SoundFont loader would. */
+static void
+upload_samples(sample_t *samples, int count)
+{
+    uint32_t addr = EMU8K_RAM_MEM_START + 0x100;
+
+    for (int s = 0; s < count; s++) {
+        const int len   = 256 + rnd(4096);
+        const int cycle = 16 + rnd(240);
+
+        samples[s].start      = addr;
+        samples[s].loop_start = addr + len - cycle;
+        samples[s].loop_end   = addr + len;
+
+        reg_write32(1, 22, DATA1, addr);
+        for (int i = 0; i < (len + 8); i++) {
+            int32_t v;
+
+            if (i < (len - cycle))
+                v = (int32_t) rnd(0x10000) - 0x8000;
+            else
+                v = (((i - (len - cycle)) * 0x10000) / cycle) - 0x8000;
+            reg_write(1, 26, DATA1, (uint16_t) v);
+        }
+        addr += len + 8 + 16;
+    }
+}
+
+static void
+note_on(int v, const sample_t *smp)
+{
+    const uint32_t pan    = rnd(256);
+    const uint32_t chorus = rnd(2) ? rnd(256) : 0;
+    const uint32_t reverb = rnd(2) ? rnd(256) : 0;
+    const uint32_t pitch  = 0xc000 + rnd(0x3000) - 0x1800;
+    const uint32_t q      = rnd(16);
+
+    /* Stop the voice and clear it, as the AWE32 programmer's guide says. */
+    reg_write(5, v, DATA1, 0x0080);
+    reg_write32(3, v, DATA0, 0x0000ffff);
+    reg_write32(2, v, DATA0, 0x0000ffff);
+    reg_write32(1, v, DATA0, 0x40000000);
+    reg_write32(0, v, DATA0, 0x40000000);
+
+    /* Envelopes, LFOs and modulation. */
+    reg_write(4, v, DATA1, rnd(4) ? 0x8000 : 0x7f00 + rnd(0x100));
+    reg_write(6, v, DATA1, rnd(4) ? 0x8000 : 0x7f00 + rnd(0x100));
+    reg_write(7, v, DATA1, rnd(0x8000));
+    reg_write(4, v, DATA2, 0x7f00 | rnd(0x80));
+    reg_write(5, v, DATA2, 0x8000 - rnd(0x400));
+    reg_write(6, v, DATA2, 0x7f00 | rnd(0x80));
+    reg_write(7, v, DATA2, 0x8000 - rnd(0x400));
+    reg_write(0, v, DATA3, pitch);
+    reg_write(1, v, DATA3, (rnd(4) ? 0xff00 : (rnd(0x100) << 8)) | rnd(0x60));
+    reg_write(2, v, DATA3, rnd(0x10000));
+    reg_write(3, v, DATA3, rnd(0x10000));
+    reg_write(4, v, DATA3, rnd(0x10000));
+    reg_write(5, v, DATA3, rnd(0x10000));
+
+    /* Sample addresses, then start the envelope. */
+    reg_write32(6, v, DATA0, (pan << 24) | (smp->loop_start - 1));
+    reg_write32(7, v, DATA0, (chorus << 24) | (smp->loop_end - 1));
+    reg_write32(0, v, DATA1, (q << 28) | (smp->start - 1));
+    reg_write32(3, v, DATA0, 0xffff0000 | (0xff00 + rnd(0x100)));
+    reg_write32(1, v, DATA0, (pitch << 16) | (reverb << 8));
+    reg_write(5, v, DATA1, rnd(0x7f00) & 0x7f7f);
+}
+
+static void
+note_off(int v)
+{
+    reg_write(5, v, DATA1, 0x8000 | rnd(0x80));
+}
+
+int
+main(int argc, char *argv[])
+{
+    const int seeds = (argc > 1) ? atoi(argv[1]) : 20;
+    sample_t  samples[8];
+
+    for (int seed = 1; seed <= seeds; seed++) {
+        rng                  = seed;
+        wavetable_pos_global = 0;
+        audible              = 0;
+
+        for (int i = 0; i < 2; i++) {
+            emu[i] = (emu8k_t *) calloc(1, sizeof(emu8k_t));
+            if (emu[i] == NULL)
+                fatal("Out of memory\n");
+            emu8k_init(emu[i], EMU_ADDR, RAM_KB);
+        }
+
+        /* Unmute. */
+        reg_write(1, 31, DATA1, 0x0004);
+
+        upload_samples(samples, 8);
+
+        for (int ev = 0; ev < 2000; ev++) {
+            const int v = rnd(32);
+
+            switch (rnd(3)) {
+                case 0:
+                case 1:
+                    note_on(v, &samples[rnd(8)]);
+                    break;
+                default:
+                    note_off(v);
+                    break;
+            }
+
+            update_both(1 + rnd(rnd(8) ? 200 : 2000));
+        }
+
+        if (audible == 0)
+            fatal("Sequence %i produced no output\n", seed);
+
+        for (int i = 0; i < 2; i++) {
+            emu8k_close(emu[i]);
+            free(emu[i]->empty);
+            free(emu[i]);
+        }
+    }
+
+    printf("%i sequences identical\n", seeds);
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Stereo filter comparison test.
+ *
+ *          Runs random stereo samples through every stereo filter in
+ *          filters.h and through the single channel filter it replaced,
+ *          once per channel, for every filter instance. The outputs must
+ *          be bit-identical. The FIR coefficients are random, normalised
+ *          to unity gain like the ones recalc_sb16_filter() computes.
+ *          Built for x86-64 this checks the SSE2 versions, for AArch64 the
+ *          NEON versions, and with -DTEST_PLAIN_C the plain C ones.
+ *
+ *          Build from this directory with:
+ *            gcc -O2 -I../include -o filters_test filters_test.c -lm
+ *
+ *          Usage: filters_test [samples]
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef TEST_PLAIN_C
+#    undef __SSE2__
+#    undef __aarch64__
+#endif
+#include <86box/filters.h>
+
+double low_fir_sb16_coef[5][SB16_NCoef];
+double low_fir_pas16_coef[SB16_NCoef];
+
+static uint32_t rng = 1;
+static int      failures;
+
+static uint32_t
+rnd(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+
+    return rng;
+}
+
+/* Mostly 16-bit samples as the cards feed in, now and then far larger. */
+static double
+random_sample(void)
+{
+    if (rnd() & 15)
+        return (double) (int16_t) rnd();
+
+    return ((double) (int32_t) rnd()) / ((double) (1 + (rnd() & 0xff)));
+}
+
+static void
+random_fir(double *coef)
+{
+    double gain = 0.0;
+
+    for (int n = 0; n < SB16_NCoef; n++) {
+        coef[n] = ((double) (int32_t) rnd()) / 2147483648.0;
+        gain += coef[n];
+    }
+    for (int n = 0; n < SB16_NCoef; n++)
+        coef[n] /= gain;
+}
+
+static void
+compare(const char *name, int c, long s, const double *out, double l, double r)
+{
+    if (memcmp(&out[0], &l, sizeof(double)) || memcmp(&out[1], &r, sizeof(double))) {
+        if (failures++ < 10)
+            fprintf(stderr, "%s %i sample %li: %.17g/%.17g, should be %.17g/%.17g\n",
+                    name, c, s, out[0], out[1], l, r);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    long   samples = (argc > 1) ? atol(argv[1]) : 1000000;
+    double out[2];
+    double in_l;
+    double in_r;
+
+    for (int c = 0; c < 5; c++)
+        random_fir(low_fir_sb16_coef[c]);
+    random_fir(low_fir_pas16_coef);
+
+    for (long s = 0; s < samples; s++) {
+        for (int c = 0; c < 4; c++) {
+            in_l = random_sample();
+            in_r = random_sample();
+            low_iir_stereo(c, in_l, in_r, out);
+            compare("low_iir", c, s, out, low_iir(c, 0, in_l), low_iir(c, 1, in_r));
+
+            in_l = random_sample();
+            in_r = random_sample();
+            low_cut_iir_stereo(c, in_l, in_r, out);
+            compare("low_cut_iir", c, s, out, low_cut_iir(c, 0, in_l), low_cut_iir(c, 1, in_r));
+
+            in_l = random_sample();
+            in_r = random_sample();
+            high_iir_stereo(c, in_l, in_r, out);
+            compare("high_iir", c, s, out, high_iir(c, 0, in_l), high_iir(c, 1, in_r));
+
+            in_l = random_sample();
+            in_r = random_sample();
+            high_cut_iir_stereo(c, in_l, in_r, out);
+            compare("high_cut_iir", c, s, out, high_cut_iir(c, 0, in_l), high_cut_iir(c, 1, in_r));
+
+            in_l = random_sample();
+            in_r = random_sample();
+            sb_iir_stereo(c, in_l, in_r, out);
+            compare("sb_iir", c, s, out, sb_iir(c, 0, in_l), sb_iir(c, 1, in_r));
+
+            /* The mono FIR steps its position on the right channel. */
+            in_l = random_sample();
+            in_r = random_sample();
+            low_fir_sb16_stereo(c, in_l, in_r, out);
+            compare("low_fir_sb16", c, s, out, low_fir_sb16(c, 0, in_l), low_fir_sb16(c, 1, in_r));
+        }
+
+        in_l = random_sample();
+        in_r = random_sample();
+        low_fir_pas16_stereo(in_l, in_r, out);
+        compare("low_fir_pas16", 0, s, out, low_fir_pas16(0, in_l), low_fir_pas16(1, in_r));
+    }
+
+    if (failures) {
+        fprintf(stderr, "%i mismatches\n", failures);
+        return 1;
+    }
+
+    printf("%li stereo samples through every filter, identical\n", samples);
+
+    return 0;
+}
@@ -0,0 +1,636 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Gravis UltraSound block rendering comparison test.
+ *
+ *          Runs two GUSes side by side on the real timer code. One renders
+ *          its voices in blocks through gus_wave_sync(), the other with a
+ *          copy of the per sample gus_poll_wave() the blocks replaced, on
+ *          its own timer. A random driver programs voice addresses,
+ *          frequencies, volume ramps, pans, loop and IRQ modes, stops and
+ *          starts voices, changes the number of active voices, resets the
+ *          wave engine, acknowledges IRQs and reads the registers at
+ *          random times, doing the same to both cards. The register
+ *          values, the interrupt line after every step and every output
+ *          buffer must be identical.
+ *
+ *          Build from this directory with:
+ *            gcc -O2 -I../include -I../cpu -o gus_test gus_test.c -lm
+ *
+ *          Usage: gus_test [seeds]
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../timer.c"
+#include "snd_gus.c"
+
+#define GUS_BASE 0x240
+
+uint64_t tsc              = 0;
+int      sound_pos_global = 0;
+int      nmi              = 0;
+
+static gus_t     *dev;
+static gus_t     *ref;
+static gus_t     *cur;
+static pc_timer_t ref_samp_timer;
+static pc_timer_t sound_timer;
+static uint64_t   sound_latch;
+static int        irq_state[2];
+static int        irq_changes[2];
+static int32_t    out_dev[SOUNDBUFLEN * 2];
+static int32_t    out_ref[SOUNDBUFLEN * 2];
+static int        buffers;
+static uint32_t   rng;
+
+void
+fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void
+pclog_ex(UNUSED(const char *fmt), UNUSED(va_list ap))
+{
+}
+
+void
+io_sethandler(UNUSED(uint16_t base), UNUSED(int size),
+              UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+              UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+              UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+              UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+              UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+              UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+              UNUSED(void *priv))
+{
+}
+
+void
+io_removehandler(UNUSED(uint16_t base), UNUSED(int size),
+                 UNUSED(uint8_t (*inb)(uint16_t addr, void *priv)),
+                 UNUSED(uint16_t (*inw)(uint16_t addr, void *priv)),
+                 UNUSED(uint32_t (*inl)(uint16_t addr, void *priv)),
+                 UNUSED(void (*outb)(uint16_t addr, uint8_t val, void *priv)),
+                 UNUSED(void (*outw)(uint16_t addr, uint16_t val, void *priv)),
+                 UNUSED(void (*outl)(uint16_t addr, uint32_t val, void *priv)),
+                 UNUSED(void *priv))
+{
+}
+
+void
+sound_add_handler(UNUSED(void (*get_buffer)(int32_t *buffer, int len, void *priv)), UNUSED(void *priv))
+{
+}
+
+uint64_t
+sound_get_pos_ts(int pos)
+{
+    return sound_timer.ts.ts64 - ((uint64_t) (sound_pos_global - pos) * sound_latch);
+}
+
+int
+device_get_config_int(const char *name)
+{
+    /* 1 MB of sample memory on a classic GUS. */
+    return !strcmp(name, "gus_ram") ? 2 : 0;
+}
+
+int
+device_get_config_hex16(UNUSED(const char *name))
+{
+    return GUS_BASE;
+}
+
+void
+midi_raw_out_byte(UNUSED(uint8_t val))
+{
+}
+
+void
+midi_in_handler(UNUSED(int set), UNUSED(void (*msg)(void *priv, uint8_t *msg, uint32_t len)),
+                UNUSED(int (*sysex)(void *priv, uint8_t *buffer, uint32_t len, int abort)), UNUSED(void *priv))
+{
+}
+
+int
+dma_channel_read(UNUSED(int channel))
+{
+    return DMA_NODATA;
+}
+
+int
+dma_channel_write(UNUSED(int channel), UNUSED(uint16_t val))
+{
+    return DMA_NODATA;
+}
+
+void
+nmi_raise(void)
+{
+}
+
+void
+picint_common(UNUSED(uint16_t num), UNUSED(int level), int set, UNUSED(uint8_t *irq_state_ptr))
+{
+    int card = (cur == ref);
+
+    if (irq_state[card] != set)
+        irq_changes[card]++;
+    irq_state[card] = set;
+}
+
+static void
+ref_poll_wave(void *priv)
+{
+    gus_t   *gus = (gus_t *) priv;
+    uint32_t addr;
+    int16_t  v;
+    int32_t  vl;
+    int      update_irqs = 0;
+
+    gus_update(gus);
+
+    timer_advance_u64(&ref_samp_timer, gus->samp_latch);
+
+    gus->out_l = gus->out_r = 0;
+
+    if ((gus->reset & 3) != 3)
+        return;
+    for (uint8_t d = 0; d < 32; d++) {
+        if (!(gus->ctrl[d] & 3)) {
+            if (gus->ctrl[d] & 4) {
+                addr = gus->cur[d] >> 9;
+                addr = (addr & 0xC0000) | ((addr << 1) & 0x3FFFE);
+                if (!(gus->freq[d] >> 10)) {
+                    /* Interpolate */
+                    if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
+                        vl = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80) *
+                             (511 - (gus->cur[d] & 511));
+                    else
+                        vl = 0;
+
+                    if (((addr + 3) & 0xfffff) < gus->gus_end_ram)
+                        vl += (int16_t) (int8_t) ((gus->ram[(addr + 3) & 0xfffff] ^ 0x80) - 0x80) *
+                              (gus->cur[d] & 511);
+
+                    v = vl >> 9;
+                } else if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
+                    v = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80);
+                else
+                    v = 0x0000;
+            } else {
+                if (!(gus->freq[d] >> 10)) {
+                    /* Interpolate */
+                    if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
+                        vl = ((int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80)) *
+                                       (511 - (gus->cur[d] & 511));
+                    else
+                        vl = 0;
+
+                    if ((((gus->cur[d] >> 9) + 1) & 0xfffff) < gus->gus_end_ram)
+                        vl += ((int8_t) ((gus->ram[((gus->cur[d] >> 9) + 1) & 0xfffff] ^ 0x80) - 0x80)) *
+                              (gus->cur[d] & 511);
+
+                    v = vl >> 9;
+                } else if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
+                    v = (int16_t) (int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80);
+                else
+                    v = 0x0000;
+            }
+
+            if ((gus->rcur[d] >> 14) > 4095)
+                v = (int16_t) (float) (v) *24.0 * vol16bit[4095];
+            else
+                v = (int16_t) (float) (v) *24.0 * vol16bit[(gus->rcur[d] >> 10) & 4095];
+
+            gus->out_l += (v * gus->pan_l[d]) / 7;
+            gus->out_r += (v * gus->pan_r[d]) / 7;
+
+            if (gus->ctrl[d] & 0x40) {
+                gus->cur[d] -= (gus->freq[d] >> 1);
+                if (gus->cur[d] <= gus->start[d]) {
+                    int diff = gus->start[d] - gus->cur[d];
+
+                    if (gus->ctrl[d] & 8) {
+                        if (gus->ctrl[d] & 0x10)
+                            gus->ctrl[d] ^= 0x40;
+                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
+                    } else if (!(gus->rctrl[d] & 4)) {
+                        gus->ctrl[d] |= 1;
+                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                    }
+
+                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
+                        gus->waveirqs[d] = 1;
+                        update_irqs      = 1;
+                    }
+                }
+            } else {
+                gus->cur[d] += (gus->freq[d] >> 1);
+
+                if (gus->cur[d] >= gus->end[d]) {
+                    int diff = gus->cur[d] - gus->end[d];
+
+                    if (gus->ctrl[d] & 8) {
+                        if (gus->ctrl[d] & 0x10)
+                            gus->ctrl[d] ^= 0x40;
+                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
+                    } else if (!(gus->rctrl[d] & 4)) {
+                        gus->ctrl[d] |= 1;
+                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                    }
+
+                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
+                        gus->waveirqs[d] = 1;
+                        update_irqs      = 1;
+                    }
+                }
+            }
+        }
+        if (!(gus->rctrl[d] & 3)) {
+            if (gus->rctrl[d] & 0x40) {
+                gus->rcur[d] -= gus->rfreq[d];
+                if (gus->rcur[d] <= gus->rstart[d]) {
+                    int diff = gus->rstart[d] - gus->rcur[d];
+                    if (!(gus->rctrl[d] & 8)) {
+                        gus->rctrl[d] |= 1;
+                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+                    } else {
+                        if (gus->rctrl[d] & 0x10)
+                            gus->rctrl[d] ^= 0x40;
+                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                    }
+
+                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
+                        gus->rampirqs[d] = 1;
+                        update_irqs      = 1;
+                    }
+                }
+            } else {
+                gus->rcur[d] += gus->rfreq[d];
+                if (gus->rcur[d] >= gus->rend[d]) {
+                    int diff = gus->rcur[d] - gus->rend[d];
+                    if (!(gus->rctrl[d] & 8)) {
+                        gus->rctrl[d] |= 1;
+                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+                    } else {
+                        if (gus->rctrl[d] & 0x10)
+                            gus->rctrl[d] ^= 0x40;
+                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                    }
+
+                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
+                        gus->rampirqs[d] = 1;
+                        update_irqs      = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (update_irqs)
+        gus_update_int_status(gus);
+}
+
+
+static void
+ref_get_buffer(int32_t *buffer, int len, void *priv)
+{
+    gus_t *gus = (gus_t *) priv;
+
+    gus_update(gus);
+
+    for (int c = 0; c < len * 2; c++)
+        buffer[c] += (int32_t) gus->buffer[c & 1][c >> 1];
+
+    gus->pos = 0;
+}
+
+static void
+dev_poll_wave(void *priv)
+{
+    cur = dev;
+    gus_poll_wave(priv);
+}
+
+static void
+ref_samp_timer_process(void *priv)
+{
+    cur = ref;
+    ref_poll_wave(priv);
+}
+
+static void
+dev_poll_timer_1(void *priv)
+{
+    cur = dev;
+    gus_poll_timer_1(priv);
+}
+
+static void
+dev_poll_timer_2(void *priv)
+{
+    cur = dev;
+    gus_poll_timer_2(priv);
+}
+
+static void
+ref_poll_timer_1(void *priv)
+{
+    cur = ref;
+    gus_poll_timer_1(priv);
+}
+
+static void
+ref_poll_timer_2(void *priv)
+{
+    cur = ref;
+    gus_poll_timer_2(priv);
+}
+
+static void
+sound_poll_test(UNUSED(void *priv))
+{
+    timer_advance_u64(&sound_timer, sound_latch);
+
+    sound_pos_global++;
+    if (sound_pos_global == SOUNDBUFLEN) {
+        memset(out_dev, 0, sizeof(out_dev));
+        memset(out_ref, 0, sizeof(out_ref));
+        cur = dev;
+        gus_get_buffer(out_dev, SOUNDBUFLEN, dev);
+        cur = ref;
+        ref_get_buffer(out_ref, SOUNDBUFLEN, ref);
+
+        for (int c = 0; c < (SOUNDBUFLEN * 2); c++) {
+            if (out_dev[c] != out_ref[c])
+                fatal("Buffer %i sample %i: %i, should be %i\n", buffers, c, out_dev[c], out_ref[c]);
+        }
+        buffers++;
+
+        sound_pos_global = 0;
+    }
+}
+
+static uint32_t
+rnd(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+
+    return rng;
+}
+
+static void
+parked_timer(UNUSED(void *priv))
+{
+    fatal("Reference card ran the block renderer\n");
+}
+
+/* The reference card must never run the block renderer, so its sample
+   timer is kept well out of reach around every register access. */
+static void
+park(void)
+{
+    timer_disable(&ref->samp_timer);
+    ref->samp_timer.ts.ts64         = 0ULL;
+    ref->samp_timer.ts.ts32.integer = (uint32_t) tsc + 0x40000000;
+    timer_enable(&ref->samp_timer);
+    ref->samp_ahead = 0;
+}
+
+static void
+outb_both(uint16_t port, uint8_t val)
+{
+    cur = dev;
+    writegus(port, val, dev);
+
+    park();
+    cur = ref;
+    writegus(port, val, ref);
+    park();
+}
+
+static uint8_t
+inb_both(uint16_t port)
+{
+    uint8_t a;
+    uint8_t b;
+
+    cur = dev;
+    a   = readgus(port, dev);
+
+    park();
+    cur = ref;
+    b   = readgus(port, ref);
+    park();
+
+    if (a != b)
+        fatal("Port %03X register %02X voice %i: %02X, should be %02X\n", port, ref->global, ref->voice, a, b);
+
+    return a;
+}
+
+static void
+write_reg(uint8_t reg, uint16_t val)
+{
+    outb_both(GUS_BASE + 0x103, reg);
+    outb_both(GUS_BASE + 0x104, val);
+    outb_both(GUS_BASE + 0x105, val >> 8);
+}
+
+/* The high byte alone, as drivers write the 8-bit registers. */
+static void
+write_reg8(uint8_t reg, uint8_t val)
+{
+    outb_both(GUS_BASE + 0x103, reg);
+    outb_both(GUS_BASE + 0x105, val);
+}
+
+static void
+check_regs(void)
+{
+    static const uint8_t regs[] = { 0x80, 0x82, 0x83, 0x89, 0x8a, 0x8b, 0x8c, 0x8d };
+
+    for (int v = 0; v < 32; v++) {
+        outb_both(GUS_BASE + 0x102, v);
+        for (unsigned i = 0; i < sizeof(regs); i++) {
+            outb_both(GUS_BASE + 0x103, regs[i]);
+            inb_both(GUS_BASE + 0x104);
+            inb_both(GUS_BASE + 0x105);
+        }
+    }
+
+    inb_both(GUS_BASE + 0x006);
+}
+
+/* Mostly short loops and ramps, so IRQs are raised often. */
+static void
+program_voice(int v)
+{
+    uint32_t addr  = rnd() % 0xff000;
+    uint32_t len   = 1 + (rnd() % ((rnd() & 3) ? 256 : 0x8000));
+    uint32_t start = addr << 9;
+    uint32_t end   = (addr + len) << 9;
+    uint32_t pos   = start + (rnd() % (end - start));
+    uint8_t  ramp0 = rnd();
+    uint8_t  ramp1 = rnd();
+
+    outb_both(GUS_BASE + 0x102, v);
+    write_reg(0x01, (rnd() & 3) ? (rnd() % 0x2000) : rnd());
+    write_reg(0x02, start >> 16);
+    write_reg(0x03, start);
+    write_reg(0x04, end >> 16);
+    write_reg(0x05, end);
+    write_reg(0x0a, pos >> 16);
+    write_reg(0x0b, pos);
+    write_reg8(0x06, rnd());
+    write_reg8(0x07, (ramp0 < ramp1) ? ramp0 : ramp1);
+    write_reg8(0x08, (ramp0 < ramp1) ? ramp1 : ramp0);
+    write_reg(0x09, rnd());
+    write_reg8(0x0c, rnd() & 0x0f);
+    write_reg8(0x0d, rnd() & ((rnd() & 3) ? 0x7c : 0x7f));
+    write_reg8(0x00, rnd() & ((rnd() & 3) ? 0x7c : 0x7f));
+}
+
+static void
+random_op(void)
+{
+    int v = rnd() & 31;
+
+    switch (rnd() % 10) {
+        case 0:
+            program_voice(v);
+            break;
+        case 1:
+            /* Stop, start or change the loop mode of a voice. */
+            outb_both(GUS_BASE + 0x102, v);
+            write_reg8(0x00, rnd() & ((rnd() & 1) ? 0x7c : 0x7f));
+            break;
+        case 2:
+            outb_both(GUS_BASE + 0x102, v);
+            write_reg8(0x0d, rnd() & ((rnd() & 1) ? 0x7c : 0x7f));
+            break;
+        case 3:
+            /* Acknowledge wave and volume ramp IRQs the way the drivers
+               do, until none are left or the next one is due. */
+            inb_both(GUS_BASE + 0x006);
+            outb_both(GUS_BASE + 0x103, 0x8f);
+            for (int i = 0; i < 32; i++) {
+                if ((inb_both(GUS_BASE + 0x105) & 0xc0) == 0xc0)
+                    break;
+            }
+            break;
+        case 4:
+            write_reg8(0x0e, 0xc0 | (rnd() & 31));
+            break;
+        case 5:
+            write_reg8(0x4c, (rnd() & 7) ? 0x07 : (rnd() & 0x07));
+            break;
+        case 6:
+            outb_both(GUS_BASE + 0x102, v);
+            write_reg(0x01, (rnd() & 3) ? (rnd() % 0x2000) : rnd());
+            break;
+        default:
+            check_regs();
+            break;
+    }
+}
+
+static void
+run(uint32_t seed)
+{
+    int steps;
+
+    rng = seed * 2654435761u + 1;
+
+    cur = dev = gus_init(NULL);
+    cur = ref = gus_init(NULL);
+    for (uint32_t i = 0; i < dev->gus_end_ram; i++)
+        dev->ram[i] = ref->ram[i] = rnd() >> 24;
+
+    timer_set_callback(&dev->samp_timer, dev_poll_wave);
+    timer_set_callback(&dev->timer_1, dev_poll_timer_1);
+    timer_set_callback(&dev->timer_2, dev_poll_timer_2);
+    timer_set_callback(&ref->samp_timer, parked_timer);
+    timer_set_callback(&ref->timer_1, ref_poll_timer_1);
+    timer_set_callback(&ref->timer_2, ref_poll_timer_2);
+    timer_add(&ref_samp_timer, ref_samp_timer_process, ref, 1);
+    park();
+
+    sound_latch = (uint64_t) (((double) TIMER_USEC) * (1000000.0 / 48000.0));
+    timer_add(&sound_timer, sound_poll_test, NULL, 0);
+    timer_set_delay_u64(&sound_timer, (sound_latch / 4) + (rnd() % (sound_latch / 2)));
+    sound_pos_global = 0;
+
+    irq_state[0] = irq_state[1] = 0;
+    irq_changes[0] = irq_changes[1] = 0;
+
+    for (int v = 0; v < 32; v++)
+        program_voice(v);
+    write_reg8(0x4c, 0x07);
+
+    buffers = 0;
+
+    for (steps = 0; buffers < 100; steps++) {
+        /* Mostly short steps, so interrupts are checked close to when they
+           are raised, with the odd long one. */
+        uint32_t sample = (uint32_t) (dev->samp_latch >> 32);
+
+        tsc += (rnd() & 15) ? (1 + (rnd() % sample)) : (rnd() % (100 * sample));
+        timer_process();
+
+        if (irq_state[0] != irq_state[1])
+            fatal("Step %i: IRQ is %i, should be %i\n", steps, irq_state[0], irq_state[1]);
+
+        if (!(rnd() % 40))
+            random_op();
+    }
+
+    check_regs();
+    if (irq_changes[0] != irq_changes[1])
+        fatal("IRQ changed %i times, should be %i\n", irq_changes[0], irq_changes[1]);
+
+    printf("Seed %u: %i steps, %i IRQ changes, identical\n", seed, steps, irq_changes[1]);
+
+    timer_disable(&dev->samp_timer);
+    timer_disable(&dev->timer_1);
+    timer_disable(&dev->timer_2);
+    timer_disable(&ref->samp_timer);
+    timer_disable(&ref->timer_1);
+    timer_disable(&ref->timer_2);
+    timer_disable(&ref_samp_timer);
+    timer_disable(&sound_timer);
+    gus_close(dev);
+    gus_close(ref);
+}
+
+int
+main(int argc, char **argv)
+{
+    int seeds = (argc > 1) ? atoi(argv[1]) : 20;
+
+    TIMER_USEC = (uint64_t) 100 << 32;
+    timer_init();
+
+    for (int seed = 1; seed <= seeds; seed++)
+        run(seed);
+
+    return 0;
+}
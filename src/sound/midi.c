@@ -18,17 +18,73 @@
  *           Copyright 2016-2020 Bit.
  *           Copyright 2008-2020 DOSBox Team.
  */
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
+#define HAVE_STDARG_H
 
 #include <86box/86box.h>
 #include <86box/device.h>
 #include <86box/midi.h>
 #include <86box/plat.h>
 
+/* Size of the event ring and of the SysEx data ring of a MIDI queue. */
+#define MIDI_QUEUE_LEN       4096
+#define MIDI_QUEUE_SYSEX_LEN (SYSEX_SIZE * 4)
+/* Event slots only messages that silence notes may use, so that a burst
+   that fills the queue cannot leave notes hanging. */
+#define MIDI_QUEUE_RESERVE   256
+
+typedef struct midi_event_t {
+    uint64_t time;      /* Value of the queue clock when the event was sent. */
+    uint32_t sysex_pos; /* Start of the SysEx data in the data ring. */
+    uint32_t len;       /* SysEx length, 0 for a short message. */
+    uint8_t  msg[4];
+} midi_event_t;
+
+struct midi_queue_t {
+    midi_event_t events[MIDI_QUEUE_LEN];
+    uint8_t      sysex[MIDI_QUEUE_SYSEX_LEN];
+
+    uint64_t now;        /* Only used by the emulation thread. */
+    uint32_t sysex_head; /* Only used by the emulation thread. */
+
+    /* Messages that silence notes and found even the reserved slots taken,
+       held as one bit per note and per channel mode controller until the
+       synth makes room. Only used by the emulation thread. */
+    uint8_t pending;
+    uint8_t pending_notes[16][16];
+    uint8_t pending_cc[16];
+    uint8_t pending_cc_val[16][8];
+
+    atomic_uint_fast64_t time;       /* Published queue clock. */
+    atomic_uint          head;       /* Only written by the emulation thread. */
+    atomic_uint          tail;       /* Only written by the synth thread. */
+    atomic_uint          sysex_tail; /* Only written by the synth thread. */
+};
+
+#ifdef ENABLE_MIDI_LOG
+int midi_do_log = ENABLE_MIDI_LOG;
+
+static void
+midi_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (midi_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define midi_log(fmt, ...)
+#endif
+
 int        midi_output_device_current = 0;
 static int midi_output_device_last    = 0;
 int        midi_input_device_current  = 0;
@@ -200,24 +256,250 @@ midi_in_close(void)
     }
 }
 
+midi_queue_t *
+midi_queue_init(void)
+{
+    midi_queue_t *q = (midi_queue_t *) calloc(1, sizeof(midi_queue_t));
+
+    atomic_init(&q->time, 0);
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->sysex_tail, 0);
+
+    return q;
+}
+
+void
+midi_queue_close(midi_queue_t *q)
+{
+    free(q);
+}
+
+/* Queues a short message if there is a free slot, reserved or not. */
+static int
+midi_queue_put_msg(midi_queue_t *q, const uint8_t *msg)
+{
+    uint32_t      head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    midi_event_t *ev;
+
+    if ((head - atomic_load_explicit(&q->tail, memory_order_acquire)) >= MIDI_QUEUE_LEN)
+        return 0;
+
+    ev = &q->events[head & (MIDI_QUEUE_LEN - 1)];
+    memcpy(ev->msg, msg, 4);
+    ev->len  = 0;
+    ev->time = q->now;
+
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+
+    return 1;
+}
+
+/* Queues as many of the held back messages that silence notes as fit. */
+static void
+midi_queue_flush_pending(midi_queue_t *q)
+{
+    uint8_t msg[4] = { 0 };
+
+    if ((atomic_load_explicit(&q->head, memory_order_relaxed) - atomic_load_explicit(&q->tail, memory_order_acquire)) >= MIDI_QUEUE_LEN)
+        return;
+
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        for (uint8_t c = 0; c < 8; c++) {
+            if (q->pending_cc[ch] & (1 << c)) {
+                msg[0] = 0xb0 | ch;
+                msg[1] = 0x78 + c;
+                msg[2] = q->pending_cc_val[ch][c];
+                if (!midi_queue_put_msg(q, msg))
+                    return;
+                q->pending_cc[ch] &= ~(1 << c);
+            }
+        }
+
+        for (uint8_t n = 0; n < 128; n++) {
+            if (q->pending_notes[ch][n >> 3] & (1 << (n & 7))) {
+                msg[0] = 0x80 | ch;
+                msg[1] = n;
+                msg[2] = 0x40;
+                if (!midi_queue_put_msg(q, msg))
+                    return;
+                q->pending_notes[ch][n >> 3] &= ~(1 << (n & 7));
+            }
+        }
+    }
+
+    q->pending = 0;
+}
+
+/* Advances the queue clock by one sound sample, called from midi_poll(). */
+static void
+midi_queue_tick(midi_queue_t *q)
+{
+    atomic_store_explicit(&q->time, ++q->now, memory_order_release);
+
+    if (q->pending)
+        midi_queue_flush_pending(q);
+}
+
+uint64_t
+midi_queue_get_time(midi_queue_t *q)
+{
+    return atomic_load_explicit(&q->time, memory_order_acquire);
+}
+
+/* Returns whether a short message silences notes: Note Off, Note On with
+   zero velocity, or a channel mode message such as All Notes Off. */
+static int
+midi_msg_is_note_off(const uint8_t *msg)
+{
+    switch (msg[0] & 0xf0) {
+        case 0x80:
+            return 1;
+        case 0x90:
+            return msg[2] == 0x00;
+        case 0xb0:
+            return msg[1] >= 0x78;
+        default:
+            return 0;
+    }
+}
+
+/* Timestamps a message or SysEx and hands it to the synth thread. The
+   emulation thread never waits for the synth; if the synth has fallen so far
+   behind that the queue is nearly full, the event is dropped. Messages that
+   silence notes may use the last MIDI_QUEUE_RESERVE slots, and if even those
+   are taken they are held back and queued as soon as there is room, so a
+   note is never left hanging. */
+static void
+midi_queue_push(midi_queue_t *q, uint8_t *msg, uint8_t *sysex, unsigned int len)
+{
+    uint32_t      head     = atomic_load_explicit(&q->head, memory_order_relaxed);
+    int           note_off = !sysex && midi_msg_is_note_off(msg);
+    uint32_t      limit    = note_off ? MIDI_QUEUE_LEN : (MIDI_QUEUE_LEN - MIDI_QUEUE_RESERVE);
+    uint8_t       ch;
+    midi_event_t *ev;
+    uint32_t      pos;
+
+    /* An empty SysEx would be taken for a short message by the synth thread. */
+    if (sysex && ((len == 0) || (len > SYSEX_SIZE))) {
+        midi_log("MIDI: Ignoring SysEx of %u bytes\n", len);
+        return;
+    }
+
+    /* Held back messages go first, nothing may overtake them. */
+    if (q->pending) {
+        midi_queue_flush_pending(q);
+        head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    }
+
+    if (q->pending || ((head - atomic_load_explicit(&q->tail, memory_order_acquire)) >= limit)) {
+        if (note_off) {
+            ch = msg[0] & 0x0f;
+            if ((msg[0] & 0xf0) == 0xb0) {
+                q->pending_cc[ch] |= 1 << (msg[1] - 0x78);
+                q->pending_cc_val[ch][msg[1] - 0x78] = msg[2];
+            } else
+                q->pending_notes[ch][(msg[1] & 0x7f) >> 3] |= 1 << (msg[1] & 7);
+            q->pending = 1;
+            midi_log("MIDI: Event queue full, holding back note off\n");
+        } else
+            midi_log("MIDI: Event queue full, dropping event\n");
+        return;
+    }
+
+    ev = &q->events[head & (MIDI_QUEUE_LEN - 1)];
+
+    if (sysex) {
+        /* Keep the data contiguous so it can be played straight from the ring. */
+        pos = q->sysex_head;
+        if (((pos & (MIDI_QUEUE_SYSEX_LEN - 1)) + len) > MIDI_QUEUE_SYSEX_LEN)
+            pos += MIDI_QUEUE_SYSEX_LEN - (pos & (MIDI_QUEUE_SYSEX_LEN - 1));
+        if ((pos + len - atomic_load_explicit(&q->sysex_tail, memory_order_acquire)) > MIDI_QUEUE_SYSEX_LEN) {
+            midi_log("MIDI: SysEx queue full, dropping %u bytes\n", len);
+            return;
+        }
+
+        memcpy(&q->sysex[pos & (MIDI_QUEUE_SYSEX_LEN - 1)], sysex, len);
+        q->sysex_head = pos + len;
+
+        ev->sysex_pos = pos;
+        ev->len       = len;
+    } else {
+        memcpy(ev->msg, msg, 4);
+        ev->len = 0;
+    }
+    ev->time = q->now;
+
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
+
+/* Renders one block of a synth that is fed through a queue, called from the
+   synth thread. The block covers queue clock ticks [start, start + ticks) and
+   is samples long at the synth's own rate. Each queued event in that range is
+   played at its position within the block, render() being called for the
+   samples in between. */
+void
+midi_queue_render(midi_device_t *dev, uint64_t start, uint32_t ticks, int samples, void (*render)(int pos, int len))
+{
+    midi_queue_t *q    = dev->queue;
+    uint32_t      tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    int           pos  = 0;
+    int           ev_pos;
+
+    while (tail != atomic_load_explicit(&q->head, memory_order_acquire)) {
+        midi_event_t *ev = &q->events[tail & (MIDI_QUEUE_LEN - 1)];
+
+        if (ev->time >= (start + ticks))
+            break;
+
+        if (ev->time > start) {
+            ev_pos = (int) (((ev->time - start) * samples) / ticks);
+            if (ev_pos > pos) {
+                render(pos, ev_pos - pos);
+                pos = ev_pos;
+            }
+        }
+
+        if (ev->len) {
+            if (dev->play_sysex)
+                dev->play_sysex(&q->sysex[ev->sysex_pos & (MIDI_QUEUE_SYSEX_LEN - 1)], ev->len);
+            atomic_store_explicit(&q->sysex_tail, ev->sysex_pos + ev->len, memory_order_release);
+        } else if (dev->play_msg)
+            dev->play_msg(ev->msg);
+
+        atomic_store_explicit(&q->tail, ++tail, memory_order_release);
+    }
+
+    if (pos < samples)
+        render(pos, samples - pos);
+}
+
 void
 midi_poll(void)
 {
-    if (midi_out && midi_out->m_out_device && midi_out->m_out_device->poll)
-        midi_out->m_out_device->poll();
+    if (midi_out && midi_out->m_out_device) {
+        if (midi_out->m_out_device->queue)
+            midi_queue_tick(midi_out->m_out_device->queue);
+        if (midi_out->m_out_device->poll)
+            midi_out->m_out_device->poll();
+    }
 }
 
 void
 play_msg(uint8_t *msg)
 {
-    if (midi_out->m_out_device->play_msg)
+    if (midi_out->m_out_device->queue)
+        midi_queue_push(midi_out->m_out_device->queue, msg, NULL, 0);
+    else if (midi_out->m_out_device->play_msg)
         midi_out->m_out_device->play_msg(msg);
 }
 
 void
 play_sysex(uint8_t *sysex, unsigned int len)
 {
-    if (midi_out->m_out_device->play_sysex)
+    if (midi_out->m_out_device->queue)
+        midi_queue_push(midi_out->m_out_device->queue, NULL, sysex, len);
+    else if (midi_out->m_out_device->play_sysex)
         midi_out->m_out_device->play_sysex(sysex, len);
 }
 
@@ -35,12 +35,15 @@ typedef struct fluidsynth {
     int               samplerate;
     int               sound_font;
 
-    thread_t *thread_h;
-    event_t  *event, *start_event;
-    int       buf_size;
-    float    *buffer;
-    int16_t  *buffer_int16;
-    int       midi_pos;
+    thread_t      *thread_h;
+    event_t       *event, *start_event;
+    int            buf_size;
+    float         *buffer;
+    int16_t       *buffer_int16;
+    void          *block;
+    int            midi_pos;
+    uint64_t       time;
+    midi_device_t *dev;
 
     int on;
 } fluidsynth_t;
@@ -64,12 +67,27 @@ fluidsynth_poll(void)
     }
 }
 
+static void
+fluidsynth_render(int pos, int len)
+{
+    fluidsynth_t *data = &fsdev;
+
+    if (!data->synth)
+        return;
+
+    if (sound_is_float)
+        fluid_synth_write_float(data->synth, len, data->block, pos * 2, 2, data->block, pos * 2 + 1, 2);
+    else
+        fluid_synth_write_s16(data->synth, len, data->block, pos * 2, 2, data->block, pos * 2 + 1, 2);
+}
+
 static void
 fluidsynth_thread(void *param)
 {
     fluidsynth_t *data     = (fluidsynth_t *) param;
     int           buf_pos  = 0;
     int           buf_size = data->buf_size / BUFFER_SEGMENTS;
+    uint8_t      *buffer   = sound_is_float ? (uint8_t *) data->buffer : (uint8_t *) data->buffer_int16;
 
     thread_set_event(data->start_event);
 
@@ -77,24 +95,20 @@ fluidsynth_thread(void *param)
         thread_wait_event(data->event, -1);
         thread_reset_event(data->event);
 
-        if (sound_is_float) {
-            float *buf = (float *) ((uint8_t *) data->buffer + buf_pos);
-            memset(buf, 0, buf_size);
-            if (data->synth)
-                fluid_synth_write_float(data->synth, buf_size / (2 * sizeof(float)), buf, 0, 2, buf, 1, 2);
-            buf_pos += buf_size;
-            if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->buffer, data->buf_size / sizeof(float));
-                buf_pos = 0;
-            }
-        } else {
-            int16_t *buf = (int16_t *) ((uint8_t *) data->buffer_int16 + buf_pos);
-            memset(buf, 0, buf_size);
-            if (data->synth)
-                fluid_synth_write_s16(data->synth, buf_size / (2 * sizeof(int16_t)), buf, 0, 2, buf, 1, 2);
+        /* Render every block the emulation has completed, so a late wake-up
+           catches up instead of dropping audio. */
+        while (data->on && ((midi_queue_get_time(data->dev->queue) - data->time) >= (SOUND_FREQ / RENDER_RATE))) {
+            data->block = buffer + buf_pos;
+            memset(data->block, 0, buf_size);
+            midi_queue_render(data->dev, data->time, SOUND_FREQ / RENDER_RATE, data->samplerate / RENDER_RATE, fluidsynth_render);
+            data->time += SOUND_FREQ / RENDER_RATE;
+
             buf_pos += buf_size;
             if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->buffer_int16, data->buf_size / sizeof(int16_t));
+                if (sound_is_float)
+                    givealbuffer_midi(data->buffer, data->buf_size / sizeof(float));
+                else
+                    givealbuffer_midi(data->buffer_int16, data->buf_size / sizeof(int16_t));
                 buf_pos = 0;
             }
         }
@@ -268,10 +282,13 @@ fluidsynth_init(UNUSED(const device_t *info))
     dev->play_msg   = fluidsynth_msg;
     dev->play_sysex = fluidsynth_sysex;
     dev->poll       = fluidsynth_poll;
+    dev->queue      = midi_queue_init();
 
     midi_out_init(dev);
 
-    data->on = 1;
+    data->dev  = dev;
+    data->time = 0;
+    data->on   = 1;
 
     data->start_event = thread_create_event();
 
@@ -296,6 +313,9 @@ fluidsynth_close(void *priv)
     thread_set_event(data->event);
     thread_wait(data->thread_h);
 
+    midi_queue_close(data->dev->queue);
+    data->dev->queue = NULL;
+
     if (data->synth) {
         delete_fluid_synth(data->synth);
         data->synth = NULL;
@@ -158,11 +158,14 @@ static int       mt32_on     = 0;
 #define RENDER_RATE     100
 #define BUFFER_SEGMENTS 10
 
-static uint32_t samplerate   = 44100;
-static int      buf_size     = 0;
-static float   *buffer       = NULL;
-static int16_t *buffer_int16 = NULL;
-static int      midi_pos     = 0;
+static uint32_t       samplerate   = 44100;
+static int            buf_size     = 0;
+static float         *buffer       = NULL;
+static int16_t       *buffer_int16 = NULL;
+static void          *block        = NULL;
+static int            midi_pos     = 0;
+static uint64_t       midi_time    = 0;
+static midi_device_t *mt32_dev     = NULL;
 
 static mt32emu_report_handler_version
 get_mt32_report_handler_version(UNUSED(mt32emu_report_handler_i i))
@@ -208,13 +211,21 @@ mt32_poll(void)
     }
 }
 
+static void
+mt32_render(int pos, int len)
+{
+    if (sound_is_float)
+        mt32_stream((float *) block + pos * 2, len);
+    else
+        mt32_stream_int16((int16_t *) block + pos * 2, len);
+}
+
 static void
 mt32_thread(UNUSED(void *param))
 {
     int      buf_pos = 0;
     int      bsize   = buf_size / BUFFER_SEGMENTS;
-    float   *buf;
-    int16_t *buf16;
+    uint8_t *buf     = sound_is_float ? (uint8_t *) buffer : (uint8_t *) buffer_int16;
 
     thread_set_event(start_event);
 
@@ -222,22 +233,20 @@ mt32_thread(UNUSED(void *param))
         thread_wait_event(event, -1);
         thread_reset_event(event);
 
-        if (sound_is_float) {
-            buf = (float *) ((uint8_t *) buffer + buf_pos);
-            memset(buf, 0, bsize);
-            mt32_stream(buf, bsize / (2 * sizeof(float)));
-            buf_pos += bsize;
-            if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer, buf_size / sizeof(float));
-                buf_pos = 0;
-            }
-        } else {
-            buf16 = (int16_t *) ((uint8_t *) buffer_int16 + buf_pos);
-            memset(buf16, 0, bsize);
-            mt32_stream_int16(buf16, bsize / (2 * sizeof(int16_t)));
+        /* Render every block the emulation has completed, so a late wake-up
+           catches up instead of dropping audio. */
+        while (mt32_on && ((midi_queue_get_time(mt32_dev->queue) - midi_time) >= (SOUND_FREQ / RENDER_RATE))) {
+            block = buf + buf_pos;
+            memset(block, 0, bsize);
+            midi_queue_render(mt32_dev, midi_time, SOUND_FREQ / RENDER_RATE, samplerate / RENDER_RATE, mt32_render);
+            midi_time += SOUND_FREQ / RENDER_RATE;
+
             buf_pos += bsize;
             if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer_int16, buf_size / sizeof(int16_t));
+                if (sound_is_float)
+                    givealbuffer_midi(buffer, buf_size / sizeof(float));
+                else
+                    givealbuffer_midi(buffer_int16, buf_size / sizeof(int16_t));
                 buf_pos = 0;
             }
         }
@@ -304,10 +313,14 @@ mt32emu_init(char *control_rom, char *pcm_rom)
     dev->play_msg   = mt32_msg;
     dev->play_sysex = mt32_sysex;
     dev->poll       = mt32_poll;
+    dev->queue      = midi_queue_init();
 
     midi_out_init(dev);
 
-    mt32_on = 1;
+    mt32_dev  = dev;
+    midi_pos  = 0;
+    midi_time = 0;
+    mt32_on   = 1;
 
     start_event = thread_create_event();
 
@@ -354,6 +367,10 @@ mt32_close(void *priv)
     thread_set_event(event);
     thread_wait(thread_h);
 
+    midi_queue_close(mt32_dev->queue);
+    mt32_dev->queue = NULL;
+    mt32_dev        = NULL;
+
     event       = NULL;
     start_event = NULL;
     thread_h    = NULL;
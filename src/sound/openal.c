@@ -43,6 +43,11 @@ ALuint        buffers_wt[4];    /* front and back buffers */
 ALuint        buffers_cd[4];    /* front and back buffers */
 ALuint        buffers_midi[4];  /* front and back buffers */
 static ALuint source[5];        /* audio source */
+static ALuint out_source;       /* buffered output stage */
+static ALuint out_buffers[8];
+static ALuint out_free[8];
+static int    out_nfree;
+static int    out_freq;
 
 static int         midi_freq     = 44100;
 static int         midi_buf_size = 4410;
@@ -96,6 +101,8 @@ closeal(void)
     if (!initialized)
         return;
 
+    sound_out_close();
+
     alSourceStopv(sources, source);
     alDeleteSources(sources, source);
 
@@ -267,7 +274,7 @@ givealbuffer_common(const void *buf, const uint8_t src, const int size, const in
     int    state;
     ALuint buffer;
 
-    if (!initialized)
+    if (!initialized || sound_out_give(src, buf, size, freq))
         return;
 
     alGetSourcei(source[src], AL_SOURCE_STATE, &state);
@@ -321,3 +328,75 @@ givealbuffer_midi(const void *buf, const uint32_t size)
 {
     givealbuffer_common(buf, 4, (int) size, midi_freq);
 }
+
+int
+al_out_open(const int freq)
+{
+    if (!initialized)
+        return 1;
+
+    alGenSources(1, &out_source);
+    alSource3f(out_source, AL_POSITION, 0.0f, 0.0f, 0.0f);
+    alSource3f(out_source, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+    alSource3f(out_source, AL_DIRECTION, 0.0f, 0.0f, 0.0f);
+    alSourcef(out_source, AL_ROLLOFF_FACTOR, 0.0f);
+    alSourcei(out_source, AL_SOURCE_RELATIVE, AL_TRUE);
+
+    alGenBuffers(8, out_buffers);
+    memcpy(out_free, out_buffers, sizeof(out_buffers));
+    out_nfree = 8;
+    out_freq  = freq;
+
+    /* The output stage applies the gain itself. */
+    alListenerf(AL_GAIN, 1.0f);
+
+    return 0;
+}
+
+void
+al_out_close(void)
+{
+    alSourceStop(out_source);
+    alDeleteSources(1, &out_source);
+    alDeleteBuffers(8, out_buffers);
+}
+
+int
+al_out_queued(void)
+{
+    ALint queued;
+    ALint processed;
+
+    alGetSourcei(out_source, AL_BUFFERS_QUEUED, &queued);
+    alGetSourcei(out_source, AL_BUFFERS_PROCESSED, &processed);
+
+    /* The output stage always writes whole periods. */
+    return (queued - processed) * SOUND_OUT_PERIOD;
+}
+
+void
+al_out_write(const float *buf, const int frames)
+{
+    ALint  processed;
+    ALint  state;
+    ALuint buffer;
+
+    /* Take back what has played first, so that restarting a starved source
+       does not play it again. */
+    alGetSourcei(out_source, AL_BUFFERS_PROCESSED, &processed);
+    while ((processed-- > 0) && (out_nfree < 8)) {
+        alSourceUnqueueBuffers(out_source, 1, &buffer);
+        out_free[out_nfree++] = buffer;
+    }
+
+    if (out_nfree == 0)
+        return;
+
+    buffer = out_free[--out_nfree];
+    alBufferData(buffer, AL_FORMAT_STEREO_FLOAT32, buf, frames * 2 * (int) sizeof(float), out_freq);
+    alSourceQueueBuffers(out_source, 1, &buffer);
+
+    alGetSourcei(out_source, AL_SOURCE_STATE, &state);
+    if (state != AL_PLAYING)
+        alSourcePlay(out_source);
+}
@@ -462,6 +462,10 @@ void SID::setSamplingParameters(double clockFrequency, SamplingMethod method, do
         resampler.reset(TwoPassSincResampler::create(clockFrequency, samplingFrequency, highestAccurateFrequency));
         break;
 
+    case RESAMPLE_FAST:
+        resampler.reset(TwoPassPolyphaseResampler::create(clockFrequency, samplingFrequency, highestAccurateFrequency));
+        break;
+
     default:
         throw SIDError("Unknown sampling method");
     }
@@ -0,0 +1,259 @@
+/*
+ * This file is part of libsidplayfp, a SID player engine.
+ *
+ * Copyright 2011-2020 Leandro Nini <drfiemost@users.sourceforge.net>
+ * Copyright 2007-2010 Antti Lankila
+ * Copyright 2004 Dag Lem <resid@nimrod.no>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "PolyphaseResampler.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+#include "../siddefs-fp.h"
+
+namespace reSIDfp
+{
+
+// Shared with SincResampler.
+double I0(double x);
+int convolve(const short* a, const short* b, int bLength);
+
+typedef std::map<std::string, matrix_t> polyphase_cache_t;
+
+/// Cache for the FIR tables built or loaded during this run.
+polyphase_cache_t POLYPHASE_CACHE;
+
+/// Directory of the on-disk FIR table cache, empty when disabled.
+std::string POLYPHASE_CACHE_DIR;
+
+/// 12 bits -> -72dB stopband attenuation.
+const int POLYPHASE_BITS = 12;
+
+/// Identifies a cache file, bump the version when the table layout changes.
+const char POLYPHASE_MAGIC[8] = { 'R', 'F', 'P', 'F', 'I', 'R', '0', '1' };
+
+struct polyphase_header_t
+{
+    char magic[8];
+    int bits;
+    int firN;
+    int firRES;
+    int byteOrder;
+    double cyclesPerSample;
+};
+
+static void fillHeader(polyphase_header_t& hdr, int firN, int firRES, double cyclesPerSample)
+{
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, POLYPHASE_MAGIC, sizeof(hdr.magic));
+    hdr.bits = POLYPHASE_BITS;
+    hdr.firN = firN;
+    hdr.firRES = firRES;
+    hdr.byteOrder = 0x01020304;
+    hdr.cyclesPerSample = cyclesPerSample;
+}
+
+/**
+ * Load a FIR table from the disk cache.
+ *
+ * @return true if the file exists and matches the requested table
+ */
+static bool loadTable(const std::string& file, matrix_t& table, int firN, int firRES, double cyclesPerSample)
+{
+    FILE* fp = fopen(file.c_str(), "rb");
+
+    if (fp == nullptr)
+        return false;
+
+    polyphase_header_t want;
+    polyphase_header_t hdr;
+    fillHeader(want, firN, firRES, cyclesPerSample);
+
+    const bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1
+        && memcmp(&hdr, &want, sizeof(hdr)) == 0
+        && fread(table[0], sizeof(short), table.length(), fp) == table.length();
+
+    fclose(fp);
+
+    return ok;
+}
+
+static void saveTable(const std::string& file, const matrix_t& table, int firN, int firRES, double cyclesPerSample)
+{
+    FILE* fp = fopen(file.c_str(), "wb");
+
+    if (fp == nullptr)
+        return;
+
+    polyphase_header_t hdr;
+    fillHeader(hdr, firN, firRES, cyclesPerSample);
+
+    const bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+        && fwrite(table[0], sizeof(short), table.length(), fp) == table.length();
+
+    // Never leave a truncated table behind.
+    if (fclose(fp) != 0 || !ok)
+        remove(file.c_str());
+}
+
+void PolyphaseResampler::setCacheDirectory(const std::string& path)
+{
+    POLYPHASE_CACHE_DIR = path;
+}
+
+int PolyphaseResampler::fir(int subcycle)
+{
+    // Pick the fir table closest to the phase
+    int phase = (subcycle * firRES + 512) >> 10;
+
+    // Find firN most recent samples.
+    int sampleStart = sampleIndex - firN + RINGSIZE - 1;
+
+    // Rounding up past the last fir table wraps around to the first fir
+    // table using the next sample.
+    if (unlikely(phase == firRES))
+    {
+        phase = 0;
+        ++sampleStart;
+    }
+
+    return convolve(sample + sampleStart, (*firTable)[phase], firN);
+}
+
+PolyphaseResampler::PolyphaseResampler(double clockFrequency, double samplingFrequency, double highestAccurateFrequency) :
+    sampleIndex(0),
+    cyclesPerSample(static_cast<int>(clockFrequency / samplingFrequency * 1024.)),
+    sampleOffset(0),
+    outputValue(0)
+{
+    const double A = -20. * log10(1.0 / (1 << POLYPHASE_BITS));
+    const double dw = (1. - 2.*highestAccurateFrequency / samplingFrequency) * M_PI * 2.;
+
+    const double beta = 0.1102 * (A - 8.7);
+    const double I0beta = I0(beta);
+    const double cyclesPerSampleD = clockFrequency / samplingFrequency;
+
+    {
+        // Same Kaiser design as SincResampler, at the lower attenuation
+        // the filter is about a third shorter.
+        int N = static_cast<int>((A - 7.95) / (2.285 * dw) + 0.5);
+        N += N & 1;
+
+        firN = static_cast<int>(N * cyclesPerSampleD) + 1;
+        firN |= 1;
+
+        // Check whether the sample ring buffer would overflow.
+        assert(firN < RINGSIZE);
+
+        // Without interpolating between tables the error is bounded by
+        // err < 1 / L instead of 1 / L^2, so L = 2^BITS. The phase only has
+        // a resolution of 1/1024 cycle, more tables than that are never used.
+        firRES = static_cast<int>(ceil((1 << POLYPHASE_BITS) / cyclesPerSampleD));
+        if (firRES > 1024)
+            firRES = 1024;
+    }
+
+    std::ostringstream o;
+    o << firN << "," << firRES << "," << cyclesPerSampleD;
+    const std::string firKey = o.str();
+    polyphase_cache_t::iterator lb = POLYPHASE_CACHE.lower_bound(firKey);
+
+    if (lb != POLYPHASE_CACHE.end() && !(POLYPHASE_CACHE.key_comp()(firKey, lb->first)))
+    {
+        firTable = &(lb->second);
+        return;
+    }
+
+    matrix_t tempTable(firRES, firN);
+    firTable = &(POLYPHASE_CACHE.emplace_hint(lb, polyphase_cache_t::value_type(firKey, tempTable))->second);
+
+    std::string file;
+
+    if (!POLYPHASE_CACHE_DIR.empty())
+    {
+        std::ostringstream f;
+        f << POLYPHASE_CACHE_DIR << "residfp_fir_" << firN << "_" << firRES << "_"
+          << static_cast<long long>(cyclesPerSampleD * 1000000. + 0.5) << ".bin";
+        file = f.str();
+
+        if (loadTable(file, *firTable, firN, firRES, cyclesPerSampleD))
+            return;
+    }
+
+    // The cutoff frequency is midway through the transition band, in effect the same as nyquist.
+    const double wc = M_PI;
+
+    // Calculate the sinc tables.
+    const double scale = 32768.0 * wc / cyclesPerSampleD / M_PI;
+
+    const int tmp = firN / 2;
+    const double firN_2 = static_cast<double>(tmp);
+
+    for (int i = 0; i < firRES; i++)
+    {
+        const double jPhase = (double) i / firRES + firN_2;
+
+        for (int j = 0; j < firN; j++)
+        {
+            const double x = j - jPhase;
+
+            const double xt = x / firN_2;
+            const double kaiserXt = fabs(xt) < 1. ? I0(beta * sqrt(1. - xt * xt)) / I0beta : 0.;
+
+            const double wt = wc * x / cyclesPerSampleD;
+            const double sincWt = fabs(wt) >= 1e-8 ? sin(wt) / wt : 1.;
+
+            (*firTable)[i][j] = static_cast<short>(scale * sincWt * kaiserXt);
+        }
+    }
+
+    if (!file.empty())
+        saveTable(file, *firTable, firN, firRES, cyclesPerSampleD);
+}
+
+bool PolyphaseResampler::input(int input)
+{
+    bool ready = false;
+
+    sample[sampleIndex] = sample[sampleIndex + RINGSIZE] = softClip(input);
+    sampleIndex = (sampleIndex + 1) & (RINGSIZE - 1);
+
+    if (sampleOffset < 1024)
+    {
+        outputValue = fir(sampleOffset);
+        ready = true;
+        sampleOffset += cyclesPerSample;
+    }
+
+    sampleOffset -= 1024;
+
+    return ready;
+}
+
+void PolyphaseResampler::reset()
+{
+    memset(sample, 0, sizeof(sample));
+    sampleOffset = 0;
+}
+
+} // namespace reSIDfp
@@ -0,0 +1,107 @@
+/*
+ * This file is part of libsidplayfp, a SID player engine.
+ *
+ * Copyright 2011-2013 Leandro Nini <drfiemost@users.sourceforge.net>
+ * Copyright 2007-2010 Antti Lankila
+ * Copyright 2004 Dag Lem <resid@nimrod.no>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef POLYPHASERESAMPLER_H
+#define POLYPHASERESAMPLER_H
+
+#include "Resampler.h"
+
+#include <string>
+
+#include "../array.h"
+
+#include "../sidcxx11.h"
+
+namespace reSIDfp
+{
+
+/**
+ * Cheaper variant of SincResampler, used for the stages of TwoPassPolyphaseResampler.
+ *
+ * Each output sample is a single convolution with the nearest of a bank of
+ * polyphase FIR tables, instead of two convolutions blended by linear
+ * interpolation. The stopband is relaxed to ~72 dB, which is still below the
+ * resolution of the SID DAC, and the number of phases is raised to keep the
+ * phase error at the same level.
+ *
+ * The tables only depend on the clock and sampling frequencies, so they are
+ * built once and shared. When a cache directory has been set they are also
+ * stored there and loaded back on the next run, skipping the Kaiser window
+ * evaluation entirely.
+ */
+class PolyphaseResampler final : public Resampler
+{
+private:
+    /// Size of the ring buffer, must be a power of 2
+    static const int RINGSIZE = 2048;
+
+private:
+    /// Table of the fir filter coefficients, firRES rows of firN taps
+    matrix_t* firTable;
+
+    int sampleIndex;
+
+    /// Number of filter phases
+    int firRES;
+
+    /// Filter length
+    int firN;
+
+    const int cyclesPerSample;
+
+    int sampleOffset;
+
+    int outputValue;
+
+    short sample[RINGSIZE * 2];
+
+private:
+    int fir(int subcycle);
+
+public:
+    /**
+     * Set the directory the FIR tables are cached in.
+     * An empty path disables the on-disk cache.
+     *
+     * @param path directory, including the trailing separator
+     */
+    static void setCacheDirectory(const std::string& path);
+
+    /**
+     * The same constraints as for SincResampler apply.
+     *
+     * @param clockFrequency System clock frequency at Hz
+     * @param samplingFrequency Desired output sampling rate
+     * @param highestAccurateFrequency
+     */
+    PolyphaseResampler(double clockFrequency, double samplingFrequency, double highestAccurateFrequency);
+
+    bool input(int input) override;
+
+    int output() const override { return outputValue; }
+
+    void reset() override;
+};
+
+} // namespace reSIDfp
+
+#endif
@@ -28,6 +28,7 @@
 
 #include "Resampler.h"
 #include "SincResampler.h"
+#include "PolyphaseResampler.h"
 
 #include "../sidcxx11.h"
 
@@ -36,29 +37,31 @@ namespace reSIDfp
 
 /**
  * Compose a more efficient SINC from chaining two other SINCs.
+ * The stages are either exact SincResamplers or the cheaper PolyphaseResamplers.
  */
-class TwoPassSincResampler final : public Resampler
+template<class Stage>
+class TwoPassResampler final : public Resampler
 {
 private:
-    std::unique_ptr<SincResampler> const s1;
-    std::unique_ptr<SincResampler> const s2;
+    std::unique_ptr<Stage> const s1;
+    std::unique_ptr<Stage> const s2;
 
 private:
-    TwoPassSincResampler(double clockFrequency, double samplingFrequency, double highestAccurateFrequency, double intermediateFrequency) :
-        s1(new SincResampler(clockFrequency, intermediateFrequency, highestAccurateFrequency)),
-        s2(new SincResampler(intermediateFrequency, samplingFrequency, highestAccurateFrequency))
+    TwoPassResampler(double clockFrequency, double samplingFrequency, double highestAccurateFrequency, double intermediateFrequency) :
+        s1(new Stage(clockFrequency, intermediateFrequency, highestAccurateFrequency)),
+        s2(new Stage(intermediateFrequency, samplingFrequency, highestAccurateFrequency))
     {}
 
 public:
     // Named constructor
-    static TwoPassSincResampler* create(double clockFrequency, double samplingFrequency, double highestAccurateFrequency)
+    static TwoPassResampler* create(double clockFrequency, double samplingFrequency, double highestAccurateFrequency)
     {
         // Calculation according to Laurent Ganier. It evaluates to about 120 kHz at typical settings.
         // Some testing around the chosen value seems to confirm that this does work.
         double const intermediateFrequency = 2. * highestAccurateFrequency
             + sqrt(2. * highestAccurateFrequency * clockFrequency
                 * (samplingFrequency - 2. * highestAccurateFrequency) / samplingFrequency);
-        return new TwoPassSincResampler(clockFrequency, samplingFrequency, highestAccurateFrequency, intermediateFrequency);
+        return new TwoPassResampler(clockFrequency, samplingFrequency, highestAccurateFrequency, intermediateFrequency);
     }
 
     bool input(int sample) override
@@ -78,6 +81,9 @@ public:
     }
 };
 
+typedef TwoPassResampler<SincResampler> TwoPassSincResampler;
+typedef TwoPassResampler<PolyphaseResampler> TwoPassPolyphaseResampler;
+
 } // namespace reSIDfp
 
 #endif
@@ -0,0 +1,413 @@
+/*
+ * This file is part of libsidplayfp, a SID player engine.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Sampling method benchmark.
+ *
+ * Renders a SID register trace with every sampling method and reports the
+ * CPU cost, the difference against the two pass sinc output and the
+ * passband/stopband response of the resampler alone.
+ *
+ * Build from this directory with:
+ *   g++ -O2 -I.. -o bench bench.cpp SincResampler.cpp PolyphaseResampler.cpp ../[A-Z]*.cpp
+ *
+ * Usage: bench [seconds] [trace]
+ *
+ * A trace is a text file of "<cycles> <register> <value>" lines, each
+ * write happening the given number of SID cycles after the previous one.
+ * Numbers may be decimal or 0x prefixed hex, '#' starts a comment.
+ * Without a trace a built-in three voice tune with a filter sweep is used.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../sid.h"
+#include "../siddefs-fp.h"
+
+#include "Resampler.h"
+#include "PolyphaseResampler.h"
+#include "TwoPassSincResampler.h"
+#include "ZeroOrderResampler.h"
+
+namespace
+{
+
+/// SSI-2001 clock, as used by 86Box.
+const double CLOCK = 14318180.0 / 16.0;
+const double RATE = 48000.0;
+const double PASSBAND = 0.9 * RATE / 2.0;
+
+struct event_t
+{
+    unsigned int cycles;
+    int reg;
+    int value;
+};
+
+struct method_t
+{
+    const char* name;
+    reSIDfp::SamplingMethod method;
+};
+
+const method_t METHODS[] =
+{
+    { "interpolate", reSIDfp::DECIMATE },
+    { "resample",    reSIDfp::RESAMPLE },
+    { "fast",        reSIDfp::RESAMPLE_FAST },
+};
+
+const int NUM_METHODS = sizeof(METHODS) / sizeof(METHODS[0]);
+
+bool loadTrace(const char* file, std::vector<event_t>& trace)
+{
+    FILE* fp = fopen(file, "r");
+
+    if (fp == nullptr)
+        return false;
+
+    char line[256];
+
+    while (fgets(line, sizeof(line), fp) != nullptr)
+    {
+        char* p = line;
+        event_t ev;
+
+        if (char* c = strchr(line, '#'))
+            *c = 0;
+
+        ev.cycles = static_cast<unsigned int>(strtoul(p, &p, 0));
+        ev.reg = static_cast<int>(strtol(p, &p, 0));
+        char* end;
+        ev.value = static_cast<int>(strtol(p, &end, 0));
+
+        if (end != p)
+            trace.push_back(ev);
+    }
+
+    fclose(fp);
+
+    return !trace.empty();
+}
+
+/**
+ * Build one second of a 50 Hz player: an arpeggio on a pulse voice,
+ * a sawtooth bass and triangle lead, with a swept low pass filter.
+ */
+void builtinTrace(std::vector<event_t>& trace)
+{
+    const unsigned int frame = static_cast<unsigned int>(CLOCK / 50.);
+    const int arp[3] = { 0, 4, 7 };
+    const double base[3] = { 220., 55., 440. };
+    const int waves[3] = { 0x41, 0x21, 0x11 };
+
+    event_t init[] =
+    {
+        { 0, 0x02, 0x00 }, { 0, 0x03, 0x08 },                  // pulse width
+        { 0, 0x05, 0x09 }, { 0, 0x06, 0xa8 },                  // ADSR
+        { 0, 0x0c, 0x09 }, { 0, 0x0d, 0xa8 },
+        { 0, 0x13, 0x09 }, { 0, 0x14, 0xa8 },
+        { 0, 0x17, 0xf3 }, { 0, 0x18, 0x1f },                  // filter voices 1+2, LP
+    };
+    trace.insert(trace.end(), init, init + sizeof(init) / sizeof(init[0]));
+
+    for (int f = 0; f < 50; f++)
+    {
+        for (int v = 0; v < 3; v++)
+        {
+            const int semi = (v == 0) ? arp[f % 3] : ((f / 12) & 1) * 5;
+            const int freq = static_cast<int>(base[v] * pow(2., semi / 12.) * 16777216. / CLOCK);
+            const int gate = (f % 12) != 11;
+            event_t w[] =
+            {
+                { 0, v * 7 + 0, freq & 0xff },
+                { 0, v * 7 + 1, (freq >> 8) & 0xff },
+                { 0, v * 7 + 4, waves[v] & ~(gate ? 0 : 1) },
+            };
+            trace.insert(trace.end(), w, w + 3);
+        }
+
+        const int cutoff = 200 + (f * 40) % 1800;
+        event_t fc[] =
+        {
+            { 0, 0x15, cutoff & 7 },
+            { frame, 0x16, cutoff >> 3 },
+        };
+        trace.insert(trace.end(), fc, fc + 2);
+    }
+}
+
+/**
+ * Render the trace, repeated as needed, for the given number of seconds.
+ */
+double render(reSIDfp::SamplingMethod method, const std::vector<event_t>& trace, double seconds,
+    std::vector<short>& out, double& setupMs)
+{
+    reSIDfp::SID sid;
+    sid.setChipModel(reSIDfp::MOS6581);
+    sid.enableFilter(true);
+
+    clock_t start = clock();
+    sid.setSamplingParameters(CLOCK, method, RATE, PASSBAND);
+    setupMs = (clock() - start) * 1000. / CLOCKS_PER_SEC;
+
+    sid.reset();
+
+    const size_t samples = static_cast<size_t>(seconds * RATE);
+    const unsigned long long total = static_cast<unsigned long long>(seconds * CLOCK);
+    unsigned long long done = 0;
+    std::vector<short> buf(65536);
+    out.clear();
+    out.reserve(samples + 64);
+
+    start = clock();
+
+    for (size_t i = 0; done < total; i = (i + 1) % trace.size())
+    {
+        unsigned int cycles = trace[i].cycles;
+
+        while (cycles != 0 && done < total)
+        {
+            const unsigned int c = std::min(cycles, 100000u);
+            out.insert(out.end(), buf.begin(), buf.begin() + sid.clock(c, &buf[0]));
+            cycles -= c;
+            done += c;
+        }
+
+        sid.write(trace[i].reg, static_cast<unsigned char>(trace[i].value));
+    }
+
+    return (clock() - start) * 1000. / CLOCKS_PER_SEC;
+}
+
+/**
+ * Value of a at a fractional position, windowed sinc interpolated.
+ */
+double sampleAt(const std::vector<short>& a, double pos)
+{
+    const int TAPS = 16;
+    const int i0 = static_cast<int>(floor(pos));
+    double sum = 0.;
+
+    for (int i = i0 - TAPS + 1; i <= i0 + TAPS; i++)
+    {
+        const double x = pos - i;
+        const double w = 0.5 + 0.5 * cos(M_PI * x / TAPS);
+        const double sinc = fabs(x) < 1e-9 ? 1. : sin(M_PI * x) / (M_PI * x);
+
+        if (i >= 0 && i < static_cast<int>(a.size()))
+            sum += a[i] * sinc * w;
+    }
+
+    return sum;
+}
+
+/**
+ * Signal and error energy of a against the reference, with a delayed by lag samples.
+ */
+void compare(const std::vector<short>& ref, const std::vector<short>& a, double lag, size_t first, size_t last,
+    double& sig, double& err)
+{
+    sig = 0.;
+    err = 0.;
+
+    for (size_t i = first; i < last; i++)
+    {
+        const double r = ref[i];
+        const double d = r - sampleAt(a, i + lag);
+        sig += r * r;
+        err += d * d;
+    }
+}
+
+/**
+ * Signal to noise ratio of a against the reference. The methods have different
+ * group delays, so the best lag is searched for first, to a 1/32 sample.
+ */
+double snr(const std::vector<short>& ref, const std::vector<short>& a)
+{
+    const int maxLag = 64;
+    const size_t n = std::min(ref.size(), a.size());
+
+    if (n < 4 * maxLag)
+        return 0.;
+
+    const size_t first = maxLag * 2;
+    const size_t last = n - maxLag * 2;
+    const size_t probe = std::min(last, first + static_cast<size_t>(RATE / 4));
+    double bestLag = 0.;
+    double bestErr = -1.;
+    double sig;
+    double err;
+
+    for (int lag = -maxLag; lag <= maxLag; lag++)
+    {
+        err = 0.;
+
+        for (size_t i = first; i < probe; i++)
+        {
+            const double d = static_cast<double>(ref[i]) - a[i + lag];
+            err += d * d;
+        }
+
+        if (bestErr < 0. || err < bestErr)
+        {
+            bestErr = err;
+            bestLag = lag;
+        }
+    }
+
+    const double coarse = bestLag;
+    bestErr = -1.;
+
+    for (double lag = coarse - 1.; lag <= coarse + 1.; lag += 1. / 32.)
+    {
+        compare(ref, a, lag, first, probe, sig, err);
+
+        if (bestErr < 0. || err < bestErr)
+        {
+            bestErr = err;
+            bestLag = lag;
+        }
+    }
+
+    compare(ref, a, bestLag, first, last, sig, err);
+
+    return err > 0. ? 10. * log10(sig / err) : 999.;
+}
+
+reSIDfp::Resampler* makeResampler(reSIDfp::SamplingMethod method)
+{
+    switch (method)
+    {
+    case reSIDfp::RESAMPLE:
+        return reSIDfp::TwoPassSincResampler::create(CLOCK, RATE, PASSBAND);
+    case reSIDfp::RESAMPLE_FAST:
+        return reSIDfp::TwoPassPolyphaseResampler::create(CLOCK, RATE, PASSBAND);
+    default:
+        return new reSIDfp::ZeroOrderResampler(CLOCK, RATE);
+    }
+}
+
+/**
+ * Output level in dB of a full scale tone at the given frequency.
+ */
+double toneLevel(reSIDfp::Resampler& r, double freq)
+{
+    const double omega = 2. * M_PI * freq / CLOCK;
+    const double amp = 16384.;
+    int k = 0;
+
+    r.reset();
+
+    // Let the filter settle.
+    for (int j = 0; j < 4096; j++)
+        r.input(static_cast<int>(amp * sin(k++ * omega)));
+
+    double pwr = 0.;
+    int n = 0;
+
+    for (int j = 0; j < 40000; j++)
+    {
+        if (r.input(static_cast<int>(amp * sin(k++ * omega))))
+        {
+            const double out = r.getOutput();
+            pwr += out * out;
+            n++;
+        }
+    }
+
+    return 10. * log10((pwr / n + 1e-3) / (amp * amp / 2.));
+}
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+    const double seconds = argc > 1 ? atof(argv[1]) : 10.;
+    std::vector<event_t> trace;
+
+    if (argc > 2)
+    {
+        if (!loadTrace(argv[2], trace))
+        {
+            std::cerr << "Cannot read trace " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    else
+        builtinTrace(trace);
+
+    reSIDfp::PolyphaseResampler::setCacheDirectory("./");
+
+    std::vector<short> out[NUM_METHODS];
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Rendering " << seconds << " s at " << RATE << " Hz" << std::endl << std::endl;
+    std::cout << std::setw(12) << "method" << std::setw(10) << "setup ms" << std::setw(10) << "render ms"
+              << std::setw(12) << "x realtime" << std::setw(10) << "SNR dB" << std::setw(10) << "pass dB"
+              << std::setw(10) << "stop dB" << std::endl;
+
+    double setupMs[NUM_METHODS];
+    double renderMs[NUM_METHODS];
+
+    for (int m = 0; m < NUM_METHODS; m++)
+        renderMs[m] = render(METHODS[m].method, trace, seconds, out[m], setupMs[m]);
+
+    for (int m = 0; m < NUM_METHODS; m++)
+    {
+        std::unique_ptr<reSIDfp::Resampler> r(makeResampler(METHODS[m].method));
+        double passMin = 0.;
+        double stopMax = -999.;
+
+        for (double f = 100.; f < CLOCK / 2.; f *= 1.05)
+        {
+            const double level = toneLevel(*r, f);
+
+            if (f <= PASSBAND)
+                passMin = std::min(passMin, level);
+            else if (f >= RATE - PASSBAND)
+                stopMax = std::max(stopMax, level);
+        }
+
+        std::cout << std::setw(12) << METHODS[m].name << std::setw(10) << setupMs[m] << std::setw(10) << renderMs[m]
+                  << std::setw(12) << seconds * 1000. / renderMs[m] << std::setw(10);
+
+        // Resample is the reference the others are measured against.
+        if (m == 1)
+            std::cout << "ref";
+        else
+            std::cout << snr(out[1], out[m]);
+
+        std::cout << std::setw(10) << passMin << std::setw(10) << stopMax << std::endl;
+    }
+
+    std::cout << std::endl << "SNR is against resample after delay matching, pass is the lowest level up to "
+              << PASSBAND << " Hz, stop the highest level from " << RATE - PASSBAND << " Hz." << std::endl;
+
+    return 0;
+}
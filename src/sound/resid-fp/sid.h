@@ -231,6 +231,9 @@ public:
      * is limited to slightly below 20kHz.
      * This constraint ensures that the FIR table is not overfilled.
      *
+     * RESAMPLE_FAST trades some stopband attenuation for a single
+     * convolution per pass and output sample, see PolyphaseResampler.
+     *
      * @param clockFrequency System clock frequency at Hz
      * @param method sampling method to use
      * @param samplingFrequency Desired output sampling rate
@@ -32,6 +32,8 @@
 #include <86box/timer.h>
 #include <86box/plat_unused.h>
 
+#define AC97_VIA_BLOCK 32
+
 typedef struct ac97_via_sgd_t {
     uint8_t            id;
     uint8_t            always_run;
@@ -53,6 +55,11 @@ typedef struct ac97_via_sgd_t {
     int      pos;
     int32_t  buffer[SOUNDBUFLEN * 2];
     uint64_t timer_latch;
+    uint64_t dma_ahead;
+    uint64_t poll_ahead;
+    uint8_t  dma_on;
+    uint8_t  poll_on;
+    uint8_t  poll_first;
 
     pc_timer_t dma_timer;
     pc_timer_t poll_timer;
@@ -104,7 +111,8 @@ ac97_via_log(const char *fmt, ...)
 #    define ac97_via_log(fmt, ...)
 #endif
 
-static void ac97_via_sgd_process(void *priv);
+static int  ac97_via_sgd_transfer(ac97_via_sgd_t *sgd);
+static void ac97_via_sync(ac97_via_t *dev);
 static void ac97_via_update_codec(ac97_via_t *dev);
 static void ac97_via_speed_changed(void *priv);
 static void ac97_via_filter_cd_audio(int channel, double *buffer, void *priv);
@@ -137,6 +145,31 @@ ac97_via_read_status(void *priv, uint8_t modem)
     return ret;
 }
 
+/* Starts the DMA timer one slot from now and moves the first dword at once. */
+static void
+ac97_via_sgd_start(ac97_via_sgd_t *sgd)
+{
+    if (!ac97_via_sgd_transfer(sgd))
+        return;
+
+    timer_set_delay_u64(&sgd->dma_timer, (uint64_t) (10.0 * ((double) TIMER_USEC)));
+    sgd->dma_ahead  = 0;
+    sgd->dma_on     = 1;
+    sgd->poll_first = 0;
+}
+
+/* Picks the poller up one sample after the one it stopped on or was due to
+   run next, as advancing its timer did. */
+static void
+ac97_via_poll_start(ac97_via_sgd_t *sgd)
+{
+    sgd->poll_timer.ts.ts64 -= sgd->poll_ahead;
+    sgd->poll_ahead = 0;
+    timer_advance_u64(&sgd->poll_timer, sgd->timer_latch);
+    sgd->poll_on    = 1;
+    sgd->poll_first = 1;
+}
+
 void
 ac97_via_write_control(void *priv, uint8_t modem, uint8_t val)
 {
@@ -145,6 +178,8 @@ ac97_via_write_control(void *priv, uint8_t modem, uint8_t val)
 
     ac97_via_log("AC97 VIA %d: write_control(%02X)\n", modem, val);
 
+    ac97_via_sync(dev);
+
     /* Reset codecs if requested. */
     if (!(val & 0x40)) {
         for (i = 0; i <= 1; i++) {
@@ -160,19 +195,21 @@ ac97_via_write_control(void *priv, uint8_t modem, uint8_t val)
         /* Start or stop PCM playback. */
         i = (val & 0xf4) == 0xc4;
         if (i && !dev->pcm_enabled)
-            timer_advance_u64(&dev->sgd[0].poll_timer, dev->sgd[0].timer_latch);
+            ac97_via_poll_start(&dev->sgd[0]);
         dev->pcm_enabled = i;
 
         /* Start or stop FM playback. */
         i = (val & 0xf2) == 0xc2;
         if (i && !dev->fm_enabled)
-            timer_advance_u64(&dev->sgd[2].poll_timer, dev->sgd[2].timer_latch);
+            ac97_via_poll_start(&dev->sgd[2]);
         dev->fm_enabled = i;
 
         /* Update primary audio codec state. */
         if (dev->codec[0][0])
             ac97_via_update_codec(dev);
     }
+
+    ac97_via_sync(dev);
 }
 
 static void
@@ -210,13 +247,15 @@ ac97_via_update_codec(ac97_via_t *dev)
 uint8_t
 ac97_via_sgd_read(uint16_t addr, void *priv)
 {
-    const ac97_via_t *dev = (ac97_via_t *) priv;
+    ac97_via_t *dev = (ac97_via_t *) priv;
 #ifdef ENABLE_AC97_VIA_LOG
     uint8_t modem = (addr & 0xff00) == dev->modem_sgd_base;
 #endif
     addr &= 0xff;
     uint8_t ret;
 
+    ac97_via_sync(dev);
+
     if (!(addr & 0x80)) {
         /* Process SGD channel registers. */
         switch (addr & 0xf) {
@@ -302,10 +341,9 @@ ac97_via_sgd_read(uint16_t addr, void *priv)
     return ret;
 }
 
-void
-ac97_via_sgd_write(uint16_t addr, uint8_t val, void *priv)
+static void
+ac97_via_sgd_write_reg(ac97_via_t *dev, uint16_t addr, uint8_t val)
 {
-    ac97_via_t   *dev   = (ac97_via_t *) priv;
     uint8_t       modem = (addr & 0xff00) == dev->modem_sgd_base;
     uint8_t       i;
     ac97_codec_t *codec;
@@ -346,7 +384,7 @@ ac97_via_sgd_write(uint16_t addr, uint8_t val, void *priv)
                         dev->sgd[addr >> 4].restart    = 2;
 
                         /* Start the actual SGD process. */
-                        ac97_via_sgd_process(&dev->sgd[addr >> 4]);
+                        ac97_via_sgd_start(&dev->sgd[addr >> 4]);
                     }
                 }
                 /* Stop SGD if requested. */
@@ -438,6 +476,19 @@ ac97_via_sgd_write(uint16_t addr, uint8_t val, void *priv)
     dev->sgd_regs[addr] = val;
 }
 
+void
+ac97_via_sgd_write(uint16_t addr, uint8_t val, void *priv)
+{
+    ac97_via_t *dev = (ac97_via_t *) priv;
+
+    ac97_via_sync(dev);
+
+    ac97_via_sgd_write_reg(dev, addr, val);
+
+    /* The write may have changed when the next interrupt is due. */
+    ac97_via_sync(dev);
+}
+
 void
 ac97_via_remap_audio_sgd(void *priv, uint16_t new_io_base, uint8_t enable)
 {
@@ -523,8 +574,10 @@ ac97_via_remap_modem_codec(void *priv, uint16_t new_io_base, uint8_t enable)
         io_sethandler(dev->modem_codec_base, 256, ac97_via_codec_read, NULL, NULL, ac97_via_codec_write, NULL, NULL, dev);
 }
 
+/* Fills the output buffer with the current sample up to the position the
+   sound timer had reached at ts. */
 static void
-ac97_via_update_stereo(ac97_via_t *dev, ac97_via_sgd_t *sgd)
+ac97_via_update_stereo(ac97_via_t *dev, ac97_via_sgd_t *sgd, uint64_t ts)
 {
     int32_t l = (((sgd->out_l * sgd->vol_l) >> 15) * dev->master_vol_l) >> 15;
     int32_t r = (((sgd->out_r * sgd->vol_r) >> 15) * dev->master_vol_r) >> 15;
@@ -538,25 +591,23 @@ ac97_via_update_stereo(ac97_via_t *dev, ac97_via_sgd_t *sgd)
     else if (r > 32767)
         r = 32767;
 
-    for (; sgd->pos < sound_pos_global; sgd->pos++) {
+    for (; (sgd->pos < sound_pos_global) && ((int64_t) (sound_get_pos_ts(sgd->pos) - ts) < 0); sgd->pos++) {
         sgd->buffer[sgd->pos * 2]     = l;
         sgd->buffer[sgd->pos * 2 + 1] = r;
     }
 }
 
-static void
-ac97_via_sgd_process(void *priv)
+/* Runs one DMA slot. Returns 0 if the SGD is not active, which stops the
+   DMA timer. */
+static int
+ac97_via_sgd_transfer(ac97_via_sgd_t *sgd)
 {
-    ac97_via_sgd_t *sgd = (ac97_via_sgd_t *) priv;
-    ac97_via_t     *dev = sgd->dev;
+    ac97_via_t *dev = sgd->dev;
 
     /* Stop if this SGD is not active. */
     uint8_t sgd_status = dev->sgd_regs[sgd->id] & 0xc4;
     if (!(sgd_status & 0x80))
-        return;
-
-    /* Schedule next run. */
-    timer_on_auto(&sgd->dma_timer, 10.0);
+        return 0;
 
     /* Process SGD if it's active, and the FIFO has room or is disabled. */
     if (((sgd_status & 0xc7) == 0x80) && (sgd->always_run || ((sgd->fifo_end - sgd->fifo_pos) <= (sizeof(sgd->fifo) - 4)))) {
@@ -656,20 +707,18 @@ ac97_via_sgd_process(void *priv)
             ac97_via_update_irqs(dev);
         }
     }
+
+    return 1;
 }
 
+/* Runs the PCM output sample taken at ts. */
 static void
-ac97_via_poll_stereo(void *priv)
+ac97_via_poll_stereo(ac97_via_t *dev, uint64_t ts)
 {
-    ac97_via_t     *dev = (ac97_via_t *) priv;
     ac97_via_sgd_t *sgd = &dev->sgd[0]; /* Audio Read */
 
-    /* Schedule next run if PCM playback is enabled. */
-    if (dev->pcm_enabled)
-        timer_advance_u64(&sgd->poll_timer, sgd->timer_latch);
-
     /* Update stereo audio buffer. */
-    ac97_via_update_stereo(dev, sgd);
+    ac97_via_update_stereo(dev, sgd, ts);
 
     /* Feed next sample from the FIFO. */
     switch (dev->sgd_regs[sgd->id | 0x2] & 0x30) {
@@ -714,18 +763,14 @@ ac97_via_poll_stereo(void *priv)
     sgd->out_l = sgd->out_r = 0;
 }
 
+/* Runs the FM output sample taken at ts. */
 static void
-ac97_via_poll_fm(void *priv)
+ac97_via_poll_fm(ac97_via_t *dev, uint64_t ts)
 {
-    ac97_via_t     *dev = (ac97_via_t *) priv;
     ac97_via_sgd_t *sgd = &dev->sgd[2]; /* FM Read */
 
-    /* Schedule next run if FM playback is enabled. */
-    if (dev->fm_enabled)
-        timer_advance_u64(&sgd->poll_timer, sgd->timer_latch);
-
     /* Update FM audio buffer. */
-    ac97_via_update_stereo(dev, sgd);
+    ac97_via_update_stereo(dev, sgd, ts);
 
     /* Feed next sample from the FIFO.
        The data format is not documented, but it probes as 16-bit stereo at 24 KHz. */
@@ -741,13 +786,149 @@ ac97_via_poll_fm(void *priv)
     sgd->out_l = sgd->out_r = 0;
 }
 
+/* Returns how many DMA slots, up to AC97_VIA_BLOCK, can run before the one
+   that may end the current block and raise an interrupt. A slot moves at
+   most one dword, so the end cannot come sooner. */
+static int
+ac97_via_sgd_block_len(const ac97_via_sgd_t *sgd)
+{
+    const ac97_via_t *dev = sgd->dev;
+    int32_t           len;
+
+    /* Nothing moves while the SGD is paused or stopped. */
+    if ((dev->sgd_regs[sgd->id] & 0xc4) != 0x80)
+        return AC97_VIA_BLOCK;
+
+    /* The length of the next block is only read when it starts. */
+    if (sgd->restart)
+        return 1;
+
+    len = (sgd->sample_count + 3) >> 2;
+    if (len < 1)
+        return 1;
+
+    return MIN(len, AC97_VIA_BLOCK);
+}
+
+/* Runs every DMA slot and output sample of the SGD due by the 32:32 time
+   stamp now, in the order their timers would have run them one at a time,
+   then sets the DMA timer for the slot that may raise the next interrupt
+   and the poll timer AC97_VIA_BLOCK samples on. Only the PCM and FM read
+   SGDs have a poller. dma_ahead and poll_ahead hold each timer's distance
+   from its next slot, so that both follow a TSC rebase. */
+static void
+ac97_via_sgd_run(ac97_via_sgd_t *sgd, uint64_t now)
+{
+    ac97_via_t *dev        = sgd->dev;
+    uint64_t    dma_period = (uint64_t) (10.0 * ((double) TIMER_USEC));
+    uint64_t    dma_ts     = sgd->dma_timer.ts.ts64 - sgd->dma_ahead;
+    uint64_t    poll_ts    = sgd->poll_timer.ts.ts64 - sgd->poll_ahead;
+    int         transfer;
+
+    while (sgd->dma_on || sgd->poll_on) {
+        /* On a tie, the timer that was set last runs first. */
+        if (!sgd->poll_on)
+            transfer = 1;
+        else if (!sgd->dma_on)
+            transfer = 0;
+        else if (dma_ts == poll_ts)
+            transfer = !sgd->poll_first;
+        else
+            transfer = (int64_t) (dma_ts - poll_ts) < 0;
+
+        if (transfer) {
+            if ((int64_t) (dma_ts - now) > 0)
+                break;
+
+            sgd->dma_on = ac97_via_sgd_transfer(sgd);
+            if (sgd->dma_on) {
+                dma_ts += dma_period;
+                sgd->poll_first = 0;
+            }
+        } else {
+            if ((int64_t) (poll_ts - now) > 0)
+                break;
+
+            /* Stopping playback lets the sample already due run. */
+            sgd->poll_on = sgd->id ? dev->fm_enabled : dev->pcm_enabled;
+            if (sgd->poll_on)
+                sgd->poll_first = 1;
+
+            if (sgd->id)
+                ac97_via_poll_fm(dev, poll_ts);
+            else
+                ac97_via_poll_stereo(dev, poll_ts);
+
+            /* A stopped poller stays on its last sample. */
+            if (sgd->poll_on)
+                poll_ts += sgd->timer_latch;
+        }
+    }
+
+    if (sgd->dma_on) {
+        sgd->dma_ahead         = (ac97_via_sgd_block_len(sgd) - 1) * dma_period;
+        sgd->dma_timer.ts.ts64 = dma_ts + sgd->dma_ahead;
+        timer_enable(&sgd->dma_timer);
+    } else {
+        sgd->dma_ahead = 0;
+        timer_disable(&sgd->dma_timer);
+    }
+
+    if (sgd->poll_on) {
+        sgd->poll_ahead         = (AC97_VIA_BLOCK - 1) * sgd->timer_latch;
+        sgd->poll_timer.ts.ts64 = poll_ts + sgd->poll_ahead;
+        timer_enable(&sgd->poll_timer);
+    } else {
+        sgd->poll_ahead         = 0;
+        sgd->poll_timer.ts.ts64 = poll_ts;
+        timer_disable(&sgd->poll_timer);
+    }
+}
+
+/* Brings all SGDs up to date before a register access, so the guest sees
+   the pointers, counts and interrupts of the current slot. Slots from the
+   cycle of a timer that is due but has not run yet are left for later, as
+   they would have been with a timer per slot. */
+static void
+ac97_via_sync(ac97_via_t *dev)
+{
+    uint32_t now = (uint32_t) tsc;
+
+    if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) tsc))
+        now = timer_target - 1;
+
+    for (uint8_t i = 0; i < (sizeof(dev->sgd) / sizeof(dev->sgd[0])); i++)
+        ac97_via_sgd_run(&dev->sgd[i], ((uint64_t) now << 32) | 0xffffffffULL);
+}
+
+static void
+ac97_via_sgd_process(void *priv)
+{
+    ac97_via_sgd_t *sgd = (ac97_via_sgd_t *) priv;
+
+    ac97_via_sgd_run(sgd, sgd->dma_timer.ts.ts64);
+}
+
+static void
+ac97_via_poll(void *priv)
+{
+    ac97_via_sgd_t *sgd = (ac97_via_sgd_t *) priv;
+
+    ac97_via_sgd_run(sgd, sgd->poll_timer.ts.ts64);
+}
+
 static void
 ac97_via_get_buffer(int32_t *buffer, int len, void *priv)
 {
     ac97_via_t *dev = (ac97_via_t *) priv;
+    uint64_t    now = sound_get_pos_ts(sound_pos_global - 1);
 
-    ac97_via_update_stereo(dev, &dev->sgd[0]);
-    ac97_via_update_stereo(dev, &dev->sgd[2]);
+    /* Catch up to the sound timer run this is called from. */
+    ac97_via_sgd_run(&dev->sgd[0], now);
+    ac97_via_sgd_run(&dev->sgd[2], now);
+
+    ac97_via_update_stereo(dev, &dev->sgd[0], sound_get_pos_ts(sound_pos_global));
+    ac97_via_update_stereo(dev, &dev->sgd[2], sound_get_pos_ts(sound_pos_global));
 
     for (int c = 0; c < len * 2; c++) {
         buffer[c] += dev->sgd[0].buffer[c] / 2;
@@ -774,6 +955,15 @@ ac97_via_speed_changed(void *priv)
     ac97_via_t *dev = (ac97_via_t *) priv;
     double      freq;
 
+    /* Run what is due at the old rates, then plan the next blocks from the
+       next slots at the new ones. */
+    ac97_via_sync(dev);
+    for (uint8_t i = 0; i < (sizeof(dev->sgd) / sizeof(dev->sgd[0])); i++) {
+        dev->sgd[i].dma_timer.ts.ts64 -= dev->sgd[i].dma_ahead;
+        dev->sgd[i].poll_timer.ts.ts64 -= dev->sgd[i].poll_ahead;
+        dev->sgd[i].dma_ahead = dev->sgd[i].poll_ahead = 0;
+    }
+
     /* Get variable sample rate if enabled. */
     if (dev->vsr_enabled && dev->codec[0][0])
         freq = ac97_codec_getrate(dev->codec[0][0], 0x2c);
@@ -782,6 +972,8 @@ ac97_via_speed_changed(void *priv)
 
     dev->sgd[0].timer_latch = (uint64_t) ((double) TIMER_USEC * (1000000.0 / freq));
     dev->sgd[2].timer_latch = (uint64_t) ((double) TIMER_USEC * (1000000.0 / 24000.0)); /* FM operates at a fixed 24 KHz */
+
+    ac97_via_sync(dev);
 }
 
 static void *
@@ -811,8 +1003,8 @@ ac97_via_init(UNUSED(const device_t *info))
     }
 
     /* Set up playback pollers. */
-    timer_add(&dev->sgd[0].poll_timer, ac97_via_poll_stereo, dev, 0);
-    timer_add(&dev->sgd[2].poll_timer, ac97_via_poll_fm, dev, 0);
+    timer_add(&dev->sgd[0].poll_timer, ac97_via_poll, &dev->sgd[0], 0);
+    timer_add(&dev->sgd[2].poll_timer, ac97_via_poll, &dev->sgd[2], 0);
     ac97_via_speed_changed(dev);
 
     /* Set up playback handler. */
@@ -29,6 +29,7 @@
 
 #include <86box/86box.h>
 #include <86box/device.h>
+#include <86box/dma.h>
 #include <86box/gameport.h>
 #include <86box/io.h>
 #include <86box/mem.h>
@@ -42,9 +43,17 @@
 
 #define N            16
 
-#define ES1371_NCoef 91
+#define ES1371_NCoef      91
+#define ES1371_PHASE_TAPS ((ES1371_NCoef + 15) / 16)
+#define ES1371_POLL_BLOCK 32
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    define ES1371_SSE2
+#    include <emmintrin.h>
+#endif
 
 static float low_fir_es1371_coef[ES1371_NCoef];
+static float low_fir_es1371_phase[ES1371_PHASE_TAPS][16];
 
 typedef struct es1371_t {
     uint8_t pci_command;
@@ -115,8 +124,9 @@ typedef struct es1371_t {
         int32_t vol_r;
     } dac[2], adc;
 
-    int64_t dac_latch;
-    int64_t dac_time;
+    int64_t  dac_latch;
+    int64_t  dac_time;
+    uint64_t poll_ahead;
 
     int master_vol_l;
     int master_vol_r;
@@ -205,6 +215,7 @@ typedef struct es1371_t {
 #define FORMAT_STEREO_16          3
 
 static void es1371_fetch(es1371_t *dev, int dac_nr);
+static void es1371_poll_sync(es1371_t *dev);
 static void update_legacy(es1371_t *dev, uint32_t old_legacy_ctrl);
 
 #ifdef ENABLE_AUDIOPCI_LOG
@@ -671,6 +682,8 @@ es1371_inb(uint16_t port, void *priv)
     es1371_t *dev = (es1371_t *) priv;
     uint8_t   ret = 0xff;
 
+    es1371_poll_sync(dev);
+
     switch (port & 0x3f) {
         /* Interrupt/Chip Select Control Register, Address 00H
            Addressable as byte, word, longword */
@@ -803,6 +816,8 @@ es1371_inw(uint16_t port, void *priv)
     es1371_t *dev = (es1371_t *) priv;
     uint16_t  ret = 0xffff;
 
+    es1371_poll_sync(dev);
+
     switch (port & 0x3e) {
         /* Interrupt/Chip Select Control Register, Address 00H
            Addressable as byte, word, longword */
@@ -908,6 +923,8 @@ es1371_inl(uint16_t port, void *priv)
     es1371_t *dev = (es1371_t *) priv;
     uint32_t  ret = 0xffffffff;
 
+    es1371_poll_sync(dev);
+
     switch (port & 0x3c) {
         /* Interrupt/Chip Select Control Register, Address 00H
            Addressable as byte, word, longword */
@@ -1003,6 +1020,8 @@ es1371_outb(uint16_t port, uint8_t val, void *priv)
 
     audiopci_log("es1371_outb: port=%04x val=%02x\n", port, val);
 
+    es1371_poll_sync(dev);
+
     switch (port & 0x3f) {
         /* Interrupt/Chip Select Control Register, Address 00H
            Addressable as byte, word, longword */
@@ -1140,6 +1159,9 @@ es1371_outb(uint16_t port, uint8_t val, void *priv)
         default:
             audiopci_log("Bad es1371_outb: port=%04x val=%02x\n", port, val);
     }
+
+    /* The write may have changed when the next interrupt is due. */
+    es1371_poll_sync(dev);
 }
 
 static void
@@ -1148,6 +1170,8 @@ es1371_outw(uint16_t port, uint16_t val, void *priv)
     es1371_t *dev = (es1371_t *) priv;
     uint32_t  old_legacy_ctrl;
 
+    es1371_poll_sync(dev);
+
     switch (port & 0x3f) {
         /* Interrupt/Chip Select Control Register, Address 00H
            Addressable as byte, word, longword */
@@ -1235,6 +1259,9 @@ es1371_outw(uint16_t port, uint16_t val, void *priv)
         default:
             break;
     }
+
+    /* The write may have changed when the next interrupt is due. */
+    es1371_poll_sync(dev);
 }
 
 static void
@@ -1245,6 +1272,8 @@ es1371_outl(uint16_t port, uint32_t val, void *priv)
 
     audiopci_log("es1371_outl: port=%04x val=%08x\n", port, val);
 
+    es1371_poll_sync(dev);
+
     switch (port & 0x3f) {
         /* Interrupt/Chip Select Control Register, Address 00H
            Addressable as byte, word, longword */
@@ -1403,6 +1432,9 @@ es1371_outl(uint16_t port, uint32_t val, void *priv)
         default:
             break;
     }
+
+    /* The write may have changed when the next interrupt is due. */
+    es1371_poll_sync(dev);
 }
 
 static void
@@ -1882,145 +1914,131 @@ es1371_fetch(es1371_t *dev, int dac_nr)
     if (dev->si_cr & (dac_nr ? SI_P2_PAUSE : SI_P1_PAUSE))
         return;
 
-    int format = dac_nr ? ((dev->si_cr >> 2) & 3) : (dev->si_cr & 3);
-    int pos    = dev->dac[dac_nr].buffer_pos & 63;
-    int c;
+    int     format = dac_nr ? ((dev->si_cr >> 2) & 3) : (dev->si_cr & 3);
+    int     pos    = dev->dac[dac_nr].buffer_pos & 63;
+    int     dwords = (format == FORMAT_STEREO_16) ? 4 : 8;
+    uint8_t data[32];
+    int     n;
+    int     c;
+
+    /* Work out how many dwords can be fetched before the buffer wraps, and
+       fetch them with a single bus master read. */
+    for (n = 1; n < dwords; n++) {
+        if ((uint16_t) (dev->dac[dac_nr].count + n) > dev->dac[dac_nr].size)
+            break;
+    }
+
+    dma_bm_read(dev->dac[dac_nr].addr, data, n << 2, 4);
 
     switch (format) {
         case FORMAT_MONO_8:
-            for (c = 0; c < 32; c += 4) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 1) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 2) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 2) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 2) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 3) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 3) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 3) ^ 0x80) << 8;
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end += 4;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
-            }
+            for (c = 0; c < (n << 2); c++)
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = (data[c] ^ 0x80) << 8;
+            dev->dac[dac_nr].buffer_pos_end += n << 2;
             break;
 
         case FORMAT_STEREO_8:
-            for (c = 0; c < 16; c += 2) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63]     = (mem_readb_phys(dev->dac[dac_nr].addr) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_r[(pos + c) & 63]     = (mem_readb_phys(dev->dac[dac_nr].addr + 1) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 2) ^ 0x80) << 8;
-                dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = (mem_readb_phys(dev->dac[dac_nr].addr + 3) ^ 0x80) << 8;
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end += 2;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
+            for (c = 0; c < (n << 1); c++) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = (data[c << 1] ^ 0x80) << 8;
+                dev->dac[dac_nr].buffer_r[(pos + c) & 63] = (data[(c << 1) + 1] ^ 0x80) << 8;
             }
+            dev->dac[dac_nr].buffer_pos_end += n << 1;
             break;
 
         case FORMAT_MONO_16:
-            for (c = 0; c < 16; c += 2) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
-                dev->dac[dac_nr].buffer_l[(pos + c + 1) & 63] = dev->dac[dac_nr].buffer_r[(pos + c + 1) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end += 2;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
-            }
+            for (c = 0; c < (n << 1); c++)
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = dev->dac[dac_nr].buffer_r[(pos + c) & 63] = data[c << 1] | (data[(c << 1) + 1] << 8);
+            dev->dac[dac_nr].buffer_pos_end += n << 1;
             break;
 
         case FORMAT_STEREO_16:
-            for (c = 0; c < 4; c++) {
-                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr);
-                dev->dac[dac_nr].buffer_r[(pos + c) & 63] = mem_readw_phys(dev->dac[dac_nr].addr + 2);
-                dev->dac[dac_nr].addr += 4;
-
-                dev->dac[dac_nr].buffer_pos_end++;
-                dev->dac[dac_nr].count++;
-
-                if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
-                    dev->dac[dac_nr].count = 0;
-                    dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
-                    break;
-                }
+            for (c = 0; c < n; c++) {
+                dev->dac[dac_nr].buffer_l[(pos + c) & 63] = data[c << 2] | (data[(c << 2) + 1] << 8);
+                dev->dac[dac_nr].buffer_r[(pos + c) & 63] = data[(c << 2) + 2] | (data[(c << 2) + 3] << 8);
             }
+            dev->dac[dac_nr].buffer_pos_end += n;
             break;
 
         default:
-            break;
+            return;
+    }
+
+    dev->dac[dac_nr].addr += n << 2;
+    dev->dac[dac_nr].count += n;
+
+    if (dev->dac[dac_nr].count > dev->dac[dac_nr].size) {
+        dev->dac[dac_nr].count = 0;
+        dev->dac[dac_nr].addr  = dev->dac[dac_nr].addr_latch;
     }
 }
 
-static inline float
-low_fir_es1371(int dac_nr, int i, float NewSample)
+/* The SRC upsamples by 16 and low-pass filters the result. Only one in 16
+   filter inputs is non-zero, so the filter is split into 16 phases of at
+   most ES1371_PHASE_TAPS taps, each producing one of the 16 outputs from
+   the last few real input samples. Phase 0 starts at the newest sample,
+   the others one sample further on. */
+static void
+low_fir_es1371(int dac_nr, const float *in, int *out_l, int *out_r)
 {
-    static float x[2][2][128]; // input samples
-    static int   x_pos[2] = { 0, 0 };
-    float        out      = 0.0;
-    int          read_pos;
-    int          n_coef;
-    int          pos = x_pos[dac_nr];
-
-    x[dac_nr][i][pos] = NewSample;
-
-    /* Since only 1/16th of input samples are non-zero, only filter those that
-       are valid.*/
-    read_pos = (pos + 15) & (127 & ~15);
-    n_coef   = (16 - pos) & 15;
-
-    while (n_coef < ES1371_NCoef) {
-        out += low_fir_es1371_coef[n_coef] * x[dac_nr][i][read_pos];
-        read_pos = (read_pos + 16) & (127 & ~15);
-        n_coef += 16;
-    }
+    static float hist[2][2][8];
+    static int   hist_pos[2] = { 0, 0 };
+    int          pos         = hist_pos[dac_nr];
+    int         *out[2]      = { out_l, out_r };
+
+    for (int i = 0; i < 2; i++) {
+        const float *h = hist[dac_nr][i];
 
-    if (i == 1) {
-        x_pos[dac_nr] = (x_pos[dac_nr] + 1) & 127;
-        if (x_pos[dac_nr] > 127)
-            x_pos[dac_nr] = 0;
+        hist[dac_nr][i][pos] = in[i];
+
+#if defined ES1371_SSE2
+        for (int j = 0; j < 16; j += 4) {
+            __m128 acc = _mm_setzero_ps();
+
+            for (int k = 0; k < ES1371_PHASE_TAPS; k++) {
+                __m128 x = _mm_set1_ps(h[(pos + 1 + k) & 7]);
+
+                if (!j)
+                    x = _mm_move_ss(x, _mm_set_ss(h[(pos + k) & 7]));
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&low_fir_es1371_phase[k][j]), x));
+            }
+
+            _mm_storeu_si128((__m128i *) &out[i][j], _mm_cvttps_epi32(acc));
+        }
+#else
+        for (int j = 0; j < 16; j++) {
+            float acc = 0.0f;
+
+            for (int k = 0; k < ES1371_PHASE_TAPS; k++)
+                acc += low_fir_es1371_phase[k][j] * h[(pos + (j ? 1 : 0) + k) & 7];
+
+            out[i][j] = (int) acc;
+        }
+#endif
     }
 
-    return out;
+    hist_pos[dac_nr] = (pos + 1) & 7;
 }
 
 static void
 es1371_next_sample_filtered(es1371_t *dev, int dac_nr, int out_idx)
 {
-    int out_l;
-    int out_r;
+    float in[2];
 
     if ((dev->dac[dac_nr].buffer_pos - dev->dac[dac_nr].buffer_pos_end) >= 0)
         es1371_fetch(dev, dac_nr);
 
-    out_l = dev->dac[dac_nr].buffer_l[dev->dac[dac_nr].buffer_pos & 63];
-    out_r = dev->dac[dac_nr].buffer_r[dev->dac[dac_nr].buffer_pos & 63];
-
-    dev->dac[dac_nr].filtered_l[out_idx] = (int) low_fir_es1371(dac_nr, 0, (float) out_l);
-    dev->dac[dac_nr].filtered_r[out_idx] = (int) low_fir_es1371(dac_nr, 1, (float) out_r);
+    in[0] = (float) dev->dac[dac_nr].buffer_l[dev->dac[dac_nr].buffer_pos & 63];
+    in[1] = (float) dev->dac[dac_nr].buffer_r[dev->dac[dac_nr].buffer_pos & 63];
 
-    for (uint8_t c = 1; c < 16; c++) {
-        dev->dac[dac_nr].filtered_l[out_idx + c] = (int) low_fir_es1371(dac_nr, 0, 0);
-        dev->dac[dac_nr].filtered_r[out_idx + c] = (int) low_fir_es1371(dac_nr, 1, 0);
-    }
+    low_fir_es1371(dac_nr, in, &dev->dac[dac_nr].filtered_l[out_idx], &dev->dac[dac_nr].filtered_r[out_idx]);
 
     dev->dac[dac_nr].buffer_pos++;
 }
 
+/* Fills the output buffer with the current sample up to the position the
+   sound timer had reached at ts. */
 static void
-es1371_update(es1371_t *dev)
+es1371_update(es1371_t *dev, uint64_t ts)
 {
     int32_t l;
     int32_t r;
@@ -2045,16 +2063,17 @@ es1371_update(es1371_t *dev)
     else if (r > 32767)
         r = 32767;
 
-    for (; dev->pos < sound_pos_global; dev->pos++) {
+    for (; (dev->pos < sound_pos_global) && ((int64_t) (sound_get_pos_ts(dev->pos) - ts) < 0); dev->pos++) {
         dev->buffer[dev->pos * 2]     = l;
         dev->buffer[dev->pos * 2 + 1] = r;
     }
 }
 
+/* Runs the output sample taken at ts. last is set on the last sample run
+   in one go. */
 static void
-es1371_poll(void *priv)
+es1371_poll_tick(es1371_t *dev, uint64_t ts, int last)
 {
-    es1371_t *dev = (es1371_t *) priv;
     int       frac;
     int       idx;
     int       samp1_l;
@@ -2062,11 +2081,14 @@ es1371_poll(void *priv)
     int       samp2_l;
     int       samp2_r;
 
-    timer_advance_u64(&dev->dac[1].timer, dev->dac[1].latch);
-
-    es1371_scan_fifo(dev);
+    /* MIDI input fills the FIFO from another thread, so anything that came
+       in while samples were pending is taken to arrive on the last one. */
+    if (last)
+        es1371_scan_fifo(dev);
+    else
+        es1371_set_rx_irq(dev, 0);
 
-    es1371_update(dev);
+    es1371_update(dev, ts);
 
     if (dev->int_ctrl & INT_DAC1_EN) {
         if ((dev->type >= AUDIOPCI_ES1373) && (dev->int_ctrl & INT_DAC1_BYPASS)) {
@@ -2145,12 +2167,111 @@ dac1_count:
     }
 }
 
+/* Returns how many samples, up to ES1371_POLL_BLOCK, the next poll block
+   can cover. The block ends on the sample that raises a DAC interrupt,
+   found by stepping copies of the counters es1371_poll_tick() uses. While
+   the UART FIFO holds data, every sample is its own block. */
+static int
+es1371_poll_block_len(const es1371_t *dev)
+{
+    int len = ES1371_POLL_BLOCK;
+
+    if (dev->read_fifo_pos != dev->write_fifo_pos)
+        return 1;
+
+    for (int d = 0; d < 2; d++) {
+        uint32_t ac    = dev->dac[d].ac;
+        int      f_pos = dev->dac[d].f_pos;
+        int      ct    = dev->dac[d].curr_samp_ct;
+        int      bypass;
+
+        if (!(dev->int_ctrl & (d ? INT_DAC2_EN : INT_DAC1_EN)))
+            continue;
+
+        bypass = (dev->type >= AUDIOPCI_ES1373) && (dev->int_ctrl & (d ? INT_DAC2_BYPASS : INT_DAC1_BYPASS));
+
+        for (int i = 1; i < len; i++) {
+            if (bypass)
+                ct--;
+            else {
+                ac = (ac + dev->dac[d].vf) & ((32 << 15) - 1);
+                if ((ac >> (15 + 4)) != f_pos) {
+                    f_pos = (f_pos + 1) & 1;
+                    ct--;
+                }
+            }
+
+            if (ct < 0) {
+                len = i;
+                break;
+            }
+        }
+    }
+
+    return len;
+}
+
+/* Runs every output sample taken up to now, then sets the poll timer for
+   the last sample of the next block. poll_ahead holds the distance from the
+   next sample to the timer, so the sample clock follows the timer if the
+   TSC is rebased. */
+static void
+es1371_poll_run(es1371_t *dev, uint32_t now)
+{
+    uint64_t latch = dev->dac[1].latch;
+    uint64_t ts    = dev->dac[1].timer.ts.ts64 - dev->poll_ahead;
+    int      len;
+    int      n;
+
+    while (1) {
+        len = es1371_poll_block_len(dev);
+        for (n = 0; n < len; n++) {
+            if (!TIMER_VAL_LESS_THAN_VAL((uint32_t) ((ts + (n * latch)) >> 32), now))
+                break;
+        }
+        if (!n)
+            break;
+
+        for (int i = 0; i < n; i++) {
+            es1371_poll_tick(dev, ts, i == (n - 1));
+            ts += latch;
+        }
+    }
+
+    dev->poll_ahead           = (len - 1) * latch;
+    dev->dac[1].timer.ts.ts64 = ts + dev->poll_ahead;
+    timer_enable(&dev->dac[1].timer);
+}
+
+/* Brings the poll up to date before a register access, so the guest sees
+   the sample counters and interrupts of the current sample. Samples from
+   the cycle of a timer that is due but has not run yet on are left for
+   later, as they would have been with a timer per sample. */
+static void
+es1371_poll_sync(es1371_t *dev)
+{
+    if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) tsc))
+        es1371_poll_run(dev, timer_target - 1);
+    else
+        es1371_poll_run(dev, (uint32_t) tsc);
+}
+
+static void
+es1371_poll(void *priv)
+{
+    es1371_t *dev = (es1371_t *) priv;
+
+    es1371_poll_run(dev, timer_get_ts_int(&dev->dac[1].timer));
+}
+
 static void
 es1371_get_buffer(int32_t *buffer, int len, void *priv)
 {
     es1371_t *dev = (es1371_t *) priv;
 
-    es1371_update(dev);
+    /* Catch up to the sound timer run this is called from. */
+    es1371_poll_run(dev, (uint32_t) (sound_get_pos_ts(sound_pos_global - 1) >> 32));
+    es1371_update(dev, sound_get_pos_ts(sound_pos_global));
 
     for (int c = 0; c < len * 2; c++)
         buffer[c] += (dev->buffer[c] / 2);
@@ -2205,6 +2326,15 @@ generate_es1371_filter(void)
     /* Normalise filter, to produce unity gain */
     for (n = 0; n < ES1371_NCoef; n++)
         low_fir_es1371_coef[n] /= gain;
+
+    /* Split into phases, padding the shorter ones with zero taps. */
+    for (int j = 0; j < 16; j++) {
+        for (int k = 0; k < ES1371_PHASE_TAPS; k++) {
+            n = (j ? (16 - j) : 0) + (k << 4);
+
+            low_fir_es1371_phase[k][j] = (n < ES1371_NCoef) ? low_fir_es1371_coef[n] : 0.0f;
+        }
+    }
 }
 
 static void
@@ -2258,6 +2388,7 @@ es1371_init(const device_t *info)
 
     pci_add_card((info->local & 1) ? PCI_ADD_SOUND : PCI_ADD_NORMAL, es1371_pci_read, es1371_pci_write, dev, &dev->pci_slot);
 
+    dev->dac[1].latch = (uint64_t) ((double) TIMER_USEC * (1000000.0 / (double) SOUND_FREQ));
     timer_add(&dev->dac[1].timer, es1371_poll, dev, 1);
 
     generate_es1371_filter();
@@ -2287,7 +2418,15 @@ es1371_speed_changed(void *priv)
 {
     es1371_t *dev = (es1371_t *) priv;
 
+    /* Run what is due at the old rate, then plan the next block from the
+       next sample at the new rate. */
+    es1371_poll_sync(dev);
+
+    dev->dac[1].timer.ts.ts64 -= dev->poll_ahead;
     dev->dac[1].latch = (uint64_t) ((double) TIMER_USEC * (1000000.0 / (double) SOUND_FREQ));
+    dev->poll_ahead   = 0;
+
+    es1371_poll_sync(dev);
 }
 
 static const device_config_t es1371_config[] = {
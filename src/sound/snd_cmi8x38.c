@@ -47,6 +47,8 @@ enum {
     CMEDIA_CMI8738_6CH = 0x080011  /* chip version 055 with 6-channel output */
 };
 
+#define CMI8X38_BLOCK 32
+
 enum {
     TRAP_DMA = 0,
     TRAP_PIC,
@@ -84,6 +86,11 @@ typedef struct cmi8x38_dma_t {
     int32_t  buffer[SOUNDBUFLEN * 2];
     uint64_t timer_latch;
     double   dma_latch;
+    uint64_t dma_ahead;
+    uint64_t poll_ahead;
+    uint8_t  dma_on;
+    uint8_t  poll_on;
+    uint8_t  poll_first;
 
     pc_timer_t dma_timer;
     pc_timer_t poll_timer;
@@ -140,7 +147,8 @@ cmi8x38_log(const char *fmt, ...)
 static const double   freqs[]             = { 5512.0, 11025.0, 22050.0, 44100.0, 8000.0, 16000.0, 32000.0, 48000.0 };
 static const uint16_t opl_ports_cmi8738[] = { 0x388, 0x3c8, 0x3e0, 0x3e8 };
 
-static void cmi8x38_dma_process(void *priv);
+static int  cmi8x38_dma_transfer(cmi8x38_dma_t *dma);
+static void cmi8x38_dma_sync(cmi8x38_t *dev);
 static void cmi8x38_speed_changed(void *priv);
 
 static void
@@ -445,6 +453,9 @@ cmi8x38_sb_mixer_write(uint16_t addr, uint8_t val, void *priv)
     cmi8x38_t         *dev   = (cmi8x38_t *) priv;
     sb_ct1745_mixer_t *mixer = &dev->sb->mixer_sb16;
 
+    /* Output already due goes out at the old volume. */
+    cmi8x38_dma_sync(dev);
+
     /* Our clone mixer has a few differences. */
     if (addr & 1) {
         cmi8x38_log("CMI8x38: sb_mixer_write(1, %02X, %02X)\n", mixer->index, val);
@@ -590,6 +601,28 @@ cmi8x38_remap_traps(cmi8x38_t *dev)
     io_trap_remap(dev->io_traps[TRAP_PIC], (dev->io_regs[0x04] & 0x01) && (dev->io_regs[0x17] & 0x01), 0x0020, 2);
 }
 
+/* Starts the DMA timer one slot from now and moves the first frame at once. */
+static void
+cmi8x38_dma_start(cmi8x38_dma_t *dma)
+{
+    if (!cmi8x38_dma_transfer(dma))
+        return;
+
+    timer_set_delay_u64(&dma->dma_timer, (uint64_t) (dma->dma_latch * ((double) TIMER_USEC)));
+    dma->dma_ahead  = 0;
+    dma->dma_on     = 1;
+    dma->poll_first = 0;
+}
+
+static void
+cmi8x38_poll_start(cmi8x38_dma_t *dma)
+{
+    timer_set_delay_u64(&dma->poll_timer, dma->timer_latch);
+    dma->poll_ahead = 0;
+    dma->poll_on    = 1;
+    dma->poll_first = 1;
+}
+
 static void
 cmi8x38_start_playback(cmi8x38_t *dev)
 {
@@ -598,12 +631,12 @@ cmi8x38_start_playback(cmi8x38_t *dev)
 
     i = !(val & 0x01);
     if (!dev->dma[0].playback_enabled && i)
-        timer_set_delay_u64(&dev->dma[0].poll_timer, dev->dma[0].timer_latch);
+        cmi8x38_poll_start(&dev->dma[0]);
     dev->dma[0].playback_enabled = i;
 
     i = !(val & 0x02);
     if (!dev->dma[1].playback_enabled && i)
-        timer_set_delay_u64(&dev->dma[1].poll_timer, dev->dma[1].timer_latch);
+        cmi8x38_poll_start(&dev->dma[1]);
     dev->dma[1].playback_enabled = i;
 }
 
@@ -614,6 +647,8 @@ cmi8x38_read(uint16_t addr, void *priv)
     addr &= 0xff;
     uint8_t ret;
 
+    cmi8x38_dma_sync(dev);
+
     switch (addr) {
         case 0x22:
         case 0x23:
@@ -685,9 +720,8 @@ io_reg:
 }
 
 static void
-cmi8x38_write(uint16_t addr, uint8_t val, void *priv)
+cmi8x38_write_reg(cmi8x38_t *dev, uint16_t addr, uint8_t val)
 {
-    cmi8x38_t *dev = (cmi8x38_t *) priv;
     addr &= 0xff;
     cmi8x38_log("CMI8x38: write(%02X, %02X)\n", addr, val);
 
@@ -720,7 +754,7 @@ cmi8x38_write(uint16_t addr, uint8_t val, void *priv)
                     /* Start DMA channel. */
                     cmi8x38_log("CMI8x38: DMA %d trigger\n", i);
                     dev->dma[i].restart = 1;
-                    cmi8x38_dma_process(&dev->dma[i]);
+                    cmi8x38_dma_start(&dev->dma[i]);
                 }
             }
 
@@ -954,6 +988,19 @@ cmi8x38_write(uint16_t addr, uint8_t val, void *priv)
     dev->io_regs[addr] = val;
 }
 
+static void
+cmi8x38_write(uint16_t addr, uint8_t val, void *priv)
+{
+    cmi8x38_t *dev = (cmi8x38_t *) priv;
+
+    cmi8x38_dma_sync(dev);
+
+    cmi8x38_write_reg(dev, addr, val);
+
+    /* The write may have changed when the next interrupt is due. */
+    cmi8x38_dma_sync(dev);
+}
+
 static void
 cmi8x38_remap(cmi8x38_t *dev)
 {
@@ -1037,35 +1084,35 @@ cmi8x38_pci_write(int func, int addr, uint8_t val, void *priv)
     dev->pci_regs[addr] = val;
 }
 
+/* Fills the output buffer with the current sample up to the position the
+   sound timer had reached at ts. */
 static void
-cmi8x38_update(cmi8x38_t *dev, cmi8x38_dma_t *dma)
+cmi8x38_update(cmi8x38_t *dev, cmi8x38_dma_t *dma, uint64_t ts)
 {
     const sb_ct1745_mixer_t *mixer = &dev->sb->mixer_sb16;
     int32_t                  l     = (dma->out_fl * mixer->voice_l) * mixer->master_l;
     int32_t                  r     = (dma->out_fr * mixer->voice_r) * mixer->master_r;
 
-    for (; dma->pos < sound_pos_global; dma->pos++) {
+    for (; (dma->pos < sound_pos_global) && ((int64_t) (sound_get_pos_ts(dma->pos) - ts) < 0); dma->pos++) {
         dma->buffer[dma->pos * 2]     = l;
         dma->buffer[dma->pos * 2 + 1] = r;
     }
 }
 
-static void
-cmi8x38_dma_process(void *priv)
+/* Runs one DMA transfer slot. Returns 0 if the channel is not active, which
+   stops the DMA timer. */
+static int
+cmi8x38_dma_transfer(cmi8x38_dma_t *dma)
 {
-    cmi8x38_dma_t *dma = (cmi8x38_dma_t *) priv;
-    cmi8x38_t     *dev = dma->dev;
+    cmi8x38_t *dev = dma->dev;
 
     /* Stop if this DMA channel is not active. */
     uint8_t dma_bit = 0x01 << dma->id;
     if (!(dev->io_regs[0x02] & dma_bit)) {
         cmi8x38_log("CMI8x38: Stopping DMA %d due to inactive channel (%02X)\n", dma->id, dev->io_regs[0x02]);
-        return;
+        return 0;
     }
 
-    /* Schedule next run. */
-    timer_on_auto(&dma->dma_timer, dma->dma_latch);
-
     /* Process DMA if it's active, and the FIFO has room or is disabled. */
     uint8_t dma_status = dev->io_regs[0x00] >> dma->id;
     if (!(dma_status & 0x04) && (dma->always_run || ((dma->fifo_end - dma->fifo_pos) <= (sizeof(dma->fifo) - 4)))) {
@@ -1127,24 +1174,22 @@ cmi8x38_dma_process(void *priv)
             dma->restart = 1;
         }
     }
+
+    return 1;
 }
 
+/* Runs the output sample taken at ts. */
 static void
-cmi8x38_poll(void *priv)
+cmi8x38_poll_sample(cmi8x38_dma_t *dma, uint64_t ts)
 {
-    cmi8x38_dma_t *dma = (cmi8x38_dma_t *) priv;
-    cmi8x38_t     *dev = dma->dev;
-    int16_t       *out_l;
-    int16_t       *out_r;
-    int16_t       *out_ol;
-    int16_t       *out_or; /* o = opposite */
-
-    /* Schedule next run if playback is enabled. */
-    if (dma->playback_enabled)
-        timer_advance_u64(&dma->poll_timer, dma->timer_latch);
+    cmi8x38_t *dev = dma->dev;
+    int16_t   *out_l;
+    int16_t   *out_r;
+    int16_t   *out_ol;
+    int16_t   *out_or; /* o = opposite */
 
     /* Update audio buffer. */
-    cmi8x38_update(dev, dma);
+    cmi8x38_update(dev, dma, ts);
 
     /* Swap stereo pair if this is the rear DMA channel according to ENDBDAC and XCHGDAC. */
     if ((dev->io_regs[0x1a] & 0x80) && (!!(dev->io_regs[0x1a] & 0x40) ^ dma->id)) {
@@ -1279,14 +1324,142 @@ n4spk3d:
     }
 }
 
+/* Returns how many DMA transfer slots, up to CMI8X38_BLOCK, can run before
+   the one that may raise the next fragment interrupt. A slot moves at most
+   one frame, so the interrupt cannot come sooner. */
+static int
+cmi8x38_dma_block_len(const cmi8x38_dma_t *dma)
+{
+    const cmi8x38_t *dev    = dma->dev;
+    int32_t          reload = *((uint16_t *) &dev->io_regs[dma->reg | 0x6]) + 1;
+    int32_t          len;
+
+    if (!(dev->io_regs[0x0e] & (0x01 << dma->id)))
+        return CMI8X38_BLOCK;
+
+    /* A restart reloads the fragment counter, be it pending or at the end
+       of the buffer. */
+    if (dma->restart)
+        len = reload;
+    else
+        len = MIN(dma->frame_count_fragment, dma->frame_count_dma + reload);
+
+    if (len < 1)
+        return 1;
+
+    return MIN(len, CMI8X38_BLOCK);
+}
+
+/* Runs every DMA transfer slot and output sample of the channel due by the
+   32:32 time stamp now, in the order their timers would have run them one at a time, then
+   sets the DMA timer for the slot that may raise the next interrupt and the
+   poll timer CMI8X38_BLOCK samples on. dma_ahead and poll_ahead hold each
+   timer's distance from its next slot, so that both follow a TSC rebase. */
+static void
+cmi8x38_dma_run(cmi8x38_dma_t *dma, uint64_t now)
+{
+    uint64_t dma_period = (uint64_t) (dma->dma_latch * ((double) TIMER_USEC));
+    uint64_t dma_ts     = dma->dma_timer.ts.ts64 - dma->dma_ahead;
+    uint64_t poll_ts    = dma->poll_timer.ts.ts64 - dma->poll_ahead;
+    int      transfer;
+
+    while (dma->dma_on || dma->poll_on) {
+        /* On a tie, the timer that was set last runs first. */
+        if (!dma->poll_on)
+            transfer = 1;
+        else if (!dma->dma_on)
+            transfer = 0;
+        else if (dma_ts == poll_ts)
+            transfer = !dma->poll_first;
+        else
+            transfer = (int64_t) (dma_ts - poll_ts) < 0;
+
+        if (transfer) {
+            if ((int64_t) (dma_ts - now) > 0)
+                break;
+
+            dma->dma_on = cmi8x38_dma_transfer(dma);
+            if (dma->dma_on) {
+                dma_ts += dma_period;
+                dma->poll_first = 0;
+            }
+        } else {
+            if ((int64_t) (poll_ts - now) > 0)
+                break;
+
+            /* Stopping playback lets the sample already due run. */
+            dma->poll_on = dma->playback_enabled;
+            if (dma->poll_on)
+                dma->poll_first = 1;
+
+            cmi8x38_poll_sample(dma, poll_ts);
+            poll_ts += dma->timer_latch;
+        }
+    }
+
+    if (dma->dma_on) {
+        dma->dma_ahead          = (cmi8x38_dma_block_len(dma) - 1) * dma_period;
+        dma->dma_timer.ts.ts64  = dma_ts + dma->dma_ahead;
+        timer_enable(&dma->dma_timer);
+    } else {
+        dma->dma_ahead = 0;
+        timer_disable(&dma->dma_timer);
+    }
+
+    if (dma->poll_on) {
+        dma->poll_ahead         = (CMI8X38_BLOCK - 1) * dma->timer_latch;
+        dma->poll_timer.ts.ts64 = poll_ts + dma->poll_ahead;
+        timer_enable(&dma->poll_timer);
+    } else {
+        dma->poll_ahead = 0;
+        timer_disable(&dma->poll_timer);
+    }
+}
+
+/* Brings both channels up to date before a register access, so the guest
+   sees the position, counters and interrupts of the current slot. Slots
+   from the cycle of a timer that is due but has not run yet are left for
+   later, as they would have been with a timer per slot. */
+static void
+cmi8x38_dma_sync(cmi8x38_t *dev)
+{
+    uint32_t now = (uint32_t) tsc;
+
+    if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) tsc))
+        now = timer_target - 1;
+
+    for (int i = 0; i < (sizeof(dev->dma) / sizeof(dev->dma[0])); i++)
+        cmi8x38_dma_run(&dev->dma[i], ((uint64_t) now << 32) | 0xffffffffULL);
+}
+
+static void
+cmi8x38_dma_process(void *priv)
+{
+    cmi8x38_dma_t *dma = (cmi8x38_dma_t *) priv;
+
+    cmi8x38_dma_run(dma, dma->dma_timer.ts.ts64);
+}
+
+static void
+cmi8x38_poll(void *priv)
+{
+    cmi8x38_dma_t *dma = (cmi8x38_dma_t *) priv;
+
+    cmi8x38_dma_run(dma, dma->poll_timer.ts.ts64);
+}
+
 static void
 cmi8x38_get_buffer(int32_t *buffer, int len, void *priv)
 {
     cmi8x38_t *dev = (cmi8x38_t *) priv;
+    uint64_t   now = sound_get_pos_ts(sound_pos_global - 1);
 
-    /* Update wave playback channels. */
-    cmi8x38_update(dev, &dev->dma[0]);
-    cmi8x38_update(dev, &dev->dma[1]);
+    /* Catch up to the sound timer run this is called from, then update wave
+       playback channels. */
+    for (int i = 0; i < (sizeof(dev->dma) / sizeof(dev->dma[0])); i++) {
+        cmi8x38_dma_run(&dev->dma[i], now);
+        cmi8x38_update(dev, &dev->dma[i], sound_get_pos_ts(sound_pos_global));
+    }
 
     /* Apply wave mute. */
     if (!(dev->io_regs[0x24] & 0x40)) {
@@ -1315,6 +1488,15 @@ cmi8x38_speed_changed(void *priv)
     sprintf(buf, "%02X-%02X-%02X-%02X", dsr, freqreg, chfmt45, chfmt6);
 #endif
 
+    /* Run what is due at the old rates, then plan the next blocks from the
+       next slots at the new ones. */
+    cmi8x38_dma_sync(dev);
+    for (int i = 0; i < (sizeof(dev->dma) / sizeof(dev->dma[0])); i++) {
+        dev->dma[i].dma_timer.ts.ts64 -= dev->dma[i].dma_ahead;
+        dev->dma[i].poll_timer.ts.ts64 -= dev->dma[i].poll_ahead;
+        dev->dma[i].dma_ahead = dev->dma[i].poll_ahead = 0;
+    }
+
     /* CMI8338 claims the frequency controls are for DAC (playback) and ADC (recording)
        respectively, while CMI8738 claims they're for channel 0 and channel 1. The Linux
        driver just assumes the latter definition, so that's what we're going to use here. */
@@ -1365,6 +1547,8 @@ stereo:
         freqreg >>= 3;
     }
 
+    cmi8x38_dma_sync(dev);
+
 #ifdef ENABLE_CMI8X38_LOG
     if (cmi8x38_do_log)
         ui_sb_bugui(buf);
@@ -1376,6 +1560,8 @@ cmi8x38_reset(void *priv)
 {
     cmi8x38_t *dev = (cmi8x38_t *) priv;
 
+    cmi8x38_dma_sync(dev);
+
     /* Reset PCI configuration registers. */
     memset(dev->pci_regs, 0, sizeof(dev->pci_regs));
     dev->pci_regs[0x00] = 0xf6;
@@ -40,6 +40,14 @@
 #define EMU8K_DEBUG_REGISTERS
 #endif
 
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    define EMU8K_SSE2
+#    include <emmintrin.h>
+#elif defined __ARM_NEON || defined _M_ARM64
+#    define EMU8K_NEON
+#    include <arm_neon.h>
+#endif
+
 char *PORT_NAMES[][8] = {
     /* Data 0 ( 0x620/0x622) */
     {
@@ -1750,361 +1758,499 @@ emu8k_vol_slide(emu8k_slide_t *slide, int32_t target)
     return slide->last;
 }
 
-#if 0
-int32_t old_pitch[32] = { 0 };
-int32_t old_cut[32]   = { 0 };
-int32_t old_vol[32]   = { 0 };
-#endif
-void
-emu8k_update(emu8k_t *emu8k)
+/* Runs the cubic interpolator for a run of samples of one voice. The SIMD
+ * version evaluates four samples at once with the same operations, in the
+ * same order, as EMU8K_READ_INTERP_CUBIC, so the results are identical. */
+static void
+emu8k_voice_interp(emu8k_t *emu8k, const uint32_t *int_addr, const uint16_t *fract, int32_t *out, int count)
 {
-    if (emu8k->pos >= wavetable_pos_global)
-        return;
-
-    int32_t       *buf;
-    emu8k_voice_t *emu_voice;
-    int            pos;
-
-    /* Clean the buffers since we will accumulate into them. */
-    buf = &emu8k->buffer[emu8k->pos * 2];
-    memset(buf, 0, 2 * (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->buffer[0]));
-    memset(&emu8k->chorus_in_buffer[emu8k->pos], 0, (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->chorus_in_buffer[0]));
-    memset(&emu8k->reverb_in_buffer[emu8k->pos], 0, (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->reverb_in_buffer[0]));
-
-    /* Voices section  */
-    for (uint8_t c = 0; c < 32; c++) {
-        emu_voice = &emu8k->voice[c];
-        buf       = &emu8k->buffer[emu8k->pos * 2];
-
-        for (pos = emu8k->pos; pos < wavetable_pos_global; pos++) {
-            int32_t dat;
-
-            if (emu_voice->cvcf_curr_volume) {
-                /* Waveform oscillator */
+    int i = 0;
+
+#if defined RESAMPLER_CUBIC && defined EMU8K_SSE2
+    for (; i <= (count - 4); i += 4) {
+        const float *t0 = &cubic_table[(fract[i + 0] >> (16 - CUBIC_RESOLUTION_LOG)) << 2];
+        const float *t1 = &cubic_table[(fract[i + 1] >> (16 - CUBIC_RESOLUTION_LOG)) << 2];
+        const float *t2 = &cubic_table[(fract[i + 2] >> (16 - CUBIC_RESOLUTION_LOG)) << 2];
+        const float *t3 = &cubic_table[(fract[i + 3] >> (16 - CUBIC_RESOLUTION_LOG)) << 2];
+        __m128       c0 = _mm_loadu_ps(t0);
+        __m128       c1 = _mm_loadu_ps(t1);
+        __m128       c2 = _mm_loadu_ps(t2);
+        __m128       c3 = _mm_loadu_ps(t3);
+        __m128       acc;
+
+        /* Turn the four table rows into one vector per tap. */
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+#    define EMU8K_TAP(n) _mm_cvtepi32_ps(_mm_setr_epi32(EMU8K_READ(emu8k, int_addr[i + 0] + n), \
+                                                        EMU8K_READ(emu8k, int_addr[i + 1] + n), \
+                                                        EMU8K_READ(emu8k, int_addr[i + 2] + n), \
+                                                        EMU8K_READ(emu8k, int_addr[i + 3] + n)))
+        acc = _mm_mul_ps(EMU8K_TAP(0), c0);
+        acc = _mm_add_ps(acc, _mm_mul_ps(EMU8K_TAP(1), c1));
+        acc = _mm_add_ps(acc, _mm_mul_ps(EMU8K_TAP(2), c2));
+        acc = _mm_add_ps(acc, _mm_mul_ps(EMU8K_TAP(3), c3));
+#    undef EMU8K_TAP
+
+        _mm_storeu_si128((__m128i *) &out[i], _mm_cvttps_epi32(acc));
+    }
+#endif
+    for (; i < count; i++) {
 #ifdef RESAMPLER_LINEAR
-                dat = EMU8K_READ_INTERP_LINEAR(emu8k, emu_voice->addr.int_address,
-                                               emu_voice->addr.fract_address);
-
+        out[i] = EMU8K_READ_INTERP_LINEAR(emu8k, int_addr[i], fract[i]);
 #elif defined RESAMPLER_CUBIC
-                dat = EMU8K_READ_INTERP_CUBIC(emu8k, emu_voice->addr.int_address,
-                                              emu_voice->addr.fract_address);
+        out[i] = EMU8K_READ_INTERP_CUBIC(emu8k, int_addr[i], fract[i]);
 #endif
+    }
+}
 
-                /* Filter section */
-                if (emu_voice->filterq_idx || emu_voice->cvcf_curr_filt_ctoff != 0xFFFF) {
-                    int           cutoff = emu_voice->cvcf_curr_filt_ctoff >> 8;
-                    const int64_t coef0  = filt_coeffs[emu_voice->filterq_idx][cutoff][0];
-                    const int64_t coef1  = filt_coeffs[emu_voice->filterq_idx][cutoff][1];
-                    const int64_t coef2  = filt_coeffs[emu_voice->filterq_idx][cutoff][2];
+static inline int32_t
+emu8k_voice_filter(emu8k_voice_t *emu_voice, int32_t dat, int cutoff)
+{
+    const int64_t coef0 = filt_coeffs[emu_voice->filterq_idx][cutoff][0];
+    const int64_t coef1 = filt_coeffs[emu_voice->filterq_idx][cutoff][1];
+    const int64_t coef2 = filt_coeffs[emu_voice->filterq_idx][cutoff][2];
 /* clip at twice the range */
 #define ClipBuffer(buf) (buf < -16777216) ? -16777216 : (buf > 16777216) ? 16777216 \
                                                                          : buf
 
 #ifdef FILTER_INITIAL
 #    define NOOP(x) (void) x;
-                    NOOP(coef1)
-                    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one doesn't).
-                     * Work in 24bits. */
-                    dat = (dat * emu_voice->filt_att) >> 8;
-
-                    int64_t vhp = ((-emu_voice->filt_buffer[0] * coef2) >> 24) - emu_voice->filt_buffer[1] - dat;
-                    emu_voice->filt_buffer[1] += (emu_voice->filt_buffer[0] * coef0) >> 24;
-                    emu_voice->filt_buffer[0] += (vhp * coef0) >> 24;
-                    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
-                    if (dat > 32767) {
-                        dat = 32767;
-                    } else if (dat < -32768) {
-                        dat = -32768;
-                    }
+    NOOP(coef1)
+    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one doesn't).
+     * Work in 24bits. */
+    dat = (dat * emu_voice->filt_att) >> 8;
+
+    int64_t vhp = ((-emu_voice->filt_buffer[0] * coef2) >> 24) - emu_voice->filt_buffer[1] - dat;
+    emu_voice->filt_buffer[1] += (emu_voice->filt_buffer[0] * coef0) >> 24;
+    emu_voice->filt_buffer[0] += (vhp * coef0) >> 24;
+    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
+    if (dat > 32767) {
+        dat = 32767;
+    } else if (dat < -32768) {
+        dat = -32768;
+    }
 
 #elif defined FILTER_MOOG
 
-                    /*move to 24bits*/
-                    dat <<= 8;
+    /*move to 24bits*/
+    dat <<= 8;
 
-                    dat -= (coef2 * emu_voice->filt_buffer[4]) >> 24; /*feedback*/
-                    int64_t t1 = emu_voice->filt_buffer[1];
-                    emu_voice->filt_buffer[1] = ((dat + emu_voice->filt_buffer[0]) * coef0 - emu_voice->filt_buffer[1] * coef1) >> 24;
-                    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
+    dat -= (coef2 * emu_voice->filt_buffer[4]) >> 24; /*feedback*/
+    int64_t t1 = emu_voice->filt_buffer[1];
+    emu_voice->filt_buffer[1] = ((dat + emu_voice->filt_buffer[0]) * coef0 - emu_voice->filt_buffer[1] * coef1) >> 24;
+    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
 
-                    int64_t t2 = emu_voice->filt_buffer[2];
-                    emu_voice->filt_buffer[2] = ((emu_voice->filt_buffer[1] + t1) * coef0 - emu_voice->filt_buffer[2] * coef1) >> 24;
-                    emu_voice->filt_buffer[2] = ClipBuffer(emu_voice->filt_buffer[2]);
+    int64_t t2 = emu_voice->filt_buffer[2];
+    emu_voice->filt_buffer[2] = ((emu_voice->filt_buffer[1] + t1) * coef0 - emu_voice->filt_buffer[2] * coef1) >> 24;
+    emu_voice->filt_buffer[2] = ClipBuffer(emu_voice->filt_buffer[2]);
 
-                    int64_t t3 = emu_voice->filt_buffer[3];
-                    emu_voice->filt_buffer[3] = ((emu_voice->filt_buffer[2] + t2) * coef0 - emu_voice->filt_buffer[3] * coef1) >> 24;
-                    emu_voice->filt_buffer[3] = ClipBuffer(emu_voice->filt_buffer[3]);
+    int64_t t3 = emu_voice->filt_buffer[3];
+    emu_voice->filt_buffer[3] = ((emu_voice->filt_buffer[2] + t2) * coef0 - emu_voice->filt_buffer[3] * coef1) >> 24;
+    emu_voice->filt_buffer[3] = ClipBuffer(emu_voice->filt_buffer[3]);
 
-                    emu_voice->filt_buffer[4] = ((emu_voice->filt_buffer[3] + t3) * coef0 - emu_voice->filt_buffer[4] * coef1) >> 24;
-                    emu_voice->filt_buffer[4] = ClipBuffer(emu_voice->filt_buffer[4]);
+    emu_voice->filt_buffer[4] = ((emu_voice->filt_buffer[3] + t3) * coef0 - emu_voice->filt_buffer[4] * coef1) >> 24;
+    emu_voice->filt_buffer[4] = ClipBuffer(emu_voice->filt_buffer[4]);
 
-                    emu_voice->filt_buffer[0] = ClipBuffer(dat);
+    emu_voice->filt_buffer[0] = ClipBuffer(dat);
 
-                    dat = (int32_t) (emu_voice->filt_buffer[4] >> 8);
-                    if (dat > 32767) {
-                        dat = 32767;
-                    } else if (dat < -32768) {
-                        dat = -32768;
-                    }
+    dat = (int32_t) (emu_voice->filt_buffer[4] >> 8);
+    if (dat > 32767) {
+        dat = 32767;
+    } else if (dat < -32768) {
+        dat = -32768;
+    }
 
 #elif defined FILTER_CONSTANT
 
-                    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one is constant gain).
-                     * Also stay at 24bits.*/
-                    dat = (dat * emu_voice->filt_att) >> 8;
-
-                    emu_voice->filt_buffer[0] = (coef1 * emu_voice->filt_buffer[0]
-                                                 + coef0 * (dat + ((coef2 * (emu_voice->filt_buffer[0] - emu_voice->filt_buffer[1])) >> 24)))
-                        >> 24;
-                    emu_voice->filt_buffer[1] = (coef1 * emu_voice->filt_buffer[1]
-                                                 + coef0 * emu_voice->filt_buffer[0])
-                        >> 24;
-
-                    emu_voice->filt_buffer[0] = ClipBuffer(emu_voice->filt_buffer[0]);
-                    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
-
-                    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
-                    if (dat > 32767) {
-                        dat = 32767;
-                    } else if (dat < -32768) {
-                        dat = -32768;
-                    }
+    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one is constant gain).
+     * Also stay at 24bits.*/
+    dat = (dat * emu_voice->filt_att) >> 8;
+
+    emu_voice->filt_buffer[0] = (coef1 * emu_voice->filt_buffer[0]
+                                 + coef0 * (dat + ((coef2 * (emu_voice->filt_buffer[0] - emu_voice->filt_buffer[1])) >> 24)))
+        >> 24;
+    emu_voice->filt_buffer[1] = (coef1 * emu_voice->filt_buffer[1]
+                                 + coef0 * emu_voice->filt_buffer[0])
+        >> 24;
+
+    emu_voice->filt_buffer[0] = ClipBuffer(emu_voice->filt_buffer[0]);
+    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
+
+    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
+    if (dat > 32767) {
+        dat = 32767;
+    } else if (dat < -32768) {
+        dat = -32768;
+    }
 
 #endif
-                }
-                if ((emu8k->hwcf3 & 0x04) && !CCCA_DMA_ACTIVE(emu_voice->ccca)) {
-                    /*volume and pan*/
-                    dat = (dat * emu_voice->cvcf_curr_volume) >> 16;
 
-                    (*buf++) += (dat * emu_voice->vol_l) >> 8;
-                    (*buf++) += (dat * emu_voice->vol_r) >> 8;
+    return dat;
+}
 
-                    /* Effects section */
-                    if (emu_voice->ptrx_revb_send > 0) {
-                        emu8k->reverb_in_buffer[pos] += (dat * emu_voice->ptrx_revb_send) >> 8;
-                    }
-                    if (emu_voice->csl_chor_send > 0) {
-                        emu8k->chorus_in_buffer[pos] += (dat * emu_voice->csl_chor_send) >> 8;
-                    }
-                }
-            }
+#ifdef EMU8K_SSE2
+/* SSE2 has no 32 bit multiply, so build the low halves from two 32x32->64
+ * multiplies. The low 32 bits are the same for signed and unsigned. */
+static inline __m128i
+emu8k_mullo_epi32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
 
-            if (emu_voice->env_engine_on) {
-                int32_t attenuation  = emu_voice->initial_att;
-                int32_t filtercut    = emu_voice->initial_filter;
-                int32_t currentpitch = emu_voice->ip;
-                /* run envelopes */
-                emu8k_envelope_t *volenv = &emu_voice->vol_envelope;
-                switch (volenv->state) {
-                    case ENV_DELAY:
-                        volenv->delay_samples--;
-                        if (volenv->delay_samples <= 0) {
-                            volenv->state         = ENV_ATTACK;
-                            volenv->delay_samples = 0;
-                        }
-                        attenuation = 0x1FFFFF;
-                        break;
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
 
-                    case ENV_ATTACK:
-                        /* Attack amount is in linear amplitude */
-                        volenv->value_amp_hz += volenv->attack_amount_amp_hz;
-                        if (volenv->value_amp_hz >= (1 << 21)) {
-                            volenv->value_amp_hz = 1 << 21;
-                            volenv->value_db_oct = 0;
-                            if (volenv->hold_samples) {
-                                volenv->state = ENV_HOLD;
-                            } else {
-                                /* RAMP_UP since db value is inverted and it is 0 at this point. */
+/* Applies volume and pan to a run of samples of one voice and accumulates
+ * them into the output and effect send buffers. Samples with a zero volume
+ * contribute nothing, as in the per sample path. */
+static void
+emu8k_voice_mix(emu8k_t *emu8k, const emu8k_voice_t *emu_voice, int32_t *dat, const int32_t *vol, int pos, int count)
+{
+    int32_t *buf = &emu8k->buffer[pos * 2];
+    int      i   = 0;
+
+#if defined EMU8K_SSE2
+    const __m128i vol_l = _mm_set1_epi32(emu_voice->vol_l);
+    const __m128i vol_r = _mm_set1_epi32(emu_voice->vol_r);
+
+    for (; i <= (count - 4); i += 4) {
+        __m128i d = _mm_srai_epi32(emu8k_mullo_epi32(_mm_loadu_si128((__m128i *) &dat[i]),
+                                                     _mm_loadu_si128((__m128i *) &vol[i])), 16);
+        __m128i l = _mm_srai_epi32(emu8k_mullo_epi32(d, vol_l), 8);
+        __m128i r = _mm_srai_epi32(emu8k_mullo_epi32(d, vol_r), 8);
+        __m128i o = _mm_loadu_si128((__m128i *) &buf[i * 2]);
+
+        _mm_storeu_si128((__m128i *) &buf[i * 2], _mm_add_epi32(o, _mm_unpacklo_epi32(l, r)));
+        o = _mm_loadu_si128((__m128i *) &buf[(i * 2) + 4]);
+        _mm_storeu_si128((__m128i *) &buf[(i * 2) + 4], _mm_add_epi32(o, _mm_unpackhi_epi32(l, r)));
+        _mm_storeu_si128((__m128i *) &dat[i], d);
+    }
+#elif defined EMU8K_NEON
+    const int32x4_t vol_l = vdupq_n_s32(emu_voice->vol_l);
+    const int32x4_t vol_r = vdupq_n_s32(emu_voice->vol_r);
+
+    for (; i <= (count - 4); i += 4) {
+        int32x4_t   d = vshrq_n_s32(vmulq_s32(vld1q_s32(&dat[i]), vld1q_s32(&vol[i])), 16);
+        int32x4x2_t o = vld2q_s32(&buf[i * 2]);
+
+        o.val[0] = vaddq_s32(o.val[0], vshrq_n_s32(vmulq_s32(d, vol_l), 8));
+        o.val[1] = vaddq_s32(o.val[1], vshrq_n_s32(vmulq_s32(d, vol_r), 8));
+        vst2q_s32(&buf[i * 2], o);
+        vst1q_s32(&dat[i], d);
+    }
+#endif
+    for (; i < count; i++) {
+        dat[i] = (dat[i] * vol[i]) >> 16;
+
+        buf[i * 2] += (dat[i] * emu_voice->vol_l) >> 8;
+        buf[(i * 2) + 1] += (dat[i] * emu_voice->vol_r) >> 8;
+    }
+
+    /* Effects section */
+    if (emu_voice->ptrx_revb_send > 0) {
+        for (i = 0; i < count; i++)
+            emu8k->reverb_in_buffer[pos + i] += (dat[i] * emu_voice->ptrx_revb_send) >> 8;
+    }
+    if (emu_voice->csl_chor_send > 0) {
+        for (i = 0; i < count; i++)
+            emu8k->chorus_in_buffer[pos + i] += (dat[i] * emu_voice->csl_chor_send) >> 8;
+    }
+}
+
+#if 0
+int32_t old_pitch[32] = { 0 };
+int32_t old_cut[32]   = { 0 };
+int32_t old_vol[32]   = { 0 };
+#endif
+void
+emu8k_update(emu8k_t *emu8k)
+{
+    if (emu8k->pos >= wavetable_pos_global)
+        return;
+
+    int32_t             *buf;
+    emu8k_voice_t       *emu_voice;
+    emu8k_voice_block_t *blk;
+    uint8_t              active[32];
+    int                  num_active;
+    int                  pos;
+    int                  count;
+
+    /* Clean the buffers since we will accumulate into them. */
+    buf = &emu8k->buffer[emu8k->pos * 2];
+    memset(buf, 0, 2 * (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->buffer[0]));
+    memset(&emu8k->chorus_in_buffer[emu8k->pos], 0, (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->chorus_in_buffer[0]));
+    memset(&emu8k->reverb_in_buffer[emu8k->pos], 0, (wavetable_pos_global - emu8k->pos) * sizeof(emu8k->reverb_in_buffer[0]));
+
+    /* Voices section  */
+    for (pos = emu8k->pos; pos < wavetable_pos_global; pos += count) {
+        count      = MIN(wavetable_pos_global - pos, EMU8K_VOICE_BLOCK);
+        num_active = 0;
+
+        /* Run the envelopes, LFOs and oscillator of each voice first, keeping
+         * the state each sample is rendered with. */
+        for (uint8_t c = 0; c < 32; c++) {
+            int audible = 0;
+
+            emu_voice = &emu8k->voice[c];
+            blk       = &emu8k->voice_block[c];
+
+            for (int i = 0; i < count; i++) {
+                blk->addr[i]  = emu_voice->addr.int_address;
+                blk->fract[i] = emu_voice->addr.fract_address;
+                blk->vol[i]   = emu_voice->cvcf_curr_volume;
+                blk->cut[i]   = emu_voice->cvcf_curr_filt_ctoff;
+                audible |= blk->vol[i];
+
+                if (emu_voice->env_engine_on) {
+                    int32_t attenuation  = emu_voice->initial_att;
+                    int32_t filtercut    = emu_voice->initial_filter;
+                    int32_t currentpitch = emu_voice->ip;
+                    /* run envelopes */
+                    emu8k_envelope_t *volenv = &emu_voice->vol_envelope;
+                    switch (volenv->state) {
+                        case ENV_DELAY:
+                            volenv->delay_samples--;
+                            if (volenv->delay_samples <= 0) {
+                                volenv->state         = ENV_ATTACK;
+                                volenv->delay_samples = 0;
+                            }
+                            attenuation = 0x1FFFFF;
+                            break;
+
+                        case ENV_ATTACK:
+                            /* Attack amount is in linear amplitude */
+                            volenv->value_amp_hz += volenv->attack_amount_amp_hz;
+                            if (volenv->value_amp_hz >= (1 << 21)) {
+                                volenv->value_amp_hz = 1 << 21;
+                                volenv->value_db_oct = 0;
+                                if (volenv->hold_samples) {
+                                    volenv->state = ENV_HOLD;
+                                } else {
+                                    /* RAMP_UP since db value is inverted and it is 0 at this point. */
+                                    volenv->state = ENV_RAMP_UP;
+                                }
+                            }
+                            attenuation += env_vol_amplitude_to_db[volenv->value_amp_hz >> 5] << 5;
+                            break;
+
+                        case ENV_HOLD:
+                            volenv->hold_samples--;
+                            if (volenv->hold_samples <= 0) {
                                 volenv->state = ENV_RAMP_UP;
                             }
-                        }
-                        attenuation += env_vol_amplitude_to_db[volenv->value_amp_hz >> 5] << 5;
-                        break;
+                            attenuation += volenv->value_db_oct;
+                            break;
 
-                    case ENV_HOLD:
-                        volenv->hold_samples--;
-                        if (volenv->hold_samples <= 0) {
-                            volenv->state = ENV_RAMP_UP;
-                        }
-                        attenuation += volenv->value_db_oct;
-                        break;
+                        case ENV_RAMP_DOWN:
+                            /* Decay/release amount is in fraction of dBs and is always positive */
+                            volenv->value_db_oct -= volenv->ramp_amount_db_oct;
+                            if (volenv->value_db_oct <= volenv->sustain_value_db_oct) {
+                                volenv->value_db_oct = volenv->sustain_value_db_oct;
+                                volenv->state        = ENV_SUSTAIN;
+                            }
+                            attenuation += volenv->value_db_oct;
+                            break;
 
-                    case ENV_RAMP_DOWN:
-                        /* Decay/release amount is in fraction of dBs and is always positive */
-                        volenv->value_db_oct -= volenv->ramp_amount_db_oct;
-                        if (volenv->value_db_oct <= volenv->sustain_value_db_oct) {
-                            volenv->value_db_oct = volenv->sustain_value_db_oct;
-                            volenv->state        = ENV_SUSTAIN;
-                        }
-                        attenuation += volenv->value_db_oct;
-                        break;
+                        case ENV_RAMP_UP:
+                            /* Decay/release amount is in fraction of dBs and is always positive */
+                            volenv->value_db_oct += volenv->ramp_amount_db_oct;
+                            if (volenv->value_db_oct >= volenv->sustain_value_db_oct) {
+                                volenv->value_db_oct = volenv->sustain_value_db_oct;
+                                volenv->state        = ENV_SUSTAIN;
+                            }
+                            attenuation += volenv->value_db_oct;
+                            break;
 
-                    case ENV_RAMP_UP:
-                        /* Decay/release amount is in fraction of dBs and is always positive */
-                        volenv->value_db_oct += volenv->ramp_amount_db_oct;
-                        if (volenv->value_db_oct >= volenv->sustain_value_db_oct) {
-                            volenv->value_db_oct = volenv->sustain_value_db_oct;
-                            volenv->state        = ENV_SUSTAIN;
-                        }
-                        attenuation += volenv->value_db_oct;
-                        break;
+                        case ENV_SUSTAIN:
+                            attenuation += volenv->value_db_oct;
+                            break;
 
-                    case ENV_SUSTAIN:
-                        attenuation += volenv->value_db_oct;
-                        break;
+                        case ENV_STOPPED:
+                            attenuation = 0x1FFFFF;
+                            break;
 
-                    case ENV_STOPPED:
-                        attenuation = 0x1FFFFF;
-                        break;
+                        default:
+                            break;
+                    }
 
-                    default:
-                        break;
-                }
+                    emu8k_envelope_t *modenv = &emu_voice->mod_envelope;
+                    switch (modenv->state) {
+                        case ENV_DELAY:
+                            modenv->delay_samples--;
+                            if (modenv->delay_samples <= 0) {
+                                modenv->state         = ENV_ATTACK;
+                                modenv->delay_samples = 0;
+                            }
+                            break;
 
-                emu8k_envelope_t *modenv = &emu_voice->mod_envelope;
-                switch (modenv->state) {
-                    case ENV_DELAY:
-                        modenv->delay_samples--;
-                        if (modenv->delay_samples <= 0) {
-                            modenv->state         = ENV_ATTACK;
-                            modenv->delay_samples = 0;
-                        }
-                        break;
+                        case ENV_ATTACK:
+                            /* Attack amount is in linear amplitude */
+                            modenv->value_amp_hz += modenv->attack_amount_amp_hz;
+                            modenv->value_db_oct = env_mod_hertz_to_octave[modenv->value_amp_hz >> 5] << 5;
+                            if (modenv->value_amp_hz >= (1 << 21)) {
+                                modenv->value_amp_hz = 1 << 21;
+                                modenv->value_db_oct = 1 << 21;
+                                if (modenv->hold_samples) {
+                                    modenv->state = ENV_HOLD;
+                                } else {
+                                    modenv->state = ENV_RAMP_DOWN;
+                                }
+                            }
+                            break;
 
-                    case ENV_ATTACK:
-                        /* Attack amount is in linear amplitude */
-                        modenv->value_amp_hz += modenv->attack_amount_amp_hz;
-                        modenv->value_db_oct = env_mod_hertz_to_octave[modenv->value_amp_hz >> 5] << 5;
-                        if (modenv->value_amp_hz >= (1 << 21)) {
-                            modenv->value_amp_hz = 1 << 21;
-                            modenv->value_db_oct = 1 << 21;
-                            if (modenv->hold_samples) {
-                                modenv->state = ENV_HOLD;
-                            } else {
-                                modenv->state = ENV_RAMP_DOWN;
+                        case ENV_HOLD:
+                            modenv->hold_samples--;
+                            if (modenv->hold_samples <= 0) {
+                                modenv->state = ENV_RAMP_UP;
                             }
-                        }
-                        break;
+                            break;
 
-                    case ENV_HOLD:
-                        modenv->hold_samples--;
-                        if (modenv->hold_samples <= 0) {
-                            modenv->state = ENV_RAMP_UP;
-                        }
-                        break;
+                        case ENV_RAMP_DOWN:
+                            /* Decay/release amount is in fraction of octave and is always positive */
+                            modenv->value_db_oct -= modenv->ramp_amount_db_oct;
+                            if (modenv->value_db_oct <= modenv->sustain_value_db_oct) {
+                                modenv->value_db_oct = modenv->sustain_value_db_oct;
+                                modenv->state        = ENV_SUSTAIN;
+                            }
+                            break;
 
-                    case ENV_RAMP_DOWN:
-                        /* Decay/release amount is in fraction of octave and is always positive */
-                        modenv->value_db_oct -= modenv->ramp_amount_db_oct;
-                        if (modenv->value_db_oct <= modenv->sustain_value_db_oct) {
-                            modenv->value_db_oct = modenv->sustain_value_db_oct;
-                            modenv->state        = ENV_SUSTAIN;
-                        }
-                        break;
+                        case ENV_RAMP_UP:
+                            /* Decay/release amount is in fraction of octave and is always positive */
+                            modenv->value_db_oct += modenv->ramp_amount_db_oct;
+                            if (modenv->value_db_oct >= modenv->sustain_value_db_oct) {
+                                modenv->value_db_oct = modenv->sustain_value_db_oct;
+                                modenv->state        = ENV_SUSTAIN;
+                            }
+                            break;
 
-                    case ENV_RAMP_UP:
-                        /* Decay/release amount is in fraction of octave and is always positive */
-                        modenv->value_db_oct += modenv->ramp_amount_db_oct;
-                        if (modenv->value_db_oct >= modenv->sustain_value_db_oct) {
-                            modenv->value_db_oct = modenv->sustain_value_db_oct;
-                            modenv->state        = ENV_SUSTAIN;
-                        }
-                        break;
+                        default:
+                            break;
+                    }
 
-                    default:
-                        break;
-                }
+                    /* run lfos */
+                    if (emu_voice->lfo1_delay_samples) {
+                        emu_voice->lfo1_delay_samples--;
+                    } else {
+                        emu_voice->lfo1_count.addr += emu_voice->lfo1_speed;
+                        emu_voice->lfo1_count.int_address &= 0xFFFF;
+                    }
+                    if (emu_voice->lfo2_delay_samples) {
+                        emu_voice->lfo2_delay_samples--;
+                    } else {
+                        emu_voice->lfo2_count.addr += emu_voice->lfo2_speed;
+                        emu_voice->lfo2_count.int_address &= 0xFFFF;
+                    }
 
-                /* run lfos */
-                if (emu_voice->lfo1_delay_samples) {
-                    emu_voice->lfo1_delay_samples--;
-                } else {
-                    emu_voice->lfo1_count.addr += emu_voice->lfo1_speed;
-                    emu_voice->lfo1_count.int_address &= 0xFFFF;
-                }
-                if (emu_voice->lfo2_delay_samples) {
-                    emu_voice->lfo2_delay_samples--;
-                } else {
-                    emu_voice->lfo2_count.addr += emu_voice->lfo2_speed;
-                    emu_voice->lfo2_count.int_address &= 0xFFFF;
-                }
+                    if (emu_voice->fixed_modenv_pitch_height) {
+                        /* modenv range 1<<21, pitch height range 1<<14 desired range 0x1000 (+/-one octave) */
+                        currentpitch += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_pitch_height) >> 14;
+                    }
 
-                if (emu_voice->fixed_modenv_pitch_height) {
-                    /* modenv range 1<<21, pitch height range 1<<14 desired range 0x1000 (+/-one octave) */
-                    currentpitch += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_pitch_height) >> 14;
-                }
+                    if (emu_voice->fixed_lfo1_vibrato) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
+                        int32_t lfo1_vibrato = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_vibrato) >> 17;
+                        currentpitch += lfo1_vibrato;
+                    }
+                    if (emu_voice->fixed_lfo2_vibrato) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
+                        int32_t lfo2_vibrato = (lfotable[emu_voice->lfo2_count.int_address] * emu_voice->fixed_lfo2_vibrato) >> 17;
+                        currentpitch += lfo2_vibrato;
+                    }
 
-                if (emu_voice->fixed_lfo1_vibrato) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
-                    int32_t lfo1_vibrato = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_vibrato) >> 17;
-                    currentpitch += lfo1_vibrato;
-                }
-                if (emu_voice->fixed_lfo2_vibrato) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
-                    int32_t lfo2_vibrato = (lfotable[emu_voice->lfo2_count.int_address] * emu_voice->fixed_lfo2_vibrato) >> 17;
-                    currentpitch += lfo2_vibrato;
-                }
+                    if (emu_voice->fixed_modenv_filter_height) {
+                        /* modenv range 1<<21, pitch height range 1<<14 desired range 0x200000 (+/-full filter range) */
+                        filtercut += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_filter_height) >> 5;
+                    }
 
-                if (emu_voice->fixed_modenv_filter_height) {
-                    /* modenv range 1<<21, pitch height range 1<<14 desired range 0x200000 (+/-full filter range) */
-                    filtercut += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_filter_height) >> 5;
-                }
+                    if (emu_voice->fixed_lfo1_filt_mod) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x100000 (+/-three octaves) */
+                        int32_t lfo1_filtmod = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_filt_mod) >> 9;
+                        filtercut += lfo1_filtmod;
+                    }
 
-                if (emu_voice->fixed_lfo1_filt_mod) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x100000 (+/-three octaves) */
-                    int32_t lfo1_filtmod = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_filt_mod) >> 9;
-                    filtercut += lfo1_filtmod;
-                }
+                    if (emu_voice->fixed_lfo1_tremolo) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x40000 (+/-12dBs). */
+                        int32_t lfo1_tremolo = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_tremolo) >> 11;
+                        attenuation += lfo1_tremolo;
+                    }
 
-                if (emu_voice->fixed_lfo1_tremolo) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x40000 (+/-12dBs). */
-                    int32_t lfo1_tremolo = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_tremolo) >> 11;
-                    attenuation += lfo1_tremolo;
+                    if (currentpitch > 0xFFFF)
+                        currentpitch = 0xFFFF;
+                    if (currentpitch < 0)
+                        currentpitch = 0;
+                    if (attenuation > 0x1FFFFF)
+                        attenuation = 0x1FFFFF;
+                    if (attenuation < 0)
+                        attenuation = 0;
+                    if (filtercut > 0x1FFFFF)
+                        filtercut = 0x1FFFFF;
+                    if (filtercut < 0)
+                        filtercut = 0;
+
+                    emu_voice->vtft_vol_target    = env_vol_db_to_vol_target[attenuation >> 5];
+                    emu_voice->vtft_filter_target = filtercut >> 5;
+                    emu_voice->ptrx_pit_target    = freqtable[currentpitch] >> 18;
+                }
+                /*
+                I've recopilated these sentences to get an idea of how to loop
+
+                - Set its PSST register and its CLS register to zero to cause no loops to occur.
+                -Setting the Loop Start Offset and the Loop End Offset to the same value, will cause the oscillator to loop the entire memory.
+
+                -Setting the PlayPosition greater than the Loop End Offset, will cause the oscillator to play in reverse, back to the Loop End Offset.
+                   It's pretty neat, but appears to be uncontrollable (the rate at which the samples are played in reverse).
+
+                -Note that due to interpolator offset, the actual loop point is one greater than the start address
+                -Note that due to interpolator offset, the actual loop point will end at an address one greater than the loop address
+                -Note that the actual audio location is the point 1 word higher than this value due to interpolation offset
+                -In programs that use the awe, they generally set the loop address as "loopaddress -1" to compensate for the above.
+                (Note: I am already using address+1 in the interpolators so these things are already as they should.)
+                */
+                emu_voice->addr.addr += ((uint64_t) emu_voice->cpf_curr_pitch) << 18;
+                if (emu_voice->addr.addr >= emu_voice->loop_end.addr) {
+                    emu_voice->addr.int_address -= (emu_voice->loop_end.int_address - emu_voice->loop_start.int_address);
+                    emu_voice->addr.int_address &= EMU8K_MEM_ADDRESS_MASK;
                 }
 
-                if (currentpitch > 0xFFFF)
-                    currentpitch = 0xFFFF;
-                if (currentpitch < 0)
-                    currentpitch = 0;
-                if (attenuation > 0x1FFFFF)
-                    attenuation = 0x1FFFFF;
-                if (attenuation < 0)
-                    attenuation = 0;
-                if (filtercut > 0x1FFFFF)
-                    filtercut = 0x1FFFFF;
-                if (filtercut < 0)
-                    filtercut = 0;
-
-                emu_voice->vtft_vol_target    = env_vol_db_to_vol_target[attenuation >> 5];
-                emu_voice->vtft_filter_target = filtercut >> 5;
-                emu_voice->ptrx_pit_target    = freqtable[currentpitch] >> 18;
+                /* TODO: How and when are the target and current values updated */
+                emu_voice->cpf_curr_pitch       = emu_voice->ptrx_pit_target;
+                emu_voice->cvcf_curr_volume     = emu8k_vol_slide(&emu_voice->volumeslide, emu_voice->vtft_vol_target);
+                emu_voice->cvcf_curr_filt_ctoff = emu_voice->vtft_filter_target;
             }
-            /*
-            I've recopilated these sentences to get an idea of how to loop
-
-            - Set its PSST register and its CLS register to zero to cause no loops to occur.
-            -Setting the Loop Start Offset and the Loop End Offset to the same value, will cause the oscillator to loop the entire memory.
-
-            -Setting the PlayPosition greater than the Loop End Offset, will cause the oscillator to play in reverse, back to the Loop End Offset.
-               It's pretty neat, but appears to be uncontrollable (the rate at which the samples are played in reverse).
-
-            -Note that due to interpolator offset, the actual loop point is one greater than the start address
-            -Note that due to interpolator offset, the actual loop point will end at an address one greater than the loop address
-            -Note that the actual audio location is the point 1 word higher than this value due to interpolation offset
-            -In programs that use the awe, they generally set the loop address as "loopaddress -1" to compensate for the above.
-            (Note: I am already using address+1 in the interpolators so these things are already as they should.)
-            */
-            emu_voice->addr.addr += ((uint64_t) emu_voice->cpf_curr_pitch) << 18;
-            if (emu_voice->addr.addr >= emu_voice->loop_end.addr) {
-                emu_voice->addr.int_address -= (emu_voice->loop_end.int_address - emu_voice->loop_start.int_address);
-                emu_voice->addr.int_address &= EMU8K_MEM_ADDRESS_MASK;
+
+            if (audible) {
+                /* Waveform oscillator */
+                emu8k_voice_interp(emu8k, blk->addr, blk->fract, blk->dat, count);
+                active[num_active++] = c;
             }
+        }
+
+        /* Filter section. Each filter depends on its previous sample, so step all
+         * voices through a sample at a time to keep the CPU busy with several
+         * independent filters instead of waiting on one. */
+        for (int i = 0; i < count; i++) {
+            for (int v = 0; v < num_active; v++) {
+                emu_voice = &emu8k->voice[active[v]];
+                blk       = &emu8k->voice_block[active[v]];
+
+                if (blk->vol[i] && (emu_voice->filterq_idx || blk->cut[i] != 0xFFFF))
+                    blk->dat[i] = emu8k_voice_filter(emu_voice, blk->dat[i], blk->cut[i] >> 8);
+            }
+        }
 
-            /* TODO: How and when are the target and current values updated */
-            emu_voice->cpf_curr_pitch       = emu_voice->ptrx_pit_target;
-            emu_voice->cvcf_curr_volume     = emu8k_vol_slide(&emu_voice->volumeslide, emu_voice->vtft_vol_target);
-            emu_voice->cvcf_curr_filt_ctoff = emu_voice->vtft_filter_target;
+        for (int v = 0; v < num_active; v++) {
+            emu_voice = &emu8k->voice[active[v]];
+
+            if ((emu8k->hwcf3 & 0x04) && !CCCA_DMA_ACTIVE(emu_voice->ccca))
+                emu8k_voice_mix(emu8k, emu_voice, emu8k->voice_block[active[v]].dat, emu8k->voice_block[active[v]].vol, pos, count);
         }
+    }
+
+    for (uint8_t c = 0; c < 32; c++) {
+        emu_voice = &emu8k->voice[c];
 
         /* Update EMU voice registers. */
         emu_voice->ccca               = (((uint32_t) emu_voice->ccca_qcontrol) << 24) | emu_voice->addr.int_address;
@@ -43,6 +43,9 @@ enum {
     GUS_TIMER_CTRL_AUTO = 0x01
 };
 
+/*Most samples rendered at once by the wave engine.*/
+#define GUS_WAVE_BLOCK 128
+
 enum {
     GUS_CLASSIC = 0,
     GUS_MAX     = 1,
@@ -94,6 +97,7 @@ typedef struct gus_t {
 
     pc_timer_t samp_timer;
     uint64_t   samp_latch;
+    uint64_t   samp_ahead;
 
     uint8_t *ram;
     uint32_t gus_end_ram;
@@ -248,6 +252,8 @@ gus_midi_update_int_status(gus_t *gus)
     gus_update_int_status(gus);
 }
 
+static void gus_wave_sync(gus_t *gus);
+
 void
 writegus(uint16_t addr, uint8_t val, void *priv)
 {
@@ -260,6 +266,8 @@ writegus(uint16_t addr, uint8_t val, void *priv)
     uint16_t csioport;
 #endif /*USE_GUSMAX */
 
+    gus_wave_sync(gus);
+
     if ((addr == 0x388) || (addr == 0x389))
         port = addr;
     else
@@ -709,10 +717,13 @@ writegus(uint16_t addr, uint8_t val, void *priv)
         default:
             break;
     }
+
+    /*The write may have changed when the next IRQ is due.*/
+    gus_wave_sync(gus);
 }
 
-uint8_t
-readgus(uint16_t addr, void *priv)
+static uint8_t
+gus_read(uint16_t addr, void *priv)
 {
     gus_t   *gus = (gus_t *) priv;
     uint8_t  val = 0xff;
@@ -955,6 +966,20 @@ readgus(uint16_t addr, void *priv)
     return val;
 }
 
+uint8_t
+readgus(uint16_t addr, void *priv)
+{
+    gus_t  *gus = (gus_t *) priv;
+    uint8_t val;
+
+    gus_wave_sync(gus);
+    val = gus_read(addr, priv);
+    /*Reading the IRQ status acknowledges wave and ramp IRQs.*/
+    gus_wave_sync(gus);
+
+    return val;
+}
+
 void
 gus_poll_timer_1(void *priv)
 {
@@ -1005,176 +1030,306 @@ gus_poll_timer_2(void *priv)
     gus_update_int_status(gus);
 }
 
+static void
+gus_output(gus_t *gus)
+{
+    if (gus->out_l < -32768)
+        gus->buffer[0][gus->pos] = -32768;
+    else if (gus->out_l > 32767)
+        gus->buffer[0][gus->pos] = 32767;
+    else
+        gus->buffer[0][gus->pos] = gus->out_l;
+    if (gus->out_r < -32768)
+        gus->buffer[1][gus->pos] = -32768;
+    else if (gus->out_r > 32767)
+        gus->buffer[1][gus->pos] = 32767;
+    else
+        gus->buffer[1][gus->pos] = gus->out_r;
+    gus->pos++;
+}
+
 static void
 gus_update(gus_t *gus)
 {
-    for (; gus->pos < sound_pos_global; gus->pos++) {
-        if (gus->out_l < -32768)
-            gus->buffer[0][gus->pos] = -32768;
-        else if (gus->out_l > 32767)
-            gus->buffer[0][gus->pos] = 32767;
-        else
-            gus->buffer[0][gus->pos] = gus->out_l;
-        if (gus->out_r < -32768)
-            gus->buffer[1][gus->pos] = -32768;
-        else if (gus->out_r > 32767)
-            gus->buffer[1][gus->pos] = 32767;
-        else
-            gus->buffer[1][gus->pos] = gus->out_r;
+    while (gus->pos < sound_pos_global)
+        gus_output(gus);
+}
+
+/*Returns how many samples can be rendered as one block, that is up to and
+  including the first sample that could raise a wave or volume ramp IRQ. The
+  voices only interact through the IRQ status, so everything before that
+  sample can be rendered one voice at a time. The crossing points are
+  computed from the current position and step; a voice that loops or stops
+  without an IRQ cannot raise one until its registers are written again.*/
+static int
+gus_wave_block_len(const gus_t *gus)
+{
+    int64_t next = GUS_WAVE_BLOCK - 1;
+    int64_t dist;
+
+    if ((gus->reset & 3) != 3)
+        return GUS_WAVE_BLOCK;
+
+    for (uint8_t d = 0; d < 32; d++) {
+        if (!(gus->ctrl[d] & 3) && (gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
+            int64_t step = gus->freq[d] >> 1;
+
+            if (gus->ctrl[d] & 0x40) {
+                if (gus->cur[d] <= gus->start[d])
+                    dist = 0;
+                else
+                    dist = step ? (((int64_t) gus->cur[d] - gus->start[d] + step - 1) / step - 1) : next;
+            } else {
+                if (gus->cur[d] >= gus->end[d])
+                    dist = 0;
+                else
+                    dist = step ? (((int64_t) gus->end[d] - gus->cur[d] + step - 1) / step - 1) : next;
+            }
+            if (dist < next)
+                next = dist;
+        }
+        if (!(gus->rctrl[d] & 3) && (gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
+            int64_t step = gus->rfreq[d];
+
+            if (gus->rctrl[d] & 0x40) {
+                if (gus->rcur[d] <= gus->rstart[d])
+                    dist = 0;
+                else
+                    dist = step ? (((int64_t) gus->rcur[d] - gus->rstart[d] + step - 1) / step - 1) : next;
+            } else {
+                if (gus->rcur[d] >= gus->rend[d])
+                    dist = 0;
+                else
+                    dist = step ? (((int64_t) gus->rend[d] - gus->rcur[d] + step - 1) / step - 1) : next;
+            }
+            if (dist < next)
+                next = dist;
+        }
     }
+
+    return (int) next + 1;
 }
 
-void
-gus_poll_wave(void *priv)
+/*Renders n samples of all voices into out_l/out_r. Returns non-zero if a
+  wave or volume ramp IRQ was raised, which can only happen on the last
+  sample of a block sized by gus_wave_block_len().*/
+static int
+gus_wave_render(gus_t *gus, int32_t *out_l, int32_t *out_r, int n)
 {
-    gus_t   *gus = (gus_t *) priv;
     uint32_t addr;
     int16_t  v;
     int32_t  vl;
     int      update_irqs = 0;
 
-    gus_update(gus);
-
-    timer_advance_u64(&gus->samp_timer, gus->samp_latch);
-
-    gus->out_l = gus->out_r = 0;
+    memset(out_l, 0, n * sizeof(int32_t));
+    memset(out_r, 0, n * sizeof(int32_t));
 
     if ((gus->reset & 3) != 3)
-        return;
+        return 0;
+
     for (uint8_t d = 0; d < 32; d++) {
-        if (!(gus->ctrl[d] & 3)) {
-            if (gus->ctrl[d] & 4) {
-                addr = gus->cur[d] >> 9;
-                addr = (addr & 0xC0000) | ((addr << 1) & 0x3FFFE);
-                if (!(gus->freq[d] >> 10)) {
-                    /* Interpolate */
-                    if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
-                        vl = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80) *
-                             (511 - (gus->cur[d] & 511));
+        if ((gus->ctrl[d] & 3) && (gus->rctrl[d] & 3))
+            continue;
+
+        for (int i = 0; i < n; i++) {
+            if (!(gus->ctrl[d] & 3)) {
+                if (gus->ctrl[d] & 4) {
+                    addr = gus->cur[d] >> 9;
+                    addr = (addr & 0xC0000) | ((addr << 1) & 0x3FFFE);
+                    if (!(gus->freq[d] >> 10)) {
+                        /* Interpolate */
+                        if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
+                            vl = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80) *
+                                 (511 - (gus->cur[d] & 511));
+                        else
+                            vl = 0;
+
+                        if (((addr + 3) & 0xfffff) < gus->gus_end_ram)
+                            vl += (int16_t) (int8_t) ((gus->ram[(addr + 3) & 0xfffff] ^ 0x80) - 0x80) *
+                                  (gus->cur[d] & 511);
+
+                        v = vl >> 9;
+                    } else if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
+                        v = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80);
                     else
-                        vl = 0;
-
-                    if (((addr + 3) & 0xfffff) < gus->gus_end_ram)
-                        vl += (int16_t) (int8_t) ((gus->ram[(addr + 3) & 0xfffff] ^ 0x80) - 0x80) *
-                              (gus->cur[d] & 511);
-
-                    v = vl >> 9;
-                } else if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
-                    v = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80);
-                else
-                    v = 0x0000;
-            } else {
-                if (!(gus->freq[d] >> 10)) {
-                    /* Interpolate */
-                    if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
-                        vl = ((int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80)) *
-                                       (511 - (gus->cur[d] & 511));
+                        v = 0x0000;
+                } else {
+                    if (!(gus->freq[d] >> 10)) {
+                        /* Interpolate */
+                        if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
+                            vl = ((int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80)) *
+                                           (511 - (gus->cur[d] & 511));
+                        else
+                            vl = 0;
+
+                        if ((((gus->cur[d] >> 9) + 1) & 0xfffff) < gus->gus_end_ram)
+                            vl += ((int8_t) ((gus->ram[((gus->cur[d] >> 9) + 1) & 0xfffff] ^ 0x80) - 0x80)) *
+                                  (gus->cur[d] & 511);
+
+                        v = vl >> 9;
+                    } else if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
+                        v = (int16_t) (int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80);
                     else
-                        vl = 0;
-
-                    if ((((gus->cur[d] >> 9) + 1) & 0xfffff) < gus->gus_end_ram)
-                        vl += ((int8_t) ((gus->ram[((gus->cur[d] >> 9) + 1) & 0xfffff] ^ 0x80) - 0x80)) *
-                              (gus->cur[d] & 511);
+                        v = 0x0000;
+                }
 
-                    v = vl >> 9;
-                } else if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
-                    v = (int16_t) (int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80);
+                if ((gus->rcur[d] >> 14) > 4095)
+                    v = (int16_t) (float) (v) *24.0 * vol16bit[4095];
                 else
-                    v = 0x0000;
-            }
-
-            if ((gus->rcur[d] >> 14) > 4095)
-                v = (int16_t) (float) (v) *24.0 * vol16bit[4095];
-            else
-                v = (int16_t) (float) (v) *24.0 * vol16bit[(gus->rcur[d] >> 10) & 4095];
-
-            gus->out_l += (v * gus->pan_l[d]) / 7;
-            gus->out_r += (v * gus->pan_r[d]) / 7;
+                    v = (int16_t) (float) (v) *24.0 * vol16bit[(gus->rcur[d] >> 10) & 4095];
+
+                out_l[i] += (v * gus->pan_l[d]) / 7;
+                out_r[i] += (v * gus->pan_r[d]) / 7;
+
+                if (gus->ctrl[d] & 0x40) {
+                    gus->cur[d] -= (gus->freq[d] >> 1);
+                    if (gus->cur[d] <= gus->start[d]) {
+                        int diff = gus->start[d] - gus->cur[d];
+
+                        if (gus->ctrl[d] & 8) {
+                            if (gus->ctrl[d] & 0x10)
+                                gus->ctrl[d] ^= 0x40;
+                            gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
+                        } else if (!(gus->rctrl[d] & 4)) {
+                            gus->ctrl[d] |= 1;
+                            gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                        }
 
-            if (gus->ctrl[d] & 0x40) {
-                gus->cur[d] -= (gus->freq[d] >> 1);
-                if (gus->cur[d] <= gus->start[d]) {
-                    int diff = gus->start[d] - gus->cur[d];
-
-                    if (gus->ctrl[d] & 8) {
-                        if (gus->ctrl[d] & 0x10)
-                            gus->ctrl[d] ^= 0x40;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
-                    } else if (!(gus->rctrl[d] & 4)) {
-                        gus->ctrl[d] |= 1;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                        if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
+                            gus->waveirqs[d] = 1;
+                            update_irqs      = 1;
+                        }
                     }
+                } else {
+                    gus->cur[d] += (gus->freq[d] >> 1);
+
+                    if (gus->cur[d] >= gus->end[d]) {
+                        int diff = gus->cur[d] - gus->end[d];
+
+                        if (gus->ctrl[d] & 8) {
+                            if (gus->ctrl[d] & 0x10)
+                                gus->ctrl[d] ^= 0x40;
+                            gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
+                        } else if (!(gus->rctrl[d] & 4)) {
+                            gus->ctrl[d] |= 1;
+                            gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                        }
 
-                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
-                        gus->waveirqs[d] = 1;
-                        update_irqs      = 1;
+                        if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
+                            gus->waveirqs[d] = 1;
+                            update_irqs      = 1;
+                        }
                     }
                 }
-            } else {
-                gus->cur[d] += (gus->freq[d] >> 1);
-
-                if (gus->cur[d] >= gus->end[d]) {
-                    int diff = gus->cur[d] - gus->end[d];
-
-                    if (gus->ctrl[d] & 8) {
-                        if (gus->ctrl[d] & 0x10)
-                            gus->ctrl[d] ^= 0x40;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
-                    } else if (!(gus->rctrl[d] & 4)) {
-                        gus->ctrl[d] |= 1;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+            }
+            if (!(gus->rctrl[d] & 3)) {
+                if (gus->rctrl[d] & 0x40) {
+                    gus->rcur[d] -= gus->rfreq[d];
+                    if (gus->rcur[d] <= gus->rstart[d]) {
+                        int diff = gus->rstart[d] - gus->rcur[d];
+                        if (!(gus->rctrl[d] & 8)) {
+                            gus->rctrl[d] |= 1;
+                            gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+                        } else {
+                            if (gus->rctrl[d] & 0x10)
+                                gus->rctrl[d] ^= 0x40;
+                            gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                        }
+
+                        if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
+                            gus->rampirqs[d] = 1;
+                            update_irqs      = 1;
+                        }
                     }
+                } else {
+                    gus->rcur[d] += gus->rfreq[d];
+                    if (gus->rcur[d] >= gus->rend[d]) {
+                        int diff = gus->rcur[d] - gus->rend[d];
+                        if (!(gus->rctrl[d] & 8)) {
+                            gus->rctrl[d] |= 1;
+                            gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+                        } else {
+                            if (gus->rctrl[d] & 0x10)
+                                gus->rctrl[d] ^= 0x40;
+                            gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                        }
 
-                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
-                        gus->waveirqs[d] = 1;
-                        update_irqs      = 1;
+                        if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
+                            gus->rampirqs[d] = 1;
+                            update_irqs      = 1;
+                        }
                     }
                 }
             }
         }
-        if (!(gus->rctrl[d] & 3)) {
-            if (gus->rctrl[d] & 0x40) {
-                gus->rcur[d] -= gus->rfreq[d];
-                if (gus->rcur[d] <= gus->rstart[d]) {
-                    int diff = gus->rstart[d] - gus->rcur[d];
-                    if (!(gus->rctrl[d] & 8)) {
-                        gus->rctrl[d] |= 1;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
-                    } else {
-                        if (gus->rctrl[d] & 0x10)
-                            gus->rctrl[d] ^= 0x40;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
-                    }
+    }
 
-                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
-                        gus->rampirqs[d] = 1;
-                        update_irqs      = 1;
-                    }
-                }
-            } else {
-                gus->rcur[d] += gus->rfreq[d];
-                if (gus->rcur[d] >= gus->rend[d]) {
-                    int diff = gus->rcur[d] - gus->rend[d];
-                    if (!(gus->rctrl[d] & 8)) {
-                        gus->rctrl[d] |= 1;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
-                    } else {
-                        if (gus->rctrl[d] & 0x10)
-                            gus->rctrl[d] ^= 0x40;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
-                    }
+    return update_irqs;
+}
 
-                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
-                        gus->rampirqs[d] = 1;
-                        update_irqs      = 1;
-                    }
-                }
-            }
+/*Renders every sample due by the 32:32 time stamp now, in blocks that end
+  on the next sample that could raise an IRQ, then reschedules samp_timer for
+  the last sample of the next block. samp_ahead holds the distance from the
+  next sample to the timer, so the sample clock follows the timer if the TSC
+  is rebased.*/
+static void
+gus_wave_run(gus_t *gus, uint64_t now)
+{
+    int32_t  out_l[GUS_WAVE_BLOCK];
+    int32_t  out_r[GUS_WAVE_BLOCK];
+    uint64_t ts = gus->samp_timer.ts.ts64 - gus->samp_ahead;
+    int      len;
+    int      n;
+
+    while (1) {
+        len = gus_wave_block_len(gus);
+        for (n = 0; n < len; n++) {
+            if ((int64_t) ((ts + (n * gus->samp_latch)) - now) > 0)
+                break;
+        }
+        if (!n)
+            break;
+
+        if (gus_wave_render(gus, out_l, out_r, n))
+            gus_update_int_status(gus);
+
+        for (int i = 0; i < n; i++) {
+            /*Output samples taken before this one hold the previous value.*/
+            while ((gus->pos < sound_pos_global) && ((int64_t) (sound_get_pos_ts(gus->pos) - ts) < 0))
+                gus_output(gus);
+
+            gus->out_l = out_l[i];
+            gus->out_r = out_r[i];
+            ts += gus->samp_latch;
         }
     }
 
-    if (update_irqs)
-        gus_update_int_status(gus);
+    gus->samp_ahead         = (len - 1) * gus->samp_latch;
+    gus->samp_timer.ts.ts64 = ts + gus->samp_ahead;
+    timer_enable(&gus->samp_timer);
+}
+
+/*Catches the wave engine up before a register access, so the guest sees the
+  voice positions and IRQ status of the current sample. Samples from the
+  cycle of a timer that is due but has not run yet are left for later, as
+  they would have been with a timer per sample.*/
+static void
+gus_wave_sync(gus_t *gus)
+{
+    uint32_t now = (uint32_t) tsc;
+
+    if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) tsc))
+        now = timer_target - 1;
+
+    gus_wave_run(gus, ((uint64_t) now << 32) | 0xffffffffULL);
+}
+
+void
+gus_poll_wave(void *priv)
+{
+    gus_t *gus = (gus_t *) priv;
+
+    gus_wave_run(gus, gus->samp_timer.ts.ts64);
 }
 
 static void
@@ -1186,6 +1341,8 @@ gus_get_buffer(int32_t *buffer, int len, void *priv)
     if ((gus->type == GUS_MAX) && (gus->max_ctrl))
         ad1848_update(&gus->ad1848);
 #endif /*USE_GUSMAX */
+    /*Catch up to the sound timer run this is called from.*/
+    gus_wave_run(gus, sound_get_pos_ts(sound_pos_global - 1));
     gus_update(gus);
 
     for (int c = 0; c < len * 2; c++) {
@@ -1269,6 +1426,7 @@ gus_reset(void *priv)
     gus->voices = 14;
 
     gus->samp_latch = (uint64_t) (TIMER_USEC * (1000000.0 / 44100.0));
+    gus->samp_ahead = 0;
 
     gus->t1l = gus->t2l = 0xff;
 
@@ -1419,11 +1577,15 @@ gus_speed_changed(void *priv)
 {
     gus_t *gus = (gus_t *) priv;
 
+    gus_wave_sync(gus);
+
     if (gus->voices < 14)
         gus->samp_latch = (uint64_t) (TIMER_USEC * (1000000.0 / 44100.0));
     else
         gus->samp_latch = (uint64_t) (TIMER_USEC * (1000000.0 / gusfreqs[gus->voices - 14]));
 
+    gus_wave_sync(gus);
+
 #ifdef USE_GUSMAX
     if ((gus->type == GUS_MAX) && (gus->max_ctrl))
         ad1848_speed_changed(&gus->ad1848);
@@ -38,6 +38,7 @@
  *          Copyright 2013-2020 Alexey Khokholov (Nuke.YKT)
  */
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -48,6 +49,7 @@
 #include <86box/sound.h>
 #include <86box/timer.h>
 #include <86box/device.h>
+#include <86box/thread.h>
 #include <86box/snd_opl.h>
 #include <86box/snd_opl_nuked.h>
 
@@ -1516,6 +1518,163 @@ nuked_timer_2(void *priv)
     nuked_timer_tick(dev, 1);
 }
 
+/* With fm_thread set, the chip runs on a worker thread. Register writes are
+   queued with the sample time they were made at, and the worker applies them
+   at exactly that sample while generating into a ring buffer. The mixer is
+   handed the samples of one music buffer earlier, which the worker has had a
+   whole buffer period to produce, so it does not normally have to wait. The
+   timers and status register stay on the emulation thread. */
+#define NUKED_QUEUE_SIZE 4096
+#define NUKED_RING_LEN   (MUSICBUFLEN * 4)
+#define NUKED_LATENCY    MUSICBUFLEN
+
+typedef struct nuked_write_t {
+    uint64_t time;
+    uint16_t reg;
+    uint8_t  val;
+} nuked_write_t;
+
+typedef struct nuked_worker_t {
+    thread_t  *thread;
+    event_t   *wake_event;
+    event_t   *done_event;
+    atomic_int on;
+
+    uint64_t time_base; /* Sample time of the start of the music buffer. */
+
+    atomic_uint_fast64_t target;   /* The worker may generate up to this time. */
+    atomic_uint_fast64_t gen_time; /* The worker has generated up to this time. */
+
+    nuked_write_t queue[NUKED_QUEUE_SIZE];
+    atomic_uint   queue_head; /* Only written by the emulation thread. */
+    atomic_uint   queue_tail; /* Only written by the worker. */
+
+    int32_t ring[NUKED_RING_LEN * 2];
+} nuked_worker_t;
+
+static void
+nuked_worker_thread(void *priv)
+{
+    nuked_drv_t    *dev  = (nuked_drv_t *) priv;
+    nuked_worker_t *wk   = dev->worker;
+    uint64_t        now  = atomic_load(&wk->gen_time);
+    uint32_t        tail = atomic_load(&wk->queue_tail);
+
+    while (atomic_load(&wk->on)) {
+        thread_wait_event(wk->wake_event, -1);
+        thread_reset_event(wk->wake_event);
+
+        uint64_t target = atomic_load_explicit(&wk->target, memory_order_acquire);
+
+        while (1) {
+            uint32_t head = atomic_load_explicit(&wk->queue_head, memory_order_acquire);
+            uint64_t end  = target;
+
+            /* Writes made before this sample go in first, as they would have
+               been applied straight away when generating on demand. */
+            while ((tail != head) && (wk->queue[tail % NUKED_QUEUE_SIZE].time <= now)) {
+                const nuked_write_t *wr = &wk->queue[tail % NUKED_QUEUE_SIZE];
+
+                OPL3_WriteRegBuffered(&dev->opl, wr->reg, wr->val);
+                tail++;
+            }
+            atomic_store_explicit(&wk->queue_tail, tail, memory_order_release);
+
+            if (now >= target)
+                break;
+
+            if ((tail != head) && (wk->queue[tail % NUKED_QUEUE_SIZE].time < end))
+                end = wk->queue[tail % NUKED_QUEUE_SIZE].time;
+
+            while (now < end) {
+                uint32_t pos = now % NUKED_RING_LEN;
+                uint32_t len = MIN(end - now, NUKED_RING_LEN - pos);
+
+                OPL3_GenerateStream(&dev->opl, &wk->ring[pos * 2], len);
+                now += len;
+            }
+            atomic_store_explicit(&wk->gen_time, now, memory_order_release);
+        }
+
+        thread_set_event(wk->done_event);
+    }
+}
+
+/* Lets the worker run up to the current time and waits until it has
+   generated up to the given time and, with drain set, applied every queued
+   write. The worker publishes its progress before setting done_event, so
+   re-checking after each wake never misses it. */
+static void
+nuked_worker_sync(nuked_drv_t *dev, uint64_t time, int drain)
+{
+    nuked_worker_t *wk = dev->worker;
+
+    atomic_store_explicit(&wk->target, wk->time_base + music_pos_global, memory_order_release);
+    thread_set_event(wk->wake_event);
+
+    while ((atomic_load_explicit(&wk->gen_time, memory_order_acquire) < time) ||
+           (drain && (atomic_load_explicit(&wk->queue_tail, memory_order_acquire) != atomic_load_explicit(&wk->queue_head, memory_order_relaxed)))) {
+        thread_wait_event(wk->done_event, -1);
+        thread_reset_event(wk->done_event);
+    }
+}
+
+static void
+nuked_worker_write(nuked_drv_t *dev, uint16_t reg, uint8_t val)
+{
+    nuked_worker_t *wk   = dev->worker;
+    uint32_t        head = atomic_load_explicit(&wk->queue_head, memory_order_relaxed);
+    nuked_write_t  *wr;
+
+    /* Only a guest hammering the ports with cycle accuracy off can fill the
+       queue; every queued write is due by now, so block until the worker
+       has applied them all. */
+    if ((head - atomic_load_explicit(&wk->queue_tail, memory_order_acquire)) >= NUKED_QUEUE_SIZE)
+        nuked_worker_sync(dev, 0, 1);
+
+    wr       = &wk->queue[head % NUKED_QUEUE_SIZE];
+    wr->time = wk->time_base + music_pos_global;
+    wr->reg  = reg;
+    wr->val  = val;
+    atomic_store_explicit(&wk->queue_head, head + 1, memory_order_release);
+}
+
+static void
+nuked_worker_start(nuked_drv_t *dev)
+{
+    nuked_worker_t *wk = (nuked_worker_t *) calloc(1, sizeof(nuked_worker_t));
+
+    /* Start the clock one buffer in, so the first buffer plays silence from
+       the zeroed ring. */
+    wk->time_base = NUKED_LATENCY;
+    atomic_init(&wk->target, NUKED_LATENCY);
+    atomic_init(&wk->gen_time, NUKED_LATENCY);
+    atomic_init(&wk->queue_head, 0);
+    atomic_init(&wk->queue_tail, 0);
+    atomic_init(&wk->on, 1);
+
+    wk->wake_event = thread_create_event();
+    wk->done_event = thread_create_event();
+
+    dev->worker = wk;
+    wk->thread  = thread_create(nuked_worker_thread, dev);
+}
+
+static void
+nuked_worker_stop(nuked_drv_t *dev)
+{
+    nuked_worker_t *wk = dev->worker;
+
+    atomic_store(&wk->on, 0);
+    thread_set_event(wk->wake_event);
+    thread_wait(wk->thread);
+
+    thread_destroy_event(wk->wake_event);
+    thread_destroy_event(wk->done_event);
+    free(wk);
+    dev->worker = NULL;
+}
+
 static void
 nuked_drv_set_do_cycles(void *priv, int8_t do_cycles)
 {
@@ -1543,6 +1702,9 @@ nuked_drv_init(const device_t *info)
     timer_add(&dev->timers[0], nuked_timer_1, dev, 0);
     timer_add(&dev->timers[1], nuked_timer_2, dev, 0);
 
+    if (fm_thread)
+        nuked_worker_start(dev);
+
     return dev;
 }
 
@@ -1550,6 +1712,10 @@ static void
 nuked_drv_close(void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
+
+    if (dev->worker)
+        nuked_worker_stop(dev);
+
     free(dev);
 }
 
@@ -1561,6 +1727,21 @@ nuked_drv_update(void *priv)
     if (dev->pos >= music_pos_global)
         return dev->buffer;
 
+    if (dev->worker) {
+        nuked_worker_t *wk = dev->worker;
+
+        nuked_worker_sync(dev, wk->time_base + music_pos_global - NUKED_LATENCY, 0);
+
+        for (; dev->pos < music_pos_global; dev->pos++) {
+            uint32_t pos = (wk->time_base + dev->pos - NUKED_LATENCY) % NUKED_RING_LEN;
+
+            dev->buffer[dev->pos * 2]       = wk->ring[pos * 2] / 2;
+            dev->buffer[(dev->pos * 2) + 1] = wk->ring[(pos * 2) + 1] / 2;
+        }
+
+        return dev->buffer;
+    }
+
     OPL3_GenerateStream(&dev->opl,
                           &dev->buffer[dev->pos * 2],
                           music_pos_global - dev->pos);
@@ -1581,7 +1762,8 @@ nuked_drv_read(uint16_t port, void *priv)
     if (dev->flags & FLAG_CYCLES)
         cycles -= ((int) (isa_timing * 8));
 
-    nuked_drv_update(dev);
+    if (!dev->worker)
+        nuked_drv_update(dev);
 
     uint8_t ret = 0xff;
 
@@ -1600,10 +1782,14 @@ static void
 nuked_drv_write(uint16_t port, uint8_t val, void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
-    nuked_drv_update(dev);
 
     if ((port & 0x0001) == 0x0001) {
-        OPL3_WriteRegBuffered(&dev->opl, dev->port, val);
+        if (dev->worker)
+            nuked_worker_write(dev, dev->port, val);
+        else {
+            nuked_drv_update(dev);
+            OPL3_WriteRegBuffered(&dev->opl, dev->port, val);
+        }
 
         switch (dev->port) {
             case 0x002: /* Timer 1 */
@@ -1629,6 +1815,11 @@ nuked_drv_write(uint16_t port, uint8_t val, void *priv)
                 break;
 
             case 0x105:
+                /* Address decoding depends on NEW, so it takes effect now.
+                   Let the worker catch up and apply the write first, so it
+                   is idle while the chip is touched from this thread. */
+                if (dev->worker)
+                    nuked_worker_sync(dev, dev->worker->time_base + music_pos_global, 1);
                 dev->opl.newm = val & 0x01;
                 break;
 
@@ -1648,6 +1839,9 @@ nuked_drv_reset_buffer(void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
 
+    if (dev->worker)
+        dev->worker->time_base += dev->pos;
+
     dev->pos = 0;
 }
 
@@ -1948,11 +1948,13 @@ pasplus_get_buffer(int32_t *buffer, int len, void *priv)
     for (int c = 0; c < len * 2; c += 2) {
         double out_l = pas16->dsp.buffer[c];
         double out_r = pas16->dsp.buffer[c + 1];
+        double filt[2];
 
         if (pas16->filter) {
             /* We divide by 3 to get the volume down to normal. */
-            out_l += low_fir_pas16(0, (double) pas16->pcm_buffer[0][c >> 1]) * mixer->pcm_l;
-            out_r += low_fir_pas16(1, (double) pas16->pcm_buffer[1][c >> 1]) * mixer->pcm_r;
+            low_fir_pas16_stereo((double) pas16->pcm_buffer[0][c >> 1], (double) pas16->pcm_buffer[1][c >> 1], filt);
+            out_l += filt[0] * mixer->pcm_l;
+            out_r += filt[1] * mixer->pcm_r;
         } else {
             out_l += ((double) pas16->pcm_buffer[0][c >> 1]) * mixer->pcm_l;
             out_r += ((double) pas16->pcm_buffer[1][c >> 1]) * mixer->pcm_r;
@@ -1967,11 +1969,13 @@ pasplus_get_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->bass];
 
             if (mixer->bass > 6) {
-                out_l += (low_iir(0, 0, out_l) * bass_treble);
-                out_r += (low_iir(0, 1, out_r) * bass_treble);
+                low_iir_stereo(0, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->bass < 6) {
-                out_l = (out_l *bass_treble + low_cut_iir(0, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + low_cut_iir(0, 1, out_r) * (1.0 - bass_treble));
+                low_cut_iir_stereo(0, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
@@ -1979,11 +1983,13 @@ pasplus_get_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->treble];
 
             if (mixer->treble > 6) {
-                out_l += (high_iir(0, 0, out_l) * bass_treble);
-                out_r += (high_iir(0, 1, out_r) * bass_treble);
+                high_iir_stereo(0, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->treble < 6) {
-                out_l = (out_l *bass_treble + high_cut_iir(0, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + high_cut_iir(0, 1, out_r) * (1.0 - bass_treble));
+                high_cut_iir_stereo(0, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
@@ -2006,6 +2012,7 @@ pasplus_get_music_buffer(int32_t *buffer, int len, void *priv)
     for (int c = 0; c < len * 2; c += 2) {
         double out_l = (((double) opl_buf[c]) * mixer->fm_l) * 0.7171630859375;
         double out_r = (((double) opl_buf[c + 1]) * mixer->fm_r) * 0.7171630859375;
+        double filt[2];
 
         /* TODO: recording CD, Mic with AGC or line in. Note: mic volume does not affect recording. */
         out_l *= mixer->master_l;
@@ -2017,11 +2024,13 @@ pasplus_get_music_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->bass];
 
             if (mixer->bass > 6) {
-                out_l += (low_iir(1, 0, out_l) * bass_treble);
-                out_r += (low_iir(1, 1, out_r) * bass_treble);
+                low_iir_stereo(1, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->bass < 6) {
-                out_l = (out_l *bass_treble + low_cut_iir(1, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + low_cut_iir(1, 1, out_r) * (1.0 - bass_treble));
+                low_cut_iir_stereo(1, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
@@ -2029,11 +2038,13 @@ pasplus_get_music_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->treble];
 
             if (mixer->treble > 6) {
-                out_l += (high_iir(1, 0, out_l) * bass_treble);
-                out_r += (high_iir(1, 1, out_r) * bass_treble);
+                high_iir_stereo(1, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->treble < 6) {
-                out_l = (out_l *bass_treble + high_cut_iir(1, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + high_cut_iir(1, 1, out_r) * (1.0 - bass_treble));
+                high_cut_iir_stereo(1, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
@@ -2126,11 +2137,13 @@ pas16_get_buffer(int32_t *buffer, int len, void *priv)
     for (int c = 0; c < len * 2; c += 2) {
         double out_l = (pas16->dsp.buffer[c] * mixer->sb_l) / 3.0;
         double out_r = (pas16->dsp.buffer[c + 1] * mixer->sb_r) / 3.0;
+        double filt[2];
 
         if (pas16->filter) {
             /* We divide by 3 to get the volume down to normal. */
-            out_l += (low_fir_pas16(0, (double) pas16->pcm_buffer[0][c >> 1]) * mixer->pcm_l) / 3.0;
-            out_r += (low_fir_pas16(1, (double) pas16->pcm_buffer[1][c >> 1]) * mixer->pcm_r) / 3.0;
+            low_fir_pas16_stereo((double) pas16->pcm_buffer[0][c >> 1], (double) pas16->pcm_buffer[1][c >> 1], filt);
+            out_l += (filt[0] * mixer->pcm_l) / 3.0;
+            out_r += (filt[1] * mixer->pcm_r) / 3.0;
         } else {
             out_l += (((double) pas16->pcm_buffer[0][c >> 1]) * mixer->pcm_l) / 3.0;
             out_r += (((double) pas16->pcm_buffer[1][c >> 1]) * mixer->pcm_r) / 3.0;
@@ -2145,11 +2158,13 @@ pas16_get_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->bass];
 
             if (mixer->bass > 6) {
-                out_l += (low_iir(0, 0, out_l) * bass_treble);
-                out_r += (low_iir(0, 1, out_r) * bass_treble);
+                low_iir_stereo(0, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->bass < 6) {
-                out_l = (out_l *bass_treble + low_cut_iir(0, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + low_cut_iir(0, 1, out_r) * (1.0 - bass_treble));
+                low_cut_iir_stereo(0, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
@@ -2157,11 +2172,13 @@ pas16_get_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->treble];
 
             if (mixer->treble > 6) {
-                out_l += (high_iir(0, 0, out_l) * bass_treble);
-                out_r += (high_iir(0, 1, out_r) * bass_treble);
+                high_iir_stereo(0, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->treble < 6) {
-                out_l = (out_l *bass_treble + high_cut_iir(0, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + high_cut_iir(0, 1, out_r) * (1.0 - bass_treble));
+                high_cut_iir_stereo(0, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
@@ -2184,6 +2201,7 @@ pas16_get_music_buffer(int32_t *buffer, int len, void *priv)
     for (int c = 0; c < len * 2; c += 2) {
         double out_l = (((double) opl_buf[c]) * mixer->fm_l) * 0.7171630859375;
         double out_r = (((double) opl_buf[c + 1]) * mixer->fm_r) * 0.7171630859375;
+        double filt[2];
 
         /* TODO: recording CD, Mic with AGC or line in. Note: mic volume does not affect recording. */
         out_l *= mixer->master_l;
@@ -2195,11 +2213,13 @@ pas16_get_music_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->bass];
 
             if (mixer->bass > 6) {
-                out_l += (low_iir(1, 0, out_l) * bass_treble);
-                out_r += (low_iir(1, 1, out_r) * bass_treble);
+                low_iir_stereo(1, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->bass < 6) {
-                out_l = (out_l *bass_treble + low_cut_iir(1, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + low_cut_iir(1, 1, out_r) * (1.0 - bass_treble));
+                low_cut_iir_stereo(1, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
@@ -2207,11 +2227,13 @@ pas16_get_music_buffer(int32_t *buffer, int len, void *priv)
             bass_treble = lmc1982_bass_treble_4bits[mixer->treble];
 
             if (mixer->treble > 6) {
-                out_l += (high_iir(1, 0, out_l) * bass_treble);
-                out_r += (high_iir(1, 1, out_r) * bass_treble);
+                high_iir_stereo(1, out_l, out_r, filt);
+                out_l += (filt[0] * bass_treble);
+                out_r += (filt[1] * bass_treble);
             } else if (mixer->treble < 6) {
-                out_l = (out_l *bass_treble + high_cut_iir(1, 0, out_l) * (1.0 - bass_treble));
-                out_r = (out_r *bass_treble + high_cut_iir(1, 1, out_r) * (1.0 - bass_treble));
+                high_cut_iir_stereo(1, out_l, out_r, filt);
+                out_l = (out_l *bass_treble + filt[0] * (1.0 - bass_treble));
+                out_r = (out_r *bass_treble + filt[1] * (1.0 - bass_treble));
             }
         }
 
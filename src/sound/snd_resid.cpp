@@ -4,7 +4,11 @@
 #include <string.h>
 
 #include "resid-fp/sid.h"
+#include "resid-fp/resample/PolyphaseResampler.h"
 #include <86box/plat.h>
+extern "C" {
+#include <86box/path.h>
+}
 #include <86box/snd_resid.h>
 
 #define RESID_FREQ 48000
@@ -20,13 +24,30 @@ typedef struct psid_t {
 psid_t *psid;
 
 void *
-sid_init(void)
+sid_init(int sampling)
 {
 #if 0
     psid_t *psid;
 #endif
     reSIDfp::SamplingMethod method         = reSIDfp::DECIMATE;
     float                   cycles_per_sec = 14318180.0 / 16.0;
+    char                    fir_path[256] = { 0 };
+
+    switch (sampling) {
+        case SID_SAMPLING_RESAMPLE:
+            method = reSIDfp::RESAMPLE;
+            break;
+        case SID_SAMPLING_FAST:
+            /* The FIR tables only depend on the rates, so keep them with
+               the global data rather than per machine. */
+            plat_get_global_data_dir(fir_path, sizeof(fir_path) - 2);
+            path_slash(fir_path);
+            reSIDfp::PolyphaseResampler::setCacheDirectory(fir_path);
+            method = reSIDfp::RESAMPLE_FAST;
+            break;
+        default:
+            break;
+    }
 
     psid = new psid_t;
 #if 0
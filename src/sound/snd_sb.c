@@ -236,11 +236,13 @@ sb_get_buffer_sbpro(int32_t *buffer, const int len, void *priv)
     for (int c = 0; c < len * 2; c += 2) {
         double out_l = 0.0;
         double out_r = 0.0;
+        double filt[2];
 
         /* TODO: Implement the stereo switch on the mixer instead of on the dsp? */
         if (mixer->output_filter) {
-            out_l += (sb_iir(0, 0, (double) sb->dsp.buffer[c]) * mixer->voice_l) / 3.9;
-            out_r += (sb_iir(0, 1, (double) sb->dsp.buffer[c + 1]) * mixer->voice_r) / 3.9;
+            sb_iir_stereo(0, (double) sb->dsp.buffer[c], (double) sb->dsp.buffer[c + 1], filt);
+            out_l += (filt[0] * mixer->voice_l) / 3.9;
+            out_r += (filt[1] * mixer->voice_r) / 3.9;
         } else {
             out_l += (sb->dsp.buffer[c] * mixer->voice_l) / 3.0;
             out_r += (sb->dsp.buffer[c + 1] * mixer->voice_r) / 3.0;
@@ -332,11 +334,13 @@ sb_get_buffer_sb16_awe32(int32_t *buffer, int len, void *priv)
     for (int c = 0; c < len * 2; c += 2) {
         double out_l = 0.0;
         double out_r = 0.0;
+        double filt[2];
 
         if (mixer->output_filter) {
             /* We divide by 3 to get the volume down to normal. */
-            out_l += (low_fir_sb16(0, 0, (double) sb->dsp.buffer[c]) * mixer->voice_l) / 3.0;
-            out_r += (low_fir_sb16(0, 1, (double) sb->dsp.buffer[c + 1]) * mixer->voice_r) / 3.0;
+            low_fir_sb16_stereo(0, (double) sb->dsp.buffer[c], (double) sb->dsp.buffer[c + 1], filt);
+            out_l += (filt[0] * mixer->voice_l) / 3.0;
+            out_r += (filt[1] * mixer->voice_r) / 3.0;
         } else {
             out_l += (((double) sb->dsp.buffer[c]) * mixer->voice_l) / 3.0;
             out_r += (((double) sb->dsp.buffer[c + 1]) * mixer->voice_r) / 3.0;
@@ -643,11 +647,13 @@ sb_get_buffer_ess(int32_t *buffer, int len, void *priv)
     for (int c = 0; c < len * 2; c += 2) {
         double out_l = 0.0;
         double out_r = 0.0;
+        double filt[2];
 
         /* TODO: Implement the stereo switch on the mixer instead of on the dsp? */
         if (mixer->output_filter) {
-            out_l += (low_fir_sb16(0, 0, (double) ess->dsp.buffer[c]) * mixer->voice_l) / 3.0;
-            out_r += (low_fir_sb16(0, 1, (double) ess->dsp.buffer[c + 1]) * mixer->voice_r) / 3.0;
+            low_fir_sb16_stereo(0, (double) ess->dsp.buffer[c], (double) ess->dsp.buffer[c + 1], filt);
+            out_l += (filt[0] * mixer->voice_l) / 3.0;
+            out_r += (filt[1] * mixer->voice_r) / 3.0;
         } else {
             out_l += (ess->dsp.buffer[c] * mixer->voice_l) / 3.0;
             out_r += (ess->dsp.buffer[c + 1] * mixer->voice_r) / 3.0;
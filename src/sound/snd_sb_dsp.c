@@ -446,9 +446,57 @@ sb_dsp_set_mpu(sb_dsp_t *dsp, mpu_t *mpu)
         mpu401_irq_attach(mpu, sb_dsp_irq_update, sb_dsp_irq_pending, dsp);
 }
 
+/* Gives the transfers read ahead but not yet played back to the DMA
+   controller, unless a write to the controller already took them back. */
 static void
-sb_stop_dma(const sb_dsp_t *dsp)
+sb_dsp_dma_unread(sb_dsp_t *dsp)
 {
+    const int ch = dsp->dma_ahead_ch;
+
+    if ((ch >= 0) && (ch < 8) && (dma[ch].ahead == (dsp->dma_ahead_len - dsp->dma_ahead_pos)))
+        dma_channel_unread(ch);
+
+    dsp->dma_ahead_pos = 0;
+    dsp->dma_ahead_len = 0;
+}
+
+/* Reads one transfer for playback from a small buffer filled ahead through
+   the DMA controller. remaining is the number of transfers left in the
+   current block; reading ahead stops there, so the block still ends, and
+   raises its IRQ, on the sample it belongs to. */
+static int
+sb_dsp_dma_read(sb_dsp_t *dsp, int channel, int remaining)
+{
+    const uint8_t *p;
+
+    if ((dsp->dma_ahead_ch != channel) || (dma[channel].ahead != (dsp->dma_ahead_len - dsp->dma_ahead_pos))) {
+        sb_dsp_dma_unread(dsp);
+        dsp->dma_ahead_ch = channel;
+    }
+
+    if ((dsp->dma_ahead_pos == dsp->dma_ahead_len) && (remaining > 1)) {
+        dsp->dma_ahead_pos = 0;
+        dsp->dma_ahead_len = dma_channel_read_ahead(channel, dsp->dma_ahead, MIN(remaining, SB_DSP_DMA_AHEAD));
+    }
+
+    if (dsp->dma_ahead_pos == dsp->dma_ahead_len)
+        return dma_channel_read(channel);
+
+    dma_channel_retire(channel, 1);
+
+    if (dma[channel].size) {
+        p = &dsp->dma_ahead[(dsp->dma_ahead_pos++) << 1];
+        return p[0] | (p[1] << 8);
+    }
+
+    return dsp->dma_ahead[dsp->dma_ahead_pos++];
+}
+
+static void
+sb_stop_dma(sb_dsp_t *dsp)
+{
+    sb_dsp_dma_unread(dsp);
+
     dma_set_drq(dsp->sb_8_dmanum, 0);
 
     if (dsp->sb_16_dmanum != 0xff) {
@@ -466,6 +514,7 @@ static void
 sb_finish_dma(sb_dsp_t *dsp)
 {
     if (dsp->ess_playback_mode) {
+        sb_dsp_dma_unread(dsp);
         ESSreg(0xB8) &= ~0x01;
         dma_set_drq(dsp->sb_8_dmanum, 0);
     } else
@@ -717,6 +766,7 @@ sb_start_dma_ess(sb_dsp_t *dsp)
 void
 sb_stop_dma_ess(sb_dsp_t *dsp)
 {
+    sb_dsp_dma_unread(dsp);
     dsp->sb_8_enable = dsp->sb_16_enable = 0;
     dma_set_drq(dsp->sb_16_8_dmanum, 0);
     dma_set_drq(dsp->sb_8_dmanum, 0);
@@ -764,7 +814,8 @@ sb_8_read_dma(void *priv)
 
        dsp->dma_ff = !dsp->dma_ff;
     } else
-        ret = dma_channel_read(dsp->sb_8_dmanum);
+        ret = sb_dsp_dma_read(dsp, dsp->sb_8_dmanum,
+                              dsp->ess_playback_mode ? (0x10000 - (int) dsp->ess_dma_counter) : (dsp->sb_8_length + 1));
 
     return ret;
 }
@@ -798,11 +849,19 @@ sb_16_read_dma(void *priv)
 
     int ret;
     int dma_ch = dsp->sb_16_dmanum;
+    int remaining;
 
     dsp->activity &= 0xdf;
 
+    /* Bytes left in the block: ESS counts bytes, the others count 16-bit
+       samples. */
+    if (dsp->ess_playback_mode)
+        remaining = 0x10000 - (int) dsp->ess_dma_counter;
+    else
+        remaining = (dsp->sb_16_length + 1) << 1;
+
     if (dsp->sb_16_dma_enabled && dsp->sb_16_dma_supported && !dsp->sb_16_dma_translate && (dma_ch != 4))
-        ret = dma_channel_read(dma_ch);
+        ret = sb_dsp_dma_read(dsp, dma_ch, remaining >> 1);
     else {
         if (dsp->sb_16_dma_enabled) {
             /* High DMA channel enabled, either translation is enabled or
@@ -814,10 +873,10 @@ sb_16_read_dma(void *priv)
         } else
             /* High DMA channel disabled, always use the first 8-bit channel. */
             dma_ch = dsp->sb_8_dmanum;
-        int temp = dma_channel_read(dma_ch);
+        int temp = sb_dsp_dma_read(dsp, dma_ch, remaining);
         ret  = temp;
         if ((temp != DMA_NODATA) && !(temp & DMA_OVER)) {
-            temp = dma_channel_read(dma_ch);
+            temp = sb_dsp_dma_read(dsp, dma_ch, remaining - 1);
             if (temp == DMA_NODATA)
                 ret = DMA_NODATA;
             else {
@@ -2127,6 +2186,8 @@ sb_dsp_init(sb_dsp_t *dsp, int type, int subtype, void *parent)
     dsp->dma_writew = sb_16_write_dma;
     dsp->dma_priv   = dsp;
 
+    dsp->dma_ahead_ch = -1;
+
     sb_doreset(dsp);
 
     timer_add(&dsp->output_timer, pollsb, dsp, 0);
@@ -69,7 +69,7 @@ ssi2001_init(UNUSED(const device_t *info))
     ssi2001_t *ssi2001 = malloc(sizeof(ssi2001_t));
     memset(ssi2001, 0, sizeof(ssi2001_t));
 
-    ssi2001->psid = sid_init();
+    ssi2001->psid = sid_init(device_get_config_int("sampling"));
     sid_reset(ssi2001->psid);
     uint16_t addr             = device_get_config_hex16("base");
     ssi2001->gameport_enabled = device_get_config_int("gameport");
@@ -120,6 +120,30 @@ static const device_config_t ssi2001_config[] = {
             { .description = "" }
         }
     },
+    {
+        .name = "sampling",
+        .description = "Sampling method",
+        .type = CONFIG_SELECTION,
+        .default_string = "",
+        .default_int = SID_SAMPLING_INTERPOLATE,
+        .file_filter = "",
+        .spinner = { 0 },
+        .selection = {
+            {
+                .description = "Interpolate",
+                .value = SID_SAMPLING_INTERPOLATE
+            },
+            {
+                .description = "Resample",
+                .value = SID_SAMPLING_RESAMPLE
+            },
+            {
+                .description = "Fast resample",
+                .value = SID_SAMPLING_FAST
+            },
+            { .description = "" }
+        }
+    },
     { "gameport", "Enable Game port", CONFIG_BINARY, "",  1 },
     { "",         "",                                    -1 }
 // clang-format off
@@ -37,6 +37,14 @@
 #include <86box/snd_mpu401.h>
 #include <86box/sound.h>
 
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    define SOUND_SSE2
+#    include <emmintrin.h>
+#elif defined __ARM_NEON || defined _M_ARM64
+#    define SOUND_NEON
+#    include <arm_neon.h>
+#endif
+
 typedef struct {
     const device_t *device;
 } SOUND_CARD;
@@ -523,6 +531,60 @@ sound_set_pc_speaker_filter(void (*filter)(int channel, double *buffer, void *pr
     }
 }
 
+/* Converts the mixed 32-bit buffer to the output format. Both kernels give
+   exactly the same result as converting one sample at a time: the scale is a
+   power of two, and packing with signed saturation is the clamp to 16 bits. */
+static void
+sound_mix_float(const int32_t *in, float *out, int len)
+{
+    int c = 0;
+
+#if defined SOUND_SSE2
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+    for (; c <= (len - 4); c += 4)
+        _mm_storeu_ps(&out[c], _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) &in[c])), scale));
+#elif defined SOUND_NEON
+    const float32x4_t scale = vdupq_n_f32(1.0f / 32768.0f);
+
+    for (; c <= (len - 4); c += 4)
+        vst1q_f32(&out[c], vmulq_f32(vcvtq_f32_s32(vld1q_s32(&in[c])), scale));
+#endif
+    for (; c < len; c++)
+        out[c] = ((float) in[c]) / (float) 32768.0;
+}
+
+static inline int16_t
+sound_clamp_int16(int32_t val)
+{
+    if (val > 32767)
+        return 32767;
+    else if (val < -32768)
+        return -32768;
+
+    return (int16_t) val;
+}
+
+static void
+sound_mix_int16(const int32_t *in, int16_t *out, int len)
+{
+    int c = 0;
+
+#if defined SOUND_SSE2
+    for (; c <= (len - 8); c += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *) &in[c]);
+        __m128i hi = _mm_loadu_si128((const __m128i *) &in[c + 4]);
+
+        _mm_storeu_si128((__m128i *) &out[c], _mm_packs_epi32(lo, hi));
+    }
+#elif defined SOUND_NEON
+    for (; c <= (len - 8); c += 8)
+        vst1q_s16(&out[c], vcombine_s16(vqmovn_s32(vld1q_s32(&in[c])), vqmovn_s32(vld1q_s32(&in[c + 4]))));
+#endif
+    for (; c < len; c++)
+        out[c] = sound_clamp_int16(in[c]);
+}
+
 void
 sound_poll(UNUSED(void *priv))
 {
@@ -539,18 +601,10 @@ sound_poll(UNUSED(void *priv))
         for (c = 0; c < sound_handlers_num; c++)
             sound_handlers[c].get_buffer(outbuffer, SOUNDBUFLEN, sound_handlers[c].priv);
 
-        for (c = 0; c < SOUNDBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_ex[c] = ((float) outbuffer[c]) / (float) 32768.0;
-            else {
-                if (outbuffer[c] > 32767)
-                    outbuffer[c] = 32767;
-                if (outbuffer[c] < -32768)
-                    outbuffer[c] = -32768;
-
-                outbuffer_ex_int16[c] = (int16_t) outbuffer[c];
-            }
-        }
+        if (sound_is_float)
+            sound_mix_float(outbuffer, outbuffer_ex, SOUNDBUFLEN * 2);
+        else
+            sound_mix_int16(outbuffer, outbuffer_ex_int16, SOUNDBUFLEN * 2);
 
         if (sound_is_float)
             givealbuffer(outbuffer_ex);
@@ -569,6 +623,14 @@ sound_poll(UNUSED(void *priv))
     }
 }
 
+/*Returns the time at which sample pos of the current buffer was taken, for
+  devices that render ahead of the sound timer.*/
+uint64_t
+sound_get_pos_ts(int pos)
+{
+    return sound_poll_timer.ts.ts64 - ((uint64_t) (sound_pos_global - pos) * sound_poll_latch);
+}
+
 void
 music_poll(UNUSED(void *priv))
 {
@@ -583,18 +645,10 @@ music_poll(UNUSED(void *priv))
         for (c = 0; c < music_handlers_num; c++)
             music_handlers[c].get_buffer(outbuffer_m, MUSICBUFLEN, music_handlers[c].priv);
 
-        for (c = 0; c < MUSICBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_m_ex[c] = ((float) outbuffer_m[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_m[c] > 32767)
-                    outbuffer_m[c] = 32767;
-                if (outbuffer_m[c] < -32768)
-                    outbuffer_m[c] = -32768;
-
-                outbuffer_m_ex_int16[c] = (int16_t) outbuffer_m[c];
-            }
-        }
+        if (sound_is_float)
+            sound_mix_float(outbuffer_m, outbuffer_m_ex, MUSICBUFLEN * 2);
+        else
+            sound_mix_int16(outbuffer_m, outbuffer_m_ex_int16, MUSICBUFLEN * 2);
 
         if (sound_is_float)
             givealbuffer_music(outbuffer_m_ex);
@@ -619,18 +673,10 @@ wavetable_poll(UNUSED(void *priv))
         for (c = 0; c < wavetable_handlers_num; c++)
             wavetable_handlers[c].get_buffer(outbuffer_w, WTBUFLEN, wavetable_handlers[c].priv);
 
-        for (c = 0; c < WTBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_w_ex[c] = ((float) outbuffer_w[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_w[c] > 32767)
-                    outbuffer_w[c] = 32767;
-                if (outbuffer_w[c] < -32768)
-                    outbuffer_w[c] = -32768;
-
-                outbuffer_w_ex_int16[c] = (int16_t) outbuffer_w[c];
-            }
-        }
+        if (sound_is_float)
+            sound_mix_float(outbuffer_w, outbuffer_w_ex, WTBUFLEN * 2);
+        else
+            sound_mix_int16(outbuffer_w, outbuffer_w_ex_int16, WTBUFLEN * 2);
 
         if (sound_is_float)
             givealbuffer_wt(outbuffer_w_ex);
@@ -664,6 +710,7 @@ sound_reset(void)
     midi_in_device_init();
 
     inital();
+    sound_out_init();
 
     timer_add(&sound_poll_timer, sound_poll, NULL, 1);
 
@@ -0,0 +1,509 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Buffered sound output stage.
+ *
+ *          With sound_latency set, the buffers handed to givealbuffer*()
+ *          go into one lock-free ring per stream instead of straight to
+ *          the audio library. An output thread drains the rings in short
+ *          periods, resamples each stream to SOUND_FREQ with a rate that
+ *          is nudged by up to SOUND_OUT_DRIFT to keep its ring centred on
+ *          the target latency, mixes them and feeds a sink: the audio
+ *          device, a WAV file or nothing at all.
+ */
+#include <math.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define HAVE_STDARG_H
+
+#include <86box/86box.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/sound.h>
+#include <86box/plat_unused.h>
+
+#define SOUND_OUT_QUEUE   (SOUND_OUT_PERIOD * 2)
+#define SOUND_OUT_DRIFT   0.005
+#define SOUND_OUT_STREAMS 5
+
+typedef struct sound_out_stream_t {
+    float      *buf; /* Interleaved stereo frames */
+    uint32_t    size;
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_int  freq;
+    atomic_int  burst; /* Frames in the last buffer given */
+    atomic_uint underruns;
+    atomic_uint overruns;
+    atomic_int  drift; /* Current rate nudge in parts per million */
+
+    /* Output thread state. */
+    uint32_t reported_underruns;
+    uint32_t reported_overruns;
+    int      cur_freq;
+    int      primed;
+    int      base;   /* Target fill in frames, from sound_out_latency */
+    int      target; /* Target fill in frames, raised after underruns */
+    double   fill;   /* Smoothed fill in frames */
+    double   pos;
+    float    prev[2];
+    float    next[2];
+} sound_out_stream_t;
+
+typedef struct sound_out_sink_t {
+    int  (*open)(int freq);
+    void (*close)(void);
+    int  (*queued)(void);
+    void (*write)(const float *buf, int frames);
+} sound_out_sink_t;
+
+static sound_out_stream_t      streams[SOUND_OUT_STREAMS];
+static const sound_out_sink_t *sink;
+static thread_t               *sound_out_thread_h;
+static event_t                *sound_out_stop_event;
+static atomic_int              sound_out_running;
+static atomic_int              sound_out_givers; /* Producers inside sound_out_give() */
+static int                     sound_out_latency; /* sound_latency, clamped */
+static float                   sound_out_buf[SOUND_OUT_PERIOD * 2];
+
+static const char *stream_names[SOUND_OUT_STREAMS] = { "sound", "music", "wavetable", "CD audio", "MIDI" };
+
+static FILE    *wav_fp;
+static uint32_t wav_frames;
+static uint64_t clock_frames;
+static uint32_t clock_start;
+
+#ifdef ENABLE_SOUND_OUT_LOG
+int sound_out_do_log = ENABLE_SOUND_OUT_LOG;
+
+static void
+sound_out_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (sound_out_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define sound_out_log(fmt, ...)
+#endif
+
+/* The WAV and null sinks have no device to pace them, so they pretend to
+   play at SOUND_FREQ against the wall clock. */
+static int
+clock_queued(void)
+{
+    const uint64_t played = ((uint64_t) (plat_get_ticks() - clock_start) * SOUND_FREQ) / 1000;
+
+    return (clock_frames > played) ? (int) (clock_frames - played) : 0;
+}
+
+static int
+null_open(UNUSED(int freq))
+{
+    clock_start  = plat_get_ticks();
+    clock_frames = 0;
+
+    return 0;
+}
+
+static void
+null_close(void)
+{
+    clock_frames = 0;
+}
+
+static void
+null_write(UNUSED(const float *buf), int frames)
+{
+    clock_frames += frames;
+}
+
+static void
+wav_put(uint32_t val, int bytes)
+{
+    for (int c = 0; c < bytes; c++)
+        fputc((val >> (c << 3)) & 0xff, wav_fp);
+}
+
+static void
+wav_header(int freq)
+{
+    fwrite("RIFF", 1, 4, wav_fp);
+    wav_put(36 + (wav_frames << 2), 4);
+    fwrite("WAVEfmt ", 1, 8, wav_fp);
+    wav_put(16, 4);
+    wav_put(1, 2); /* PCM */
+    wav_put(2, 2);
+    wav_put(freq, 4);
+    wav_put(freq << 2, 4);
+    wav_put(4, 2);
+    wav_put(16, 2);
+    fwrite("data", 1, 4, wav_fp);
+    wav_put(wav_frames << 2, 4);
+}
+
+static int
+wav_open(int freq)
+{
+    char  temp[1024];
+    char *p = sound_wav_path;
+
+    if (*p == '\0') {
+        path_append_filename(temp, usr_path, "sound.wav");
+        p = temp;
+    }
+
+    wav_fp = plat_fopen(p, "wb");
+    if (wav_fp == NULL)
+        return 1;
+
+    wav_frames = 0;
+    wav_header(freq);
+
+    return null_open(freq);
+}
+
+static void
+wav_close(void)
+{
+    if (wav_fp == NULL)
+        return;
+
+    fseek(wav_fp, 0, SEEK_SET);
+    wav_header(SOUND_FREQ);
+    fclose(wav_fp);
+    wav_fp = NULL;
+}
+
+static void
+wav_write(const float *buf, int frames)
+{
+    for (int c = 0; c < (frames << 1); c++) {
+        float s = buf[c] * 32768.0f;
+
+        if (s > 32767.0f)
+            s = 32767.0f;
+        else if (s < -32768.0f)
+            s = -32768.0f;
+
+        wav_put((uint16_t) (int16_t) s, 2);
+    }
+
+    wav_frames += frames;
+    null_write(buf, frames);
+}
+
+static const sound_out_sink_t sinks[] = {
+    {al_out_open, al_out_close, al_out_queued, al_out_write},
+    { wav_open,   wav_close,    clock_queued,  wav_write   },
+    { null_open,  null_close,   clock_queued,  null_write  }
+};
+
+int
+sound_out_give(int stream, const void *buf, int samples, int freq)
+{
+    sound_out_stream_t *s = &streams[stream];
+    uint32_t            head;
+    uint32_t            space;
+    int                 frames = samples >> 1;
+
+    /* Announce ourselves before looking at sound_out_running, so that
+       sound_out_close() either sees us or we see it stopped. */
+    atomic_fetch_add(&sound_out_givers, 1);
+    if (!atomic_load(&sound_out_running)) {
+        atomic_fetch_sub(&sound_out_givers, 1);
+        return 0;
+    }
+
+    head  = atomic_load_explicit(&s->head, memory_order_relaxed);
+    space = s->size - (head - atomic_load_explicit(&s->tail, memory_order_acquire));
+
+    if ((uint32_t) frames > space) {
+        atomic_fetch_add_explicit(&s->overruns, 1, memory_order_relaxed);
+        frames = (int) space;
+    }
+
+    for (int c = 0; c < frames; c++) {
+        float *f = &s->buf[((head + c) & (s->size - 1)) << 1];
+
+        if (sound_is_float) {
+            f[0] = ((const float *) buf)[c << 1];
+            f[1] = ((const float *) buf)[(c << 1) + 1];
+        } else {
+            f[0] = (float) ((const int16_t *) buf)[c << 1] * (1.0f / 32768.0f);
+            f[1] = (float) ((const int16_t *) buf)[(c << 1) + 1] * (1.0f / 32768.0f);
+        }
+    }
+
+    atomic_store_explicit(&s->freq, freq, memory_order_relaxed);
+    atomic_store_explicit(&s->burst, samples >> 1, memory_order_relaxed);
+    atomic_store_explicit(&s->head, head + frames, memory_order_release);
+
+    atomic_fetch_sub(&sound_out_givers, 1);
+
+    return 1;
+}
+
+/* Resamples one stream into the mix. The step through the ring is the
+   nominal rate ratio, nudged by up to SOUND_OUT_DRIFT towards the target
+   fill, which the ear does not notice but which soaks up the difference
+   between the emulated and the real clock. */
+static void
+sound_out_stream_mix(sound_out_stream_t *s, float *out, int frames)
+{
+    const int freq = atomic_load_explicit(&s->freq, memory_order_relaxed);
+    uint32_t  head;
+    uint32_t  tail;
+    uint32_t  avail;
+    int       burst;
+    int       min_target;
+    double    centre;
+    double    drift;
+    double    step;
+
+    if (freq == 0)
+        return;
+
+    if (freq != s->cur_freq) {
+        s->cur_freq = freq;
+        s->base     = (int) (((int64_t) sound_out_latency * freq) / 1000);
+        s->target   = s->base;
+        s->primed   = 0;
+    }
+
+    head  = atomic_load_explicit(&s->head, memory_order_acquire);
+    tail  = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    avail = head - tail;
+
+    /* Producers give whole buffers, so the fill is a sawtooth between the
+       target and a buffer above it; the target itself has to cover a couple
+       of periods. */
+    burst      = atomic_load_explicit(&s->burst, memory_order_relaxed);
+    min_target = ((SOUND_OUT_PERIOD * 2 * freq) / SOUND_FREQ) + 1;
+    if (s->target < min_target)
+        s->target = min_target;
+    centre = s->target + (burst / 2.0);
+
+    if (!s->primed) {
+        if (avail < (uint32_t) (s->target + burst))
+            return;
+
+        /* Start at the peak of the sawtooth, dropping anything older, so
+           the ring begins centred. */
+        tail  = head - (s->target + burst);
+        avail = s->target + burst;
+
+        s->primed  = 1;
+        s->fill    = centre;
+        s->pos     = 1.0;
+        s->prev[0] = s->prev[1] = 0.0f;
+        s->next[0] = s->next[1] = 0.0f;
+    }
+
+    s->fill += ((double) avail - s->fill) * 0.05;
+    drift = ((s->fill - centre) / centre) * 0.02;
+    if (drift > SOUND_OUT_DRIFT)
+        drift = SOUND_OUT_DRIFT;
+    else if (drift < -SOUND_OUT_DRIFT)
+        drift = -SOUND_OUT_DRIFT;
+    atomic_store_explicit(&s->drift, (int) (drift * 1000000.0), memory_order_relaxed);
+    step = ((double) freq / (double) SOUND_FREQ) * (1.0 + drift);
+
+    for (int c = 0; c < frames; c++) {
+        while (s->pos >= 1.0) {
+            const float *f;
+
+            if (tail == head) {
+                /* Starve quietly, and wait for a deeper ring before
+                   starting again. */
+                atomic_fetch_add_explicit(&s->underruns, 1, memory_order_relaxed);
+                s->primed = 0;
+                s->target = MIN(s->target + (s->base >> 2) + 1, MAX(s->base << 1, min_target << 1));
+                atomic_store_explicit(&s->tail, tail, memory_order_release);
+                return;
+            }
+
+            f          = &s->buf[(tail++ & (s->size - 1)) << 1];
+            s->prev[0] = s->next[0];
+            s->prev[1] = s->next[1];
+            s->next[0] = f[0];
+            s->next[1] = f[1];
+            s->pos -= 1.0;
+        }
+
+        out[c << 1] += s->prev[0] + ((s->next[0] - s->prev[0]) * (float) s->pos);
+        out[(c << 1) + 1] += s->prev[1] + ((s->next[1] - s->prev[1]) * (float) s->pos);
+        s->pos += step;
+    }
+
+    atomic_store_explicit(&s->tail, tail, memory_order_release);
+
+    /* Give back latency added after an underrun, a frame per period. */
+    if (s->target > MAX(s->base, min_target))
+        s->target--;
+}
+
+static void
+sound_out_mix(float *out, int frames)
+{
+    const float gain = (float) pow(10.0, (double) sound_gain / 20.0);
+
+    memset(out, 0, frames * 2 * sizeof(float));
+
+    for (int c = 0; c < SOUND_OUT_STREAMS; c++)
+        sound_out_stream_mix(&streams[c], out, frames);
+
+    for (int c = 0; c < (frames << 1); c++)
+        out[c] *= gain;
+}
+
+/* Returns the underruns and overruns of a stream since the output stage
+   was started, and the rate nudge currently applied to it. */
+void
+sound_out_get_stats(int stream, uint32_t *underruns, uint32_t *overruns, int *drift_ppm)
+{
+    const sound_out_stream_t *s = &streams[stream];
+
+    *underruns = atomic_load_explicit(&s->underruns, memory_order_relaxed);
+    *overruns  = atomic_load_explicit(&s->overruns, memory_order_relaxed);
+    *drift_ppm = atomic_load_explicit(&s->drift, memory_order_relaxed);
+}
+
+#ifdef ENABLE_SOUND_OUT_LOG
+/* Logs the underruns and overruns of each stream since the last report,
+   for the streams where either count has changed. */
+static void
+sound_out_report(void)
+{
+    uint32_t underruns;
+    uint32_t overruns;
+    int      drift_ppm;
+
+    for (int c = 0; c < SOUND_OUT_STREAMS; c++) {
+        sound_out_stream_t *s = &streams[c];
+
+        sound_out_get_stats(c, &underruns, &overruns, &drift_ppm);
+        if ((underruns != s->reported_underruns) || (overruns != s->reported_overruns)) {
+            sound_out_log("sound_out: %s stream had %u underruns and %u overruns in the last second, drift %i ppm\n",
+                          stream_names[c], underruns - s->reported_underruns, overruns - s->reported_overruns, drift_ppm);
+            s->reported_underruns = underruns;
+            s->reported_overruns  = overruns;
+        }
+    }
+}
+#endif
+
+static void
+sound_out_thread(UNUSED(void *priv))
+{
+#ifdef ENABLE_SOUND_OUT_LOG
+    uint32_t report = plat_get_ticks();
+#endif
+
+    while (atomic_load_explicit(&sound_out_running, memory_order_acquire)) {
+        while (sink->queued() < SOUND_OUT_QUEUE) {
+            sound_out_mix(sound_out_buf, SOUND_OUT_PERIOD);
+            sink->write(sound_out_buf, SOUND_OUT_PERIOD);
+        }
+
+#ifdef ENABLE_SOUND_OUT_LOG
+        if ((plat_get_ticks() - report) >= 1000) {
+            sound_out_report();
+            report = plat_get_ticks();
+        }
+#endif
+
+        thread_wait_event(sound_out_stop_event, 2);
+    }
+}
+
+void
+sound_out_init(void)
+{
+    uint32_t size     = 8192;
+    int      sink_num = sound_sink;
+
+    if ((sound_latency <= 0) || atomic_load(&sound_out_running))
+        return;
+
+    /* Clamp copies, so the configured values are saved as they were. */
+    sound_out_latency = MIN(sound_latency, 500);
+    if ((sink_num < SOUND_SINK_DEVICE) || (sink_num > SOUND_SINK_NULL))
+        sink_num = SOUND_SINK_DEVICE;
+
+    /* Room for four times the latency at the highest stream rate, plus the
+       largest buffer a producer gives. */
+    while (size < (uint32_t) (((sound_out_latency * FREQ_96000) / 250) + 8192))
+        size <<= 1;
+
+    sink = &sinks[sink_num];
+    if (sink->open(SOUND_FREQ)) {
+        sound_out_log("sound_out: Unable to open sink %i\n", sink_num);
+        return;
+    }
+
+    /* No producer can be inside sound_out_give() here: sound_out_close()
+       waited for the last one to leave, and none get past the check of
+       sound_out_running until it is set below. */
+    for (int c = 0; c < SOUND_OUT_STREAMS; c++) {
+        sound_out_stream_t *s   = &streams[c];
+        float              *buf = s->buf;
+
+        if (s->size != size) {
+            free(buf);
+            buf = (float *) calloc(size * 2, sizeof(float));
+        }
+
+        memset(s, 0, sizeof(sound_out_stream_t));
+        s->buf  = buf;
+        s->size = size;
+    }
+
+    sound_out_log("sound_out: %i ms, %u frame rings, sink %i\n", sound_out_latency, size, sink_num);
+
+    sound_out_stop_event = thread_create_event();
+    atomic_store(&sound_out_running, 1);
+    sound_out_thread_h = thread_create(sound_out_thread, NULL);
+}
+
+void
+sound_out_close(void)
+{
+    if (!atomic_load(&sound_out_running))
+        return;
+
+    atomic_store(&sound_out_running, 0);
+    thread_set_event(sound_out_stop_event);
+    thread_wait(sound_out_thread_h);
+    thread_destroy_event(sound_out_stop_event);
+    sound_out_thread_h   = NULL;
+    sound_out_stop_event = NULL;
+
+    /* The MIDI and CD audio threads give buffers on their own, so wait for
+       any that are still writing to a ring. */
+    while (atomic_load(&sound_out_givers))
+        plat_delay_ms(1);
+
+    sink->close();
+
+#ifdef ENABLE_SOUND_OUT_LOG
+    for (int c = 0; c < SOUND_OUT_STREAMS; c++) {
+        sound_out_log("sound_out: Stream %i: %u underruns, %u overruns\n", c,
+                      atomic_load(&streams[c].underruns), atomic_load(&streams[c].overruns));
+    }
+#endif
+}
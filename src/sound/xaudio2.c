@@ -55,6 +55,7 @@ static IXAudio2SourceVoice    *srcvoicemusic = NULL;
 static IXAudio2SourceVoice    *srcvoicewt    = NULL;
 static IXAudio2SourceVoice    *srcvoicemidi  = NULL;
 static IXAudio2SourceVoice    *srcvoicecd    = NULL;
+static IXAudio2SourceVoice    *srcvoiceout   = NULL;
 
 #define FREQ   SOUND_FREQ
 #define BUFLEN SOUNDBUFLEN
@@ -209,6 +210,7 @@ closeal(void)
 {
     if (!initialized)
         return;
+    sound_out_close();
     initialized = 0;
     (void) IXAudio2SourceVoice_Stop(srcvoice, 0, XAUDIO2_COMMIT_NOW);
     (void) IXAudio2SourceVoice_FlushSourceBuffers(srcvoice);
@@ -269,25 +271,28 @@ givealbuffer_common(const void *buf, IXAudio2SourceVoice *sourcevoice, const siz
 void
 givealbuffer(const void *buf)
 {
-    givealbuffer_common(buf, srcvoice, BUFLEN << 1);
+    if (!sound_out_give(0, buf, BUFLEN << 1, FREQ))
+        givealbuffer_common(buf, srcvoice, BUFLEN << 1);
 }
 
 void
 givealbuffer_music(const void *buf)
 {
-    givealbuffer_common(buf, srcvoicemusic, MUSICBUFLEN << 1);
+    if (!sound_out_give(1, buf, MUSICBUFLEN << 1, MUSIC_FREQ))
+        givealbuffer_common(buf, srcvoicemusic, MUSICBUFLEN << 1);
 }
 
 void
 givealbuffer_wt(const void *buf)
 {
-    givealbuffer_common(buf, srcvoicewt, WTBUFLEN << 1);
+    if (!sound_out_give(2, buf, WTBUFLEN << 1, WT_FREQ))
+        givealbuffer_common(buf, srcvoicewt, WTBUFLEN << 1);
 }
 
 void
 givealbuffer_cd(const void *buf)
 {
-    if (srcvoicecd)
+    if (!sound_out_give(3, buf, CD_BUFLEN << 1, CD_FREQ) && srcvoicecd)
         givealbuffer_common(buf, srcvoicecd, CD_BUFLEN << 1);
 }
 
@@ -323,5 +328,78 @@ al_set_midi(const int freq, const int buf_size)
 void
 givealbuffer_midi(const void *buf, const uint32_t size)
 {
-    givealbuffer_common(buf, srcvoicemidi, size);
+    if (!sound_out_give(4, buf, (int) size, midi_freq))
+        givealbuffer_common(buf, srcvoicemidi, size);
+}
+
+int
+al_out_open(const int freq)
+{
+    WAVEFORMATEX fmt;
+
+    if (!initialized)
+        return 1;
+
+    fmt.nChannels       = 2;
+    fmt.wFormatTag      = WAVE_FORMAT_IEEE_FLOAT;
+    fmt.wBitsPerSample  = 32;
+    fmt.nSamplesPerSec  = freq;
+    fmt.nBlockAlign     = fmt.nChannels * fmt.wBitsPerSample / 8;
+    fmt.nAvgBytesPerSec = fmt.nSamplesPerSec * fmt.nBlockAlign;
+    fmt.cbSize          = 0;
+
+    if (IXAudio2_CreateSourceVoice(xaudio2, &srcvoiceout, &fmt, 0, 2.0f, &callbacks, NULL, NULL)) {
+        srcvoiceout = NULL;
+        return 1;
+    }
+
+    /* The output stage applies the gain itself. */
+    (void) IXAudio2MasteringVoice_SetVolume(mastervoice, 1.0f, XAUDIO2_COMMIT_NOW);
+    (void) IXAudio2SourceVoice_Start(srcvoiceout, 0, XAUDIO2_COMMIT_NOW);
+
+    return 0;
+}
+
+void
+al_out_close(void)
+{
+    if (srcvoiceout == NULL)
+        return;
+
+    (void) IXAudio2SourceVoice_Stop(srcvoiceout, 0, XAUDIO2_COMMIT_NOW);
+    (void) IXAudio2SourceVoice_FlushSourceBuffers(srcvoiceout);
+    IXAudio2SourceVoice_DestroyVoice(srcvoiceout);
+    srcvoiceout = NULL;
+}
+
+int
+al_out_queued(void)
+{
+    XAUDIO2_VOICE_STATE state;
+
+    if (srcvoiceout == NULL)
+        return 0;
+
+    IXAudio2SourceVoice_GetState(srcvoiceout, &state, 0);
+
+    /* The output stage always writes whole periods. */
+    return (int) state.BuffersQueued * SOUND_OUT_PERIOD;
+}
+
+void
+al_out_write(const float *buf, const int frames)
+{
+    XAUDIO2_BUFFER buffer = { 0 };
+
+    if (srcvoiceout == NULL)
+        return;
+
+    buffer.AudioBytes = frames * 2 * sizeof(float);
+    buffer.pAudioData = malloc(buffer.AudioBytes);
+    if (buffer.pAudioData == NULL)
+        fatal("xaudio2: Out Of Memory!");
+    memcpy((void *) buffer.pAudioData, buf, buffer.AudioBytes);
+    buffer.PlayLength = frames;
+    buffer.pContext   = (void *) buffer.pAudioData;
+    (void) IXAudio2SourceVoice_SubmitSourceBuffer(srcvoiceout, &buffer, NULL);
 }
@@ -1330,6 +1330,13 @@ main(int argc, char **argv)
                             case SDL_WINDOWEVENT_LEAVE:
                                 mouse_inside = 0;
                                 break;
+                            case SDL_WINDOWEVENT_MINIMIZED:
+                                video_minimized = 1;
+                                break;
+                            case SDL_WINDOWEVENT_RESTORED:
+                            case SDL_WINDOWEVENT_MAXIMIZED:
+                                video_minimized = 0;
+                                break;
                         }
                     }
             }
@@ -41,6 +41,7 @@
 #include <86box/vid_svga_render.h>
 #include <86box/vid_ati_eeprom.h>
 #include <86box/vid_ati_mach8.h>
+#include <86box/vid_rop.h>
 #include "cpu.h"
 
 #define BIOS_MACH8_ROM_PATH  "roms/video/mach8/11301113140_4k.BIN"
@@ -980,6 +981,143 @@ ibm8514_short_stroke_start(int count, int cpu_input, uint32_t mix_dat, uint32_t
     ibm8514_accel_start(count, cpu_input, mix_dat, cpu_dat, svga, len);
 }
 
+/*Draws all but the last pixel of the current rectangle fill or BitBlt line
+  as a single ROP3 span, and leaves the engine state as if the per-pixel loop
+  had drawn them, so that the end of line bookkeeping stays in one place.
+  The caller has already checked that the line uses the foreground mix with a
+  logical (0-15) mix code and no colour compare. Returns 0, having drawn
+  nothing, if the line is clipped, wraps around video memory, or overlaps its
+  source in a way the pixel order makes visible.*/
+static int
+ibm8514_accel_span(ibm8514_t *dev, int blit, uint16_t src_col, uint16_t wrt_mask,
+                   int16_t clip_t, int16_t clip_l, uint16_t clip_b, uint16_t clip_r)
+{
+    int         count = dev->accel.sx;
+    int         bpp   = dev->bpp ? 2 : 1;
+    uint32_t    mask  = dev->bpp ? (dev->vram_mask >> 1) : dev->vram_mask;
+    int         xinc  = (dev->accel.cmd & 0x20) ? 1 : -1;
+    int         x     = blit ? dev->accel.dx : dev->accel.cx;
+    int         y     = blit ? dev->accel.dy : dev->accel.cy;
+    int         x_l   = (xinc > 0) ? x : (x - count + 1);
+    uint32_t    dst;
+    uint32_t    src = 0;
+    rop3_span_t span;
+
+    if (count <= 0)
+        return 0;
+    if ((y < clip_t) || (y > clip_b) || (x_l < clip_l) || ((x_l + count - 1) > clip_r))
+        return 0;
+
+    dst = (dev->accel.dest + x_l) & mask;
+    if ((dst + count) > (mask + 1))
+        return 0;
+
+    if (blit && (((dev->accel.frgd_mix >> 5) & 3) == 3)) {
+        src = (dev->accel.src + ((xinc > 0) ? dev->accel.cx : (dev->accel.cx - count + 1))) & mask;
+        if ((src + count) > (mask + 1))
+            return 0;
+        if ((dst < (src + count)) && (src < (dst + count)) && ((xinc < 0) || (dst > src)))
+            return 0;
+        span.src = &dev->vram[src * bpp];
+    } else
+        span.src = NULL;
+
+    span.dst      = &dev->vram[dst * bpp];
+    span.pat      = NULL;
+    span.src_col  = src_col;
+    span.pat_col  = 0;
+    span.wrt_mask = wrt_mask;
+    span.bpp      = bpp;
+    span.count    = count;
+    rop3_span(rop3_mix[dev->accel.frgd_mix & 0x0f], &span);
+
+    for (uint32_t page = (dst * bpp) >> 12; page <= (((dst + count) * bpp - 1) >> 12); page++)
+        dev->changedvram[page] = changeframecount;
+
+    if (blit)
+        dev->accel.dx += count * xinc;
+    dev->accel.cx += count * xinc;
+    dev->accel.sx -= count;
+    return 1;
+}
+
+/*Fixed pattern (PIXCNTL 1) counterpart of the above for rectangle fills.
+  The pattern bit picks the foreground or background mix per pixel, which
+  is a single ROP3 with the bit expanded into the pattern operand and the
+  selected colour as the source. The pattern shift register is stepped
+  exactly as the per-pixel loop steps it. The caller has already checked
+  that both mixes are logical and there is no colour compare.*/
+static int
+ibm8514_accel_pattern_span(ibm8514_t *dev, uint32_t *mix_dat, uint16_t mix_mask, uint16_t frgd_color, uint16_t bkgd_color,
+                           uint16_t wrt_mask, int16_t clip_t, int16_t clip_l, uint16_t clip_b, uint16_t clip_r)
+{
+    uint8_t     src_buf[2048 * 2];
+    uint8_t     pat_buf[2048 * 2];
+    int         count     = dev->accel.sx;
+    int         bpp       = dev->bpp ? 2 : 1;
+    uint32_t    mask      = dev->bpp ? (dev->vram_mask >> 1) : dev->vram_mask;
+    int         xinc      = (dev->accel.cmd & 0x20) ? 1 : -1;
+    int         x_l       = (xinc > 0) ? dev->accel.cx : (dev->accel.cx - count + 1);
+    int         frgd_mix  = (dev->accel.frgd_mix >> 5) & 3;
+    int         bkgd_mix  = (dev->accel.bkgd_mix >> 5) & 3;
+    uint16_t    frgd_src  = (frgd_mix == 0) ? bkgd_color : ((frgd_mix == 1) ? frgd_color : 0);
+    uint16_t    bkgd_src  = (bkgd_mix == 0) ? bkgd_color : ((bkgd_mix == 1) ? frgd_color : 0);
+    uint32_t    dst;
+    rop3_span_t span;
+
+    if (count <= 0)
+        return 0;
+    if ((dev->accel.cy < clip_t) || (dev->accel.cy > clip_b) || (x_l < clip_l) || ((x_l + count - 1) > clip_r))
+        return 0;
+
+    dst = (dev->accel.dest + x_l) & mask;
+    if ((dst + count) > (mask + 1))
+        return 0;
+
+    for (int c = 0; c < count; c++) {
+        int      o;
+        uint16_t col;
+
+        if (!dev->accel.temp_cnt) {
+            *mix_dat >>= 8;
+            dev->accel.temp_cnt = 8;
+        }
+
+        o   = ((xinc > 0) ? c : (count - 1 - c)) * bpp;
+        col = (*mix_dat & mix_mask) ? frgd_src : bkgd_src;
+
+        src_buf[o] = col;
+        pat_buf[o] = (*mix_dat & mix_mask) ? 0xff : 0x00;
+        if (bpp == 2) {
+            src_buf[o + 1] = col >> 8;
+            pat_buf[o + 1] = pat_buf[o];
+        }
+
+        if (dev->accel.temp_cnt > 0) {
+            dev->accel.temp_cnt--;
+            *mix_dat <<= 1;
+            *mix_dat |= 1;
+        }
+    }
+
+    span.dst      = &dev->vram[dst * bpp];
+    span.src      = src_buf;
+    span.pat      = pat_buf;
+    span.src_col  = 0;
+    span.pat_col  = 0;
+    span.wrt_mask = wrt_mask;
+    span.bpp      = bpp;
+    span.count    = count;
+    rop3_span((rop3_mix[dev->accel.frgd_mix & 0x0f] & 0xf0) | (rop3_mix[dev->accel.bkgd_mix & 0x0f] & 0x0f), &span);
+
+    for (uint32_t page = (dst * bpp) >> 12; page <= (((dst + count) * bpp - 1) >> 12); page++)
+        dev->changedvram[page] = changeframecount;
+
+    dev->accel.cx += count * xinc;
+    dev->accel.sx -= count;
+    return 1;
+}
+
 void
 ibm8514_accel_start(int count, int cpu_input, uint32_t mix_dat, uint32_t cpu_dat, svga_t *svga, UNUSED(int len))
 {
@@ -2117,6 +2255,11 @@ skip_nibble_rect_write:
                         if (dev->accel.cmd & 0x40) {
                             count = (dev->accel.maj_axis_pcnt & 0x7ff) + 1;
                             dev->accel.temp_cnt = 8;
+                            if ((compare_mode == 0) && !(dev->accel.frgd_mix & 0x10) && !(dev->accel.bkgd_mix & 0x10) &&
+                                (dev->accel.sy >= 0) && (dev->accel.sx == (dev->accel.maj_axis_pcnt & 0x7ff))) {
+                                if (ibm8514_accel_pattern_span(dev, &mix_dat, mix_mask, frgd_color, bkgd_color, wrt_mask, clip_t, clip_l, clip_b, clip_r))
+                                    count = 1;
+                            }
                             while (count-- && dev->accel.sy >= 0) {
                                 if (!dev->accel.temp_cnt) {
                                     mix_dat >>= 8;
@@ -2361,8 +2504,13 @@ skip_nibble_rect_write:
                             }
                         }
                     } else {
+                        int span = (frgd_mix != 0) && (compare_mode == 0) && !(dev->accel.frgd_mix & 0x10) && (dev->accel.cmd & 0x10);
+
                         ibm8514_log("Polygon Draw Type=%02x, CX=%d, CY=%d, SY=%d, CL=%d, CR=%d.\n", dev->accel.multifunc[0x0a] & 0x06, dev->accel.cx, dev->accel.cy, dev->accel.sy, clip_l, clip_r);
                         while (count-- && (dev->accel.sy >= 0)) {
+                            if (span && (dev->accel.sx == (dev->accel.maj_axis_pcnt & 0x7ff)))
+                                ibm8514_accel_span(dev, 0, (frgd_mix == 1) ? frgd_color : 0, wrt_mask, clip_t, clip_l, clip_b, clip_r);
+
                             if ((dev->accel.cx >= clip_l) &&
                                 (dev->accel.cx <= clip_r) &&
                                 (dev->accel.cy >= clip_t) &&
@@ -3136,7 +3284,12 @@ skip_nibble_bitblt_write:
                             }
                         }
                     } else {
+                        int span = (pixcntl != 3) && (frgd_mix != 0) && (compare_mode == 0) && !(dev->accel.frgd_mix & 0x10);
+
                         while (count-- && dev->accel.sy >= 0) {
+                            if (span && (dev->accel.sx == (dev->accel.maj_axis_pcnt & 0x7ff)))
+                                ibm8514_accel_span(dev, 1, (frgd_mix == 1) ? frgd_color : 0, wrt_mask, clip_t, clip_l, clip_b, clip_r);
+
                             if ((dev->accel.dx >= clip_l) &&
                                 (dev->accel.dx <= clip_r) &&
                                 (dev->accel.dy >= clip_t) &&
@@ -38,6 +38,7 @@
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_rop.h>
 #include <86box/vid_ati_eeprom.h>
 
 #ifdef CLAMP
@@ -1600,6 +1601,85 @@ mach64_start_line(mach64_t *mach64)
         svga->changedvram[(((addr) >> 3) & mach64->vram_mask) >> 12] = svga->monitor->mon_changeframecount;    \
     }
 
+/*Draws all but the last pixel of the current OP_RECT line as a single ROP3
+  span, for the common solid fill and screen to screen copy cases at 8, 16
+  and 32 bpp, and leaves the blitter state as if the per-pixel loop had
+  drawn them. The last pixel is left to the per-pixel loop so that the end
+  of line bookkeeping stays in one place. Returns 0, having drawn nothing,
+  if the line needs any per-pixel work (clipping, colour compare, patterns,
+  polygon fill, 24bpp rotation, source wrap) or would overlap its source in
+  a way the pixel order makes visible.*/
+static int
+mach64_blit_span(mach64_t *mach64)
+{
+    svga_t     *svga  = &mach64->svga;
+    int         count = mach64->accel.x_count - 1;
+    int         bpp   = 1 << mach64->accel.dst_size;
+    int         xinc  = mach64->accel.xinc;
+    int         dst_x = mach64->accel.dst_x + mach64->accel.dst_x_start;
+    int         dst_y = (mach64->accel.dst_y + mach64->accel.dst_y_start) & 0x3fff;
+    int         dst_l = (xinc > 0) ? dst_x : (dst_x - count + 1);
+    uint32_t    dst;
+    uint32_t    src = 0;
+    rop3_span_t span;
+
+    if ((count <= 0) || (mach64->accel.dst_size > 2) || (mach64->accel.source_mix != MONO_SRC_1) || (mach64->accel.mix_fg > 0xf))
+        return 0;
+    if ((mach64->accel.source_fg != SRC_FG) && ((mach64->accel.source_fg != SRC_BLITSRC) || (mach64->accel.src_size != mach64->accel.dst_size)))
+        return 0;
+    if ((mach64->dst_cntl & (DST_24_ROT_EN | DST_POLYGON_EN)) || (mach64->accel.clr_cmp_fn == 1) || (mach64->accel.clr_cmp_fn == 4) || (mach64->accel.clr_cmp_fn == 5))
+        return 0;
+    if ((dst_l < 0) || ((dst_l + count - 1) > 0xfff) || (dst_l < mach64->accel.sc_left) || ((dst_l + count - 1) > mach64->accel.sc_right) ||
+        (dst_y < mach64->accel.sc_top) || (dst_y > mach64->accel.sc_bottom))
+        return 0;
+
+    dst = ((mach64->accel.dst_offset + (dst_y * mach64->accel.dst_pitch) + dst_l) << mach64->accel.dst_size) & mach64->vram_mask;
+    if ((dst + (count * bpp)) > (mach64->vram_mask + 1))
+        return 0;
+
+    if (mach64->accel.source_fg == SRC_BLITSRC) {
+        int src_x = mach64->accel.src_x;
+        int src_y = (mach64->accel.src_y + mach64->accel.src_y_start) & 0x3fff;
+        int src_l;
+
+        if (!(mach64->src_cntl & SRC_LINEAR_EN)) {
+            if (mach64->accel.src_x_count <= count)
+                return 0;
+            src_x += mach64->accel.src_x_start;
+        }
+        src_l = (xinc > 0) ? src_x : (src_x - count + 1);
+        if (!(mach64->src_cntl & SRC_LINEAR_EN) && ((src_l < 0) || ((src_l + count - 1) > 0xfff)))
+            return 0;
+
+        src = ((mach64->accel.src_offset + (src_y * mach64->accel.src_pitch) + src_l) << mach64->accel.dst_size) & mach64->vram_mask;
+        if ((src + (count * bpp)) > (mach64->vram_mask + 1))
+            return 0;
+        if ((dst < (src + (count * bpp))) && (src < (dst + (count * bpp))) && ((xinc < 0) || (dst > src)))
+            return 0;
+    }
+
+    span.dst      = &svga->vram[dst];
+    span.src      = (mach64->accel.source_fg == SRC_BLITSRC) ? &svga->vram[src] : NULL;
+    span.pat      = NULL;
+    span.src_col  = mach64->accel.dp_frgd_clr;
+    span.pat_col  = 0;
+    span.wrt_mask = mach64->accel.write_mask;
+    span.bpp      = bpp;
+    span.count    = count;
+    rop3_span(rop3_mix[mach64->accel.mix_fg], &span);
+
+    for (uint32_t page = dst >> 12; page <= ((dst + (count * bpp) - 1) >> 12); page++)
+        svga->changedvram[page] = svga->monitor->mon_changeframecount;
+
+    mach64->accel.src_x += count * xinc;
+    mach64->accel.dst_x += count * xinc;
+    if (!(mach64->src_cntl & SRC_LINEAR_EN))
+        mach64->accel.src_x_count -= count;
+    mach64->accel.x_count -= count;
+    mach64->accel.xx_count = (mach64->accel.xx_count + count) % 3;
+    return 1;
+}
+
 void
 mach64_blit(uint32_t cpu_dat, int count, mach64_t *mach64)
 {
@@ -1625,6 +1705,9 @@ mach64_blit(uint32_t cpu_dat, int count, mach64_t *mach64)
                 int      src_x;
                 int      src_y;
 
+                if ((count < 0) && (mach64->accel.x_count == mach64->accel.dst_width))
+                    mach64_blit_span(mach64);
+
                 dst_x = (mach64->accel.dst_x + mach64->accel.dst_x_start) & 0xfff;
                 dst_y = (mach64->accel.dst_y + mach64->accel.dst_y_start) & 0x3fff;
 
@@ -2879,12 +2962,17 @@ mach64_ext_readb(uint32_t addr, void *priv)
 
             case 0x310:
             case 0x311:
-                if (!mach64->blitter_busy)
-                    wake_fifo_thread(mach64);
+                {
+                    /*One bit per occupied slot of the 16 entry hardware
+                      FIFO, scaled from the depth of the software queue.*/
+                    uint32_t fifo_used = (FIFO_ENTRIES + 4095) >> 12;
+                    uint32_t fifo_stat = (1 << MIN(fifo_used, 16)) - 1;
 
-                ret = 0;
-                if (FIFO_FULL)
-                    ret = 0xff;
+                    if (!mach64->blitter_busy)
+                        wake_fifo_thread(mach64);
+
+                    READ8(addr, fifo_stat);
+                }
                 break;
 
             case 0x320:
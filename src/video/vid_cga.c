@@ -295,16 +295,11 @@ cga_render(cga_t *cga, int line)
             } else
                 cols[0] = (attr >> 4) + 16;
             if (drawcursor) {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 3) + c + 8]
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0] ^ 15;
-                }
-            } else {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 3) + c + 8]
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0];
-                }
+                cols[0] ^= 15;
+                cols[1] ^= 15;
             }
+            video_font_row(&buffer32->line[line][(x << 3) + 8],
+                           fontdat[chr + cga->fontbase][cga->sc & 7], cols[1], cols[0]);
             cga->ma++;
         }
     } else if (!(cga->cgamode & 2)) {
@@ -324,18 +319,11 @@ cga_render(cga_t *cga, int line)
                 cols[0] = (attr >> 4) + 16;
             cga->ma++;
             if (drawcursor) {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 4) + (c << 1) + 8]
-                        = buffer32->line[line][(x << 4) + (c << 1) + 9]
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0] ^ 15;
-                }
-            } else {
-                for (c = 0; c < 8; c++) {
-                    buffer32->line[line][(x << 4) + (c << 1) + 8]
-                        = buffer32->line[line][(x << 4) + (c << 1) + 9] 
-                        = cols[(fontdat[chr + cga->fontbase][cga->sc & 7] & (1 << (c ^ 7))) ? 1 : 0];
-                }
+                cols[0] ^= 15;
+                cols[1] ^= 15;
             }
+            video_font_row_wide(&buffer32->line[line][(x << 4) + 8],
+                                fontdat[chr + cga->fontbase][cga->sc & 7], cols[1], cols[0]);
         }
     } else if (!(cga->cgamode & 16)) {
         cols[0] = (cga->cgacol & 15) | 16;
@@ -529,25 +517,31 @@ cga_poll(void *priv)
         if (cga->cgadispon) {
             if (cga->displine < cga->firstline) {
                 cga->firstline = cga->displine;
-                video_wait_for_buffer();
+                if (!cga->frame_skip)
+                    video_wait_for_buffer();
             }
             cga->lastline = cga->displine;
-            switch (cga->double_type) {
-                default:
-                    cga_render(cga, cga->displine << 1);
-                    cga_render_blank(cga, (cga->displine << 1) + 1);
-                    break;
-                case DOUBLE_NONE:
-                    cga_render(cga, cga->displine);
-                    break;
-                case DOUBLE_SIMPLE:
-                    old_ma = cga->ma;
-                    cga_render(cga, cga->displine << 1);
-                    cga->ma = old_ma;
-                    cga_render(cga, (cga->displine << 1) + 1);
-                    break;
+            if (cga->frame_skip) {
+                /* Keep the address counter moving as cga_render() would. */
+                cga->ma += cga->crtc[1];
+            } else {
+                switch (cga->double_type) {
+                    default:
+                        cga_render(cga, cga->displine << 1);
+                        cga_render_blank(cga, (cga->displine << 1) + 1);
+                        break;
+                    case DOUBLE_NONE:
+                        cga_render(cga, cga->displine);
+                        break;
+                    case DOUBLE_SIMPLE:
+                        old_ma = cga->ma;
+                        cga_render(cga, cga->displine << 1);
+                        cga->ma = old_ma;
+                        cga_render(cga, (cga->displine << 1) + 1);
+                        break;
+                }
             }
-        } else {
+        } else if (!cga->frame_skip) {
             switch (cga->double_type) {
                 default:
                     cga_render_blank(cga, cga->displine << 1);
@@ -562,14 +556,16 @@ cga_poll(void *priv)
             }
         }
 
-        switch (cga->double_type) {
-            default:
-                cga_render_process(cga, cga->displine << 1);
-                cga_render_process(cga, (cga->displine << 1) + 1);
-                break;
-            case DOUBLE_NONE:
-                cga_render_process(cga, cga->displine);
-                break;
+        if (!cga->frame_skip) {
+            switch (cga->double_type) {
+                default:
+                    cga_render_process(cga, cga->displine << 1);
+                    cga_render_process(cga, (cga->displine << 1) + 1);
+                    break;
+                case DOUBLE_NONE:
+                    cga_render_process(cga, cga->displine);
+                    break;
+            }
         }
 
         cga->sc = oldsc;
@@ -670,20 +666,22 @@ cga_poll(void *priv)
                                 video_force_resize_set(0);
                         }
 
-                        if (cga->double_type > DOUBLE_NONE) {
-                            if (enable_overscan)
-                                cga_blit_memtoscreen(cga, 0, (cga->firstline - 4) << 1,
-                                                     xsize, ((cga->lastline - cga->firstline) << 1) + 16);
-                            else
-                                cga_blit_memtoscreen(cga, 8, cga->firstline << 1,
-                                                     xsize, (cga->lastline - cga->firstline) << 1);
-                        } else {
-                            if (enable_overscan)
-                                video_blit_memtoscreen(0, cga->firstline - 4,
-                                                       xsize, (cga->lastline - cga->firstline) + 8);
-                            else
-                                video_blit_memtoscreen(8, cga->firstline,
-                                                       xsize, cga->lastline - cga->firstline);
+                        if (!cga->frame_skip) {
+                            if (cga->double_type > DOUBLE_NONE) {
+                                if (enable_overscan)
+                                    cga_blit_memtoscreen(cga, 0, (cga->firstline - 4) << 1,
+                                                         xsize, ((cga->lastline - cga->firstline) << 1) + 16);
+                                else
+                                    cga_blit_memtoscreen(cga, 8, cga->firstline << 1,
+                                                         xsize, (cga->lastline - cga->firstline) << 1);
+                            } else {
+                                if (enable_overscan)
+                                    video_blit_memtoscreen(0, cga->firstline - 4,
+                                                           xsize, (cga->lastline - cga->firstline) + 8);
+                                else
+                                    video_blit_memtoscreen(8, cga->firstline,
+                                                           xsize, cga->lastline - cga->firstline);
+                            }
                         }
                     }
 
@@ -709,6 +707,7 @@ cga_poll(void *priv)
                 cga->lastline  = 0;
                 cga->cgablink++;
                 cga->oddeven ^= 1;
+                cga->frame_skip = video_frame_skip();
             }
         } else {
             cga->sc++;
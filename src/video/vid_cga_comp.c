@@ -29,6 +29,14 @@
 #include <86box/vid_cga.h>
 #include <86box/vid_cga_comp.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define COMPOSITE_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define COMPOSITE_NEON
+#    include <arm_neon.h>
+#endif
+
 int CGA_Composite_Table[1024];
 
 static double brightness = 0;
@@ -86,6 +94,25 @@ int    tandy_mode_control = 0;
 
 static bool new_cga = 0;
 
+/*The decode coefficients are whole numbers, keep integer copies so the
+  per-pixel math does not have to go through double. That is only exact
+  while no sum can leave the int range, which coef_exact tracks; extreme
+  picture settings fall back to the double math.*/
+static int coef_exact;
+static int coef_ri;
+static int coef_rq;
+static int coef_gi;
+static int coef_gq;
+static int coef_bi;
+static int coef_bq;
+
+/*Last decoded line. Consecutive lines are often identical (doubled lines
+  on PCjr/Tandy, blank lines, repeated text rows), these are served by a
+  copy instead of a full decode. Cleared whenever the tables change.*/
+static uint32_t cache_blocks = 0;
+static uint8_t  cache_mode;
+static uint8_t  cache_border;
+
 void
 update_cga16_color(uint8_t cgamode)
 {
@@ -101,6 +128,9 @@ update_cga16_color(uint8_t cgamode)
     double i0;
     double i3;
     double mode_saturation;
+    double max_sig;
+    double max_y;
+    double max_coef;
 
     static const double ri = 0.9563;
     static const double rq = 0.6210;
@@ -170,6 +200,25 @@ update_cga16_color(uint8_t cgamode)
     video_bi        = (int) (bi * iq_adjust_i + bq * iq_adjust_q);
     video_bq        = (int) (-bi * iq_adjust_q + bq * iq_adjust_i);
     video_sharpness = (int) (sharpness * 256 / 100);
+
+    /*Bound every term: the chroma-removed signal is within 16 times and
+      both chroma components within 8 times the largest table entry.*/
+    max_sig = 0;
+    for (uint16_t x = 0; x < 1024; ++x)
+        max_sig = MAX(max_sig, fabs((double) CGA_Composite_Table[x]));
+    max_y    = 64.0 * max_sig * 256.0 + fabs((double) video_sharpness) * 64.0 * max_sig;
+    max_coef = MAX(fabs(video_ri) + fabs(video_rq), MAX(fabs(video_gi) + fabs(video_gq), fabs(video_bi) + fabs(video_bq)));
+
+    coef_exact = ((max_y + max_coef * 8.0 * max_sig) < 2147483647.0);
+
+    coef_ri = (int) video_ri;
+    coef_rq = (int) video_rq;
+    coef_gi = (int) video_gi;
+    coef_gq = (int) video_gq;
+    coef_bi = (int) video_bi;
+    coef_bq = (int) video_bq;
+
+    cache_blocks = 0;
 }
 
 static uint8_t
@@ -186,38 +235,222 @@ static int temp[SCALER_MAXWIDTH + 10] = { 0 };
 static int atemp[SCALER_MAXWIDTH + 2] = { 0 };
 static int btemp[SCALER_MAXWIDTH + 2] = { 0 };
 
+static uint32_t cache_in[SCALER_MAXWIDTH];
+static uint32_t cache_out[SCALER_MAXWIDTH];
+
+#if defined(COMPOSITE_SSE2)
+/*SSE2 has no 32-bit low multiply; the low halves of the unsigned 32x32
+  products are the same as the signed ones. b must hold the same value in
+  every lane.*/
+static __inline __m128i
+composite_mullo(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), b);
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/*byte_clamp() on four lanes.*/
+static __inline __m128i
+composite_clamp(__m128i v)
+{
+    __m128i v16 = _mm_packs_epi32(_mm_srai_epi32(v, 13), _mm_setzero_si128());
+
+    v16 = _mm_min_epi16(_mm_max_epi16(v16, _mm_setzero_si128()), _mm_set1_epi16(255));
+    return _mm_unpacklo_epi16(v16, _mm_setzero_si128());
+}
+
+/*Luma for four pixels; i[-1] to i[4] must be valid.*/
+static __inline __m128i
+composite_luma(const int *i, int shift, __m128i sharp)
+{
+    __m128i l = _mm_slli_epi32(_mm_loadu_si128((const __m128i *) &i[-1]), shift);
+    __m128i m = _mm_slli_epi32(_mm_loadu_si128((const __m128i *) &i[0]), shift);
+    __m128i r = _mm_slli_epi32(_mm_loadu_si128((const __m128i *) &i[1]), shift);
+    __m128i c = _mm_add_epi32(m, m);
+    __m128i d = _mm_add_epi32(l, r);
+
+    return _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(c, d), 8), composite_mullo(_mm_sub_epi32(c, d), sharp));
+}
+#elif defined(COMPOSITE_NEON)
+static __inline uint32x4_t
+composite_clamp(int32x4_t v)
+{
+    v = vshrq_n_s32(v, 13);
+    return vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(v, vdupq_n_s32(0)), vdupq_n_s32(255)));
+}
+
+static __inline int32x4_t
+composite_luma(const int *i, int shift, int32x4_t sharp)
+{
+    int32x4_t sh = vdupq_n_s32(shift);
+    int32x4_t l  = vshlq_s32(vld1q_s32(&i[-1]), sh);
+    int32x4_t m  = vshlq_s32(vld1q_s32(&i[0]), sh);
+    int32x4_t r  = vshlq_s32(vld1q_s32(&i[1]), sh);
+    int32x4_t c  = vaddq_s32(m, m);
+    int32x4_t d  = vaddq_s32(l, r);
+
+    return vmlaq_s32(vshlq_n_s32(vaddq_s32(c, d), 8), sharp, vsubq_s32(c, d));
+}
+#endif
+
+/*Monochrome decode of w pixels, i points at the first one.*/
+static void
+composite_decode_mono(const int *i, uint32_t *srgb, int w)
+{
+    int x = 0;
+
+#if defined(COMPOSITE_SSE2)
+    __m128i sharp = _mm_set1_epi32(video_sharpness);
+
+    for (; x <= (w - 4); x += 4) {
+        __m128i v = composite_clamp(composite_luma(&i[x], 3, sharp));
+
+        v = _mm_or_si128(_mm_or_si128(v, _mm_slli_epi32(v, 8)), _mm_slli_epi32(v, 16));
+        _mm_storeu_si128((__m128i *) &srgb[x], v);
+    }
+#elif defined(COMPOSITE_NEON)
+    int32x4_t sharp = vdupq_n_s32(video_sharpness);
+
+    for (; x <= (w - 4); x += 4) {
+        uint32x4_t v = composite_clamp(composite_luma(&i[x], 3, sharp));
+
+        vst1q_u32(&srgb[x], vmulq_n_u32(v, 0x10101));
+    }
+#endif
+    for (; x < w; x++) {
+        int c = (i[x] + i[x]) << 3;
+        int d = (i[x - 1] + i[x + 1]) << 3;
+        int y = ((c + d) << 8) + video_sharpness * (c - d);
+
+        srgb[x] = byte_clamp(y) * 0x10101;
+    }
+}
+
+/*Colour decode of w pixels (a multiple of 4). i holds the chroma-removed
+  signal and ap/bp the two chroma components, all indexed by pixel; the
+  colour burst phase rotates (I, Q) through (a, b), (-b, a), (-a, -b) and
+  (b, -a).*/
+static void
+composite_decode_color(const int *i, const int *ap, const int *bp, uint32_t *srgb, int w)
+{
+    int x = 0;
+
+#if defined(COMPOSITE_SSE2)
+    const __m128i sharp = _mm_set1_epi32(video_sharpness);
+    const __m128i swap  = _mm_set_epi32(-1, 0, -1, 0);
+    const __m128i neg_i = _mm_set_epi32(0, -1, -1, 0);
+    const __m128i neg_q = _mm_set_epi32(-1, -1, 0, 0);
+    const __m128i ri    = _mm_set1_epi32(coef_ri);
+    const __m128i rq    = _mm_set1_epi32(coef_rq);
+    const __m128i gi    = _mm_set1_epi32(coef_gi);
+    const __m128i gq    = _mm_set1_epi32(coef_gq);
+    const __m128i bi    = _mm_set1_epi32(coef_bi);
+    const __m128i bq    = _mm_set1_epi32(coef_bq);
+
+    for (; coef_exact && (x < w); x += 4) {
+        __m128i a  = _mm_loadu_si128((const __m128i *) &ap[x]);
+        __m128i b  = _mm_loadu_si128((const __m128i *) &bp[x]);
+        __m128i ab = _mm_and_si128(swap, _mm_xor_si128(a, b));
+        __m128i iv = _mm_xor_si128(a, ab);
+        __m128i qv = _mm_xor_si128(b, ab);
+        __m128i y  = composite_luma(&i[x], 0, sharp);
+        __m128i rr;
+        __m128i gg;
+        __m128i bb;
+
+        iv = _mm_sub_epi32(_mm_xor_si128(iv, neg_i), neg_i);
+        qv = _mm_sub_epi32(_mm_xor_si128(qv, neg_q), neg_q);
+
+        rr = _mm_add_epi32(y, _mm_add_epi32(composite_mullo(iv, ri), composite_mullo(qv, rq)));
+        gg = _mm_add_epi32(y, _mm_add_epi32(composite_mullo(iv, gi), composite_mullo(qv, gq)));
+        bb = _mm_add_epi32(y, _mm_add_epi32(composite_mullo(iv, bi), composite_mullo(qv, bq)));
+
+        rr = _mm_or_si128(_mm_slli_epi32(composite_clamp(rr), 16), _mm_slli_epi32(composite_clamp(gg), 8));
+        _mm_storeu_si128((__m128i *) &srgb[x], _mm_or_si128(rr, composite_clamp(bb)));
+    }
+#elif defined(COMPOSITE_NEON)
+    static const uint32_t swap_lanes[4] = { 0, 0xffffffff, 0, 0xffffffff };
+    static const int32_t  sign_i[4]     = { 1, -1, -1, 1 };
+    static const int32_t  sign_q[4]     = { 1, 1, -1, -1 };
+    const int32x4_t       sharp         = vdupq_n_s32(video_sharpness);
+    const uint32x4_t      swap          = vld1q_u32(swap_lanes);
+    const int32x4_t       si            = vld1q_s32(sign_i);
+    const int32x4_t       sq            = vld1q_s32(sign_q);
+
+    for (; coef_exact && (x < w); x += 4) {
+        int32x4_t  a  = vld1q_s32(&ap[x]);
+        int32x4_t  b  = vld1q_s32(&bp[x]);
+        int32x4_t  iv = vmulq_s32(vbslq_s32(swap, b, a), si);
+        int32x4_t  qv = vmulq_s32(vbslq_s32(swap, a, b), sq);
+        int32x4_t  y  = composite_luma(&i[x], 0, sharp);
+        int32x4_t  rr = vmlaq_n_s32(vmlaq_n_s32(y, iv, coef_ri), qv, coef_rq);
+        int32x4_t  gg = vmlaq_n_s32(vmlaq_n_s32(y, iv, coef_gi), qv, coef_gq);
+        int32x4_t  bb = vmlaq_n_s32(vmlaq_n_s32(y, iv, coef_bi), qv, coef_bq);
+        uint32x4_t v  = vorrq_u32(vshlq_n_u32(composite_clamp(rr), 16), vshlq_n_u32(composite_clamp(gg), 8));
+
+        vst1q_u32(&srgb[x], vorrq_u32(v, composite_clamp(bb)));
+    }
+#endif
+    for (; x < w; x++) {
+        int a = ap[x];
+        int b = bp[x];
+        int c = i[x] + i[x];
+        int d = i[x - 1] + i[x + 1];
+        int y = ((c + d) << 8) + video_sharpness * (c - d);
+        int iv;
+        int qv;
+        int rr;
+        int gg;
+        int bb;
+
+        switch (x & 3) {
+            default:
+            case 0:
+                iv = a;
+                qv = b;
+                break;
+            case 1:
+                iv = -b;
+                qv = a;
+                break;
+            case 2:
+                iv = -a;
+                qv = -b;
+                break;
+            case 3:
+                iv = b;
+                qv = -a;
+                break;
+        }
+
+        if (coef_exact) {
+            rr = y + coef_ri * iv + coef_rq * qv;
+            gg = y + coef_gi * iv + coef_gq * qv;
+            bb = y + coef_bi * iv + coef_bq * qv;
+        } else {
+            rr = y + video_ri * iv + video_rq * qv;
+            gg = y + video_gi * iv + video_gq * qv;
+            bb = y + video_bi * iv + video_bq * qv;
+        }
+        srgb[x] = (byte_clamp(rr) << 16) | (byte_clamp(gg) << 8) | byte_clamp(bb);
+    }
+}
+
 uint32_t *
 Composite_Process(uint8_t cgamode, uint8_t border, uint32_t blocks /*, bool doublewidth*/, uint32_t *TempLine)
 {
-    uint32_t x2;
-
     int w = blocks * 4;
 
     int            *o;
     const uint32_t *rgbi;
     const int      *b;
     int            *i;
-    uint32_t       *srgb;
     int            *ap;
     int            *bp;
-
-#define COMPOSITE_CONVERT(I, Q)                                                  \
-    do {                                                                         \
-        i[1] = (i[1] << 3) - ap[1];                                              \
-        a    = ap[0];                                                            \
-        b    = bp[0];                                                            \
-        c    = i[0] + i[0];                                                      \
-        d    = i[-1] + i[1];                                                     \
-        y    = ((c + d) << 8) + video_sharpness * (c - d);                       \
-        rr   = y + video_ri * (I) + video_rq * (Q);                              \
-        gg   = y + video_gi * (I) + video_gq * (Q);                              \
-        bb   = y + video_bi * (I) + video_bq * (Q);                              \
-        ++i;                                                                     \
-        ++ap;                                                                    \
-        ++bp;                                                                    \
-        *srgb = (byte_clamp(rr) << 16) | (byte_clamp(gg) << 8) | byte_clamp(bb); \
-        ++srgb;                                                                  \
-    } while (0)
+    int             cacheable = (w <= SCALER_MAXWIDTH);
 
 #define OUT(v)    \
     do {          \
@@ -225,6 +458,15 @@ Composite_Process(uint8_t cgamode, uint8_t border, uint32_t blocks /*, bool doub
         ++o;      \
     } while (0)
 
+    if (cacheable && (blocks == cache_blocks) && (((cgamode ^ cache_mode) & 4) == 0) && (border == cache_border) &&
+        !memcmp(TempLine, cache_in, w * sizeof(uint32_t))) {
+        memcpy(TempLine, cache_out, w * sizeof(uint32_t));
+        return TempLine;
+    }
+
+    if (cacheable)
+        memcpy(cache_in, TempLine, w * sizeof(uint32_t));
+
     /* Simulate CGA composite output */
     o    = temp;
     rgbi = TempLine;
@@ -242,16 +484,7 @@ Composite_Process(uint8_t cgamode, uint8_t border, uint32_t blocks /*, bool doub
 
     if ((cgamode & 4) != 0) {
         /* Decode */
-        i    = temp + 5;
-        srgb = TempLine;
-        for (x2 = 0; x2 < blocks * 4; ++x2) {
-            int c = (i[0] + i[0]) << 3;
-            int d = (i[-1] + i[1]) << 3;
-            int y = ((c + d) << 8) + video_sharpness * (c - d);
-            ++i;
-            *srgb = byte_clamp(y) * 0x10101;
-            ++srgb;
-        }
+        composite_decode_mono(temp + 5, TempLine, w);
     } else {
         /* Store chroma */
         i  = temp + 4;
@@ -263,29 +496,23 @@ Composite_Process(uint8_t cgamode, uint8_t border, uint32_t blocks /*, bool doub
             ++i;
         }
 
+        /* Remove chroma from the signal */
+        i = temp + 5;
+        for (int x = -1; x < w + 1; ++x)
+            i[x] = (i[x] << 3) - ap[x];
+
         /* Decode */
-        i     = temp + 5;
-        i[-1] = (i[-1] << 3) - ap[-1];
-        i[0]  = (i[0] << 3) - ap[0];
-        srgb  = TempLine;
-        for (x2 = 0; x2 < blocks; ++x2) {
-            int y;
-            int a;
-            int b;
-            int c;
-            int d;
-            int rr;
-            int gg;
-            int bb;
-            COMPOSITE_CONVERT(a, b);
-            COMPOSITE_CONVERT(-b, a);
-            COMPOSITE_CONVERT(-a, -b);
-            COMPOSITE_CONVERT(b, -a);
-        }
+        composite_decode_color(i, ap, bp, TempLine, w);
     }
-#undef COMPOSITE_CONVERT
 #undef OUT
 
+    if (cacheable) {
+        memcpy(cache_out, TempLine, w * sizeof(uint32_t));
+        cache_blocks = blocks;
+        cache_mode   = cgamode;
+        cache_border = border;
+    }
+
     return TempLine;
 }
 
@@ -666,6 +666,8 @@ gd54xx_set_svga_fast(gd54xx_t *gd54xx)
         svga->fast = ((svga->gdcreg[8] == 0xff) && !(svga->gdcreg[3] & 0x18) &&
                      !svga->gdcreg[1]) && ((svga->chain4 && svga->packed_chain4) ||
                      svga->fb_only);
+
+    svga_recalc_planar_write(svga);
 }
 
 static void
@@ -971,6 +973,7 @@ gd54xx_out(uint16_t addr, uint8_t val, void *priv)
                             }
                             svga->seqregs[2] &= 0x0f;
                         }
+                        svga_recalc_planar_write(svga);
                         fallthrough;
                     case 0x09:
                     case 0x0a:
@@ -254,6 +254,10 @@ ega_out(uint16_t addr, uint8_t val, void *priv)
                 default:
                     break;
             }
+            if ((ega->writemode == 0) && (ega->gdcreg[8] == 0xff) && !(ega->gdcreg[3] & 0x18) && !ega->gdcreg[1])
+                ega->planar_write = 1;
+            else
+                ega->planar_write = (ega->writemode == 1) ? 2 : 0;
             break;
         case 0x3d0:
         case 0x3d4:
@@ -746,29 +750,32 @@ ega_poll(void *priv)
             ega->ma &= ega->vrammask;
             if (ega->firstline == 2000) {
                 ega->firstline = ega->displine;
-                video_wait_for_buffer();
+                if (!ega->frame_skip)
+                    video_wait_for_buffer();
             }
 
-            old_ma = ega->ma;
-            ega->displine *= ega->vres + 1;
-            ega->y_add *= ega->vres + 1;
-            for (y = 0; y <= ega->vres; y++) {
-                /* Render scanline */
-                ega->render(ega);
-
-                /* Render overscan */
-                ega->x_add = (overscan_x >> 1);
-                ega_render_overscan_left(ega);
-                ega_render_overscan_right(ega);
-                ega->x_add = (overscan_x >> 1) - ega->scrollcache;
-
-                if (y != ega->vres) {
-                    ega->ma = old_ma;
-                    ega->displine++;
+            if (!ega->frame_skip) {
+                old_ma = ega->ma;
+                ega->displine *= ega->vres + 1;
+                ega->y_add *= ega->vres + 1;
+                for (y = 0; y <= ega->vres; y++) {
+                    /* Render scanline */
+                    ega->render(ega);
+
+                    /* Render overscan */
+                    ega->x_add = (overscan_x >> 1);
+                    ega_render_overscan_left(ega);
+                    ega_render_overscan_right(ega);
+                    ega->x_add = (overscan_x >> 1) - ega->scrollcache;
+
+                    if (y != ega->vres) {
+                        ega->ma = old_ma;
+                        ega->displine++;
+                    }
                 }
+                ega->displine /= ega->vres + 1;
+                ega->y_add /= ega->vres + 1;
             }
-            ega->displine /= ega->vres + 1;
-            ega->y_add /= ega->vres + 1;
 
             if (ega->lastline < ega->displine)
                 ega->lastline = ega->displine;
@@ -878,13 +885,12 @@ ega_poll(void *priv)
 
             wx = x;
 
-            if (ega->vres) {
+            if (ega->vres)
                 wy = (ega->lastline - ega->firstline) << 1;
-                ega_doblit(wx, wy, ega);
-            } else {
+            else
                 wy = ega->lastline - ega->firstline;
+            if (!ega->frame_skip)
                 ega_doblit(wx, wy, ega);
-            }
 
             frames++;
 
@@ -899,6 +905,11 @@ ega_poll(void *priv)
             changeframecount = ega->interlace ? 3 : 2;
             ega->vslines     = 0;
 
+            y = video_frame_skip();
+            if (ega->frame_skip && !y)
+                ega->fullchange = changeframecount;
+            ega->frame_skip = y;
+
             if (ega->interlace && ega->oddeven)
                 ega->ma = ega->maback = ega->ma_latch + (ega->rowoffset << 1);
             else
@@ -1114,6 +1125,19 @@ ega_write(uint32_t addr, uint8_t val, void *priv)
     if (!(ega->gdcreg[6] & 1))
         ega->fullchange = 2;
 
+    if (ega->planar_write) {
+        uint32_t mask = video_plane_mask[writemask2 & 0xf];
+        uint32_t old;
+
+        memcpy(&old, &ega->vram[addr], 4);
+        if (ega->planar_write == 1)
+            old = (old & ~mask) | ((ega_rotate[ega->gdcreg[3] & 7][val] * 0x01010101) & mask);
+        else
+            old = (old & ~mask) | ((ega->la | (ega->lb << 8) | (ega->lc << 16) | ((uint32_t) ega->ld << 24)) & mask);
+        memcpy(&ega->vram[addr], &old, 4);
+        return;
+    }
+
     switch (ega->writemode) {
         case 1:
             if (writemask2 & 1)
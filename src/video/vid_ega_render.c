@@ -169,13 +169,19 @@ ega_render_text(ega_t *ega)
                 }
             }
 
-            uint32_t dat = ega->vram[charaddr + (ega->sc << 2)];
-            dat <<= 1;
-            if ((chr & ~0x1F) == 0xC0 && attrlinechars)
-                dat |= (dat >> 1) & 1;
-
-            for (int xx = 0; xx < charwidth; xx++)
-                p[xx] = (dat & (0x100 >> (xx >> dwshift))) ? fg : bg;
+            uint8_t dat = ega->vram[charaddr + (ega->sc << 2)];
+            if (doublewidth)
+                video_font_row_wide(p, dat, fg, bg);
+            else
+                video_font_row(p, dat, fg, bg);
+
+            if (seq9dot) {
+                uint32_t col = bg;
+                if ((chr & ~0x1F) == 0xC0 && attrlinechars && (dat & 1))
+                    col = fg;
+                for (int xx = (8 << dwshift); xx < charwidth; xx++)
+                    p[xx] = col;
+            }
 
             ega->ma += 4;
             p += charwidth;
@@ -348,8 +348,8 @@ hercules_poll(void *priv)
                         for (c = 0; c < 9; c++)
                             buffer32->line[dev->displine + 14][(x * 9) + c + 8] = dev->cols[attr][blink][1];
                     } else {
-                        for (c = 0; c < 8; c++)
-                            buffer32->line[dev->displine + 14][(x * 9) + c + 8] = dev->cols[attr][blink][(fontdatm[chr][dev->sc] & (1 << (c ^ 7))) ? 1 : 0];
+                        video_font_row(&buffer32->line[dev->displine + 14][(x * 9) + 8], fontdatm[chr][dev->sc],
+                                       dev->cols[attr][blink][1], dev->cols[attr][blink][0]);
 
                         if ((chr & ~0x1f) == 0xc0)
                             buffer32->line[dev->displine + 14][(x * 9) + 8 + 8] = dev->cols[attr][blink][fontdatm[chr][dev->sc] & 1];
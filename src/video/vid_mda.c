@@ -164,8 +164,8 @@ mda_poll(void *priv)
                     for (c = 0; c < 9; c++)
                         buffer32->line[mda->displine][(x * 9) + c] = mdacols[attr][blink][1];
                 } else {
-                    for (c = 0; c < 8; c++)
-                        buffer32->line[mda->displine][(x * 9) + c] = mdacols[attr][blink][(fontdatm[chr + mda->fontbase][mda->sc] & (1 << (c ^ 7))) ? 1 : 0];
+                    video_font_row(&buffer32->line[mda->displine][x * 9], fontdatm[chr + mda->fontbase][mda->sc],
+                                   mdacols[attr][blink][1], mdacols[attr][blink][0]);
                     if ((chr & ~0x1f) == 0xc0)
                         buffer32->line[mda->displine][(x * 9) + 8] = mdacols[attr][blink][fontdatm[chr + mda->fontbase][mda->sc] & 1];
                     else
@@ -36,6 +36,7 @@
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_rop.h>
 
 #define ROM_MILLENNIUM    "roms/video/matrox/matrox2064wr2.BIN"
 #define ROM_MILLENNIUM_II "roms/video/matrox/matrox2164wpc.BIN"
@@ -325,6 +326,7 @@
 #define DWGCTRL_PATTERN               (1 << 29)
 #define DWGCTRL_TRANSC                (1 << 30)
 #define BOP(x)                        ((x) << 16)
+#define BOP_ROP3(dwgctrl)             ((((dwgctrl) & DWGCTRL_BOP_MASK) >> 16) * 0x11)
 
 #define MACCESS_PWIDTH_MASK           (3 << 0)
 #define MACCESS_PWIDTH_8              (0 << 0)
@@ -3304,6 +3306,117 @@ bitop(uint32_t src, uint32_t dst, uint32_t dwgctrl)
     return 0;
 }
 
+/*Draws one line of a blit, pixels x_l to x_r, as a single ROP3 span. The
+  source is either the VRAM pixels starting at src_addr and advancing in
+  x_dir, or src_col for every pixel if use_src is 0. Returns 0, having drawn
+  nothing, if the line needs clipping, wraps around VRAM, or is a copy whose
+  source and destination overlap in a way the pixel at a time loops would
+  turn into a smear; the caller then draws it pixel by pixel.*/
+static int
+blit_span(mystique_t *mystique, uint8_t rop, int x_l, int x_r, int x_dir, int use_src, uint32_t src_addr, uint32_t src_col)
+{
+    svga_t     *svga  = &mystique->svga;
+    int         count = x_r - x_l + 1;
+    int         bpp;
+    uint32_t    dst;
+    uint32_t    src = 0;
+    rop3_span_t span;
+
+    switch (mystique->maccess_running & MACCESS_PWIDTH_MASK) {
+        case MACCESS_PWIDTH_8:
+            bpp = 1;
+            break;
+        case MACCESS_PWIDTH_16:
+            bpp = 2;
+            break;
+        case MACCESS_PWIDTH_24:
+            bpp = 3;
+            break;
+        case MACCESS_PWIDTH_32:
+            bpp = 4;
+            break;
+
+        default:
+            return 0;
+    }
+
+    if ((count <= 0) || (x_l < mystique->dwgreg.cxleft) || (x_r > mystique->dwgreg.cxright) ||
+        (mystique->dwgreg.ydst_lin < mystique->dwgreg.ytop) || (mystique->dwgreg.ydst_lin > mystique->dwgreg.ybot))
+        return 0;
+
+    dst = ((mystique->dwgreg.ydst_lin + x_l) * bpp) & mystique->vram_mask;
+    if ((dst + (count * bpp)) > (mystique->vram_mask + 1))
+        return 0;
+
+    if (use_src) {
+        src = (((x_dir > 0) ? src_addr : (src_addr - count + 1)) * bpp) & mystique->vram_mask;
+        if ((src + (count * bpp)) > (mystique->vram_mask + 1))
+            return 0;
+        if ((dst < (src + (count * bpp))) && (src < (dst + (count * bpp))) && ((x_dir < 0) || (dst > src)))
+            return 0;
+    }
+
+    span.dst      = &svga->vram[dst];
+    span.src      = use_src ? &svga->vram[src] : NULL;
+    span.pat      = NULL;
+    span.src_col  = src_col;
+    span.pat_col  = 0;
+    span.wrt_mask = 0xffffffff;
+    span.bpp      = bpp;
+    span.count    = count;
+    rop3_span(rop, &span);
+
+    for (uint32_t page = dst >> 12; page <= ((dst + (count * bpp) - 1) >> 12); page++)
+        svga->changedvram[page] = changeframecount;
+
+    return 1;
+}
+
+/*Copies one blit line as a span if the source runs exactly to the end of
+  line address in AR0, then steps AR0/AR3 on to the next line the same way
+  the pixel loops do. Returns 0 if the line has to be drawn pixel by pixel.*/
+static int
+blit_copy_line(mystique_t *mystique, uint8_t rop, uint32_t *src_addr, int16_t x_start, int16_t x_end, int x_dir)
+{
+    int count = (x_end - x_start) * x_dir + 1;
+
+    if ((count <= 0) || (mystique->dwgreg.ar[0] != (*src_addr + ((count - 1) * x_dir))))
+        return 0;
+
+    if (!blit_span(mystique, rop, (x_dir > 0) ? x_start : x_end, (x_dir > 0) ? x_end : x_start, x_dir, 1, *src_addr, 0))
+        return 0;
+
+    mystique->dwgreg.ar[0] += mystique->dwgreg.ar[5];
+    mystique->dwgreg.ar[3] += mystique->dwgreg.ar[5];
+    *src_addr = mystique->dwgreg.ar[3];
+    return 1;
+}
+
+/*Fills one trapezoid line as a span if the pattern is a solid colour across
+  the line. Lines entirely outside the clip rectangle count as drawn. Returns
+  0 if the line has to be drawn pixel by pixel.*/
+static int
+blit_trap_line(mystique_t *mystique, uint8_t rop, int x_l, int len, int yoff)
+{
+    const bool *pattern = mystique->dwgreg.pattern[yoff];
+    int         xoff    = mystique->dwgreg.xoff;
+    int         x_r     = x_l + len - 1;
+
+    for (int c = 1; c < 8; c++) {
+        if (pattern[(xoff + c) & 15] != pattern[xoff & 15])
+            return 0;
+    }
+
+    if (x_l < mystique->dwgreg.cxleft)
+        x_l = mystique->dwgreg.cxleft;
+    if (x_r > mystique->dwgreg.cxright)
+        x_r = mystique->dwgreg.cxright;
+    if ((x_l > x_r) || (mystique->dwgreg.ydst_lin < mystique->dwgreg.ytop) || (mystique->dwgreg.ydst_lin > mystique->dwgreg.ybot))
+        return 1;
+
+    return blit_span(mystique, rop, x_l, x_r, 1, 0, 0, pattern[xoff & 15] ? mystique->dwgreg.fcol : mystique->dwgreg.bcol);
+}
+
 static uint16_t
 dither(mystique_t *mystique, int r, int g, int b, int x, int y)
 {
@@ -3524,6 +3637,9 @@ blit_fbitblt(mystique_t *mystique)
     for (uint16_t y = 0; y < mystique->dwgreg.length; y++) {
         int16_t x = x_start;
         while (1) {
+            if ((x == x_start) && blit_copy_line(mystique, ROP3_SRCCOPY, &src_addr, x_start, x_end, x_dir))
+                break;
+
             if (x >= mystique->dwgreg.cxleft && x <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot) {
                 uint32_t src;
                 uint32_t old_dst;
@@ -4700,6 +4816,9 @@ blit_trap(mystique_t *mystique)
                 else
                     len = x_r - x_l;
 
+                if (!trans_sel && blit_trap_line(mystique, ROP3_SRCCOPY, x_l, len, yoff))
+                    len = 0;
+
                 while (len > 0) {
                     if (x_l >= mystique->dwgreg.cxleft && x_l <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot && trans[x_l & 3]) {
                         int      xoff    = (mystique->dwgreg.xoff + (x_l & 7)) & 15;
@@ -4769,6 +4888,9 @@ blit_trap(mystique_t *mystique)
                 else
                     len = x_r - x_l;
 
+                if (!trans_sel && blit_trap_line(mystique, BOP_ROP3(mystique->dwgreg.dwgctrl_running), x_l, len, yoff))
+                    len = 0;
+
                 while (len > 0) {
                     if (x_l >= mystique->dwgreg.cxleft && x_l <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot && trans[x_l & 3]) {
                         int      xoff    = (mystique->dwgreg.xoff + (x_l & 7)) & 15;
@@ -5787,6 +5909,10 @@ blit_bitblt(mystique_t *mystique)
                         int16_t              x            = x_start;
 
                         while (1) {
+                            if ((x == x_start) && !trans_sel && !(mystique->dwgreg.dwgctrl_running & (DWGCTRL_PATTERN | DWGCTRL_TRANSC)) &&
+                                blit_copy_line(mystique, BOP_ROP3(mystique->dwgreg.dwgctrl_running), &src_addr, x_start, x_end, x_dir))
+                                break;
+
                             if (x >= mystique->dwgreg.cxleft && x <= mystique->dwgreg.cxright && mystique->dwgreg.ydst_lin >= mystique->dwgreg.ytop && mystique->dwgreg.ydst_lin <= mystique->dwgreg.ybot && trans[x & 3]) {
                                 uint32_t src;
                                 uint32_t dst;
@@ -0,0 +1,173 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Common ternary raster operation (ROP3) span engine.
+ *
+ *          ROP3s are bitwise, so a span of any pixel depth is evaluated as
+ *          a run of bytes. Solid source/pattern colours and the write mask
+ *          are replicated into small buffers whose length is a multiple of
+ *          both the pixel size and the vector size, so they can be loaded
+ *          exactly like pixel data. The most common GDI ROPs get their own
+ *          instantiation of the kernel with a constant ROP, which the
+ *          compiler reduces to the plain expression.
+ */
+#include <stdint.h>
+#include <string.h>
+#include <86box/vid_rop.h>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#    define ROP3_SSE2
+#    include <emmintrin.h>
+#elif defined __ARM_NEON || defined _M_ARM64
+#    define ROP3_NEON
+#    include <arm_neon.h>
+#endif
+
+#if defined ROP3_SSE2
+typedef __m128i rop3_vec_t;
+#    define ROP3_VEC_LOAD(p)     _mm_loadu_si128((const __m128i *) (p))
+#    define ROP3_VEC_STORE(p, v) _mm_storeu_si128((__m128i *) (p), v)
+#    define ROP3_VEC_SET(v)      _mm_set1_epi32((int) (v))
+#    define ROP3_VEC_AND(a, b)   _mm_and_si128(a, b)
+#    define ROP3_VEC_XOR(a, b)   _mm_xor_si128(a, b)
+#elif defined ROP3_NEON
+typedef uint32x4_t rop3_vec_t;
+#    define ROP3_VEC_LOAD(p)     vreinterpretq_u32_u8(vld1q_u8((const uint8_t *) (p)))
+#    define ROP3_VEC_STORE(p, v) vst1q_u8((uint8_t *) (p), vreinterpretq_u8_u32(v))
+#    define ROP3_VEC_SET(v)      vdupq_n_u32(v)
+#    define ROP3_VEC_AND(a, b)   vandq_u32(a, b)
+#    define ROP3_VEC_XOR(a, b)   veorq_u32(a, b)
+#endif
+
+/*Replicated solid colour/mask buffers. 48 bytes is the smallest length that
+  holds a whole number of 16 byte vectors and of 3 byte pixels; one extra
+  vector is kept so a load at any phase stays inside the buffer.*/
+#define ROP3_REP_LEN 64
+
+const uint8_t rop3_mix[16] = {
+    0x55, 0x00, 0xff, 0xaa, 0x33, 0x66, 0x99, 0xcc,
+    0x77, 0xbb, 0xdd, 0xee, 0x88, 0x44, 0x22, 0x11
+};
+
+#ifdef ROP3_VEC_LOAD
+#    define ROP3_VEC_MUX(sel, a, b) ROP3_VEC_XOR(b, ROP3_VEC_AND(sel, ROP3_VEC_XOR(a, b)))
+
+static __inline rop3_vec_t
+rop3_vec(uint8_t rop, rop3_vec_t d, rop3_vec_t s, rop3_vec_t p)
+{
+    rop3_vec_t m0 = ROP3_VEC_SET(-(uint32_t) ((rop >> 0) & 1));
+    rop3_vec_t m1 = ROP3_VEC_SET(-(uint32_t) ((rop >> 1) & 1));
+    rop3_vec_t m2 = ROP3_VEC_SET(-(uint32_t) ((rop >> 2) & 1));
+    rop3_vec_t m3 = ROP3_VEC_SET(-(uint32_t) ((rop >> 3) & 1));
+    rop3_vec_t m4 = ROP3_VEC_SET(-(uint32_t) ((rop >> 4) & 1));
+    rop3_vec_t m5 = ROP3_VEC_SET(-(uint32_t) ((rop >> 5) & 1));
+    rop3_vec_t m6 = ROP3_VEC_SET(-(uint32_t) ((rop >> 6) & 1));
+    rop3_vec_t m7 = ROP3_VEC_SET(-(uint32_t) ((rop >> 7) & 1));
+    rop3_vec_t s0 = ROP3_VEC_MUX(s, ROP3_VEC_MUX(d, m3, m2), ROP3_VEC_MUX(d, m1, m0));
+    rop3_vec_t s1 = ROP3_VEC_MUX(s, ROP3_VEC_MUX(d, m7, m6), ROP3_VEC_MUX(d, m5, m4));
+
+    return ROP3_VEC_MUX(p, s1, s0);
+}
+#endif
+
+static __inline void
+rop3_kernel(const uint8_t rop, uint8_t *dst, const uint8_t *src, const uint8_t *pat, const uint8_t *mask,
+            const uint8_t *src_rep, const uint8_t *pat_rep, int period, int bytes)
+{
+    int o = 0;
+
+#ifdef ROP3_VEC_LOAD
+    for (; o <= (bytes - 16); o += 16) {
+        int        phase = o % period;
+        rop3_vec_t d     = ROP3_VEC_LOAD(&dst[o]);
+        rop3_vec_t s     = ROP3_VEC_LOAD(src ? &src[o] : &src_rep[phase]);
+        rop3_vec_t p     = ROP3_VEC_LOAD(pat ? &pat[o] : &pat_rep[phase]);
+        rop3_vec_t r     = rop3_vec(rop, d, s, p);
+
+        if (mask)
+            r = ROP3_VEC_MUX(ROP3_VEC_LOAD(&mask[phase]), r, d);
+
+        ROP3_VEC_STORE(&dst[o], r);
+    }
+#endif
+    for (; o < bytes; o++) {
+        int     phase = o % period;
+        uint8_t s     = src ? src[o] : src_rep[phase];
+        uint8_t p     = pat ? pat[o] : pat_rep[phase];
+        uint8_t r     = rop3(rop, dst[o], s, p);
+
+        if (mask)
+            r = ROP3_MUX(mask[phase], r, dst[o]);
+
+        dst[o] = r;
+    }
+}
+
+static void
+rop3_replicate(uint8_t *buf, uint32_t col, int bpp)
+{
+    for (int c = 0; c < ROP3_REP_LEN; c++)
+        buf[c] = col >> ((c % bpp) << 3);
+}
+
+void
+rop3_span(uint8_t rop, const rop3_span_t *span)
+{
+    uint8_t        src_rep[ROP3_REP_LEN];
+    uint8_t        pat_rep[ROP3_REP_LEN];
+    uint8_t        mask_rep[ROP3_REP_LEN];
+    const uint8_t *src    = span->src;
+    const uint8_t *pat    = span->pat;
+    const uint8_t *mask   = NULL;
+    uint32_t       full   = (span->bpp == 4) ? 0xffffffff : ((1u << (span->bpp << 3)) - 1);
+    int            period = (span->bpp == 3) ? 48 : 16;
+    int            bytes  = span->count * span->bpp;
+
+    if (bytes <= 0)
+        return;
+
+    if (!src)
+        rop3_replicate(src_rep, span->src_col, span->bpp);
+    if (!pat)
+        rop3_replicate(pat_rep, span->pat_col, span->bpp);
+    if ((span->wrt_mask & full) != full) {
+        rop3_replicate(mask_rep, span->wrt_mask, span->bpp);
+        mask = mask_rep;
+    }
+
+#define ROP3_CASE(r)                                                                          \
+    case r:                                                                                   \
+        rop3_kernel(r, span->dst, src, pat, mask, src_rep, pat_rep, period, bytes); \
+        break;
+
+    switch (rop) {
+        case ROP3_NOP:
+            break;
+        ROP3_CASE(ROP3_BLACKNESS)
+        ROP3_CASE(ROP3_NOTSRCERASE)
+        ROP3_CASE(ROP3_NOTSRCCOPY)
+        ROP3_CASE(ROP3_SRCERASE)
+        ROP3_CASE(ROP3_DSTINVERT)
+        ROP3_CASE(ROP3_PATINVERT)
+        ROP3_CASE(ROP3_SRCINVERT)
+        ROP3_CASE(ROP3_SRCAND)
+        ROP3_CASE(ROP3_MERGEPAINT)
+        ROP3_CASE(ROP3_MERGECOPY)
+        ROP3_CASE(ROP3_SRCCOPY)
+        ROP3_CASE(ROP3_SRCPAINT)
+        ROP3_CASE(ROP3_PATCOPY)
+        ROP3_CASE(ROP3_PATPAINT)
+        ROP3_CASE(ROP3_WHITENESS)
+
+        default:
+            rop3_kernel(rop, span->dst, src, pat, mask, src_rep, pat_rep, period, bytes);
+            break;
+    }
+
+#undef ROP3_CASE
+}
@@ -74,6 +74,8 @@ static int dither[4][4] = {
 #define RB_SIZE 256
 #define RB_MASK (RB_SIZE - 1)
 
+#define VIRGE_MAX_RENDER_THREADS 8
+
 #define RB_ENTRIES (virge->s3d_write_idx - virge->s3d_read_idx)
 #define RB_FULL (RB_ENTRIES == RB_SIZE)
 #define RB_EMPTY (!RB_ENTRIES)
@@ -188,6 +190,21 @@ typedef struct s3d_t {
     uint8_t       fog_b;
 } s3d_t;
 
+typedef struct virge_render_worker_t {
+    struct virge_t *virge;
+    int             band;
+    int             bands;
+
+    thread_t       *thread;
+    event_t        *wake_event;
+    event_t        *done_event;
+
+    int             start_idx;
+    int             end_idx;
+    int             pixel_count;
+    uint64_t        time;
+} virge_render_worker_t;
+
 typedef struct virge_t {
     mem_mapping_t linear_mapping;
     mem_mapping_t mmio_mapping;
@@ -225,6 +242,9 @@ typedef struct virge_t {
     event_t *     wake_main_thread;
     event_t *     not_full_event;
 
+    int                   render_threads;
+    virge_render_worker_t render_workers[VIRGE_MAX_RENDER_THREADS];
+
     uint32_t      hwc_fg_col;
     uint32_t      hwc_bg_col;
     int           hwc_col_stack_pos;
@@ -2576,7 +2596,7 @@ skip_line:
 
 #define RGB15(r, g, b, dest)                                \
         if (virge->dithering_enabled) {                     \
-                int add = dither[_y & 3][_x & 3];           \
+                int add = dither[state->y & 3][x & 3];      \
                 int _r = (r > 248) ? 248 : r + add;         \
                 int _g = (g > 248) ? 248 : g + add;         \
                 int _b = (b > 248) ? 248 : b + add;         \
@@ -2594,6 +2614,8 @@ typedef struct rgba_t {
     int r, g, b, a;
 } rgba_t;
 
+struct s3d_texture_state_t;
+
 typedef struct s3d_state_t {
     int32_t   r;
     int32_t   g;
@@ -2631,6 +2653,14 @@ typedef struct s3d_state_t {
     int       y;
 
     rgba_t    dest_rgba;
+
+    int       band;
+    int       bands;
+    int       pixel_count;
+
+    void (*tex_read)(struct s3d_state_t *state, struct s3d_texture_state_t *texture_state, rgba_t *out);
+    void (*tex_sample)(struct s3d_state_t *state);
+    void (*dest_pixel)(struct s3d_state_t *state);
 } s3d_state_t;
 
 typedef struct s3d_texture_state_t {
@@ -2641,16 +2671,9 @@ typedef struct s3d_texture_state_t {
     int32_t   v;
 } s3d_texture_state_t;
 
-static void (*tex_read)(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
-static void (*tex_sample)(s3d_state_t *state);
-static void (*dest_pixel)(s3d_state_t *state);
-
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-static int _x;
-static int _y;
-
 static void
 tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out) {
     int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
@@ -2741,7 +2764,7 @@ tex_sample_normal(s3d_state_t *state) {
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -2759,21 +2782,21 @@ tex_sample_normal_filter(s3d_state_t *state) {
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -2801,7 +2824,7 @@ tex_sample_mipmap(s3d_state_t *state) {
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -2821,21 +2844,21 @@ tex_sample_mipmap_filter(s3d_state_t *state) {
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = state->u + state->tbu;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = state->u + state->tbu + tex_offset;
     texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -2865,7 +2888,7 @@ tex_sample_persp_normal(s3d_state_t *state) {
     texture_state.u = (int32_t)(((int64_t)state->u * (int64_t)w) >> (12 + state->max_d)) + state->tbu;
     texture_state.v = (int32_t)(((int64_t)state->v * (int64_t)w) >> (12 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -2892,21 +2915,21 @@ tex_sample_persp_normal_filter(s3d_state_t *state) {
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -2936,7 +2959,7 @@ tex_sample_persp_normal_375(s3d_state_t *state) {
     texture_state.u = (int32_t)(((int64_t)state->u * (int64_t)w) >> (8 + state->max_d)) + state->tbu;
     texture_state.v = (int32_t)(((int64_t)state->v * (int64_t)w) >> (8 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -2963,21 +2986,21 @@ tex_sample_persp_normal_filter_375(s3d_state_t *state) {
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3009,7 +3032,7 @@ tex_sample_persp_mipmap(s3d_state_t *state) {
     texture_state.u = (int32_t)(((int64_t)state->u * (int64_t)w) >> (12 + state->max_d)) + state->tbu;
     texture_state.v = (int32_t)(((int64_t)state->v * (int64_t)w) >> (12 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3038,21 +3061,21 @@ tex_sample_persp_mipmap_filter(s3d_state_t *state) {
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3084,7 +3107,7 @@ tex_sample_persp_mipmap_375(s3d_state_t *state) {
     texture_state.u = (int32_t)(((int64_t)state->u * (int64_t)w) >> (8 + state->max_d)) + state->tbu;
     texture_state.v = (int32_t)(((int64_t)state->v * (int64_t)w) >> (8 + state->max_d)) + state->tbv;
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    state->tex_read(state, &texture_state, &state->dest_rgba);
 }
 
 static void
@@ -3113,21 +3136,21 @@ tex_sample_persp_mipmap_filter_375(s3d_state_t *state) {
 
     texture_state.u = u;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
+    state->tex_read(state, &texture_state, &tex_samples[0]);
     du = (u >> (texture_state.texture_shift - 8)) & 0xff;
     dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
 
     texture_state.u = u + tex_offset;
     texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
+    state->tex_read(state, &texture_state, &tex_samples[1]);
 
     texture_state.u = u;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
+    state->tex_read(state, &texture_state, &tex_samples[2]);
 
     texture_state.u = u + tex_offset;
     texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
+    state->tex_read(state, &texture_state, &tex_samples[3]);
 
     d[0] = (256 - du) * (256 - dv);
     d[1] = du * (256 - dv);
@@ -3193,7 +3216,7 @@ dest_pixel_gouraud_shaded_triangle(s3d_state_t *state) {
 
 static void
 dest_pixel_unlit_texture_triangle(s3d_state_t *state) {
-    tex_sample(state);
+    state->tex_sample(state);
 
     if (state->cmd_set & CMD_SET_ABC_SRC)
         state->dest_rgba.a = state->a >> 7;
@@ -3201,7 +3224,7 @@ dest_pixel_unlit_texture_triangle(s3d_state_t *state) {
 
 static void
 dest_pixel_lit_texture_decal(s3d_state_t *state) {
-    tex_sample(state);
+    state->tex_sample(state);
 
     if (state->cmd_set & CMD_SET_ABC_SRC)
         state->dest_rgba.a = state->a >> 7;
@@ -3209,7 +3232,7 @@ dest_pixel_lit_texture_decal(s3d_state_t *state) {
 
 static void
 dest_pixel_lit_texture_reflection(s3d_state_t *state) {
-    tex_sample(state);
+    state->tex_sample(state);
 
     state->dest_rgba.r += (state->r >> 7);
     state->dest_rgba.g += (state->g >> 7);
@@ -3227,7 +3250,7 @@ dest_pixel_lit_texture_modulate(s3d_state_t *state) {
     int b = state->b >> 7;
     int a = state->a >> 7;
 
-    tex_sample(state);
+    state->tex_sample(state);
 
     CLAMP_RGBA(r, g, b, a);
 
@@ -3291,6 +3314,11 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
              xe--;
          }
 
+         /*With several render threads, each one only draws its own band of
+           scanlines but still steps through every line of the triangle*/
+         if ((state->bands > 1) && (((unsigned) state->y % state->bands) != state->band))
+             goto tri_skip_line;
+
          if (x != xe && ((x_dir > 0 && x < xe) || (x_dir < 0 && x > xe))) {
              uint32_t dest_addr;
              uint32_t z_addr;
@@ -3372,9 +3400,6 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                   int      update = 1;
                   uint16_t src_z  = 0;
 
-                  _x = x;
-                  _y = state->y;
-
                   if (use_z) {
                       src_z = Z_READ(z_addr);
                       Z_CLIP(src_z, z >> 16);
@@ -3383,7 +3408,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                   if (update) {
                       uint32_t dest_col;
 
-                      dest_pixel(state);
+                      state->dest_pixel(state);
 
                       if (s3d_tri->cmd_set & CMD_SET_FE) {
                           int a              = state->a >> 7;
@@ -3452,7 +3477,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                   state->w  += s3d_tri->TdWdX;
                   dest_addr += x_offset;
                   z_addr    += xz_offset;
-                  virge->pixel_count++;
+                  state->pixel_count++;
               }
         }
 
@@ -3477,7 +3502,7 @@ tri_skip_line:
 static int tex_size[8] = {4 * 2, 2 * 2, 2 * 2, 1 * 2, 2 / 1, 2 / 1, 1 * 2, 1 * 2};
 
 static void
-s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri) {
+s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri, virge_render_worker_t *worker) {
     s3d_state_t state;
 
     uint32_t    tex_base;
@@ -3495,6 +3520,10 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri) {
 
     state.cmd_set = s3d_tri->cmd_set;
 
+    state.band        = worker->band;
+    state.bands       = worker->bands;
+    state.pixel_count = 0;
+
     state.base_u = s3d_tri->tus;
     state.base_v = s3d_tri->tvs;
     state.base_z = s3d_tri->tzs;
@@ -3514,19 +3543,19 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri) {
 
     switch ((s3d_tri->cmd_set >> 27) & 0xf) {
         case 0:
-            dest_pixel = dest_pixel_gouraud_shaded_triangle;
+            state.dest_pixel = dest_pixel_gouraud_shaded_triangle;
             break;
         case 1:
         case 5:
             switch ((s3d_tri->cmd_set >> 15) & 0x3) {
                 case 0:
-                    dest_pixel = dest_pixel_lit_texture_reflection;
+                    state.dest_pixel = dest_pixel_lit_texture_reflection;
                     break;
                 case 1:
-                    dest_pixel = dest_pixel_lit_texture_modulate;
+                    state.dest_pixel = dest_pixel_lit_texture_modulate;
                     break;
                 case 2:
-                    dest_pixel = dest_pixel_lit_texture_decal;
+                    state.dest_pixel = dest_pixel_lit_texture_decal;
                     break;
                 default:
                     return;
@@ -3534,7 +3563,7 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri) {
             break;
         case 2:
         case 6:
-            dest_pixel = dest_pixel_unlit_texture_triangle;
+            state.dest_pixel = dest_pixel_unlit_texture_triangle;
             break;
         default:
             return;
@@ -3543,66 +3572,66 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri) {
     switch (((s3d_tri->cmd_set >> 12) & 7) | ((s3d_tri->cmd_set & (1 << 29)) ? 8 : 0)) {
         case 0:
         case 1:
-            tex_sample = tex_sample_mipmap;
+            state.tex_sample = tex_sample_mipmap;
             break;
         case 2:
         case 3:
-            tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
+            state.tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
             break;
         case 4:
         case 5:
-            tex_sample = tex_sample_normal;
+            state.tex_sample = tex_sample_normal;
             break;
         case 6:
         case 7:
-            tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
+            state.tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
             break;
         case (0 | 8):
         case (1 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_mipmap_375;
+                state.tex_sample = tex_sample_persp_mipmap_375;
             else
-                tex_sample = tex_sample_persp_mipmap;
+                state.tex_sample = tex_sample_persp_mipmap;
             break;
         case (2 | 8):
         case (3 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
                                                        tex_sample_persp_mipmap_375;
             else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
                                                        tex_sample_persp_mipmap;
             break;
         case (4 | 8):
         case (5 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_normal_375;
+                state.tex_sample = tex_sample_persp_normal_375;
             else
-                tex_sample = tex_sample_persp_normal;
+                state.tex_sample = tex_sample_persp_normal;
             break;
         case (6 | 8):
         case (7 | 8):
             if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
                                                        tex_sample_persp_normal_375;
             else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
+                state.tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
                                                        tex_sample_persp_normal;
             break;
     }
 
     switch ((s3d_tri->cmd_set >> 5) & 7) {
         case 0:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
             break;
         case 1:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
             break;
         case 2:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
             break;
         default:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            state.tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
             break;
     }
 
@@ -3613,24 +3642,197 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri) {
     state.x2 = s3d_tri->txend12;
     tri(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
 
-    virge->tri_count++;
+    worker->pixel_count += state.pixel_count;
+
+    if (!worker->band)
+        virge->tri_count++;
 
     end_time = plat_timer_read();
 
-    virge_time += end_time - start_time;
+    worker->time += end_time - start_time;
+}
+
+static int
+s3_virge_tri_textured(s3d_t *s3d_tri)
+{
+    switch ((s3d_tri->cmd_set >> 27) & 0xf) {
+        case 1:
+        case 2:
+        case 5:
+        case 6:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+/*VRAM written by a triangle. Covers whole scanlines plus the widest span
+  that can run past the stride; a range that wraps covers all of VRAM.*/
+static void
+s3_virge_tri_dest_range(s3d_t *s3d_tri, uint32_t *start, uint32_t *end)
+{
+    *start = s3d_tri->dest_base + ((s3d_tri->tys - s3d_tri->ty01 - s3d_tri->ty12) * s3d_tri->dest_str);
+    *end   = s3d_tri->dest_base + ((s3d_tri->tys + 1) * s3d_tri->dest_str) + (2048 * 4);
+
+    if (*start > *end) {
+        *start = 0;
+        *end   = 0xffffffff;
+    }
+}
+
+/*VRAM read as texture, all mipmap levels included.*/
+static void
+s3_virge_tri_tex_range(s3d_t *s3d_tri, uint32_t *start, uint32_t *end)
+{
+    int max_d = (s3d_tri->cmd_set >> 8) & 15;
+
+    *start = s3d_tri->tex_base;
+    *end   = s3d_tri->tex_base;
+    for (int c = 9; c >= 0; c--) {
+        if (c <= max_d)
+            *end += ((1 << (c * 2)) * tex_size[(s3d_tri->cmd_set >> 5) & 7]) / 2;
+    }
+
+    if (*start > *end) {
+        *start = 0;
+        *end   = 0xffffffff;
+    }
+}
+
+/*Finds the end of the next batch of triangles that the bands can draw
+  together. A band may run ahead of the others, so a triangle that samples
+  VRAM written earlier in the same batch starts a new batch, and one that
+  samples its own destination is drawn by a single band.*/
+static int
+render_batch_end(virge_t *virge, int *bands)
+{
+    int      start_idx  = virge->s3d_read_idx;
+    int      end_idx    = virge->s3d_write_idx;
+    uint32_t dest_start = 0xffffffff;
+    uint32_t dest_end   = 0;
+    uint32_t start;
+    uint32_t end;
+    uint32_t tex_start;
+    uint32_t tex_end;
+
+    *bands = virge->render_threads;
+
+    for (int idx = start_idx; idx != end_idx; idx++) {
+        s3d_t *s3d_tri = &virge->s3d_buffer[idx & RB_MASK];
+
+        s3_virge_tri_dest_range(s3d_tri, &start, &end);
+
+        if (s3_virge_tri_textured(s3d_tri)) {
+            s3_virge_tri_tex_range(s3d_tri, &tex_start, &tex_end);
+
+            if ((tex_start < dest_end) && (tex_end > dest_start))
+                return idx;
+
+            if ((tex_start < end) && (tex_end > start)) {
+                if (idx != start_idx)
+                    return idx;
+                *bands = 1;
+                return idx + 1;
+            }
+        }
+
+        if (start < dest_start)
+            dest_start = start;
+        if (end > dest_end)
+            dest_end = end;
+    }
+
+    return end_idx;
+}
+
+static void
+render_worker_thread(void *param)
+{
+    virge_render_worker_t *worker = (virge_render_worker_t *) param;
+    virge_t               *virge  = worker->virge;
+
+    while (1) {
+        thread_wait_event(worker->wake_event, -1);
+        thread_reset_event(worker->wake_event);
+        if (!virge->render_thread_run)
+            break;
+
+        for (int idx = worker->start_idx; idx != worker->end_idx; idx++)
+            s3_virge_triangle(virge, &virge->s3d_buffer[idx & RB_MASK], worker);
+
+        thread_set_event(worker->done_event);
+    }
+}
+
+/*Draws the next batch of triangles in the ring buffer. Each render thread
+  draws its band of scanlines for each triangle in ring order, so every
+  pixel sees the same Z buffer and framebuffer updates in the same order
+  as with a single thread. The read index only moves on once all bands
+  are done.*/
+static void
+render_batch(virge_t *virge)
+{
+    virge_render_worker_t *worker    = &virge->render_workers[0];
+    int                    start_idx = virge->s3d_read_idx;
+    int                    end_idx;
+    int                    bands;
+
+    end_idx       = render_batch_end(virge, &bands);
+    worker->bands = bands;
+
+    if (bands > 1) {
+        for (int c = 1; c < virge->render_threads; c++) {
+            virge->render_workers[c].start_idx = start_idx;
+            virge->render_workers[c].end_idx   = end_idx;
+            thread_set_event(virge->render_workers[c].wake_event);
+        }
+    }
+
+    for (int idx = start_idx; idx != end_idx; idx++)
+        s3_virge_triangle(virge, &virge->s3d_buffer[idx & RB_MASK], worker);
+
+    if (bands > 1) {
+        for (int c = 1; c < virge->render_threads; c++) {
+            thread_wait_event(virge->render_workers[c].done_event, -1);
+            thread_reset_event(virge->render_workers[c].done_event);
+            worker->pixel_count += virge->render_workers[c].pixel_count;
+            worker->time += virge->render_workers[c].time;
+            virge->render_workers[c].pixel_count = 0;
+            virge->render_workers[c].time        = 0;
+        }
+    }
+
+    virge->pixel_count += worker->pixel_count;
+    worker->pixel_count = 0;
+    virge_time += worker->time;
+    worker->time = 0;
+
+    virge->s3d_read_idx = end_idx;
+    thread_set_event(virge->not_full_event);
 }
 
 static void
 render_thread(void *param)
 {
-    virge_t *virge = (virge_t *)param;
+    virge_t               *virge  = (virge_t *)param;
+    virge_render_worker_t *worker = &virge->render_workers[0];
 
     while (virge->render_thread_run) {
         thread_wait_event(virge->wake_render_thread, -1);
         thread_reset_event(virge->wake_render_thread);
         virge->s3d_busy = 1;
         while (!RB_EMPTY) {
-            s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx & RB_MASK]);
+            if (virge->render_threads > 1) {
+                render_batch(virge);
+                continue;
+            }
+
+            s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx & RB_MASK], worker);
+            virge->pixel_count += worker->pixel_count;
+            worker->pixel_count = 0;
+            virge_time += worker->time;
+            worker->time = 0;
             virge->s3d_read_idx++;
 
             if (RB_ENTRIES == RB_MASK)
@@ -4566,10 +4768,26 @@ s3_virge_init(const device_t *info)
 
     virge->svga.force_old_addr = 1;
 
+    virge->render_threads = device_get_config_int("render_threads");
+    if (virge->render_threads < 1)
+        virge->render_threads = 1;
+    else if (virge->render_threads > VIRGE_MAX_RENDER_THREADS)
+        virge->render_threads = VIRGE_MAX_RENDER_THREADS;
+
     virge->render_thread_run = 1;
     virge->wake_render_thread = thread_create_event();
     virge->wake_main_thread = thread_create_event();
     virge->not_full_event = thread_create_event();
+    for (int c = 0; c < virge->render_threads; c++) {
+        virge->render_workers[c].virge = virge;
+        virge->render_workers[c].band  = c;
+        virge->render_workers[c].bands = virge->render_threads;
+        if (c) {
+            virge->render_workers[c].wake_event = thread_create_event();
+            virge->render_workers[c].done_event = thread_create_event();
+            virge->render_workers[c].thread     = thread_create(render_worker_thread, &virge->render_workers[c]);
+        }
+    }
     virge->render_thread = thread_create(render_thread, virge);
 
     virge->fifo_thread_run = 1;
@@ -4592,6 +4810,12 @@ s3_virge_close(void *priv)
     virge->render_thread_run = 0;
     thread_set_event(virge->wake_render_thread);
     thread_wait(virge->render_thread);
+    for (int c = 1; c < virge->render_threads; c++) {
+        thread_set_event(virge->render_workers[c].wake_event);
+        thread_wait(virge->render_workers[c].thread);
+        thread_destroy_event(virge->render_workers[c].done_event);
+        thread_destroy_event(virge->render_workers[c].wake_event);
+    }
     thread_destroy_event(virge->not_full_event);
     thread_destroy_event(virge->wake_main_thread);
     thread_destroy_event(virge->wake_render_thread);
@@ -4728,6 +4952,33 @@ static const device_config_t s3_virge_config[] = {
         .type = CONFIG_BINARY,
         .default_int = 1
     },
+    {
+        .name = "render_threads",
+        .description = "Render threads",
+        .type = CONFIG_SELECTION,
+        .default_int = 1,
+        .selection = {
+            {
+                .description = "1",
+                .value = 1
+            },
+            {
+                .description = "2",
+                .value = 2
+            },
+            {
+                .description = "4",
+                .value = 4
+            },
+            {
+                .description = "8",
+                .value = 8
+            },
+            {
+                .description = ""
+            }
+        }
+    },
     {
         .type = CONFIG_END
     }
@@ -4771,6 +5022,33 @@ static const device_config_t s3_virge_stb_config[] = {
         .type = CONFIG_BINARY,
         .default_int = 1
     },
+    {
+        .name = "render_threads",
+        .description = "Render threads",
+        .type = CONFIG_SELECTION,
+        .default_int = 1,
+        .selection = {
+            {
+                .description = "1",
+                .value = 1
+            },
+            {
+                .description = "2",
+                .value = 2
+            },
+            {
+                .description = "4",
+                .value = 4
+            },
+            {
+                .description = "8",
+                .value = 8
+            },
+            {
+                .description = ""
+            }
+        }
+    },
     {
         .type = CONFIG_END
     }
@@ -4791,6 +5069,33 @@ static const device_config_t s3_virge_357_config[] = {
         .type = CONFIG_BINARY,
         .default_int = 1
     },
+    {
+        .name = "render_threads",
+        .description = "Render threads",
+        .type = CONFIG_SELECTION,
+        .default_int = 1,
+        .selection = {
+            {
+                .description = "1",
+                .value = 1
+            },
+            {
+                .description = "2",
+                .value = 2
+            },
+            {
+                .description = "4",
+                .value = 4
+            },
+            {
+                .description = "8",
+                .value = 8
+            },
+            {
+                .description = ""
+            }
+        }
+    },
     {
         .type = CONFIG_END
     }
@@ -4830,6 +5135,33 @@ static const device_config_t s3_trio3d2x_config[] = {
         .type = CONFIG_BINARY,
         .default_int = 1
     },
+    {
+        .name = "render_threads",
+        .description = "Render threads",
+        .type = CONFIG_SELECTION,
+        .default_int = 1,
+        .selection = {
+            {
+                .description = "1",
+                .value = 1
+            },
+            {
+                .description = "2",
+                .value = 2
+            },
+            {
+                .description = "4",
+                .value = 4
+            },
+            {
+                .description = "8",
+                .value = 8
+            },
+            {
+                .description = ""
+            }
+        }
+    },
     {
         .type = CONFIG_END
     }
@@ -376,6 +376,7 @@ svga_out(uint16_t addr, uint8_t val, void *priv)
             }
             svga->gdcreg[svga->gdcaddr & 15] = val;
             svga->fast                       = (svga->gdcreg[8] == 0xff && !(svga->gdcreg[3] & 0x18) && !svga->gdcreg[1]) && ((svga->chain4 && (svga->packed_chain4 || svga->force_old_addr)) || svga->fb_only);
+            svga_recalc_planar_write(svga);
             if (((svga->gdcaddr & 15) == 5 && (val ^ o) & 0x70) || ((svga->gdcaddr & 15) == 6 && (val ^ o) & 1)) {
                 svga_log("GDCADDR%02x recalc.\n", svga->gdcaddr & 0x0f);
                 svga_recalctimings(svga);
@@ -1014,13 +1015,16 @@ svga_recalctimings(svga_t *svga)
 static void
 svga_do_render(svga_t *svga)
 {
+    int draw = !svga->override && !svga->frame_skip;
+
     /* Always render a blank screen and nothing else while in DPMS mode. */
     if (svga->dpms) {
-        svga_render_blank(svga);
+        if (!svga->frame_skip)
+            svga_render_blank(svga);
         return;
     }
 
-    if (!svga->override) {
+    if (draw) {
         svga->render(svga);
 
         svga->x_add = (svga->monitor->mon_overscan_x >> 1);
@@ -1030,7 +1034,7 @@ svga_do_render(svga_t *svga)
     }
 
     if (svga->overlay_on) {
-        if (!svga->override && svga->overlay_draw)
+        if (draw && svga->overlay_draw)
             svga->overlay_draw(svga, svga->displine + svga->y_add);
         svga->overlay_on--;
         if (svga->overlay_on && svga->interlace)
@@ -1038,7 +1042,7 @@ svga_do_render(svga_t *svga)
     }
 
     if (svga->dac_hwcursor_on) {
-        if (!svga->override && svga->dac_hwcursor_draw)
+        if (draw && svga->dac_hwcursor_draw)
             svga->dac_hwcursor_draw(svga, (svga->displine + svga->y_add + ((svga->dac_hwcursor_latch.y >= 0) ? 0 : svga->dac_hwcursor_latch.y)) & 2047);
         svga->dac_hwcursor_on--;
         if (svga->dac_hwcursor_on && svga->interlace)
@@ -1046,7 +1050,7 @@ svga_do_render(svga_t *svga)
     }
 
     if (svga->hwcursor_on) {
-        if (!svga->override && svga->hwcursor_draw)
+        if (draw && svga->hwcursor_draw)
             svga->hwcursor_draw(svga, (svga->displine + svga->y_add + ((svga->hwcursor_latch.y >= 0) ? 0 : svga->hwcursor_latch.y)) & 2047);
 
         svga->hwcursor_on--;
@@ -1117,7 +1121,8 @@ svga_poll(void *priv)
             svga->ma &= svga->vram_display_mask;
             if (svga->firstline == 2000) {
                 svga->firstline = svga->displine;
-                video_wait_for_buffer_monitor(svga->monitor_index);
+                if (!svga->frame_skip)
+                    video_wait_for_buffer_monitor(svga->monitor_index);
             }
 
             if (svga->hwcursor_on || svga->dac_hwcursor_on || svga->overlay_on)
@@ -1260,11 +1265,13 @@ svga_poll(void *priv)
                 if (svga->vertical_linedbl) {
                     wy = (svga->lastline - svga->firstline) << 1;
                     svga->vdisp = wy + 1;
-                    svga_doblit(wx, wy, svga);
+                    if (!svga->frame_skip)
+                        svga_doblit(wx, wy, svga);
                 } else {
                     wy = svga->lastline - svga->firstline;
                     svga->vdisp = wy + 1;
-                    svga_doblit(wx, wy, svga);
+                    if (!svga->frame_skip)
+                        svga_doblit(wx, wy, svga);
                 }
             }
 
@@ -1279,6 +1286,13 @@ svga_poll(void *priv)
             svga->monitor->mon_changeframecount = svga->interlace ? 3 : 2;
             svga->vslines                       = 0;
 
+            /* Lines changed while frames were being skipped may have aged out
+               of changedvram, so redraw everything once skipping stops. */
+            ret = svga->override ? 0 : video_frame_skip_monitor(svga->monitor_index);
+            if (svga->frame_skip && !ret)
+                svga->fullchange = svga->monitor->mon_changeframecount;
+            svga->frame_skip = ret;
+
             if (svga->interlace && svga->oddeven)
                 svga->ma = svga->maback = svga->ma_latch + (svga->rowoffset << 1) + svga->hblank_sub;
             else
@@ -1477,6 +1491,108 @@ svga_decode_addr(svga_t *svga, uint32_t addr, int write)
     return addr;
 }
 
+/* Re-derive the planar write path, called whenever the write mode or a
+   graphics controller register it depends on changes. */
+void
+svga_recalc_planar_write(svga_t *svga)
+{
+    svga->planar_write = SVGA_PLANAR_GENERIC;
+
+    if ((svga->writemode == 0) && (svga->gdcreg[8] == 0xff) && !(svga->gdcreg[3] & 0x18) &&
+        (!svga->gdcreg[1] || svga->set_reset_disabled))
+        svga->planar_write = SVGA_PLANAR_DIRECT;
+    else if (svga->writemode == 1)
+        svga->planar_write = SVGA_PLANAR_LATCH;
+}
+
+/* Merge the selected planes of val into the four bytes at addr. Plane i
+   lives at addr | i, so the four planes only make up one aligned word when
+   addr is 4 byte aligned; some chips (ET4000 chain modes) hand over
+   addresses that are not, and those are written a plane at a time. */
+static __inline void
+svga_planar_store(svga_t *svga, uint32_t addr, uint32_t mask, uint32_t val)
+{
+    uint32_t old;
+
+    if (!(addr & 3)) {
+        memcpy(&old, &svga->vram[addr], 4);
+        old = (old & ~mask) | (val & mask);
+        memcpy(&svga->vram[addr], &old, 4);
+        return;
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        if (mask & (0xff << (i << 3)))
+            svga->vram[addr | i] = (val >> (i << 3)) & 0xff;
+    }
+}
+
+/* Write modes 0-3 on all four planes at once. */
+static __inline void
+svga_write_planar(svga_t *svga, uint32_t addr, uint8_t val, int writemask2)
+{
+    uint32_t  mask  = video_plane_mask[writemask2 & 0xf];
+    uint32_t  latch = svga->latch.d[0];
+    uint32_t  bit_mask;
+    uint32_t  vall;
+
+    switch (svga->planar_write) {
+        case SVGA_PLANAR_DIRECT:
+            vall = svga_rotate[svga->gdcreg[3] & 7][val] * 0x01010101;
+            svga_planar_store(svga, addr, mask, vall);
+            return;
+        case SVGA_PLANAR_LATCH:
+            svga_planar_store(svga, addr, mask, latch);
+            return;
+
+        default:
+            break;
+    }
+
+    bit_mask = svga->gdcreg[8];
+    switch (svga->writemode) {
+        default:
+        case 0:
+            vall = svga_rotate[svga->gdcreg[3] & 7][val] * 0x01010101;
+            if ((bit_mask == 0xff) && !(svga->gdcreg[3] & 0x18) && (!svga->gdcreg[1] || svga->set_reset_disabled)) {
+                svga_planar_store(svga, addr, mask, vall);
+                return;
+            }
+            vall = (vall & ~video_plane_mask[svga->gdcreg[1] & 0xf]) |
+                   (video_plane_mask[svga->gdcreg[0] & 0xf] & video_plane_mask[svga->gdcreg[1] & 0xf]);
+            break;
+        case 1:
+            svga_planar_store(svga, addr, mask, latch);
+            return;
+        case 2:
+            vall = video_plane_mask[val & 0xf];
+            break;
+        case 3:
+            bit_mask &= svga_rotate[svga->gdcreg[3] & 7][val];
+            vall = video_plane_mask[svga->gdcreg[0] & 0xf];
+            break;
+    }
+
+    bit_mask *= 0x01010101;
+    switch (svga->gdcreg[3] & 0x18) {
+        default:
+        case 0x00: /* Set */
+            vall = (vall & bit_mask) | (latch & ~bit_mask);
+            break;
+        case 0x08: /* AND */
+            vall = (vall | ~bit_mask) & latch;
+            break;
+        case 0x10: /* OR */
+            vall = (vall & bit_mask) | latch;
+            break;
+        case 0x18: /* XOR */
+            vall = (vall & bit_mask) ^ latch;
+            break;
+    }
+
+    svga_planar_store(svga, addr, mask, vall);
+}
+
 static __inline void
 svga_write_common(uint32_t addr, uint8_t val, uint8_t linear, void *priv)
 {
@@ -1540,6 +1656,11 @@ svga_write_common(uint32_t addr, uint8_t val, uint8_t linear, void *priv)
 
     svga->changedvram[addr >> 12] = svga->monitor->mon_changeframecount;
 
+    if ((svga->writemode < 4) && !(svga->adv_flags & (FLAG_LATCH8 | FLAG_EXT_WRITE))) {
+        svga_write_planar(svga, addr, val, writemask2);
+        return;
+    }
+
     count = 4;
     if (svga->adv_flags & FLAG_LATCH8)
         count = 8;
@@ -136,7 +136,6 @@ void
 svga_render_text_40(svga_t *svga)
 {
     uint32_t *p;
-    int       xx;
     int       drawcursor;
     int       xinc;
     uint8_t   chr;
@@ -192,12 +191,8 @@ svga_render_text_40(svga_t *svga)
             }
 
             dat = svga->vram[charaddr + (svga->sc << 2)];
-            if (svga->seqregs[1] & 1) {
-                for (xx = 0; xx < 16; xx += 2)
-                    p[xx] = p[xx + 1] = (dat & (0x80 >> (xx >> 1))) ? fg : bg;
-            } else {
-                for (xx = 0; xx < 16; xx += 2)
-                    p[xx] = p[xx + 1] = (dat & (0x80 >> (xx >> 1))) ? fg : bg;
+            video_font_row_wide(p, dat, fg, bg);
+            if (!(svga->seqregs[1] & 1)) {
                 if ((chr & ~0x1f) != 0xc0 || !(svga->attrregs[0x10] & 4))
                     p[16] = p[17] = bg;
                 else
@@ -214,7 +209,6 @@ void
 svga_render_text_80(svga_t *svga)
 {
     uint32_t *p;
-    int       xx;
     int       drawcursor;
     int       xinc;
     uint8_t   chr;
@@ -269,12 +263,8 @@ svga_render_text_80(svga_t *svga)
             }
 
             dat = svga->vram[charaddr + (svga->sc << 2)];
-            if (svga->seqregs[1] & 1) {
-                for (xx = 0; xx < 8; xx++)
-                    p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
-            } else {
-                for (xx = 0; xx < 8; xx++)
-                    p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
+            video_font_row(p, dat, fg, bg);
+            if (!(svga->seqregs[1] & 1)) {
                 if ((chr & ~0x1F) != 0xC0 || !(svga->attrregs[0x10] & 4))
                     p[8] = bg;
                 else
@@ -292,7 +282,6 @@ void
 svga_render_text_80_ksc5601(svga_t *svga)
 {
     uint32_t *p;
-    int       xx;
     int       drawcursor;
     int       xinc;
     uint8_t   chr;
@@ -360,12 +349,8 @@ svga_render_text_80_ksc5601(svga_t *svga)
                     dat = svga->vram[charaddr + (svga->sc << 2)];
             }
 
-            if (svga->seqregs[1] & 1) {
-                for (xx = 0; xx < 8; xx++)
-                    p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
-            } else {
-                for (xx = 0; xx < 8; xx++)
-                    p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
+            video_font_row(p, dat, fg, bg);
+            if (!(svga->seqregs[1] & 1)) {
                 if (((chr & ~0x1f) != 0xc0) || !(svga->attrregs[0x10] & 4))
                     p[8] = bg;
                 else
@@ -397,12 +382,8 @@ svga_render_text_80_ksc5601(svga_t *svga)
                 else
                     dat = 0xff;
 
-                if (svga->seqregs[1] & 1) {
-                    for (xx = 0; xx < 8; xx++)
-                        p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
-                } else {
-                    for (xx = 0; xx < 8; xx++)
-                        p[xx] = (dat & (0x80 >> xx)) ? fg : bg;
+                video_font_row(p, dat, fg, bg);
+                if (!(svga->seqregs[1] & 1)) {
                     if (((chr & ~0x1f) != 0xc0) || !(svga->attrregs[0x10] & 4))
                         p[8] = bg;
                     else
@@ -74,6 +74,7 @@
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/vid_rop.h>
 
 #define ROM_TGUI_9400CXI          "roms/video/tgui9440/9400CXI.VBI"
 #define ROM_TGUI_9440_VLB         "roms/video/tgui9440/trident_9440_vlb.bin"
@@ -439,6 +440,7 @@ tgui_out(uint16_t addr, uint8_t val, void *priv)
                 }
             }
             svga->fast = (svga->gdcreg[8] == 0xff && !(svga->gdcreg[3] & 0x18) && !svga->gdcreg[1]) && ((svga->chain4 && (svga->packed_chain4 || svga->force_old_addr)) || svga->fb_only);
+            svga_recalc_planar_write(svga);
             if (((svga->gdcaddr == 5) && ((val ^ o) & 0x70)) || ((svga->gdcaddr == 6) && ((val ^ o) & 1)))
                 svga_recalctimings(svga);
             return;
@@ -1454,18 +1456,9 @@ enum {
     else                                               \
         dat = vram_l[(addr) & (tgui->vram_mask >> 2)];
 
-#define MIX()                                 \
-    do {                                      \
-        out = 0;                              \
-        for (c = 0; c < 32; c++) {            \
-            d = (dst_dat & (1 << c)) ? 1 : 0; \
-            if (src_dat & (1 << c))           \
-                d |= 2;                       \
-            if (pat_dat & (1 << c))           \
-                d |= 4;                       \
-            if (tgui->accel.rop & (1 << d))   \
-                out |= (1 << c);              \
-        }                                     \
+#define MIX()                                                   \
+    do {                                                        \
+        out = rop3(tgui->accel.rop, dst_dat, src_dat, pat_dat); \
     } while (0)
 
 #define WRITE(addr, dat)                                                               \
@@ -1487,8 +1480,6 @@ tgui_accel_command(int count, uint32_t cpu_dat, tgui_t *tgui)
     const uint32_t *pattern_data;
     int             x;
     int             y;
-    int             c;
-    int             d;
     uint32_t        out;
     uint32_t        src_dat   = 0;
     uint32_t        dst_dat;
@@ -1095,7 +1095,7 @@ banshee_status(banshee_t *banshee)
     int           fifo_entries = FIFO_ENTRIES;
     int           swap_count   = voodoo->swap_count;
     int           written      = voodoo->cmd_written + voodoo->cmd_written_fifo;
-    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || voodoo->render_voodoo_busy[0] || voodoo->render_voodoo_busy[1] || voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3] || voodoo->voodoo_busy;
+    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || voodoo_render_busy(voodoo) || voodoo->voodoo_busy;
     uint32_t      ret          = 0;
 
     if (fifo_entries < 0x20)
@@ -3211,12 +3211,51 @@ static const device_config_t banshee_sgram_config[] = {
                 .description = "4",
                 .value = 4
             },
+            {
+                .description = "8",
+                .value = 8
+            },
+            {
+                .description = "16",
+                .value = 16
+            },
             {
                 .description = ""
             }
         },
         .default_int = 2
     },
+    {
+        .name = "texture_cache_size",
+        .description = "Texture cache size",
+        .type = CONFIG_SELECTION,
+        .selection = {
+            {
+                .description = "32 MB",
+                .value = 32
+            },
+            {
+                .description = "64 MB",
+                .value = 64
+            },
+            {
+                .description = "128 MB",
+                .value = 128
+            },
+            {
+                .description = "256 MB",
+                .value = 256
+            },
+            {
+                .description = "512 MB",
+                .value = 512
+            },
+            {
+                .description = ""
+            }
+        },
+        .default_int = 128
+    },
 #ifndef NO_CODEGEN
     {
         .name = "recompiler",
@@ -3266,12 +3305,51 @@ static const device_config_t banshee_sgram_16mbonly_config[] = {
                 .description = "4",
                 .value = 4
             },
+            {
+                .description = "8",
+                .value = 8
+            },
+            {
+                .description = "16",
+                .value = 16
+            },
             {
                 .description = ""
             }
         },
         .default_int = 2
     },
+    {
+        .name = "texture_cache_size",
+        .description = "Texture cache size",
+        .type = CONFIG_SELECTION,
+        .selection = {
+            {
+                .description = "32 MB",
+                .value = 32
+            },
+            {
+                .description = "64 MB",
+                .value = 64
+            },
+            {
+                .description = "128 MB",
+                .value = 128
+            },
+            {
+                .description = "256 MB",
+                .value = 256
+            },
+            {
+                .description = "512 MB",
+                .value = 512
+            },
+            {
+                .description = ""
+            }
+        },
+        .default_int = 128
+    },
 #ifndef NO_CODEGEN
     {
         .name = "recompiler",
@@ -3321,12 +3399,51 @@ static const device_config_t banshee_sdram_config[] = {
                 .description = "4",
                 .value = 4
             },
+            {
+                .description = "8",
+                .value = 8
+            },
+            {
+                .description = "16",
+                .value = 16
+            },
             {
                 .description = ""
             }
         },
         .default_int = 2
     },
+    {
+        .name = "texture_cache_size",
+        .description = "Texture cache size",
+        .type = CONFIG_SELECTION,
+        .selection = {
+            {
+                .description = "32 MB",
+                .value = 32
+            },
+            {
+                .description = "64 MB",
+                .value = 64
+            },
+            {
+                .description = "128 MB",
+                .value = 128
+            },
+            {
+                .description = "256 MB",
+                .value = 256
+            },
+            {
+                .description = "512 MB",
+                .value = 512
+            },
+            {
+                .description = ""
+            }
+        },
+        .default_int = 128
+    },
 #ifndef NO_CODEGEN
     {
         .name = "recompiler",
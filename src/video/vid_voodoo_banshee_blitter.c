@@ -31,7 +31,9 @@
 #include <86box/vid_svga.h>
 #include <86box/vid_voodoo_common.h>
 #include <86box/vid_voodoo_banshee_blitter.h>
+#include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
+#include <86box/vid_rop.h>
 
 #define COMMAND_CMD_MASK                         (0xf)
 #define COMMAND_CMD_NOP                          (0 << 0)
@@ -163,9 +165,8 @@ colorkey(voodoo_t *voodoo, uint32_t src, int src_notdst, int color_format)
 static uint32_t
 MIX(voodoo_t *voodoo, uint32_t dest, uint32_t src, uint32_t pattern, int colour_format_src, int colour_format_dest)
 {
-    int      rop_nr = 0;
-    uint32_t result = 0;
-    uint32_t rop;
+    int     rop_nr = 0;
+    uint8_t rop;
 
     if (colorkey(voodoo, src, 1, colour_format_src))
         rop_nr |= 2;
@@ -174,24 +175,7 @@ MIX(voodoo_t *voodoo, uint32_t dest, uint32_t src, uint32_t pattern, int colour_
 
     rop = voodoo->banshee_blt.rops[rop_nr];
 
-    if (rop & 0x01)
-        result |= (~pattern & ~src & ~dest);
-    if (rop & 0x02)
-        result |= (~pattern & ~src & dest);
-    if (rop & 0x04)
-        result |= (~pattern & src & ~dest);
-    if (rop & 0x08)
-        result |= (~pattern & src & dest);
-    if (rop & 0x10)
-        result |= (pattern & ~src & ~dest);
-    if (rop & 0x20)
-        result |= (pattern & ~src & dest);
-    if (rop & 0x40)
-        result |= (pattern & src & ~dest);
-    if (rop & 0x80)
-        result |= (pattern & src & dest);
-
-    return result;
+    return rop3(rop, dest, src, pattern);
 }
 
 static uint32_t
@@ -550,6 +534,63 @@ DECODE_YUYV422_16BPP(uint16_t *buf, uint8_t *src)
     } while (0);
 }
 
+/*Same-format screen to screen line that needs neither the pattern, colour
+  keying nor clipping within the line; done as a single ROP3 span. Returns 0
+  if the per-pixel path has to be used.*/
+static int
+do_screen_to_screen_line_span(voodoo_t *voodoo, uint8_t *src_p, int src_x, int dst_y, const clip_t *clip)
+{
+    uint8_t     rop   = voodoo->banshee_blt.rops[0];
+    int         dst_x = voodoo->banshee_blt.dstX;
+    int         bpp   = voodoo->banshee_blt.src_bpp >> 3;
+    int         len   = voodoo->banshee_blt.dstSizeX * bpp;
+    uint8_t    *src   = &src_p[(src_x * voodoo->banshee_blt.src_bpp) >> 3];
+    uint32_t    dst_addr;
+    rop3_span_t span;
+
+    switch (voodoo->banshee_blt.dstFormat & DST_FORMAT_COL_MASK) {
+        case DST_FORMAT_COL_8_BPP:
+        case DST_FORMAT_COL_16_BPP:
+        case DST_FORMAT_COL_24_BPP:
+        case DST_FORMAT_COL_32_BPP:
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (ROP3_USES_PAT(rop) || (voodoo->banshee_blt.command & COMMAND_DX) || voodoo->banshee_blt.dstBaseAddr_tiled ||
+        (voodoo->banshee_blt.commandExtra & (CMDEXTRA_SRC_COLORKEY | CMDEXTRA_DST_COLORKEY)))
+        return 0;
+    if ((len <= 0) || (src_x < 0) || (dst_x < clip->x_min) || ((dst_x + voodoo->banshee_blt.dstSizeX) > clip->x_max))
+        return 0;
+
+    dst_addr = get_addr(voodoo, dst_x * bpp, dst_y, 0, 0);
+    if (((dst_addr + len) > (voodoo->fb_mask + 1)) || ((src + len) > &voodoo->vram[voodoo->fb_mask + 1]))
+        return 0;
+
+    /*The per-pixel loop runs left to right, so a destination overlapping the
+      source further right repeats source pixels; leave that case to it.*/
+    if ((&voodoo->vram[dst_addr] > src) && (&voodoo->vram[dst_addr] < (src + len)))
+        return 0;
+
+    span.dst      = &voodoo->vram[dst_addr];
+    span.src      = src;
+    span.pat      = NULL;
+    span.src_col  = 0;
+    span.pat_col  = 0;
+    span.wrt_mask = 0xffffffff;
+    span.bpp      = bpp;
+    span.count    = voodoo->banshee_blt.dstSizeX;
+    rop3_span(rop, &span);
+
+    for (uint32_t page = dst_addr >> 12; page <= ((dst_addr + len - 1) >> 12); page++)
+        voodoo->changedvram[page] = changeframecount;
+
+    voodoo->banshee_blt.cur_x = voodoo->banshee_blt.dstSizeX;
+    return 1;
+}
+
 static void
 do_screen_to_screen_line(voodoo_t *voodoo, uint8_t *src_p, int use_x_dir, int src_x, int src_tiled)
 {
@@ -577,7 +618,8 @@ do_screen_to_screen_line(voodoo_t *voodoo, uint8_t *src_p, int use_x_dir, int sr
 #endif
     if ((voodoo->banshee_blt.srcFormat & SRC_FORMAT_COL_MASK) == (voodoo->banshee_blt.dstFormat & DST_FORMAT_COL_MASK)) {
         /*No conversion required*/
-        if (dst_y >= clip->y_min && dst_y < clip->y_max) {
+        if (dst_y >= clip->y_min && dst_y < clip->y_max &&
+            !(use_x_dir && !src_tiled && !use_pattern_trans && do_screen_to_screen_line_span(voodoo, src_p, src_x, dst_y, clip))) {
             int     dst_x        = voodoo->banshee_blt.dstX;
             int     pat_x        = voodoo->banshee_blt.patoff_x + voodoo->banshee_blt.dstX;
             uint8_t pattern_mask = pattern_mono[pat_y & 7];
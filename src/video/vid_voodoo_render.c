@@ -660,10 +660,461 @@ voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t *params, voodoo_sta
 #    include <86box/vid_voodoo_codegen_x86.h>
 #elif (defined __amd64__ || defined _M_X64)
 #    include <86box/vid_voodoo_codegen_x86-64.h>
+#elif (defined __aarch64__ || defined _M_ARM64)
+#    include <86box/vid_voodoo_codegen_arm64.h>
 #else
 int voodoo_recomp = 0;
 #endif
 
+/*Specialised span renderers.
+
+  Untextured, unfogged and unblended spans (flat or Gouraud shaded fills,
+  with or without depth buffering) are drawn four pixels at a time by one of
+  the variants below, each specialised at compile time on colour source,
+  dither pattern and whether the depth test is enabled. Everything else is
+  left to the generic per-pixel loop in voodoo_half_triangle().
+
+  Pixels within a span do not depend on each other, so spans are always
+  walked left to right. The iterators at pixel x are start + (x - x0) * dXdX
+  for either direction, with the same 32-bit wraparound as the per-pixel
+  loop.*/
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VOODOO_SPAN_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VOODOO_SPAN_NEON
+#    include <arm_neon.h>
+#endif
+
+enum {
+    VOODOO_SPAN_DITHER_NONE = 0,
+    VOODOO_SPAN_DITHER_4x4,
+    VOODOO_SPAN_DITHER_2x2
+};
+
+typedef void (*voodoo_span_func_t)(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int x, int x2, int real_y);
+
+static inline int
+voodoo_span_depth_pass(int op, int32_t comp_depth, int32_t old_depth)
+{
+    switch (op) {
+        case DEPTHOP_LESSTHAN:
+            return comp_depth < old_depth;
+        case DEPTHOP_EQUAL:
+            return comp_depth == old_depth;
+        case DEPTHOP_LESSTHANEQUAL:
+            return comp_depth <= old_depth;
+        case DEPTHOP_GREATERTHAN:
+            return comp_depth > old_depth;
+        case DEPTHOP_NOTEQUAL:
+            return comp_depth != old_depth;
+        case DEPTHOP_GREATERTHANEQUAL:
+            return comp_depth >= old_depth;
+        case DEPTHOP_ALWAYS:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+#if defined(VOODOO_SPAN_SSE2)
+static inline __m128i
+voodoo_span_clamp16_sse2(__m128i v)
+{
+    const __m128i ffff = _mm_set1_epi32(0xffff);
+    __m128i       over;
+
+    v    = _mm_and_si128(v, _mm_cmpgt_epi32(v, _mm_set1_epi32(-1)));
+    over = _mm_cmpgt_epi32(v, ffff);
+    return _mm_or_si128(_mm_andnot_si128(over, v), _mm_and_si128(over, ffff));
+}
+
+static inline __m128i
+voodoo_span_depth_mask_sse2(int op, __m128i comp_depth, __m128i old_depth)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+
+    switch (op) {
+        case DEPTHOP_LESSTHAN:
+            return _mm_cmplt_epi32(comp_depth, old_depth);
+        case DEPTHOP_EQUAL:
+            return _mm_cmpeq_epi32(comp_depth, old_depth);
+        case DEPTHOP_LESSTHANEQUAL:
+            return _mm_xor_si128(_mm_cmpgt_epi32(comp_depth, old_depth), ones);
+        case DEPTHOP_GREATERTHAN:
+            return _mm_cmpgt_epi32(comp_depth, old_depth);
+        case DEPTHOP_NOTEQUAL:
+            return _mm_xor_si128(_mm_cmpeq_epi32(comp_depth, old_depth), ones);
+        case DEPTHOP_GREATERTHANEQUAL:
+            return _mm_xor_si128(_mm_cmplt_epi32(comp_depth, old_depth), ones);
+        case DEPTHOP_ALWAYS:
+            return ones;
+        default:
+            return _mm_setzero_si128();
+    }
+}
+#elif defined(VOODOO_SPAN_NEON)
+static inline int32x4_t
+voodoo_span_clamp16_neon(int32x4_t v)
+{
+    return vminq_s32(vmaxq_s32(v, vdupq_n_s32(0)), vdupq_n_s32(0xffff));
+}
+
+static inline uint32x4_t
+voodoo_span_depth_mask_neon(int op, int32x4_t comp_depth, int32x4_t old_depth)
+{
+    switch (op) {
+        case DEPTHOP_LESSTHAN:
+            return vcltq_s32(comp_depth, old_depth);
+        case DEPTHOP_EQUAL:
+            return vceqq_s32(comp_depth, old_depth);
+        case DEPTHOP_LESSTHANEQUAL:
+            return vcleq_s32(comp_depth, old_depth);
+        case DEPTHOP_GREATERTHAN:
+            return vcgtq_s32(comp_depth, old_depth);
+        case DEPTHOP_NOTEQUAL:
+            return vmvnq_u32(vceqq_s32(comp_depth, old_depth));
+        case DEPTHOP_GREATERTHANEQUAL:
+            return vcgeq_s32(comp_depth, old_depth);
+        case DEPTHOP_ALWAYS:
+            return vdupq_n_u32(0xffffffff);
+        default:
+            return vdupq_n_u32(0);
+    }
+}
+#endif
+
+static inline void
+voodoo_span_draw(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int x, int x2, int real_y,
+                 const int iterated, const int dither_mode, const int depth_test)
+{
+    uint16_t      *fb_mem      = state->fb_mem;
+    uint16_t      *aux_mem     = state->aux_mem;
+    int            xs          = (x < x2) ? x : x2;
+    int            xe          = (x < x2) ? x2 : x;
+    int            count       = xe - xs + 1;
+    int            passed      = 0;
+    int            rgb_write   = params->fbzMode & FBZ_RGB_WMASK;
+    int            depth_write = depth_test && (params->fbzMode & FBZ_DEPTH_WMASK);
+    int            op          = depth_op;
+    int32_t        bias        = (params->fbzMode & FBZ_DEPTH_BIAS) ? (int16_t) params->zaColor : 0;
+    int32_t        src_depth   = (params->fbzMode & FBZ_DEPTH_SOURCE) ? (int32_t) (params->zaColor & 0xffff) : -1;
+    uint32_t       dr          = params->dRdX;
+    uint32_t       dg          = params->dGdX;
+    uint32_t       db          = params->dBdX;
+    uint32_t       dz          = params->dZdX;
+    uint32_t       ir          = state->ir + (uint32_t) (xs - x) * dr;
+    uint32_t       ig          = state->ig + (uint32_t) (xs - x) * dg;
+    uint32_t       ib          = state->ib + (uint32_t) (xs - x) * db;
+    uint32_t       z           = state->z + (uint32_t) (xs - x) * dz;
+    const uint8_t *rb_row      = NULL;
+    const uint8_t *g_row       = NULL;
+    int            stride      = 0;
+    int            x_mask      = 0;
+    int            const_r     = 0;
+    int            const_g     = 0;
+    int            const_b     = 0;
+    uint16_t       const_pix[4];
+    int            px = xs;
+
+    if (dither_mode == VOODOO_SPAN_DITHER_4x4) {
+        rb_row = &dither_rb[0][real_y & 3][0];
+        g_row  = &dither_g[0][real_y & 3][0];
+        stride = 16;
+        x_mask = 3;
+    } else if (dither_mode == VOODOO_SPAN_DITHER_2x2) {
+        rb_row = &dither_rb2x2[0][real_y & 1][0];
+        g_row  = &dither_g2x2[0][real_y & 1][0];
+        stride = 4;
+        x_mask = 1;
+    }
+
+    if (!iterated) {
+        uint32_t col = cc_zero_other ? params->color0 : params->color1;
+
+        const_r = (col >> 16) & 0xff;
+        const_g = (col >> 8) & 0xff;
+        const_b = col & 0xff;
+        for (uint8_t c = 0; c < 4; c++) {
+            if (dither_mode != VOODOO_SPAN_DITHER_NONE)
+                const_pix[c] = rb_row[const_b * stride + (c & x_mask)] | (g_row[const_g * stride + (c & x_mask)] << 5) | (rb_row[const_r * stride + (c & x_mask)] << 11);
+            else
+                const_pix[c] = (const_b >> 3) | ((const_g >> 2) << 5) | ((const_r >> 3) << 11);
+        }
+    }
+
+#if defined(VOODOO_SPAN_SSE2)
+    {
+        __m128i       vr      = _mm_set_epi32(ir + 3 * dr, ir + 2 * dr, ir + dr, ir);
+        __m128i       vg      = _mm_set_epi32(ig + 3 * dg, ig + 2 * dg, ig + dg, ig);
+        __m128i       vb      = _mm_set_epi32(ib + 3 * db, ib + 2 * db, ib + db, ib);
+        __m128i       vz      = _mm_set_epi32(z + 3 * dz, z + 2 * dz, z + dz, z);
+        const __m128i step_r  = _mm_set1_epi32(4 * dr);
+        const __m128i step_g  = _mm_set1_epi32(4 * dg);
+        const __m128i step_b  = _mm_set1_epi32(4 * db);
+        const __m128i step_z  = _mm_set1_epi32(4 * dz);
+        const __m128i zero    = _mm_setzero_si128();
+        const __m128i ff_w    = _mm_set1_epi16(0xff);
+        const __m128i bias_d  = _mm_set1_epi32(0x8000);
+        const __m128i bias_w  = _mm_set1_epi16((int16_t) 0x8000);
+        const __m128i vsource = _mm_set1_epi32(src_depth);
+
+        for (; px + 3 <= xe; px += 4) {
+            __m128i new_depth = voodoo_span_clamp16_sse2(_mm_srai_epi32(vz, 12));
+            __m128i pass      = _mm_set1_epi32(-1);
+            int     mask      = 0xf;
+
+            if (bias)
+                new_depth = voodoo_span_clamp16_sse2(_mm_add_epi32(new_depth, _mm_set1_epi32(bias)));
+
+            if (depth_test) {
+                __m128i old_depth = _mm_unpacklo_epi16(_mm_loadl_epi64((__m128i *) &aux_mem[px]), zero);
+
+                pass = voodoo_span_depth_mask_sse2(op, (src_depth >= 0) ? vsource : new_depth, old_depth);
+                mask = _mm_movemask_ps(_mm_castsi128_ps(pass));
+            }
+
+            if (mask) {
+                __m128i mask_w = _mm_packs_epi32(pass, pass);
+
+                passed += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+
+                if (rgb_write) {
+                    __m128i pix;
+                    __m128i old_pix = _mm_loadl_epi64((__m128i *) &fb_mem[px]);
+
+                    if (iterated) {
+                        __m128i rg = _mm_packs_epi32(_mm_srai_epi32(vr, 12), _mm_srai_epi32(vg, 12));
+                        __m128i bb = _mm_packs_epi32(_mm_srai_epi32(vb, 12), _mm_srai_epi32(vb, 12));
+
+                        if (dither_mode != VOODOO_SPAN_DITHER_NONE) {
+                            uint8_t  c[16];
+                            uint16_t p[4];
+
+                            _mm_storeu_si128((__m128i *) c, _mm_packus_epi16(rg, bb));
+                            for (uint8_t i = 0; i < 4; i++) {
+                                int xx = (px + i) & x_mask;
+
+                                p[i] = rb_row[c[8 + i] * stride + xx] | (g_row[c[4 + i] * stride + xx] << 5) | (rb_row[c[i] * stride + xx] << 11);
+                            }
+                            pix = _mm_loadl_epi64((__m128i *) p);
+                        } else {
+                            rg  = _mm_min_epi16(_mm_max_epi16(rg, zero), ff_w);
+                            bb  = _mm_min_epi16(_mm_max_epi16(bb, zero), ff_w);
+                            pix = _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(rg, 3), 11),
+                                               _mm_slli_epi16(_mm_srli_epi16(_mm_srli_si128(rg, 8), 2), 5));
+                            pix = _mm_or_si128(pix, _mm_srli_epi16(bb, 3));
+                        }
+                    } else
+                        pix = _mm_set_epi16(0, 0, 0, 0,
+                                            const_pix[(px + 3) & 3], const_pix[(px + 2) & 3], const_pix[(px + 1) & 3], const_pix[px & 3]);
+
+                    pix = _mm_or_si128(_mm_and_si128(mask_w, pix), _mm_andnot_si128(mask_w, old_pix));
+                    _mm_storel_epi64((__m128i *) &fb_mem[px], pix);
+                }
+
+                if (depth_write) {
+                    __m128i depth     = _mm_packs_epi32(_mm_sub_epi32(new_depth, bias_d), _mm_sub_epi32(new_depth, bias_d));
+                    __m128i old_depth = _mm_loadl_epi64((__m128i *) &aux_mem[px]);
+
+                    depth = _mm_xor_si128(depth, bias_w);
+                    depth = _mm_or_si128(_mm_and_si128(mask_w, depth), _mm_andnot_si128(mask_w, old_depth));
+                    _mm_storel_epi64((__m128i *) &aux_mem[px], depth);
+                }
+            }
+
+            vr = _mm_add_epi32(vr, step_r);
+            vg = _mm_add_epi32(vg, step_g);
+            vb = _mm_add_epi32(vb, step_b);
+            vz = _mm_add_epi32(vz, step_z);
+        }
+
+        ir = _mm_cvtsi128_si32(vr);
+        ig = _mm_cvtsi128_si32(vg);
+        ib = _mm_cvtsi128_si32(vb);
+        z  = _mm_cvtsi128_si32(vz);
+    }
+#elif defined(VOODOO_SPAN_NEON)
+    {
+        const int32_t lanes[4] = { 0, 1, 2, 3 };
+        int32x4_t     vlane    = vld1q_s32(lanes);
+        int32x4_t     vr       = vmlaq_n_s32(vdupq_n_s32(ir), vlane, dr);
+        int32x4_t     vg       = vmlaq_n_s32(vdupq_n_s32(ig), vlane, dg);
+        int32x4_t     vb       = vmlaq_n_s32(vdupq_n_s32(ib), vlane, db);
+        int32x4_t     vz       = vmlaq_n_s32(vdupq_n_s32(z), vlane, dz);
+        int32x4_t     vsource  = vdupq_n_s32(src_depth);
+
+        for (; px + 3 <= xe; px += 4) {
+            int32x4_t  new_depth = voodoo_span_clamp16_neon(vshrq_n_s32(vz, 12));
+            uint32x4_t pass      = vdupq_n_u32(0xffffffff);
+            int        n         = 4;
+
+            if (bias)
+                new_depth = voodoo_span_clamp16_neon(vaddq_s32(new_depth, vdupq_n_s32(bias)));
+
+            if (depth_test) {
+                int32x4_t old_depth = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(&aux_mem[px])));
+
+                pass = voodoo_span_depth_mask_neon(op, (src_depth >= 0) ? vsource : new_depth, old_depth);
+                n    = (vgetq_lane_u32(pass, 0) & 1) + (vgetq_lane_u32(pass, 1) & 1) + (vgetq_lane_u32(pass, 2) & 1) + (vgetq_lane_u32(pass, 3) & 1);
+            }
+
+            if (n) {
+                uint16x4_t mask_w = vmovn_u32(pass);
+
+                passed += n;
+
+                if (rgb_write) {
+                    uint16x4_t pix;
+
+                    if (iterated) {
+                        uint8x8_t rg = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(vr, 12)), vqmovn_s32(vshrq_n_s32(vg, 12))));
+                        uint8x8_t bb = vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(vb, 12)), vqmovn_s32(vshrq_n_s32(vb, 12))));
+
+                        if (dither_mode != VOODOO_SPAN_DITHER_NONE) {
+                            uint8_t  c[16];
+                            uint16_t p[4];
+
+                            vst1_u8(c, rg);
+                            vst1_u8(&c[8], bb);
+                            for (uint8_t i = 0; i < 4; i++) {
+                                int xx = (px + i) & x_mask;
+
+                                p[i] = rb_row[c[8 + i] * stride + xx] | (g_row[c[4 + i] * stride + xx] << 5) | (rb_row[c[i] * stride + xx] << 11);
+                            }
+                            pix = vld1_u16(p);
+                        } else {
+                            uint16x8_t rg_w = vmovl_u8(rg);
+                            uint16x4_t b_w  = vget_low_u16(vmovl_u8(bb));
+
+                            pix = vorr_u16(vshl_n_u16(vshr_n_u16(vget_low_u16(rg_w), 3), 11), vshl_n_u16(vshr_n_u16(vget_high_u16(rg_w), 2), 5));
+                            pix = vorr_u16(pix, vshr_n_u16(b_w, 3));
+                        }
+                    } else {
+                        uint16_t p[4];
+
+                        for (uint8_t i = 0; i < 4; i++)
+                            p[i] = const_pix[(px + i) & 3];
+                        pix = vld1_u16(p);
+                    }
+
+                    vst1_u16(&fb_mem[px], vbsl_u16(mask_w, pix, vld1_u16(&fb_mem[px])));
+                }
+
+                if (depth_write)
+                    vst1_u16(&aux_mem[px], vbsl_u16(mask_w, vmovn_u32(vreinterpretq_u32_s32(new_depth)), vld1_u16(&aux_mem[px])));
+            }
+
+            vr = vaddq_s32(vr, vdupq_n_s32(4 * dr));
+            vg = vaddq_s32(vg, vdupq_n_s32(4 * dg));
+            vb = vaddq_s32(vb, vdupq_n_s32(4 * db));
+            vz = vaddq_s32(vz, vdupq_n_s32(4 * dz));
+        }
+
+        ir = vgetq_lane_s32(vr, 0);
+        ig = vgetq_lane_s32(vg, 0);
+        ib = vgetq_lane_s32(vb, 0);
+        z  = vgetq_lane_s32(vz, 0);
+    }
+#endif
+
+    for (; px <= xe; px++) {
+        int32_t new_depth = CLAMP16((int32_t) z >> 12);
+
+        if (bias)
+            new_depth = CLAMP16(new_depth + bias);
+
+        if (!depth_test || voodoo_span_depth_pass(op, (src_depth >= 0) ? src_depth : new_depth, aux_mem[px])) {
+            passed++;
+
+            if (rgb_write) {
+                if (iterated) {
+                    int r = CLAMP((int32_t) ir >> 12);
+                    int g = CLAMP((int32_t) ig >> 12);
+                    int b = CLAMP((int32_t) ib >> 12);
+
+                    if (dither_mode != VOODOO_SPAN_DITHER_NONE) {
+                        int xx = px & x_mask;
+
+                        fb_mem[px] = rb_row[b * stride + xx] | (g_row[g * stride + xx] << 5) | (rb_row[r * stride + xx] << 11);
+                    } else
+                        fb_mem[px] = (b >> 3) | ((g >> 2) << 5) | ((r >> 3) << 11);
+                } else
+                    fb_mem[px] = const_pix[px & 3];
+            }
+            if (depth_write)
+                aux_mem[px] = new_depth;
+        }
+
+        ir += dr;
+        ig += dg;
+        ib += db;
+        z += dz;
+    }
+
+    if (depth_test)
+        voodoo->fbiZFuncFail += count - passed;
+    voodoo->fbiPixelsOut += passed;
+    state->pixel_count = count;
+}
+
+#define VOODOO_SPAN_VARIANT(name, iterated, dither_mode, depth_test)                                              \
+    static void                                                                                                    \
+    name(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int x, int x2, int real_y)             \
+    {                                                                                                              \
+        voodoo_span_draw(voodoo, params, state, x, x2, real_y, iterated, dither_mode, depth_test);                 \
+    }
+
+VOODOO_SPAN_VARIANT(voodoo_span_const, 0, VOODOO_SPAN_DITHER_NONE, 0)
+VOODOO_SPAN_VARIANT(voodoo_span_const_z, 0, VOODOO_SPAN_DITHER_NONE, 1)
+VOODOO_SPAN_VARIANT(voodoo_span_const_d4, 0, VOODOO_SPAN_DITHER_4x4, 0)
+VOODOO_SPAN_VARIANT(voodoo_span_const_d4_z, 0, VOODOO_SPAN_DITHER_4x4, 1)
+VOODOO_SPAN_VARIANT(voodoo_span_const_d2, 0, VOODOO_SPAN_DITHER_2x2, 0)
+VOODOO_SPAN_VARIANT(voodoo_span_const_d2_z, 0, VOODOO_SPAN_DITHER_2x2, 1)
+VOODOO_SPAN_VARIANT(voodoo_span_iter, 1, VOODOO_SPAN_DITHER_NONE, 0)
+VOODOO_SPAN_VARIANT(voodoo_span_iter_z, 1, VOODOO_SPAN_DITHER_NONE, 1)
+VOODOO_SPAN_VARIANT(voodoo_span_iter_d4, 1, VOODOO_SPAN_DITHER_4x4, 0)
+VOODOO_SPAN_VARIANT(voodoo_span_iter_d4_z, 1, VOODOO_SPAN_DITHER_4x4, 1)
+VOODOO_SPAN_VARIANT(voodoo_span_iter_d2, 1, VOODOO_SPAN_DITHER_2x2, 0)
+VOODOO_SPAN_VARIANT(voodoo_span_iter_d2_z, 1, VOODOO_SPAN_DITHER_2x2, 1)
+
+/*Indexed by [iterated][dither mode][depth test]*/
+static const voodoo_span_func_t voodoo_span_funcs[2][3][2] = {
+    {
+        { voodoo_span_const,    voodoo_span_const_z    },
+        { voodoo_span_const_d4, voodoo_span_const_d4_z },
+        { voodoo_span_const_d2, voodoo_span_const_d2_z }
+    },
+    {
+        { voodoo_span_iter,    voodoo_span_iter_z    },
+        { voodoo_span_iter_d4, voodoo_span_iter_d4_z },
+        { voodoo_span_iter_d2, voodoo_span_iter_d2_z }
+    }
+};
+
+static voodoo_span_func_t
+voodoo_span_select(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    int iterated;
+    int dither_mode;
+
+    if (voodoo->params.col_tiled || voodoo->params.aux_tiled)
+        return NULL;
+
+    iterated = voodoo_plain_colour_mode(params);
+    if (iterated < 0)
+        return NULL;
+
+    if (!dither)
+        dither_mode = VOODOO_SPAN_DITHER_NONE;
+    else if (dither2x2)
+        dither_mode = VOODOO_SPAN_DITHER_2x2;
+    else
+        dither_mode = VOODOO_SPAN_DITHER_4x4;
+
+    return voodoo_span_funcs[iterated][dither_mode][(params->fbzMode & FBZ_DEPTH_ENABLE) ? 1 : 0];
+}
+
 static void
 voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
 {
@@ -697,6 +1148,7 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
 #ifndef NO_CODEGEN
     uint8_t (*voodoo_draw)(voodoo_state_t * state, voodoo_params_t * params, int x, int real_y);
 #endif
+    voodoo_span_func_t span_func;
     int y_diff   = SLI_ENABLED ? 2 : 1;
     int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? voodoo->y_origin_swap : (voodoo->v_disp - 1);
 
@@ -790,6 +1242,7 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
     else
         voodoo_draw = NULL;
 #endif
+    span_func = voodoo_span_select(voodoo, params);
 
     voodoo_render_log("dxAB=%08x dxBC=%08x dxAC=%08x\n", state->dxAB, state->dxBC, state->dxAC);
 #if 0
@@ -831,10 +1284,10 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
             real_y >>= 4;
 
         if (SLI_ENABLED) {
-            if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
+            if ((((unsigned) real_y >> 1) % voodoo->render_threads) != odd_even)
                 goto next_line;
         } else {
-            if ((real_y & voodoo->odd_even_mask) != odd_even)
+            if (((unsigned) real_y % voodoo->render_threads) != odd_even)
                 goto next_line;
         }
 
@@ -937,10 +1390,14 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         state->x           = x;
         state->x2          = x2;
 #ifndef NO_CODEGEN
-        if (voodoo->use_recompiler) {
+        if (voodoo_draw) {
             voodoo_draw(state, params, x, real_y);
         } else
 #endif
+        if (span_func) {
+            span_func(voodoo, params, state, x, x2, real_y);
+            state->texel_count = state->pixel_count * texels;
+        } else
             do {
                 int x_tiled = (x & 63) | ((x >> 6) * 128 * 32 / 2);
                 start_x     = x;
@@ -1540,9 +1997,11 @@ voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
 }
 
 static void
-render_thread(void *param, int odd_even)
+voodoo_render_thread(void *param)
 {
-    voodoo_t *voodoo = (voodoo_t *) param;
+    voodoo_render_param_t *render_param = (voodoo_render_param_t *) param;
+    voodoo_t              *voodoo       = render_param->voodoo;
+    int                    odd_even     = render_param->thread;
 
     while (voodoo->render_thread_run[odd_even]) {
         thread_set_event(voodoo->render_not_full_event[odd_even]);
@@ -1570,48 +2029,64 @@ render_thread(void *param, int odd_even)
     }
 }
 
+/*Every render thread reads every triangle from the shared params ring
+  through its own read index, and rasterises only the scanlines it owns
+  (line % render_threads). The ring is full as soon as the slowest thread
+  falls PARAM_SIZE triangles behind.*/
 void
-voodoo_render_thread_1(void *param)
-{
-    render_thread(param, 0);
-}
-void
-voodoo_render_thread_2(void *param)
+voodoo_render_threads_init(voodoo_t *voodoo)
 {
-    render_thread(param, 1);
+    if (voodoo->render_threads < 1)
+        voodoo->render_threads = 1;
+    else if (voodoo->render_threads > VOODOO_MAX_RENDER_THREADS)
+        voodoo->render_threads = VOODOO_MAX_RENDER_THREADS;
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_param[c].voodoo   = voodoo;
+        voodoo->render_param[c].thread   = c;
+        voodoo->wake_render_thread[c]    = thread_create_event();
+        voodoo->render_not_full_event[c] = thread_create_event();
+        voodoo->render_thread_run[c]     = 1;
+        voodoo->render_thread[c]         = thread_create(voodoo_render_thread, &voodoo->render_param[c]);
+    }
 }
+
 void
-voodoo_render_thread_3(void *param)
+voodoo_render_threads_close(voodoo_t *voodoo)
 {
-    render_thread(param, 2);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 0;
+        thread_set_event(voodoo->wake_render_thread[c]);
+        thread_wait(voodoo->render_thread[c]);
+        thread_destroy_event(voodoo->wake_render_thread[c]);
+        thread_destroy_event(voodoo->render_not_full_event[c]);
+    }
 }
-void
-voodoo_render_thread_4(void *param)
+
+static int
+voodoo_params_full(voodoo_t *voodoo)
 {
-    render_thread(param, 3);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_FULL(c))
+            return 1;
+    }
+
+    return 0;
 }
 
 void
 voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
     voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
-
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) || (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3)))) {
-        thread_reset_event(voodoo->render_not_full_event[0]);
-        if (voodoo->render_threads >= 2)
-            thread_reset_event(voodoo->render_not_full_event[1]);
-        if (voodoo->render_threads == 4) {
-            thread_reset_event(voodoo->render_not_full_event[2]);
-            thread_reset_event(voodoo->render_not_full_event[3]);
+    int              wake       = 0;
+
+    while (voodoo_params_full(voodoo)) {
+        for (int c = 0; c < voodoo->render_threads; c++)
+            thread_reset_event(voodoo->render_not_full_event[c]);
+        for (int c = 0; c < voodoo->render_threads; c++) {
+            if (PARAM_FULL(c))
+                thread_wait_event(voodoo->render_not_full_event[c], -1); /*Wait for room in ringbuffer*/
         }
-        if (PARAM_FULL(0))
-            thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-            thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(2))
-            thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(3))
-            thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
     }
 
     voodoo_use_texture(voodoo, params, 0);
@@ -1622,6 +2097,10 @@ voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 
     voodoo->params_write_idx++;
 
-    if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) || (voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_ENTRIES(c) < 4)
+            wake = 1;
+    }
+    if (wake)
         voodoo_wake_render_thread(voodoo);
 }
@@ -14,6 +14,7 @@
  *
  *          Copyright 2008-2020 Sarah Walker.
  */
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -239,14 +240,114 @@ voodoo_recalc_tex3(voodoo_t *voodoo, int tmu)
 
 #define makergba(r, g, b, a) ((b) | ((g) << 8) | ((r) << 16) | ((a) << 24))
 
+#define TEX_DATA_SIZE ((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4)
+
+static __inline int
+voodoo_texture_hash(uint32_t base, uint32_t tLOD, uint32_t palette_checksum)
+{
+    uint32_t hash = (base >> 3) ^ (tLOD * 0x9e3779b1) ^ palette_checksum;
+
+    return (hash ^ (hash >> 10) ^ (hash >> 20)) & TEX_HASH_MASK;
+}
+
+/*Add (delta = 1) or remove (delta = -1) a cache entry from the page
+  presence counts and the region index.*/
+static void
+voodoo_texture_track(voodoo_t *voodoo, int tmu, int c, int delta)
+{
+    texture_t *texture = &voodoo->texture_cache[tmu][c];
+    uint32_t   bit     = 1 << (c & 31);
+
+    for (uint8_t d = 0; d < 4; d++) {
+        uint32_t addr     = texture->addr_start[d];
+        uint32_t addr_end = texture->addr_end[d];
+
+        if (addr_end == 0)
+            continue;
+
+        for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT)) {
+            uint32_t  masked = addr & voodoo->texture_mask;
+            uint32_t *index  = &voodoo->texture_index[tmu][((masked >> TEX_INDEX_SHIFT) * voodoo->texture_index_words) + (c >> 5)];
+
+            voodoo->texture_present[tmu][masked >> TEX_DIRTY_SHIFT] += delta;
+            if (delta > 0)
+                *index |= bit;
+            else
+                *index &= ~bit;
+        }
+    }
+}
+
+static void
+voodoo_texture_remove(voodoo_t *voodoo, int tmu, int c)
+{
+    texture_t *texture = &voodoo->texture_cache[tmu][c];
+    int       *link;
+
+    if (texture->base == -1)
+        return;
+
+    link = &voodoo->texture_hash[tmu][voodoo_texture_hash(texture->base, texture->tLOD, texture->palette_checksum)];
+    while (*link != c)
+        link = &voodoo->texture_cache[tmu][*link].hash_next;
+    *link = texture->hash_next;
+
+    voodoo_texture_track(voodoo, tmu, c, -1);
+    texture->base = -1;
+}
+
+static void
+voodoo_texture_cache_stats(voodoo_t *voodoo)
+{
+    voodoo_texture_log("Texture cache: %i entries, %" PRIu64 " kB, %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions, %" PRIu64 " flushes\n",
+                       voodoo->texture_cache_size, voodoo->texture_cache_bytes >> 10, voodoo->texture_cache_hits,
+                       voodoo->texture_cache_misses, voodoo->texture_cache_evictions, voodoo->texture_cache_flushes);
+}
+
+/*size_mb caps the texture data of both TMUs together. Every entry may
+  need a full TEX_DATA_SIZE buffer, so the entry count is what fits.*/
+void
+voodoo_texture_cache_init(voodoo_t *voodoo, int size_mb)
+{
+    uint64_t entries = ((uint64_t) size_mb << 20) / ((voodoo->dual_tmus ? 2 : 1) * TEX_DATA_SIZE);
+    int      c;
+
+    voodoo->texture_cache_size  = (int) MAX(MIN(entries, TEX_CACHE_MAX), 16);
+    voodoo->texture_index_words = (voodoo->texture_cache_size + 31) >> 5;
+    voodoo->texture_cache_bytes = 0;
+
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        voodoo->texture_cache[tmu] = calloc(voodoo->texture_cache_size, sizeof(texture_t));
+        voodoo->texture_index[tmu] = calloc(TEX_INDEX_REGIONS * voodoo->texture_index_words, sizeof(uint32_t));
+
+        for (c = 0; c < voodoo->texture_cache_size; c++)
+            voodoo->texture_cache[tmu][c].base = -1; /*invalid*/
+        for (c = 0; c < TEX_HASH_SIZE; c++)
+            voodoo->texture_hash[tmu][c] = -1;
+    }
+}
+
+void
+voodoo_texture_cache_close(voodoo_t *voodoo)
+{
+    voodoo_texture_cache_stats(voodoo);
+
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        for (int c = 0; c < voodoo->texture_cache_size; c++)
+            free(voodoo->texture_cache[tmu][c].data);
+        free(voodoo->texture_cache[tmu]);
+        free(voodoo->texture_index[tmu]);
+    }
+}
+
 void
 voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 {
     int      c;
     int      lod_min;
     int      lod_max;
+    int      hash;
     uint32_t addr = 0;
-    uint32_t addr_end;
     uint32_t palette_checksum;
 
     lod_min = (params->tLOD[tmu] >> 2) & 15;
@@ -254,10 +355,12 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 
     if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88) {
         if (voodoo->palette_dirty[tmu]) {
-            palette_checksum = 0;
+            /*FNV-1a over the palette entries, so that reordered palettes
+              do not collide the way an XOR of the entries would*/
+            palette_checksum = 0x811c9dc5;
 
             for (c = 0; c < 256; c++)
-                palette_checksum ^= voodoo->palette[tmu][c].u;
+                palette_checksum = (palette_checksum ^ voodoo->palette[tmu][c].u) * 0x01000193;
 
             voodoo->palette_checksum[tmu] = palette_checksum;
             voodoo->palette_dirty[tmu]    = 0;
@@ -272,34 +375,44 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
         addr = params->texBaseAddr[tmu];
 
     /*Try to find texture in cache*/
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
+    hash = voodoo_texture_hash(addr, params->tLOD[tmu] & 0xf00fff, palette_checksum);
+    for (c = voodoo->texture_hash[tmu][hash]; c != -1; c = voodoo->texture_cache[tmu][c].hash_next) {
         if (voodoo->texture_cache[tmu][c].base == addr && voodoo->texture_cache[tmu][c].tLOD == (params->tLOD[tmu] & 0xf00fff) && voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum) {
             params->tex_entry[tmu] = c;
             voodoo->texture_cache[tmu][c].refcount++;
+            voodoo->texture_cache_hits++;
             return;
         }
     }
 
+    voodoo->texture_cache_misses++;
+    if (!(voodoo->texture_cache_misses & 0xffff))
+        voodoo_texture_cache_stats(voodoo);
+
     /*Texture not found, search for unused texture*/
     do {
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
-            voodoo->texture_last_removed++;
-            voodoo->texture_last_removed &= (TEX_CACHE_MAX - 1);
-            if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] && (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
+        for (c = 0; c < voodoo->texture_cache_size; c++) {
+            if (++voodoo->texture_last_removed >= voodoo->texture_cache_size)
+                voodoo->texture_last_removed = 0;
+            if (voodoo_texture_idle(voodoo, &voodoo->texture_cache[tmu][voodoo->texture_last_removed]))
                 break;
         }
-        if (c == TEX_CACHE_MAX)
+        if (c == voodoo->texture_cache_size)
             voodoo_wait_for_render_thread_idle(voodoo);
-    } while (c == TEX_CACHE_MAX);
-    if (c == TEX_CACHE_MAX)
-        fatal("Texture cache full!\n");
+    } while (c == voodoo->texture_cache_size);
 
     c = voodoo->texture_last_removed;
 
-    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
-    else
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr[tmu];
+    if (voodoo->texture_cache[tmu][c].base != -1) {
+        voodoo_texture_remove(voodoo, tmu, c);
+        voodoo->texture_cache_evictions++;
+    }
+    if (!voodoo->texture_cache[tmu][c].data) {
+        voodoo->texture_cache[tmu][c].data = malloc(TEX_DATA_SIZE);
+        voodoo->texture_cache_bytes += TEX_DATA_SIZE;
+    }
+
+    voodoo->texture_cache[tmu][c].base = addr;
     voodoo->texture_cache[tmu][c].tLOD = params->tLOD[tmu] & 0xf00fff;
 
     lod_min = (params->tLOD[tmu] >> 2) & 15;
@@ -536,15 +649,9 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
     } else
         voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->texture_cache[tmu][c].addr_end[3] = 0;
 
-    for (uint8_t d = 0; d < 4; d++) {
-        addr     = voodoo->texture_cache[tmu][c].addr_start[d];
-        addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
-
-        if (addr_end != 0) {
-            for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
-                voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-        }
-    }
+    voodoo_texture_track(voodoo, tmu, c, 1);
+    voodoo->texture_cache[tmu][c].hash_next = voodoo->texture_hash[tmu][hash];
+    voodoo->texture_hash[tmu][hash]         = c;
 
     params->tex_entry[tmu] = c;
     voodoo->texture_cache[tmu][c].refcount++;
@@ -553,14 +660,21 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 void
 flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
 {
-    int wait_for_idle = 0;
+    const uint32_t *index         = &voodoo->texture_index[tmu][(dirty_addr >> TEX_INDEX_SHIFT) * voodoo->texture_index_words];
+    int             wait_for_idle = 0;
 
-    memset(voodoo->texture_present[tmu], 0, sizeof(voodoo->texture_present[0]));
 #if 0
     voodoo_texture_log("Evict %08x %i\n", dirty_addr, sizeof(voodoo->texture_present));
 #endif
-    for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base != -1) {
+    /*Only the entries that overlap the 64 kB region of the write need
+      to be checked against their exact address ranges*/
+    for (int w = 0; w < voodoo->texture_index_words; w++) {
+        uint32_t bits = index[w];
+
+        for (int c = w << 5; bits; c++, bits >>= 1) {
+            if (!(bits & 1))
+                continue;
+
             for (uint8_t d = 0; d < 4; d++) {
                 int addr_start = voodoo->texture_cache[tmu][c].addr_start[d];
                 int addr_end   = voodoo->texture_cache[tmu][c].addr_end[d];
@@ -576,13 +690,12 @@ flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
                         voodoo_texture_log("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
 #endif
 
-                        if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] || (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
+                        if (!voodoo_texture_idle(voodoo, &voodoo->texture_cache[tmu][c]))
                             wait_for_idle = 1;
 
-                        voodoo->texture_cache[tmu][c].base = -1;
-                    } else {
-                        for (; addr_start <= addr_end; addr_start += (1 << TEX_DIRTY_SHIFT))
-                            voodoo->texture_present[tmu][(addr_start & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
+                        voodoo_texture_remove(voodoo, tmu, c);
+                        voodoo->texture_cache_flushes++;
+                        break;
                     }
                 }
             }
@@ -31,6 +31,7 @@
 #include <86box/timer.h>
 #include <86box/video.h>
 #include <86box/vid_xga.h>
+#include <86box/vid_rop.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
 #include <86box/vid_xga_device.h>
@@ -1414,6 +1415,136 @@ xga_line_draw_write(svga_t *svga)
     }
 }
 
+/*XGA mix codes 0-15 as ROP3s with the pattern operand unused.*/
+static uint8_t
+xga_rop3(int mix)
+{
+    uint8_t rop = ((mix & 1) << 3) | ((mix & 2) << 1) | ((mix & 4) >> 1) | ((mix & 8) >> 3);
+
+    return rop | (rop << 4);
+}
+
+/*Draws all but the last pixel of the current BitBlt line as a single ROP3
+  span, and leaves the engine state as if the per-pixel loop had drawn them,
+  so that the end of line bookkeeping stays in one place. Only 8 and 16 bpp
+  maps inside the video memory aperture, with no mask map, no colour compare
+  and logical mixes, are handled. With use_pat the pattern map picks the
+  foreground or background colour per pixel; otherwise the line is a solid
+  fill or, with a source map, a screen to screen copy. Returns 0, having
+  drawn nothing, if the line needs anything else.*/
+static int
+xga_bitblt_span(svga_t *svga, int16_t *dx, int16_t dy, int xdir, int use_pat)
+{
+    xga_t      *xga       = (xga_t *) svga->xga;
+    uint8_t     src_buf[4096 * 2];
+    uint8_t     pat_buf[4096 * 2];
+    int         count     = xga->accel.blt_width & 0xfff;
+    int         fmt       = xga->accel.px_map_format[xga->accel.dst_map] & 0x07;
+    int         bpp       = (fmt == 4) ? 2 : 1;
+    int         from_src  = (((xga->accel.command >> 28) & 3) == 2);
+    uint32_t    dstbase   = xga->accel.px_map_base[xga->accel.dst_map];
+    uint32_t    srcbase   = xga->accel.px_map_base[xga->accel.src_map];
+    uint32_t    patbase   = xga->accel.px_map_base[xga->accel.pat_src];
+    uint32_t    dstwidth  = xga->accel.px_map_width[xga->accel.dst_map];
+    uint32_t    srcwidth  = xga->accel.px_map_width[xga->accel.src_map];
+    uint32_t    patwidth  = xga->accel.px_map_width[xga->accel.pat_src];
+    uint32_t    dstheight = xga->accel.px_map_height[xga->accel.dst_map];
+    int         x_l       = (xdir > 0) ? *dx : (*dx - count + 1);
+    uint8_t     rop       = xga_rop3(xga->accel.frgd_mix & 0x0f);
+    uint32_t    dst;
+    uint32_t    src       = 0;
+    rop3_span_t span;
+
+    if ((count <= 0) || !xga->on || (xga->accel.command & 0xc0) || (xga->accel.cc_cond != 4) || (xga->accel.frgd_mix & 0x10))
+        return 0;
+    /*Every pixel is also written back through the linear aperture, which
+      must land on the same bytes.*/
+    if (!xga->linear_mapping.enable || (xga->linear_mapping.base != xga->linear_base))
+        return 0;
+    if ((fmt != 3) && ((fmt != 4) || (!(xga->access_mode & 0x08) && ((xga->access_mode & 0x07) == 0x04))))
+        return 0;
+    if ((dstbase < xga->linear_base) || (dstbase > (xga->linear_base + 0xfffff)))
+        return 0;
+    if ((dy < 0) || (dy > (int) dstheight) || (x_l < 0) || ((x_l + count - 1) > (int) dstwidth))
+        return 0;
+
+    dst = (dstbase + ((dy * (dstwidth + 1) + x_l) * bpp)) & xga->vram_mask;
+    if ((dst + (count * bpp)) > (xga->vram_mask + 1))
+        return 0;
+
+    span.src = NULL;
+    span.pat = NULL;
+
+    if (use_pat) {
+        if (from_src || (((xga->accel.command >> 30) & 3) == 2) || (xga->accel.bkgd_mix & 0x10))
+            return 0;
+
+        rop = (rop & 0xf0) | (xga_rop3(xga->accel.bkgd_mix & 0x0f) & 0x0f);
+        for (int c = 0; c < count; c++) {
+            int      mix = xga_accel_read_pattern_map_pixel(svga, xga->accel.px, xga->accel.py, patbase, patwidth + 1);
+            uint32_t col = mix ? xga->accel.frgd_color : xga->accel.bkgd_color;
+            int      o   = ((xdir > 0) ? c : (count - 1 - c)) * bpp;
+
+            src_buf[o] = col;
+            pat_buf[o] = mix ? 0xff : 0x00;
+            if (bpp == 2) {
+                src_buf[o + 1] = col >> 8;
+                pat_buf[o + 1] = pat_buf[o];
+            }
+
+            xga->accel.sx += xdir;
+            if (xga->accel.pattern)
+                xga->accel.px = ((xga->accel.px + xdir) & patwidth) | (xga->accel.px & ~patwidth);
+            else
+                xga->accel.px += xdir;
+        }
+        span.src = src_buf;
+        span.pat = pat_buf;
+    } else if (from_src) {
+        int src_l = (xdir > 0) ? xga->accel.sx : (xga->accel.sx - count + 1);
+
+        if (xga->accel.pattern || ((xga->accel.px_map_format[xga->accel.src_map] & 0x07) != fmt))
+            return 0;
+        if ((srcbase < xga->linear_base) || (srcbase > (xga->linear_base + 0xfffff)))
+            return 0;
+        if ((src_l < 0) || ((src_l + count - 1) > (int) srcwidth) || (xga->accel.sy < 0))
+            return 0;
+
+        src = (srcbase + ((xga->accel.sy * (srcwidth + 1) + src_l) * bpp)) & xga->vram_mask;
+        if ((src + (count * bpp)) > (xga->vram_mask + 1))
+            return 0;
+        if ((dst < (src + (count * bpp))) && (src < (dst + (count * bpp))) && ((xdir < 0) || (dst > src)))
+            return 0;
+
+        span.src = &xga->vram[src];
+        xga->accel.sx += count * xdir;
+    } else {
+        for (int c = 0; c < count; c++) {
+            if (xga->accel.pattern)
+                xga->accel.sx = ((xga->accel.sx + xdir) & srcwidth) | (xga->accel.sx & ~srcwidth);
+            else
+                xga->accel.sx += xdir;
+        }
+    }
+
+    span.dst      = &xga->vram[dst];
+    span.src_col  = xga->accel.frgd_color;
+    span.pat_col  = 0;
+    span.wrt_mask = xga->accel.plane_mask;
+    span.bpp      = bpp;
+    span.count    = count;
+    rop3_span(rop, &span);
+
+    for (uint32_t page = dst >> 12; page <= ((dst + (count * bpp) - 1) >> 12); page++)
+        xga->changedvram[page] = svga->monitor->mon_changeframecount;
+
+    cycles -= count * bpp * svga->monitor->mon_video_timing_write_b;
+
+    *dx += count * xdir;
+    xga->accel.x -= count;
+    return 1;
+}
+
 static void
 xga_bitblt(svga_t *svga)
 {
@@ -1494,6 +1625,9 @@ xga_bitblt(svga_t *svga)
         xga_log("PAT8: Pattern Enabled?=%d, xdir=%d, ydir=%d.\n", xga->accel.pattern, xdir, ydir);
 
         while (xga->accel.y >= 0) {
+            if (xga->accel.x == (xga->accel.blt_width & 0xfff))
+                xga_bitblt_span(svga, &dx, dy, xdir, 0);
+
             if (xga->accel.command & 0xc0) {
                 if ((dx >= xga->accel.mask_map_origin_x_off) && (dx <= ((xga->accel.px_map_width[0] & 0xfff) + xga->accel.mask_map_origin_x_off)) && (dy >= xga->accel.mask_map_origin_y_off) && (dy <= ((xga->accel.px_map_height[0] & 0xfff) + xga->accel.mask_map_origin_y_off))) {
                     src_dat  = (((xga->accel.command >> 28) & 3) == 2) ? xga_accel_read_map_pixel(svga, xga->accel.sx, xga->accel.sy, xga->accel.src_map, srcbase, srcwidth + 1) : frgdcol;
@@ -1657,6 +1791,9 @@ xga_bitblt(svga_t *svga)
             }
         } else {
             while (xga->accel.y >= 0) {
+                if (xga->accel.x == (xga->accel.blt_width & 0xfff))
+                    xga_bitblt_span(svga, &dx, dy, xdir, 1);
+
                 mix = xga_accel_read_pattern_map_pixel(svga, xga->accel.px, xga->accel.py, patbase, patwidth + 1);
 
                 if (xga->accel.command & 0xc0) {
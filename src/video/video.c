@@ -99,6 +99,15 @@ uint32_t    *video_8togs          = NULL;
 uint32_t    *video_8to32          = NULL;
 uint32_t    *video_15to32         = NULL;
 uint32_t    *video_16to32         = NULL;
+uint32_t     video_font_mask[256][8];
+const uint32_t video_plane_mask[16] = {
+    0x00000000, 0x000000ff, 0x0000ff00, 0x0000ffff,
+    0x00ff0000, 0x00ff00ff, 0x00ffff00, 0x00ffffff,
+    0xff000000, 0xff0000ff, 0xff00ff00, 0xff00ffff,
+    0xffff0000, 0xffff00ff, 0xffffff00, 0xffffffff
+};
+atomic_int   video_overloaded     = 0;
+atomic_int   video_minimized      = 0;
 monitor_t          monitors[MONITORS_NUM];
 monitor_settings_t monitor_settings[MONITORS_NUM];
 atomic_bool        doresize_monitors[MONITORS_NUM];
@@ -418,6 +427,264 @@ video_screenshot(uint32_t *buf, int start_x, int start_y, int row_len)
     video_screenshot_monitor(buf, start_x, start_y, row_len, 0);
 }
 
+/*
+ * Colour transform kernels for the inverted and monochrome display modes.
+ *
+ * Everything that depends on the display settings is resolved once by
+ * video_color_transform_update(): the per-channel luma weights, the divisor
+ * and the final luma to output colour table (with the inversion folded in).
+ * The kernels themselves only differ in whether the output is a plain gray
+ * (and can be built in registers) or has to go through the shade table.
+ * Their output is identical to video_color_transform().
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define VIDEO_TRANSFORM_SSE2
+#    include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#    define VIDEO_TRANSFORM_NEON
+#    include <arm_neon.h>
+#endif
+
+typedef void (*video_transform_kernel_t)(uint32_t *dst, const uint32_t *src, size_t count);
+
+static uint16_t                 video_transform_luma_r[256];
+static uint16_t                 video_transform_luma_g[256];
+static uint16_t                 video_transform_luma_b[256];
+static uint32_t                 video_transform_lut[256];
+static uint8_t                  video_transform_w[3];
+static uint32_t                 video_transform_xor;
+static video_transform_kernel_t video_transform_kernel;
+
+/* Both divisions are exact over the range of weighted sums they receive:
+   at most 255 * 255 for the weighted types and 3 * 255 for the average. */
+static __inline uint32_t
+video_transform_div255(uint32_t sum)
+{
+    return (sum + (sum >> 8) + 1) >> 8;
+}
+
+static __inline uint32_t
+video_transform_div3(uint32_t sum)
+{
+    return (sum * 0xaaab) >> 17;
+}
+
+static __inline uint32_t
+video_transform_luma(uint32_t color, const int avg)
+{
+    uint32_t sum = video_transform_luma_r[(color >> 16) & 0xff] + video_transform_luma_g[(color >> 8) & 0xff] + video_transform_luma_b[color & 0xff];
+
+    return avg ? video_transform_div3(sum) : video_transform_div255(sum);
+}
+
+static void
+video_transform_invert(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(VIDEO_TRANSFORM_SSE2)
+    const __m128i mask = _mm_set1_epi32(0x00ffffff);
+
+    for (; (i + 4) <= count; i += 4)
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_xor_si128(_mm_loadu_si128((const __m128i *) &src[i]), mask));
+#elif defined(VIDEO_TRANSFORM_NEON)
+    const uint32x4_t mask = vdupq_n_u32(0x00ffffff);
+
+    for (; (i + 4) <= count; i += 4)
+        vst1q_u32(&dst[i], veorq_u32(vld1q_u32(&src[i]), mask));
+#endif
+
+    for (; i < count; i++)
+        dst[i] = src[i] ^ 0x00ffffff;
+}
+
+static __inline void
+video_transform_gray(uint32_t *dst, const uint32_t *src, size_t count, const int avg, const int direct)
+{
+    size_t i = 0;
+
+#if defined(VIDEO_TRANSFORM_SSE2)
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i w_r  = _mm_set1_epi32(video_transform_w[0]);
+    const __m128i w_g  = _mm_set1_epi32(video_transform_w[1]);
+    const __m128i w_b  = _mm_set1_epi32(video_transform_w[2]);
+    const __m128i one  = _mm_set1_epi32(1);
+    const __m128i inv  = _mm_set1_epi32(video_transform_xor);
+    uint32_t      luma[4];
+
+    for (; (i + 4) <= count; i += 4) {
+        const __m128i px = _mm_loadu_si128((const __m128i *) &src[i]);
+        /* All products fit in 16 bits and the high halves are zero, so
+           the 16-bit multiplies give the full 32-bit result. */
+        __m128i sum = _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(px, 16), mask), w_r);
+        sum         = _mm_add_epi32(sum, _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(px, 8), mask), w_g));
+        sum         = _mm_add_epi32(sum, _mm_mullo_epi16(_mm_and_si128(px, mask), w_b));
+
+        __m128i v;
+        if (avg)
+            v = _mm_srli_epi32(_mm_mulhi_epu16(sum, _mm_set1_epi32(0xaaab)), 1);
+        else
+            v = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 8)), one), 8);
+
+        if (direct) {
+            v = _mm_or_si128(_mm_or_si128(v, _mm_slli_epi32(v, 8)), _mm_slli_epi32(v, 16));
+            _mm_storeu_si128((__m128i *) &dst[i], _mm_xor_si128(v, inv));
+        } else {
+            _mm_storeu_si128((__m128i *) luma, v);
+            dst[i]     = video_transform_lut[luma[0]];
+            dst[i + 1] = video_transform_lut[luma[1]];
+            dst[i + 2] = video_transform_lut[luma[2]];
+            dst[i + 3] = video_transform_lut[luma[3]];
+        }
+    }
+#elif defined(VIDEO_TRANSFORM_NEON)
+    const uint8x8_t  w_r = vdup_n_u8(video_transform_w[0]);
+    const uint8x8_t  w_g = vdup_n_u8(video_transform_w[1]);
+    const uint8x8_t  w_b = vdup_n_u8(video_transform_w[2]);
+    const uint8x16_t inv = vdupq_n_u8(video_transform_xor & 0xff);
+    uint8_t          luma[16];
+
+    for (; (i + 16) <= count; i += 16) {
+        /* Little-endian 0x00RRGGBB pixels deinterleave into B, G, R, A. */
+        uint8x16x4_t px = vld4q_u8((const uint8_t *) &src[i]);
+        uint16x8_t   lo = vmull_u8(vget_low_u8(px.val[2]), w_r);
+        uint16x8_t   hi = vmull_u8(vget_high_u8(px.val[2]), w_r);
+        lo              = vmlal_u8(lo, vget_low_u8(px.val[1]), w_g);
+        hi              = vmlal_u8(hi, vget_high_u8(px.val[1]), w_g);
+        lo              = vmlal_u8(lo, vget_low_u8(px.val[0]), w_b);
+        hi              = vmlal_u8(hi, vget_high_u8(px.val[0]), w_b);
+
+        if (avg) {
+            lo = vcombine_u16(vshrn_n_u32(vmull_n_u16(vget_low_u16(lo), 0xaaab), 16),
+                              vshrn_n_u32(vmull_n_u16(vget_high_u16(lo), 0xaaab), 16));
+            hi = vcombine_u16(vshrn_n_u32(vmull_n_u16(vget_low_u16(hi), 0xaaab), 16),
+                              vshrn_n_u32(vmull_n_u16(vget_high_u16(hi), 0xaaab), 16));
+            lo = vshrq_n_u16(lo, 1);
+            hi = vshrq_n_u16(hi, 1);
+        } else {
+            lo = vshrq_n_u16(vaddq_u16(vaddq_u16(lo, vshrq_n_u16(lo, 8)), vdupq_n_u16(1)), 8);
+            hi = vshrq_n_u16(vaddq_u16(vaddq_u16(hi, vshrq_n_u16(hi, 8)), vdupq_n_u16(1)), 8);
+        }
+
+        const uint8x16_t v = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+
+        if (direct) {
+            px.val[0] = px.val[1] = px.val[2] = veorq_u8(v, inv);
+            px.val[3]                         = vdupq_n_u8(0);
+            vst4q_u8((uint8_t *) &dst[i], px);
+        } else {
+            vst1q_u8(luma, v);
+            for (int j = 0; j < 16; j++)
+                dst[i + j] = video_transform_lut[luma[j]];
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+        dst[i] = video_transform_lut[video_transform_luma(src[i], avg)];
+}
+
+static void
+video_transform_gray_direct(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    video_transform_gray(dst, src, count, 0, 1);
+}
+
+static void
+video_transform_gray_direct_avg(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    video_transform_gray(dst, src, count, 1, 1);
+}
+
+static void
+video_transform_gray_lut(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    video_transform_gray(dst, src, count, 0, 0);
+}
+
+static void
+video_transform_gray_lut_avg(uint32_t *dst, const uint32_t *src, size_t count)
+{
+    video_transform_gray(dst, src, count, 1, 0);
+}
+
+#ifdef ENABLE_VIDEO_LOG
+static void
+video_color_transform_verify(void)
+{
+    uint32_t src[259];
+    uint32_t dst[259];
+    uint32_t seed   = 0x12345678;
+    int      errors = 0;
+
+    /* Every channel value on its own, then a pseudo-random mix; the odd
+       length exercises the scalar tail of the kernels as well. */
+    for (int i = 0; i < 256; i++)
+        src[i] = (i << 16) | ((255 - i) << 8) | (i ^ 0x5a) | ((i & 1) << 24);
+    for (int i = 256; i < 259; i++) {
+        seed   = (seed * 1103515245) + 12345;
+        src[i] = seed;
+    }
+
+    video_transform_kernel(dst, src, 259);
+
+    for (int i = 0; i < 259; i++) {
+        if (dst[i] != video_color_transform(src[i]))
+            errors++;
+    }
+
+    if (errors)
+        video_log("Colour transform kernel mismatch: %i pixels differ from the reference\n", errors);
+}
+#endif
+
+/* Rebuild the colour transform state after a change to video_grayscale,
+   video_graytype or invert_display; the caller holds the blit lock. */
+void
+video_color_transform_update(void)
+{
+    const int avg    = (video_graytype == 2);
+    const int direct = (video_grayscale < 2);
+
+    if (video_graytype == 1) {
+        video_transform_w[0] = 54;
+        video_transform_w[1] = 183;
+        video_transform_w[2] = 18;
+    } else if (avg) {
+        video_transform_w[0] = video_transform_w[1] = video_transform_w[2] = 1;
+    } else {
+        video_transform_w[0] = 76;
+        video_transform_w[1] = 150;
+        video_transform_w[2] = 29;
+    }
+
+    for (int c = 0; c < 256; c++) {
+        video_transform_luma_r[c] = video_transform_w[0] * c;
+        video_transform_luma_g[c] = video_transform_w[1] * c;
+        video_transform_luma_b[c] = video_transform_w[2] * c;
+    }
+
+    video_transform_xor = invert_display ? 0x00ffffff : 0x00000000;
+
+    for (int c = 0; c < 256; c++)
+        video_transform_lut[c] = (direct ? (c * 0x010101) : shade[video_grayscale][c]) ^ video_transform_xor;
+
+    if (video_grayscale) {
+        if (direct)
+            video_transform_kernel = avg ? video_transform_gray_direct_avg : video_transform_gray_direct;
+        else
+            video_transform_kernel = avg ? video_transform_gray_lut_avg : video_transform_gray_lut;
+    } else
+        video_transform_kernel = video_transform_invert;
+
+    video_copy = (video_grayscale || invert_display) ? video_transform_copy : memcpy;
+
+#ifdef ENABLE_VIDEO_LOG
+    if (video_copy != memcpy)
+        video_color_transform_verify();
+#endif
+}
+
 #ifdef _WIN32
 void *__cdecl video_transform_copy(void *_Dst, const void *_Src, size_t _Size)
 #else
@@ -425,20 +692,46 @@ void *
 video_transform_copy(void *__restrict _Dst, const void *__restrict _Src, size_t _Size)
 #endif
 {
-    uint32_t       *dest_ex = (uint32_t *) _Dst;
-    const uint32_t *src_ex  = (const uint32_t *) _Src;
+    if ((_Dst != NULL) && (_Src != NULL))
+        video_transform_kernel((uint32_t *) _Dst, (const uint32_t *) _Src, _Size / sizeof(uint32_t));
 
-    _Size /= sizeof(uint32_t);
+    return _Dst;
+}
 
-    if ((dest_ex != NULL) && (src_ex != NULL)) {
-        for (size_t i = 0; i < _Size; i++) {
-            *dest_ex = video_color_transform(*src_ex);
-            dest_ex++;
-            src_ex++;
-        }
+/* Called by the video card once per frame, at the point where it has just
+   blitted (or skipped) the previous frame. Returns 1 if the coming frame should
+   neither be rendered nor blitted; the card keeps running its timings and
+   raising its status bits and interrupts as usual. While the emulator is not
+   keeping up, at most VIDEO_FRAMESKIP_MAX frames in a row are skipped so the
+   screen keeps updating; while the window is minimized, or there is no
+   renderer to blit to at all, every frame is. */
+int
+video_frame_skip_monitor(int monitor_index)
+{
+    monitor_t *monitor = &monitors[monitor_index];
+    int        hidden  = atomic_load(&video_minimized) || (blit_func == NULL);
+
+    if (!video_frameskip || atomic_load(&monitor->mon_screenshots) ||
+        !(hidden || (atomic_load(&video_overloaded) && (monitor->mon_frameskip_run < VIDEO_FRAMESKIP_MAX)))) {
+        monitor->mon_frameskip_run = 0;
+        return 0;
     }
 
-    return _Dst;
+    monitor->mon_frameskip_run++;
+    atomic_fetch_add(&monitor->mon_frames_skipped, 1);
+    return 1;
+}
+
+/* Frames skipped so far, summed over all monitors. */
+int
+video_frames_skipped(void)
+{
+    int total = 0;
+
+    for (int i = 0; i < MONITORS_NUM; i++)
+        total += atomic_load(&monitors[i].mon_frames_skipped);
+
+    return total;
 }
 
 static void
@@ -870,6 +1163,8 @@ video_monitor_init(int index)
     monitors[index].mon_vid_type                         = VIDEO_FLAG_TYPE_NONE;
     atomic_init(&doresize_monitors[index], 0);
     atomic_init(&monitors[index].mon_screenshots, 0);
+    atomic_init(&monitors[index].mon_frames_skipped, 0);
+    monitors[index].mon_frameskip_run = 0;
     if (index >= 1)
         ui_init_monitor(index);
     monitors[index].mon_blit_data_ptr->blit_thread = thread_create(blit_thread, monitors[index].mon_blit_data_ptr);
@@ -947,6 +1242,11 @@ video_init(void)
             egaremap2bpp[c] |= 0x08;
     }
 
+    for (uint16_t c = 0; c < 256; c++) {
+        for (uint8_t d = 0; d < 8; d++)
+            video_font_mask[c][d] = (c & (0x80 >> d)) ? 0xffffffff : 0x00000000;
+    }
+
     video_6to8 = malloc(4 * 256);
     for (uint16_t c = 0; c < 256; c++)
         video_6to8[c] = calc_6to8(c);